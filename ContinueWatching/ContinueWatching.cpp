@@ -33,6 +33,9 @@
   * This service will be enabled/disabled using an TR181 parameter.
   */
 #include <iomanip>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
 
 #include "ContinueWatching.h"
 
@@ -83,6 +86,7 @@ namespace WPEFramework {
 		ContinueWatching::~ContinueWatching()
 		{
 			LOGINFO();
+			ContinueWatchingTokenStore::getInstance().flush();
 			ContinueWatching::_instance = nullptr;
 		}
 
@@ -473,149 +477,336 @@ namespace WPEFramework {
 		}
 
 		/**
-		 * @brief This function is used to write the protectedData into file.
+		 * @brief Returns the process wide token store.
 		 *
-		 * @param[in] protectedData Variable of string.
+		 * @return ContinueWatchingTokenStore&.
+		 */
+		ContinueWatchingTokenStore& ContinueWatchingTokenStore::getInstance()
+		{
+			static ContinueWatchingTokenStore instance;
+			return instance;
+		}
+
+		/**
+		 * @brief Class ContinueWatchingTokenStore Constructor.
 		 *
-		 * @return True if it able to write data into file.
+		 * @return None.
 		 */
-		bool ContinueWatchingImpl::writeToJson(std::string protectedData)
+		ContinueWatchingTokenStore::ContinueWatchingTokenStore()
+		: m_generation(0)
+		, m_persistedGeneration(0)
+		, m_loaded(false)
+		, m_stop(false)
 		{
-			char *jsonDoc = NULL;
-			char *jsonOut = NULL;
-			cJSON *root = NULL;
-			bool createNewJsonDoc = true;
+		}
+
+		/**
+		 * @brief Class ContinueWatchingTokenStore Destructor.
+		 *
+		 * @return None.
+		 */
+		ContinueWatchingTokenStore::~ContinueWatchingTokenStore()
+		{
+			flush();
+		}
+
+		/**
+		 * @brief This function is used to parse CW_LOCAL_FILE into the in-memory index.
+		 * It is only done once; m_mutex must be held by the caller.
+		 *
+		 * @return None.
+		 */
+		void ContinueWatchingTokenStore::loadLocked()
+		{
+			if (m_loaded)
+				return;
+			m_loaded = true;
 
 			FILE *file = fopen(CW_LOCAL_FILE, "r");
-			if (file) {
-				fseek(file, 0, SEEK_END);
-				long numbytes = ftell(file);
-				jsonDoc = (char*)malloc(sizeof(char)*(numbytes + 1));
-				if(jsonDoc == NULL) {
-					return false;
-				}
+			if (!file)
+				return;
 
-				fseek(file, 0, SEEK_SET);
-				fread(jsonDoc, numbytes, 1, file);
+			fseek(file, 0, SEEK_END);
+			long numbytes = ftell(file);
+			if (numbytes <= 0) {
 				fclose(file);
-				file = NULL;
-				jsonDoc[numbytes] = 0;
-
-				root = cJSON_Parse(jsonDoc);
-				cJSON *tokens = cJSON_GetObjectItem(root, "tokens");
-				if (tokens) {
-					int i;
-					bool tokenUpdated = false;
-					int tokensCount = cJSON_GetArraySize(tokens);
-					createNewJsonDoc = false;
-					for (i = 0; i < tokensCount; i++) {
-						cJSON *token = cJSON_GetArrayItem(tokens, i);
-						cJSON *item = cJSON_GetObjectItem(token, "applicationName");
-						if (item) {
-							//updating token data
-							if (strcmp(item->valuestring, mStrApplicationName.c_str()) == 0) {
-								tokenUpdated = true;
-								cJSON_ReplaceItemInObject(token, "encryptedData", cJSON_CreateString(protectedData.c_str()));
-				 				break;
-							}
-						}
-					}
+				return;
+			}
+
+			std::string jsonDoc(numbytes, '\0');
+			fseek(file, 0, SEEK_SET);
+			size_t bytesRead = fread(&jsonDoc[0], 1, numbytes, file);
+			fclose(file);
+			jsonDoc.resize(bytesRead);
 
-					//Adding new entry to list
-					if(!tokenUpdated) {
-						cJSON *jsonItem = cJSON_CreateObject();
+			cJSON *root = cJSON_Parse(jsonDoc.c_str());
+			if (!root) {
+				LOGERR("Failed to parse %s\n", CW_LOCAL_FILE);
+				return;
+			}
 
-						cJSON_AddItemToObject(jsonItem, "applicationName", cJSON_CreateString(mStrApplicationName.c_str()));
-						cJSON_AddItemToObject(jsonItem, "encryptedData", cJSON_CreateString(protectedData.c_str()));
-						cJSON_AddItemToArray(tokens, jsonItem);
-					}
+			cJSON *tokens = cJSON_GetObjectItem(root, "tokens");
+			int tokensCount = cJSON_GetArraySize(tokens);
+			for (int i = 0; i < tokensCount; i++) {
+				cJSON *token = cJSON_GetArrayItem(tokens, i);
+				cJSON *item = cJSON_GetObjectItem(token, "applicationName");
+				cJSON *encryptedDataItem = cJSON_GetObjectItem(token, "encryptedData");
+				if (item && item->valuestring && encryptedDataItem && encryptedDataItem->valuestring) {
+					m_tokens[item->valuestring] = encryptedDataItem->valuestring;
 				}
-				free(jsonDoc);
-				jsonDoc = NULL;
 			}
+			cJSON_Delete(root);
+		}
 
-			if (createNewJsonDoc) {
-				cJSON *tokenArray;
-				cJSON *jsonItem;
+		/**
+		 * @brief This function is used to look up the encrypted token of an application.
+		 *
+		 * @param[in] applicationName Name of the application.
+		 * @param[out] encryptedData Encrypted token data.
+		 *
+		 * @return True if a token is stored for the application.
+		 */
+		bool ContinueWatchingTokenStore::get(const std::string& applicationName, std::string& encryptedData)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			loadLocked();
+			auto it = m_tokens.find(applicationName);
+			if (it == m_tokens.end())
+				return false;
+			encryptedData = it->second;
+			return true;
+		}
 
-				root  = cJSON_CreateObject();
-				tokenArray=  cJSON_CreateArray();
-				cJSON_AddItemToObject(root, "tokens", tokenArray);
-				jsonItem = cJSON_CreateObject();
-				cJSON_AddItemToObject(jsonItem, "applicationName", cJSON_CreateString(mStrApplicationName.c_str()));
-				cJSON_AddItemToObject(jsonItem, "encryptedData", cJSON_CreateString(protectedData.c_str()));
-				cJSON_AddItemToArray(tokenArray, jsonItem);
+		/**
+		 * @brief This function is used to add or replace the encrypted token of an application.
+		 *
+		 * @param[in] applicationName Name of the application.
+		 * @param[in] encryptedData Encrypted token data.
+		 *
+		 * @return True if the update was persisted (or queued for persistence); on failure the
+		 * previous token is restored.
+		 */
+		bool ContinueWatchingTokenStore::set(const std::string& applicationName, const std::string& encryptedData)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			loadLocked();
+			auto it = m_tokens.find(applicationName);
+			bool existed = (it != m_tokens.end());
+			std::string previous = existed ? it->second : std::string();
+			m_tokens[applicationName] = encryptedData;
+			m_generation++;
+			if (commit(lock))
+				return true;
+
+			// Not persisted: put the previous token back unless someone changed it meanwhile.
+			lock.lock();
+			it = m_tokens.find(applicationName);
+			if (it != m_tokens.end() && it->second == encryptedData) {
+				if (existed)
+					it->second = previous;
+				else
+					m_tokens.erase(it);
+				m_generation++;
 			}
+			return false;
+		}
 
-			jsonOut = cJSON_Print(root);
-			cJSON_Delete(root);
-
-			file = fopen(CW_LOCAL_FILE, "w");
-			if (!file) {
-				free(jsonOut);
-				jsonOut = NULL;
+		/**
+		 * @brief This function is used to remove the encrypted token of an application.
+		 *
+		 * @param[in] applicationName Name of the application.
+		 *
+		 * @return True if a token was removed and the update was persisted (or queued for persistence).
+		 */
+		bool ContinueWatchingTokenStore::erase(const std::string& applicationName)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			loadLocked();
+			auto it = m_tokens.find(applicationName);
+			if (it == m_tokens.end())
 				return false;
+			std::string previous = it->second;
+			m_tokens.erase(it);
+			m_generation++;
+			if (commit(lock))
+				return true;
+
+			// Not persisted: put the token back unless someone set a new one meanwhile.
+			lock.lock();
+			if (m_tokens.find(applicationName) == m_tokens.end()) {
+				m_tokens[applicationName] = previous;
+				m_generation++;
 			}
+			return false;
+		}
 
-			fprintf(file, "%s", jsonOut);
+		/**
+		 * @brief This function is used to write any pending update and stop the writer thread.
+		 *
+		 * @return None.
+		 */
+		void ContinueWatchingTokenStore::flush()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stop = true;
+			}
+			m_cond.notify_all();
+			if (m_writer.joinable())
+				m_writer.join();
 
-			fclose (file);
-			file = NULL;
-			free(jsonOut);
-			jsonOut = NULL;
+			persist();
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = false;
+		}
 
+		/**
+		 * @brief This function is used to persist an update, either right away or
+		 * through the writer thread when CW_PERSIST_DELAY_MS is set.
+		 *
+		 * @param[in] lock Lock on m_mutex held by the caller; it is released.
+		 *
+		 * @return True if the update was persisted (or queued for persistence).
+		 */
+		bool ContinueWatchingTokenStore::commit(std::unique_lock<std::mutex>& lock)
+		{
+		#if CW_PERSIST_DELAY_MS > 0
+			if (!m_writer.joinable())
+				m_writer = std::thread(&ContinueWatchingTokenStore::writerLoop, this);
+			lock.unlock();
+			m_cond.notify_one();
 			return true;
+		#else
+			lock.unlock();
+			return persist();
+		#endif
 		}
 
 		/**
-		 * @brief This function is used to read the protectedData from file.
+		 * @brief Writer thread; coalesces the updates made within CW_PERSIST_DELAY_MS into one write.
 		 *
-		 * @return protectedData.
+		 * @return None.
 		 */
-		std::string ContinueWatchingImpl::readFromJson()
+		void ContinueWatchingTokenStore::writerLoop()
 		{
-			char *jsonDoc = NULL;
-			std::string retVal = "";
-			FILE *file = fopen(CW_LOCAL_FILE, "r");
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (!m_stop) {
+				m_cond.wait(lock, [this] { return m_stop || (m_generation != m_persistedGeneration); });
+				if (m_stop)
+					break;
+
+				m_cond.wait_for(lock, std::chrono::milliseconds(CW_PERSIST_DELAY_MS), [this] { return m_stop; });
+				if (m_stop)
+					break;
+
+				lock.unlock();
+				persist();
+				lock.lock();
+			}
+		}
 
-			if (!file)
-				return retVal;
+		/**
+		 * @brief This function is used to write the in-memory index to CW_LOCAL_FILE.
+		 * The document is written to a temp file, synced and renamed over the old file.
+		 *
+		 * @return True if the file is up to date.
+		 */
+		bool ContinueWatchingTokenStore::persist()
+		{
+			std::lock_guard<std::mutex> fileLock(m_fileMutex);
+			uint64_t generation;
+			char *jsonOut = NULL;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (m_generation == m_persistedGeneration)
+					return true;
+				generation = m_generation;
 
-			fseek(file, 0, SEEK_END);
-			long numbytes = ftell(file);
-			jsonDoc = (char*)malloc(sizeof(char)*(numbytes + 1));
-			if(jsonDoc == NULL) {
-				return retVal;
+				cJSON *root = cJSON_CreateObject();
+				cJSON *tokenArray = cJSON_CreateArray();
+				cJSON_AddItemToObject(root, "tokens", tokenArray);
+				for (auto it = m_tokens.begin(); it != m_tokens.end(); ++it) {
+					cJSON *jsonItem = cJSON_CreateObject();
+					cJSON_AddItemToObject(jsonItem, "applicationName", cJSON_CreateString(it->first.c_str()));
+					cJSON_AddItemToObject(jsonItem, "encryptedData", cJSON_CreateString(it->second.c_str()));
+					cJSON_AddItemToArray(tokenArray, jsonItem);
+				}
+				jsonOut = cJSON_Print(root);
+				cJSON_Delete(root);
 			}
 
-			fseek(file, 0, SEEK_SET);
-			fread(jsonDoc, 1, numbytes, file);
-			fclose(file);
-			jsonDoc[numbytes] = '\0';
-
-			cJSON *root = cJSON_Parse(jsonDoc);
-			cJSON *tokens = cJSON_GetObjectItem(root, "tokens");
-			int tokensCount = cJSON_GetArraySize(tokens);
-			int i;
+			if (!jsonOut)
+				return false;
 
-			for (i = 0; i < tokensCount; i++) {
-				cJSON *token = cJSON_GetArrayItem(tokens, i);
-				cJSON *item = cJSON_GetObjectItem(token, "applicationName");
-				if (item) {
-					if (strcmp(item->valuestring, mStrApplicationName.c_str()) == 0) {
-						cJSON *encrypteDataItem = cJSON_GetObjectItem(token, "encryptedData");
-						if (encrypteDataItem){
-							retVal = encrypteDataItem->valuestring;
-						}
+			std::string tmpFile = std::string(CW_LOCAL_FILE) + ".tmp";
+			bool retVal = false;
+			int fd = open(tmpFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			if (fd >= 0) {
+				size_t length = strlen(jsonOut);
+				size_t offset = 0;
+				while (offset < length) {
+					ssize_t written = write(fd, jsonOut + offset, length - offset);
+					if (written < 0) {
+						if (errno == EINTR)
+							continue;
 						break;
 					}
+					offset += written;
+				}
+				retVal = (offset == length) && (fsync(fd) == 0);
+				close(fd);
+
+				if (retVal && rename(tmpFile.c_str(), CW_LOCAL_FILE) != 0)
+					retVal = false;
+
+				if (retVal) {
+					// Make the rename itself durable.
+					std::string dir(CW_LOCAL_FILE);
+					dir = dir.substr(0, dir.find_last_of('/') + 1);
+					int dirFd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+					if (dirFd >= 0) {
+						fsync(dirFd);
+						close(dirFd);
+					}
+				}
+				else {
+					unlink(tmpFile.c_str());
 				}
 			}
-			cJSON_Delete(root);
-			root = NULL;
-			free(jsonDoc);
-			root = NULL;
+			free(jsonOut);
+
+			if (!retVal) {
+				LOGERR("Failed to persist %s errno %d\n", CW_LOCAL_FILE, errno);
+				return false;
+			}
 
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_persistedGeneration = generation;
+			return true;
+		}
+
+		/**
+		 * @brief This function is used to write the protectedData into file.
+		 *
+		 * @param[in] protectedData Variable of string.
+		 *
+		 * @return True if it able to write data into file.
+		 */
+		bool ContinueWatchingImpl::writeToJson(std::string protectedData)
+		{
+			return ContinueWatchingTokenStore::getInstance().set(mStrApplicationName, protectedData);
+		}
+
+		/**
+		 * @brief This function is used to read the protectedData from file.
+		 *
+		 * @return protectedData.
+		 */
+		std::string ContinueWatchingImpl::readFromJson()
+		{
+			std::string retVal = "";
+			ContinueWatchingTokenStore::getInstance().get(mStrApplicationName, retVal);
 			return retVal;
 		}
 
@@ -626,74 +817,12 @@ namespace WPEFramework {
 		 */
 		bool ContinueWatchingImpl::deleteToken()
 		{
-			char *jsonDoc = NULL;
-			char *jsonOut = NULL;
-			cJSON *root = NULL;
-			bool retVal = false;
-
 			if(!tr181FeatureEnabled()) {
 				LOGWARN("Feature DISABLED...\n");
 				return false;
 			}
 
-			FILE *file = fopen(CW_LOCAL_FILE, "r");
-			if (!file)
-				return retVal;
-
-			fseek(file, 0, SEEK_END);
-			long numbytes = ftell(file);
-			jsonDoc = (char*)malloc(sizeof(char)*(numbytes + 1));
-			if(jsonDoc==NULL) {
-				return false;
-			}
-			fseek(file, 0, SEEK_SET);
-			fread(jsonDoc, numbytes, 1, file);
-			fclose(file);
-			file = NULL;
-			jsonDoc[numbytes] = 0;
-
-			root = cJSON_Parse(jsonDoc);
-			cJSON *tokens = cJSON_GetObjectItem(root, "tokens");
-			if (tokens) {
-				int i;
-				int tokensCount = cJSON_GetArraySize(tokens);
-				for (i = 0; i < tokensCount; i++) {
-					cJSON *token = cJSON_GetArrayItem(tokens, i);
-					cJSON *item = cJSON_GetObjectItem(token, "applicationName");
-					if (item) {
-						if (strcmp(item->valuestring, mStrApplicationName.c_str()) == 0) {
-							retVal = true;
-							cJSON_DeleteItemFromArray(tokens, i);
-							break;
-						}
-					}
-				}
-			}
-			free(jsonDoc);
-			jsonDoc = NULL;
-
-			if (!retVal) {
-				cJSON_Delete(root);
-				return retVal;
-			}
-
-			jsonOut = cJSON_Print(root);
-			cJSON_Delete(root);
-
-			file = fopen(CW_LOCAL_FILE, "w");
-			if (!file) {
-				free(jsonOut);
-				jsonOut = NULL;
-				retVal = false;
-				return retVal;
-			}
-
-			fprintf(file, "%s", jsonOut);
-			fclose (file);
-			file = NULL;
-			free(jsonOut);
-			jsonOut = NULL;
-			return true;
+			return ContinueWatchingTokenStore::getInstance().erase(mStrApplicationName);
 		}
 
 		/**
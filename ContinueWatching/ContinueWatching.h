@@ -40,6 +40,9 @@
 
 #include <string.h>
 #include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
 #include "Module.h"
 #include "utils.h"
 #if !defined(DISABLE_SECAPI)
@@ -52,6 +55,12 @@
 #define CW_LOCAL_FILE  "/opt/continuewatching.json"
 #define NETFLIX_CONTINUEWATCHING_APP_NAME  "netflix"
 
+// Delay used to coalesce several token updates into a single file write.
+// 0 keeps writes synchronous so that set/delete report the persistence result.
+#ifndef CW_PERSIST_DELAY_MS
+#define CW_PERSIST_DELAY_MS 0
+#endif
+
 namespace WPEFramework {
 
 	namespace Plugin {
@@ -97,6 +106,45 @@ namespace WPEFramework {
 			uint32_t m_apiVersionNumber;
 	        };
 
+		/**
+		* @brief In-memory index of application name to encrypted token, backed by CW_LOCAL_FILE.
+		*
+		* The file is parsed once; lookups never touch the file system. Updates are
+		* persisted by writing a temp file, fsync'ing it and renaming it over CW_LOCAL_FILE
+		* so a crash during the write never leaves a truncated document behind.
+		**/
+		class ContinueWatchingTokenStore
+		{
+		public:
+			static ContinueWatchingTokenStore& getInstance();
+
+			bool get(const std::string& applicationName, std::string& encryptedData);
+			bool set(const std::string& applicationName, const std::string& encryptedData);
+			bool erase(const std::string& applicationName);
+			void flush();
+
+		private:
+			ContinueWatchingTokenStore();
+			~ContinueWatchingTokenStore();
+			ContinueWatchingTokenStore(const ContinueWatchingTokenStore&) = delete;
+			ContinueWatchingTokenStore& operator=(const ContinueWatchingTokenStore&) = delete;
+
+			void loadLocked();
+			bool commit(std::unique_lock<std::mutex>& lock);
+			bool persist();
+			void writerLoop();
+
+			std::mutex m_mutex;
+			std::mutex m_fileMutex;
+			std::condition_variable m_cond;
+			std::thread m_writer;
+			std::unordered_map<std::string, std::string> m_tokens;
+			uint64_t m_generation;
+			uint64_t m_persistedGeneration;
+			bool m_loaded;
+			bool m_stop;
+		};
+
 		/**
 		* @brief Class declaration for ContinueWatching Implementation
 		**/
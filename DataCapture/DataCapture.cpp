@@ -63,6 +63,45 @@ namespace WPEFramework {
             while (dir.Next()) Core::File(AUDIOCAPTUREMGR_FILE_PATH + dir.Name()).Destroy();
         }
 
+        // Replaces the value of the query parameter name in url, if the url has that parameter
+        static bool setQueryParameter(string &url, const string &name, const string &value)
+        {
+            size_t start = url.find('?');
+            if (string::npos == start)
+                return false;
+
+            size_t end = url.find('#', start);
+            if (string::npos == end)
+                end = url.size();
+
+            for (start++; start < end; )
+            {
+                size_t next = url.find('&', start);
+                if (string::npos == next || next > end)
+                    next = end;
+
+                size_t equals = url.find('=', start);
+                if (string::npos != equals && equals < next && 0 == url.compare(start, equals - start, name))
+                {
+                    url.replace(equals + 1, next - equals - 1, value);
+                    return true;
+                }
+                start = next + 1;
+            }
+            return false;
+        }
+
+        // Format of an uploaded clip as the "codec" query value, same layout as constructFormatString(): PCM_16_48000, FLAC_1_16_16000, ...
+        static string codecQueryValue(const char *codec, const audio_encoder::format_t &format)
+        {
+            string value(codec);
+            value += "_";
+            if (2 != format.channels)
+                value += std::to_string(format.channels) + "_";
+            value += std::to_string(format.bits_per_sample) + "_" + std::to_string(format.sample_rate);
+            return value;
+        }
+
         SERVICE_REGISTRATION(DataCapture, 1, 0);
 
         DataCapture* DataCapture::_instance = nullptr;
@@ -72,6 +111,10 @@ namespace WPEFramework {
             , _session_id(-1)
             , _max_supported_duration(0)
             , _is_precapture(false)
+            , _is_streaming(false)
+            , _audio_format()
+            , _codec(audio_encoder::PCM)
+            , _downmix(false)
             , _duration(0)
         {
             LOGINFO("ctor");
@@ -307,9 +350,21 @@ namespace WPEFramework {
             _duration = (unsigned int)clipRequest["duration"].Number();
             const string& captureMode = clipRequest["captureMode"].String();
             _is_precapture = (captureMode == "preCapture");
+            // Stream the clip from the socket straight into a chunked upload if asked to
+            _is_streaming = clipRequest.HasLabel("streaming") && clipRequest["streaming"].Boolean();
+            // Optionally encode it (and downmix to 16 kHz mono) on the way
+            const string codec = clipRequest.HasLabel("codec") ? clipRequest["codec"].String() : string("pcm");
+            _downmix = clipRequest.HasLabel("downmix") && clipRequest["downmix"].Boolean();
 
-            LOGINFO("DataCaptureService calling getAudioClip: stream = %s, url = %s, duration = %d, captureMode = %s, session id = %d",
-                         stream.c_str(), _destination_url.c_str(), _duration, captureMode.c_str(), _session_id);
+            LOGINFO("DataCaptureService calling getAudioClip: stream = %s, url = %s, duration = %d, captureMode = %s, streaming = %d, codec = %s, downmix = %d, session id = %d",
+                         stream.c_str(), _destination_url.c_str(), _duration, captureMode.c_str(), _is_streaming, codec.c_str(), _downmix, _session_id);
+
+            if(!audio_encoder::parse_codec(codec, _codec) || !audio_encoder::is_supported(_codec))
+            {
+                LOGERR("Codec %s is not supported.", codec.c_str());
+                _codec = audio_encoder::PCM;
+                return ACM_RESULT_GENERAL_FAILURE;
+            }
 
             if(0 > _session_id)
             {
@@ -346,17 +401,22 @@ namespace WPEFramework {
         void DataCapture::constructFormatString()
         {
             _audio_format_string = "";
+            _audio_format = { 0, 0, 0 };
             switch(_audio_properties.format)
             {
                 case acmFormate16BitStereo:
+                    _audio_format.channels = 2; _audio_format.bits_per_sample = 16;
                     _audio_format_string += "codec=PCM_16_"; break;
                 case acmFormate16BitMonoLeft: //fall-through
                 case acmFormate16BitMonoRight: //fall-through
                 case acmFormate16BitMono:
+                    _audio_format.channels = 1; _audio_format.bits_per_sample = 16;
                     _audio_format_string += "codec=PCM_1_16_"; break;
                 case acmFormate24BitStereo:
+                    _audio_format.channels = 2; _audio_format.bits_per_sample = 24;
                     _audio_format_string += "codec=PCM_24_"; break;
                 case acmFormate24Bit5_1:
+                    _audio_format.channels = 6; _audio_format.bits_per_sample = 24;
                     _audio_format_string += "codec=PCM_6_24_"; break;
                 default:
                     LOGERR("Unsupported audio format!");
@@ -365,14 +425,19 @@ namespace WPEFramework {
             switch(_audio_properties.sampling_frequency)
             {
                 case acmFreqe48000:
+                    _audio_format.sample_rate = 48000;
                     _audio_format_string += "48000&"; break;
                 case acmFreqe44100:
+                    _audio_format.sample_rate = 44100;
                     _audio_format_string += "44100&"; break;
                 case acmFreqe32000:
+                    _audio_format.sample_rate = 32000;
                     _audio_format_string += "32000&"; break;
                 case acmFreqe24000:
+                    _audio_format.sample_rate = 24000;
                     _audio_format_string += "24000&"; break;
                 case acmFreqe16000:
+                    _audio_format.sample_rate = 16000;
                     _audio_format_string += "16000&"; break;
                 default:
                     LOGERR("Unsupported audio sampling rate!");
@@ -407,33 +472,68 @@ namespace WPEFramework {
                 string fileName;
                 pos = dataLocator.rfind(delimiter);
                 fileName = dataLocator.substr(pos + delimiter.length(), dataLocator.length());
-                int attemptsLeft = 2;
-                vector<unsigned char> data;
-                int time_wait_sec = 1;
 
                 JsonObject params;
                 params["fileName"] = fileName;
 
-                while (attemptsLeft) {
-                    if(0 == _sock_adaptor->connect_socket(payload->dataLocator))
+                if(connectToClip(payload->dataLocator))
+                {
+                    std::string error_str;
+                    bool uploaded = false;
+
+                    if (_codec != audio_encoder::PCM || _downmix)
                     {
-                        _sock_adaptor->get_data(data); // closes the socket
-                        if (data.size() > 0) {
-                            LOGINFO("Got a clip: %u bytes", data.size());
-                            break;
-                        } else {
-                            LOGWARN("No data in the socket. One more attempt in %d sec", time_wait_sec);
-                            usleep(1000 * 1000 * time_wait_sec);
-                            --attemptsLeft;
-                            continue;
+                        // The encoder reads the socket on its own thread, the upload takes what it produced so far
+                        audio_encoder encoder(_codec, _audio_format, _downmix);
+                        auto read = [&encoder](char *buffer, unsigned int size) { return encoder.read_data(buffer, size); };
+
+                        // The url describes the captured PCM, describe what is uploaded instead
+                        string url(_destination_url);
+                        const audio_encoder::format_t &output = encoder.get_output_format();
+                        setQueryParameter(url, "codec", codecQueryValue(encoder.get_codec_name(), output));
+                        setQueryParameter(url, "channels", std::to_string(output.channels));
+                        setQueryParameter(url, "rate", std::to_string(output.sample_rate));
+                        LOGINFO("Uploading the encoded clip to %s", url.c_str());
+
+                        if (0 != encoder.start(_sock_adaptor))
+                        {
+                            error_str = "encoder error";
+                        }
+                        else if (_is_streaming)
+                        {
+                            uploaded = uploadStreamToUrl(read, encoder.get_content_type(), url.c_str(), error_str);
                         }
+                        else
+                        {
+                            vector<unsigned char> data;
+                            char chunk[16 * 1024];
+                            int size;
+                            while ((size = read(chunk, sizeof(chunk))) > 0)
+                                data.insert(data.end(), chunk, chunk + size);
+                            LOGINFO("Got an encoded clip: %u bytes", data.size());
+                            if (size < 0)
+                                error_str = "encoder error";
+                            else
+                                uploaded = uploadDataToUrl(data, encoder.get_content_type(), url.c_str(), error_str);
+                        }
+                        encoder.stop();
+                        _sock_adaptor->close_socket();
+                    }
+                    else if (_is_streaming)
+                    {
+                        auto read = [this](char *buffer, unsigned int size) { return _sock_adaptor->read_data(buffer, size); };
+                        uploaded = uploadStreamToUrl(read, "audio/x-wav", _destination_url.c_str(), error_str);
+                        _sock_adaptor->close_socket();
+                    }
+                    else
+                    {
+                        vector<unsigned char> data;
+                        _sock_adaptor->get_data(data); // closes the socket
+                        LOGINFO("Got a clip: %u bytes", data.size());
+                        uploaded = uploadDataToUrl(data, "audio/x-wav", _destination_url.c_str(), error_str);
                     }
-                }
 
-                if(data.size() > 0)
-                {
-                    std::string error_str;
-                    if (uploadDataToUrl(data, _destination_url.c_str(), error_str))
+                    if (uploaded)
                     {
                         params["status"] = true;
                         params["message"] = "Success";
@@ -443,18 +543,6 @@ namespace WPEFramework {
                         params["status"] = false;
                         params["message"] = std::string("Upload Failed: ") + error_str;
                     }
-
-                    // Optionally, we can save a file
-//                    FILE * pFile;
-//                    const char* path = strcat(payload->dataLocator, ".received.pcm");
-//                    pFile = fopen (path, "wb");
-//                    fwrite (&data[0] , sizeof(unsigned char), data.size(), pFile);
-//                    fclose (pFile);
-                    // now, upload it, then remove:
-//                    if (remove(path) != 0)
-//                    {
-//                        LOGERR("Unable to delete %s", path);
-//                    }
                 } else {
                     LOGERR("Unable to read data from %s (connection error)", payload->dataLocator);
                     params["status"] = false;
@@ -468,7 +556,129 @@ namespace WPEFramework {
             }
         }
 
-        bool DataCapture::uploadDataToUrl(std::vector<unsigned char> &data, const char *url, std::string &error_str)
+        bool DataCapture::connectToClip(const char *dataLocator)
+        {
+            int attemptsLeft = 2;
+            int time_wait_sec = 1;
+
+            while (attemptsLeft--)
+            {
+                if (0 == _sock_adaptor->connect_socket(dataLocator))
+                {
+                    if (_sock_adaptor->wait_for_data())
+                        return true;
+                    _sock_adaptor->close_socket();
+                }
+
+                if (attemptsLeft)
+                {
+                    LOGWARN("No data in the socket. One more attempt in %d sec", time_wait_sec);
+                    usleep(1000 * 1000 * time_wait_sec);
+                }
+            }
+            return false;
+        }
+
+        struct StreamUpload
+        {
+            const std::function<int(char*, unsigned int)>& read;
+            size_t size;
+            bool failed;
+        };
+
+        // Reads the clip (from the socket or the encoder) straight into cURL's upload buffer
+        static size_t readClip(char *buffer, size_t size, size_t nitems, void *userdata)
+        {
+            StreamUpload* upload = static_cast<StreamUpload*>(userdata);
+
+            int ret = upload->read(buffer, size * nitems);
+            if (ret < 0)
+            {
+                upload->failed = true;
+                return CURL_READFUNC_ABORT;
+            }
+            upload->size += ret;
+            return ret;
+        }
+
+        bool DataCapture::uploadStreamToUrl(const std::function<int(char*, unsigned int)>& read, const char *content_type, const char *url, std::string &error_str)
+        {
+            CURL *curl;
+            CURLcode res;
+            bool call_succeeded = true;
+            StreamUpload upload = { read, 0, false };
+
+            if(!url || !strlen(url))
+            {
+                LOGERR("no url given");
+                return false;
+            }
+
+            LOGWARN("streaming %s data to '%s'", content_type, url);
+
+            //init curl
+            curl_global_init(CURL_GLOBAL_ALL);
+            curl = curl_easy_init();
+
+            if(!curl)
+            {
+                LOGERR("could not init curl\n");
+                return false;
+            }
+
+            //create header, the size is not known up front so the body is sent in chunks
+            struct curl_slist *chunk = NULL;
+            chunk = curl_slist_append(chunk, (std::string("Content-Type: ") + content_type).c_str());
+            chunk = curl_slist_append(chunk, "Transfer-Encoding: chunked");
+            //don't wait for 100-continue before sending the first chunk
+            chunk = curl_slist_append(chunk, "Expect:");
+
+            //set url and data source
+            curl_easy_setopt(curl, CURLOPT_URL, url);
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, chunk);
+            curl_easy_setopt(curl, CURLOPT_POST, 1L);
+            curl_easy_setopt(curl, CURLOPT_READFUNCTION, readClip);
+            curl_easy_setopt(curl, CURLOPT_READDATA, &upload);
+
+            //perform blocking upload call, the clip is read as it is sent
+            res = curl_easy_perform(curl);
+
+            //output success / failure log
+            if(CURLE_OK == res)
+            {
+                long response_code;
+
+                curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+
+                if(600 > response_code && response_code >= 400)
+                {
+                    LOGERR("uploading failed with response code %ld\n", response_code);
+                    error_str = std::string("response code:") + std::to_string(response_code);
+                    call_succeeded = false;
+                }
+                else
+                    LOGWARN("upload done, %zu bytes", upload.size);
+            }
+            else if(upload.failed)
+            {
+                LOGERR("reading the clip failed after %zu bytes", upload.size);
+                error_str = std::string("clip read error");
+                call_succeeded = false;
+            }
+            else
+            {
+                LOGERR("upload failed with error %d:'%s'", res, curl_easy_strerror(res));
+                error_str = std::to_string(res) + std::string(":'") + std::string(curl_easy_strerror(res)) + std::string("'");
+                call_succeeded = false;
+            }
+            //clean up curl object
+            curl_easy_cleanup(curl);
+            curl_slist_free_all(chunk);
+
+            return call_succeeded;
+        }
+
+        bool DataCapture::uploadDataToUrl(std::vector<unsigned char> &data, const char *content_type, const char *url, std::string &error_str)
         {
             CURL *curl;
             CURLcode res;
@@ -480,7 +690,7 @@ namespace WPEFramework {
                 return false;
             }
 
-            LOGWARN("uploading pcm data of size %u to '%s'", data.size(), url);
+            LOGWARN("uploading %s data of size %u to '%s'", content_type, data.size(), url);
 
             //init curl
             curl_global_init(CURL_GLOBAL_ALL);
@@ -494,7 +704,7 @@ namespace WPEFramework {
 
             //create header
             struct curl_slist *chunk = NULL;
-            chunk = curl_slist_append(chunk, "Content-Type: audio/x-wav");
+            chunk = curl_slist_append(chunk, (std::string("Content-Type: ") + content_type).c_str());
 
             //set url and data
             curl_easy_setopt(curl, CURLOPT_URL, url);
@@ -23,6 +23,8 @@
 #include "utils.h"
 #include "AbstractPlugin.h"
 #include "libIBus.h"
+#include "audio_encoder.h"
+#include <functional>
 //#include "irMgr.h"
 
 class socket_adaptor;
@@ -63,15 +65,21 @@ namespace WPEFramework {
             int enableAudioCapture(unsigned int bufferMaxDuration);
             int getAudioClip(const JsonObject& clipRequest);
             void constructFormatString();
-            bool uploadDataToUrl(std::vector<unsigned char> &data, const char *url, std::string &error_str);
+            bool connectToClip(const char *dataLocator);
+            bool uploadDataToUrl(std::vector<unsigned char> &data, const char *content_type, const char *url, std::string &error_str);
+            bool uploadStreamToUrl(const std::function<int(char*, unsigned int)>& read, const char *content_type, const char *url, std::string &error_str);
         private/*members*/:
             audiocapturemgr::session_id_t _session_id;
             unsigned int _max_supported_duration;
             socket_adaptor* _sock_adaptor;
             audiocapturemgr::audio_properties_ifce_t _audio_properties;
             string _audio_format_string;
+            audio_encoder::format_t _audio_format;
+            audio_encoder::codec_t _codec;
+            bool _downmix;
             string _destination_url;
             bool _is_precapture;
+            bool _is_streaming;
             unsigned int _duration;
             static pthread_mutex_t _mutex;
         };
@@ -0,0 +1,520 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2020 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#include "audio_encoder.h"
+#include "socket_adaptor.h"
+#include <string.h>
+#include <algorithm>
+#include <unistd.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const unsigned int CHUNK_SIZE = 64 * 1024;
+static const size_t MAX_QUEUED_BYTES = 256 * 1024;
+static const unsigned int DOWNMIX_SAMPLE_RATE = 16000;
+static const unsigned int FLAC_COMPRESSION_LEVEL = 5;
+
+/*Averages the two channels of interleaved stereo samples*/
+static void downmix_stereo(const int16_t * in, unsigned int frames, int16_t * out)
+{
+	unsigned int i = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+	for(; i + 8 <= frames; i += 8)
+	{
+		int16x8x2_t lr = vld2q_s16(in + 2 * i);
+		vst1q_s16(out + i, vhaddq_s16(lr.val[0], lr.val[1]));
+	}
+#elif defined(__SSE2__)
+	const __m128i ones = _mm_set1_epi16(1);
+	for(; i + 8 <= frames; i += 8)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *)(in + 2 * i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(in + 2 * i + 8));
+		/*Pairwise L + R in 32 bits, halved, then narrowed back (the result always fits)*/
+		__m128i sum_a = _mm_srai_epi32(_mm_madd_epi16(a, ones), 1);
+		__m128i sum_b = _mm_srai_epi32(_mm_madd_epi16(b, ones), 1);
+		_mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(sum_a, sum_b));
+	}
+#endif
+	for(; i < frames; i++)
+	{
+		out[i] = (int16_t)(((int32_t)in[2 * i] + in[2 * i + 1]) >> 1);
+	}
+}
+
+/*Sign extends samples to the 32 bit containers libFLAC takes*/
+static void widen_samples(const int16_t * in, unsigned int count, int32_t * out)
+{
+	unsigned int i = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+	for(; i + 8 <= count; i += 8)
+	{
+		int16x8_t v = vld1q_s16(in + i);
+		vst1q_s32(out + i, vmovl_s16(vget_low_s16(v)));
+		vst1q_s32(out + i + 4, vmovl_s16(vget_high_s16(v)));
+	}
+#elif defined(__SSE2__)
+	for(; i + 8 <= count; i += 8)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+		_mm_storeu_si128((__m128i *)(out + i), _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+		_mm_storeu_si128((__m128i *)(out + i + 4), _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+	}
+#endif
+	for(; i < count; i++)
+	{
+		out[i] = in[i];
+	}
+}
+
+audio_encoder::audio_encoder(codec_t codec, const format_t &input, bool downmix) : m_codec(codec), m_input(input), m_output(input),
+	m_downmix(downmix), m_source(nullptr), m_queued_bytes(0), m_read_offset(0), m_eos(false), m_failed(false), m_stop(false),
+	m_in_pending(0), m_decimation(1), m_acc(0), m_acc_count(0), m_step(1.0), m_position(1.0), m_last_sample(0)
+#ifdef FLAC_FOUND
+	, m_flac(nullptr)
+#endif
+#ifdef OPUSENC_FOUND
+	, m_opus(nullptr)
+#endif
+{
+	if(m_downmix)
+	{
+		m_output.channels = 1;
+		if(m_input.sample_rate > DOWNMIX_SAMPLE_RATE)
+		{
+			m_output.sample_rate = DOWNMIX_SAMPLE_RATE;
+		}
+		if(0 < m_output.sample_rate)
+		{
+			m_step = (double)m_input.sample_rate / m_output.sample_rate;
+			m_decimation = (0 == m_input.sample_rate % m_output.sample_rate) ? m_input.sample_rate / m_output.sample_rate : 0;
+		}
+	}
+}
+
+audio_encoder::~audio_encoder()
+{
+	stop();
+}
+
+bool audio_encoder::parse_codec(const std::string &name, codec_t &codec)
+{
+	if(name == "pcm")
+	{
+		codec = PCM;
+	}
+	else if(name == "flac")
+	{
+		codec = FLAC;
+	}
+	else if(name == "opus")
+	{
+		codec = OPUS;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+bool audio_encoder::is_supported(codec_t codec)
+{
+	switch(codec)
+	{
+		case PCM:
+			return true;
+#ifdef FLAC_FOUND
+		case FLAC:
+			return true;
+#endif
+#ifdef OPUSENC_FOUND
+		case OPUS:
+			return true;
+#endif
+		default:
+			return false;
+	}
+}
+
+const char * audio_encoder::get_content_type() const
+{
+	switch(m_codec)
+	{
+		case FLAC:
+			return "audio/flac";
+		case OPUS:
+			return "audio/ogg; codecs=opus";
+		default:
+			return "audio/x-wav";
+	}
+}
+
+const char * audio_encoder::get_codec_name() const
+{
+	switch(m_codec)
+	{
+		case FLAC:
+			return "FLAC";
+		case OPUS:
+			return "OPUS";
+		default:
+			return "PCM";
+	}
+}
+
+int audio_encoder::start(socket_adaptor * source)
+{
+	if((16 != m_input.bits_per_sample) || (0 == m_input.channels) || (0 == m_input.sample_rate))
+	{
+		SA_ERR("Only 16 bit PCM can be encoded.\n");
+		return -1;
+	}
+	if(!is_supported(m_codec) || !encoder_open())
+	{
+		SA_ERR("Unable to set up encoder %d.\n", m_codec);
+		return -1;
+	}
+
+	const unsigned int frames = CHUNK_SIZE / (m_input.channels * sizeof(int16_t));
+	m_in_buffer.resize(CHUNK_SIZE);
+	if(m_downmix)
+	{
+		m_mono.resize(frames);
+		m_resampled.resize(frames + 1);
+	}
+	if(FLAC == m_codec)
+	{
+		m_wide.resize(frames * m_input.channels);
+	}
+
+	SA_INFO("Encoding %u Hz, %u channels into codec %d at %u Hz, %u channels.\n",
+			m_input.sample_rate, m_input.channels, m_codec, m_output.sample_rate, m_output.channels);
+	m_source = source;
+	m_thread = std::thread(&audio_encoder::worker_thread, this);
+	return 0;
+}
+
+int audio_encoder::read_data(char * buffer, const unsigned int size)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_condition.wait(lock, [this] () { return !m_queue.empty() || m_eos; });
+
+	if(m_queue.empty())
+	{
+		return m_failed ? -1 : 0;
+	}
+
+	unsigned int copied = 0;
+	while(copied < size && !m_queue.empty())
+	{
+		std::vector<unsigned char> &front = m_queue.front();
+		size_t length = std::min((size_t)(size - copied), front.size() - m_read_offset);
+		memcpy(buffer + copied, front.data() + m_read_offset, length);
+		copied += length;
+		m_read_offset += length;
+		if(m_read_offset == front.size())
+		{
+			m_queue.pop_front();
+			m_read_offset = 0;
+		}
+	}
+	m_queued_bytes -= copied;
+	m_condition.notify_all();
+	return copied;
+}
+
+void audio_encoder::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+		m_condition.notify_all();
+	}
+	if(m_thread.joinable())
+	{
+		/*The worker may be blocked reading the socket rather than waiting for the reader*/
+		m_source->cancel_read();
+		m_thread.join();
+	}
+}
+
+void audio_encoder::worker_thread()
+{
+	SA_INFO("Enter\n");
+	const unsigned int frame_size = m_input.channels * sizeof(int16_t);
+	size_t total_size = 0;
+	bool ok = true;
+
+	while(ok)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if(m_stop)
+			{
+				ok = false;
+				break;
+			}
+		}
+		int size_recv = m_source->read_data(m_in_buffer.data() + m_in_pending, m_in_buffer.size() - m_in_pending);
+		if(size_recv <= 0)
+		{
+			ok = (0 == size_recv);
+			break;
+		}
+		total_size += size_recv;
+
+		unsigned int available = m_in_pending + size_recv;
+		unsigned int frames = available / frame_size;
+		const int16_t * samples = reinterpret_cast<const int16_t *>(m_in_buffer.data());
+
+		if(m_downmix)
+		{
+			unsigned int count = downmix(samples, frames, m_mono.data());
+			count = resample(m_mono.data(), count, m_resampled.data());
+			ok = encoder_write(m_resampled.data(), count);
+		}
+		else
+		{
+			ok = encoder_write(samples, frames);
+		}
+
+		/*Keep a partial frame for the next read*/
+		m_in_pending = available - frames * frame_size;
+		memmove(m_in_buffer.data(), m_in_buffer.data() + frames * frame_size, m_in_pending);
+	}
+
+	ok = encoder_close() && ok;
+	SA_INFO("Encoded %zu bytes, %s\n", total_size, ok ? "done" : "failed");
+	finish(!ok);
+}
+
+unsigned int audio_encoder::downmix(const int16_t * in, unsigned int frames, int16_t * out)
+{
+	if(2 == m_input.channels)
+	{
+		downmix_stereo(in, frames, out);
+	}
+	else if(1 == m_input.channels)
+	{
+		memcpy(out, in, frames * sizeof(int16_t));
+	}
+	else
+	{
+		for(unsigned int i = 0; i < frames; i++)
+		{
+			int32_t sum = 0;
+			for(unsigned int channel = 0; channel < m_input.channels; channel++)
+			{
+				sum += in[i * m_input.channels + channel];
+			}
+			out[i] = (int16_t)(sum / (int32_t)m_input.channels);
+		}
+	}
+	return frames;
+}
+
+unsigned int audio_encoder::resample(const int16_t * in, unsigned int samples, int16_t * out)
+{
+	unsigned int count = 0;
+
+	if(1 == m_decimation)
+	{
+		memcpy(out, in, samples * sizeof(int16_t));
+		return samples;
+	}
+
+	if(1 < m_decimation)
+	{
+		/*Integer ratio (48 and 32 kHz): average every m_decimation samples*/
+		for(unsigned int i = 0; i < samples; i++)
+		{
+			m_acc += in[i];
+			if(++m_acc_count == m_decimation)
+			{
+				out[count++] = (int16_t)(m_acc / (int32_t)m_decimation);
+				m_acc = 0;
+				m_acc_count = 0;
+			}
+		}
+		return count;
+	}
+
+	/*Otherwise interpolate linearly. Position 0 is the last sample of the previous read, 1 is in[0].*/
+	while(m_position < samples)
+	{
+		unsigned int index = (unsigned int)m_position;
+		double fraction = m_position - index;
+		int16_t first = (0 == index) ? m_last_sample : in[index - 1];
+		int16_t second = in[index];
+		out[count++] = (int16_t)(first + fraction * (second - first));
+		m_position += m_step;
+	}
+	if(0 < samples)
+	{
+		m_position -= samples;
+		m_last_sample = in[samples - 1];
+	}
+	return count;
+}
+
+bool audio_encoder::encoder_open()
+{
+	switch(m_codec)
+	{
+#ifdef FLAC_FOUND
+		case FLAC:
+			m_flac = FLAC__stream_encoder_new();
+			if(nullptr == m_flac)
+			{
+				return false;
+			}
+			FLAC__stream_encoder_set_channels(m_flac, m_output.channels);
+			FLAC__stream_encoder_set_bits_per_sample(m_flac, 16);
+			FLAC__stream_encoder_set_sample_rate(m_flac, m_output.sample_rate);
+			FLAC__stream_encoder_set_compression_level(m_flac, FLAC_COMPRESSION_LEVEL);
+			if(FLAC__STREAM_ENCODER_INIT_STATUS_OK != FLAC__stream_encoder_init_stream(m_flac, flac_write, nullptr, nullptr, nullptr, this))
+			{
+				FLAC__stream_encoder_delete(m_flac);
+				m_flac = nullptr;
+				return false;
+			}
+			return true;
+#endif
+#ifdef OPUSENC_FOUND
+		case OPUS:
+		{
+			int error = OPE_OK;
+			OpusEncCallbacks callbacks = { opus_write, opus_close };
+			OggOpusComments * comments = ope_comments_create();
+			m_opus = ope_encoder_create_callbacks(&callbacks, this, comments, m_output.sample_rate, m_output.channels,
+					(2 < m_output.channels) ? 1 : 0, &error);
+			ope_comments_destroy(comments);
+			if(nullptr == m_opus)
+			{
+				SA_ERR("ope_encoder_create_callbacks() failed: %s\n", ope_strerror(error));
+				return false;
+			}
+			return true;
+		}
+#endif
+		case PCM:
+			return true;
+		default:
+			return false;
+	}
+}
+
+bool audio_encoder::encoder_write(const int16_t * samples, unsigned int frames)
+{
+	if(0 == frames)
+	{
+		return true;
+	}
+
+	switch(m_codec)
+	{
+#ifdef FLAC_FOUND
+		case FLAC:
+			widen_samples(samples, frames * m_output.channels, m_wide.data());
+			return FLAC__stream_encoder_process_interleaved(m_flac, m_wide.data(), frames);
+#endif
+#ifdef OPUSENC_FOUND
+		case OPUS:
+			return (OPE_OK == ope_encoder_write(m_opus, samples, frames));
+#endif
+		default:
+			return (0 == push_output(reinterpret_cast<const unsigned char *>(samples), frames * m_output.channels * sizeof(int16_t)));
+	}
+}
+
+bool audio_encoder::encoder_close()
+{
+	bool ok = true;
+#ifdef FLAC_FOUND
+	if(nullptr != m_flac)
+	{
+		ok = FLAC__stream_encoder_finish(m_flac);
+		FLAC__stream_encoder_delete(m_flac);
+		m_flac = nullptr;
+	}
+#endif
+#ifdef OPUSENC_FOUND
+	if(nullptr != m_opus)
+	{
+		ok = (OPE_OK == ope_encoder_drain(m_opus));
+		ope_encoder_destroy(m_opus);
+		m_opus = nullptr;
+	}
+#endif
+	return ok;
+}
+
+int audio_encoder::push_output(const unsigned char * data, size_t size)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	/*Don't run too far ahead of the upload*/
+	m_condition.wait(lock, [this] () { return m_stop || m_queued_bytes < MAX_QUEUED_BYTES; });
+	if(m_stop)
+	{
+		return -1;
+	}
+	m_queue.emplace_back(data, data + size);
+	m_queued_bytes += size;
+	m_condition.notify_all();
+	return 0;
+}
+
+void audio_encoder::finish(bool failed)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_eos = true;
+	m_failed = failed;
+	m_condition.notify_all();
+}
+
+#ifdef FLAC_FOUND
+FLAC__StreamEncoderWriteStatus audio_encoder::flac_write(const FLAC__StreamEncoder * encoder, const FLAC__byte buffer[], size_t bytes,
+		unsigned samples, unsigned current_frame, void * client_data)
+{
+	UNUSED(encoder);
+	UNUSED(samples);
+	UNUSED(current_frame);
+	audio_encoder * self = static_cast<audio_encoder *>(client_data);
+	return (0 == self->push_output(buffer, bytes)) ? FLAC__STREAM_ENCODER_WRITE_STATUS_OK : FLAC__STREAM_ENCODER_WRITE_STATUS_FATAL_ERROR;
+}
+#endif
+
+#ifdef OPUSENC_FOUND
+int audio_encoder::opus_write(void * user_data, const unsigned char * ptr, opus_int32 len)
+{
+	audio_encoder * self = static_cast<audio_encoder *>(user_data);
+	return self->push_output(ptr, len);
+}
+
+int audio_encoder::opus_close(void * user_data)
+{
+	UNUSED(user_data);
+	return 0;
+}
+#endif
@@ -0,0 +1,172 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2020 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#ifndef _audio_encoder_H_
+#define _audio_encoder_H_
+#include <stdint.h>
+#include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#ifdef FLAC_FOUND
+#include <FLAC/stream_encoder.h>
+#endif
+#ifdef OPUSENC_FOUND
+#include <opusenc.h>
+#endif
+
+class socket_adaptor;
+
+/**
+ * Encodes the 16 bit PCM read from a socket_adaptor on a worker thread, optionally
+ * downmixing it to mono and resampling it to 16 kHz first. The encoded stream is
+ * handed out through read_data() as it is produced.
+ */
+class audio_encoder
+{
+	public:
+	typedef enum
+	{
+		PCM = 0,
+		FLAC,
+		OPUS
+	} codec_t;
+
+	typedef struct
+	{
+		unsigned int sample_rate;
+		unsigned int channels;
+		unsigned int bits_per_sample;
+	} format_t;
+
+	private:
+	codec_t m_codec;
+	format_t m_input;
+	format_t m_output;
+	bool m_downmix;
+	socket_adaptor * m_source;
+	std::thread m_thread;
+
+	/*Encoded data not read yet*/
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::deque<std::vector<unsigned char>> m_queue;
+	size_t m_queued_bytes;
+	size_t m_read_offset;
+	bool m_eos;
+	bool m_failed;
+	bool m_stop;
+
+	/*Conversion buffers, allocated once per clip*/
+	std::vector<char> m_in_buffer;
+	unsigned int m_in_pending;
+	std::vector<int16_t> m_mono;
+	std::vector<int16_t> m_resampled;
+	std::vector<int32_t> m_wide;
+
+	/*Resampler state, carried across reads*/
+	unsigned int m_decimation;
+	int32_t m_acc;
+	unsigned int m_acc_count;
+	double m_step;
+	double m_position;
+	int16_t m_last_sample;
+
+#ifdef FLAC_FOUND
+	FLAC__StreamEncoder * m_flac;
+#endif
+#ifdef OPUSENC_FOUND
+	OggOpusEnc * m_opus;
+#endif
+
+	void worker_thread();
+	bool encoder_open();
+	bool encoder_write(const int16_t * samples, unsigned int frames);
+	bool encoder_close();
+	unsigned int downmix(const int16_t * in, unsigned int frames, int16_t * out);
+	unsigned int resample(const int16_t * in, unsigned int samples, int16_t * out);
+	int push_output(const unsigned char * data, size_t size);
+	void finish(bool failed);
+
+#ifdef FLAC_FOUND
+	static FLAC__StreamEncoderWriteStatus flac_write(const FLAC__StreamEncoder * encoder, const FLAC__byte buffer[], size_t bytes,
+			unsigned samples, unsigned current_frame, void * client_data);
+#endif
+#ifdef OPUSENC_FOUND
+	static int opus_write(void * user_data, const unsigned char * ptr, opus_int32 len);
+	static int opus_close(void * user_data);
+#endif
+
+	public:
+	audio_encoder(codec_t codec, const format_t &input, bool downmix);
+	~audio_encoder();
+
+    /**
+     *  @brief This api maps a codec name ("pcm", "flac" or "opus") to its codec_t.
+     *
+     *  @return Returns false if the name is unknown
+     */
+	static bool parse_codec(const std::string &name, codec_t &codec);
+
+    /**
+     *  @brief This api tells if support for the codec was built in.
+     */
+	static bool is_supported(codec_t codec);
+
+    /**
+     *  @brief This api returns the MIME type of the encoded stream.
+     */
+	const char * get_content_type() const;
+
+    /**
+     *  @brief This api returns the name of the codec as used in the upload URL ("PCM", "FLAC" or "OPUS").
+     */
+	const char * get_codec_name() const;
+
+    /**
+     *  @brief This api returns the format of the encoded stream, after the optional downmix.
+     */
+	const format_t & get_output_format() const { return m_output; }
+
+    /**
+     *  @brief This api starts encoding what is read from the (connected) socket on a worker thread.
+     *
+     *  @param[in] source  Socket to read the PCM data from. It is read until the other end closes it.
+     *
+     *  @return Returns 0 on success or -1 if the encoder could not be set up
+     */
+	int start(socket_adaptor * source);
+
+    /**
+     *  @brief This api copies encoded data into the supplied buffer, blocking until there is some.
+     *
+     *  @return Returns the number of bytes copied, 0 at the end of the stream or -1 in case of an error
+     */
+	int read_data(char * buffer, const unsigned int size);
+
+    /**
+     *  @brief This api stops the worker thread, dropping whatever was not read. A read from the
+     *  source that is blocked is cancelled, the source socket has to be closed afterwards.
+     */
+	void stop();
+};
+#endif //_audio_encoder_H_
@@ -81,6 +81,7 @@ int socket_adaptor::connect_socket(const std::string &path)
         } else {
             SA_ERR("connect() failed\n");
             close(m_read_fd);
+            m_read_fd = -1;
             ret = -1;
             return ret;
 
@@ -118,11 +119,71 @@ int socket_adaptor::write_data(const char * buffer, const unsigned int size)
 	return ret;
 }
 
+bool socket_adaptor::wait_for_data()
+{
+    char byte;
+    int ret;
+
+    if(m_read_fd < 0) {
+        SA_ERR("Unable to wait for data. Did you connect?");
+        return false;
+    }
+
+    do
+    {
+        ret = recv(m_read_fd, &byte, sizeof(byte), MSG_PEEK);
+    } while(ret < 0 && errno == EINTR);
+
+    return ret > 0;
+}
+
+int socket_adaptor::read_data(char * buffer, const unsigned int size)
+{
+    int ret;
+
+    if(m_read_fd < 0) {
+        SA_ERR("Unable to read data. Did you connect?");
+        return -1;
+    }
+
+    do
+    {
+        ret = read(m_read_fd, buffer, size);
+    } while(ret < 0 && errno == EINTR);
+
+    if(ret < 0)
+    {
+        SA_ERR("read() failed. errno: 0x%x\n", errno);
+    }
+    return ret;
+}
+
+void socket_adaptor::close_socket()
+{
+    lock();
+    if(0 < m_read_fd)
+    {
+        close(m_read_fd);
+        m_read_fd = -1;
+    }
+    unlock();
+}
+
+void socket_adaptor::cancel_read()
+{
+    lock();
+    if(0 < m_read_fd)
+    {
+        shutdown(m_read_fd, SHUT_RDWR);
+    }
+    unlock();
+}
+
 unsigned int socket_adaptor::fetch_data()
 {
-    unsigned int size_recv , total_size = 0, n = 0;
-    unsigned short int CHUNK_SIZE = 4096;
-    char chunk[CHUNK_SIZE];
+    unsigned int total_size = 0, n = 0;
+    const unsigned int CHUNK_SIZE = 64 * 1024;
+    int size_recv;
 
     if(m_read_fd < 0) {
         SA_ERR("Unable to fetch data. Did you connect?");
@@ -132,27 +193,23 @@ unsigned int socket_adaptor::fetch_data()
     m_fetch_buffer.clear();
     while(1)
     {
-        memset(chunk ,0 , CHUNK_SIZE);
-        if((size_recv =  read(m_read_fd , chunk , CHUNK_SIZE) ) <= 0)
+        // Read straight into the tail of the buffer. resize() zero-fills what it adds, which
+        // only touches the bytes the previous read filled, so each byte is cleared once.
+        m_fetch_buffer.resize(total_size + CHUNK_SIZE);
+        if((size_recv = read_data(reinterpret_cast<char *>(m_fetch_buffer.data()) + total_size, CHUNK_SIZE)) <= 0)
         {
             break;
         }
         else
         {
-            m_fetch_buffer.insert(m_fetch_buffer.end(), chunk, chunk + size_recv);
             total_size += size_recv;
             ++n;
         }
     }
+    m_fetch_buffer.resize(total_size);
     SA_WARN("%d bytes received in %u reads!\n", total_size, n);
 
-    close(m_read_fd);
-    lock();
-    if(0 < m_read_fd)
-    {
-        m_read_fd = -1;
-    }
-    unlock();
+    close_socket();
 
     return total_size;
 }
@@ -167,8 +224,8 @@ void socket_adaptor::get_data(std::vector<unsigned char>& data)
             return;
         }
     }
-    data = m_fetch_buffer;
-    m_fetch_buffer.clear();
+    data.clear();
+    data.swap(m_fetch_buffer);
 }
 
 unsigned int socket_adaptor::get_data(char * buffer, const unsigned int size)
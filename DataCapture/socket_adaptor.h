@@ -109,6 +109,34 @@ class socket_adaptor
      */
 	int write_data(const char * buffer, const unsigned int size);
 
+    /**
+     *  @brief This api blocks until the connected socket has data to read or is closed by the other end.
+     *
+     *  @return Returns true if there is data to read
+     */
+    bool wait_for_data();
+
+    /**
+     *  @brief This api invokes unix read() once, straight into the supplied buffer
+     *
+     * @param[in] buffer Data buffer.
+     * @param[in] size   Size of the buffer
+     *
+     *  @return Returns the number of bytes read, 0 at the end of the data or -1 in case of an error
+     */
+    int read_data(char * buffer, const unsigned int size);
+
+    /**
+     *  @brief This api invokes close() on the socket opened by connect_socket()
+     */
+    void close_socket();
+
+    /**
+     *  @brief This api invokes shutdown() on the socket opened by connect_socket(), so a read_data()
+     *  blocked on another thread returns 0. The socket still has to be closed with close_socket().
+     */
+    void cancel_read();
+
     /**
      *  @brief This api invokes unix read() to read all data from the socket into the internal buffer
      *
@@ -19,12 +19,48 @@
 
 #include "DeviceInfo.h"
 
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
 namespace WPEFramework {
 namespace Plugin {
 
     SERVICE_REGISTRATION(DeviceInfo, 1, 0);
 
-    static Core::ProxyPoolType<Web::JSONBodyType<DeviceInfo::Data>> jsonResponseFactory(4);
+    static Core::ProxyPoolType<Web::TextBody> textResponseFactory(4);
+
+    static void FillAddresses(const std::list<DeviceInfo::AddressEntry>& addresses, Core::JSON::ArrayType<JsonData::DeviceInfo::AddressesData>& addressInfo)
+    {
+        for (const DeviceInfo::AddressEntry& entry : addresses) {
+            JsonData::DeviceInfo::AddressesData newElement;
+            newElement.Name = entry.Name;
+            newElement.Mac = entry.Mac;
+            JsonData::DeviceInfo::AddressesData& element(addressInfo.Add(newElement));
+
+            for (const string& ip : entry.Ips) {
+                Core::JSON::String nodeName;
+                nodeName = ip;
+
+                element.Ip.Add(nodeName);
+            }
+        }
+    }
+
+    static void FillSystemInfo(const DeviceInfo::SystemSnapshot& system, JsonData::DeviceInfo::SysteminfoData& systemInfo)
+    {
+        systemInfo.Time = system.Time;
+        systemInfo.Version = system.Version;
+        systemInfo.Uptime = system.Uptime;
+        systemInfo.Freeram = system.Freeram;
+        systemInfo.Totalram = system.Totalram;
+        systemInfo.Devicename = system.Devicename;
+        systemInfo.Cpuload = system.Cpuload;
+        systemInfo.Serialnumber = system.Serialnumber;
+    }
 
     /* virtual */ const string DeviceInfo::Initialize(PluginHost::IShell* service)
     {
@@ -39,9 +75,31 @@ namespace Plugin {
         _subSystem = service->SubSystems();
         _service = service;
         _systemId = Core::SystemInfo::Instance().Id(Core::SystemInfo::Instance().RawDeviceId(), ~0);
+        _refresh = std::max(config.Refresh.Value(), static_cast<uint16_t>(1));
 
         ASSERT(_subSystem != nullptr);
 
+        if (_subSystem != nullptr) {
+            Core::SystemInfo& singleton(Core::SystemInfo::Instance());
+
+            // These do not change while we run, fill them in once.
+            _system.Version = _service->Version() + _T("#") + _subSystem->BuildTreeHash();
+            _system.Totalram = singleton.GetTotalRam();
+            _system.Devicename = singleton.GetHostName();
+            _system.Serialnumber = _systemId;
+
+            // Listen before the first read, so a change that lands in between is not lost.
+            if (_addressMonitor.Open() == false) {
+                TRACE(Trace::Information, (_T("No netlink notifications, addresses are refreshed every %d seconds"), _refresh));
+            }
+
+            UpdateAddresses();
+            UpdateSystemInfo();
+            UpdateSockets();
+
+            _job.Schedule(Core::Time::Now().Add(_refresh * 1000));
+        }
+
         // On success return empty, to indicate there is no error text.
 
         return (_subSystem != nullptr) ? EMPTY_STRING : _T("Could not retrieve System Information.");
@@ -51,6 +109,10 @@ namespace Plugin {
     {
         ASSERT(_service == service);
 
+        // The job falls back to polling the addresses once the monitor is closed, so stop it first
+        _job.Revoke();
+        _addressMonitor.Close();
+
         if (_subSystem != nullptr) {
             _subSystem->Release();
             _subSystem = nullptr;
@@ -82,24 +144,27 @@ namespace Plugin {
         // <GET> - currently, only the GET command is supported, returning system info
         if (request.Verb == Web::Request::HTTP_GET) {
 
-            Core::ProxyType<Web::JSONBodyType<Data>> response(jsonResponseFactory.Element());
+            Core::ProxyType<Web::TextBody> response(textResponseFactory.Element());
 
             Core::TextSegmentIterator index(Core::TextFragment(request.Path, _skipURL, static_cast<uint32_t>(request.Path.length()) - _skipURL), false, '/');
 
             // Always skip the first one, it is an empty part because we start with a '/' if there are more parameters.
             index.Next();
 
+            // Served from the pre-rendered snapshot, a request does not touch the system at all.
+            _adminLock.Lock();
             if (index.Next() == false) {
-                AddressInfo(response->Addresses);
-                SysInfo(response->SystemInfo);
-                SocketPortInfo(response->Sockets);
+                response->assign(_allText);
             } else if (index.Current() == "Adresses") {
-                AddressInfo(response->Addresses);
+                response->assign(_T("{\"addresses\":") + _addressesText + _T("}"));
             } else if (index.Current() == "System") {
-                SysInfo(response->SystemInfo);
+                response->assign(_T("{\"systeminfo\":") + _systemText + _T("}"));
             } else if (index.Current() == "Sockets") {
-                SocketPortInfo(response->Sockets);
+                response->assign(_T("{\"sockets\":") + _socketsText + _T("}"));
+            } else {
+                response->assign(_T("{}"));
             }
+            _adminLock.Unlock();
             // TODO RB: I guess we should do something here to return other info (e.g. time) as well.
 
             result->ContentType = Web::MIMETypes::MIME_JSON;
@@ -113,46 +178,195 @@ namespace Plugin {
     }
 
     void DeviceInfo::SysInfo(JsonData::DeviceInfo::SysteminfoData& systemInfo) const
+    {
+        _adminLock.Lock();
+        FillSystemInfo(_system, systemInfo);
+        _adminLock.Unlock();
+    }
+
+    void DeviceInfo::AddressInfo(Core::JSON::ArrayType<JsonData::DeviceInfo::AddressesData>& addressInfo) const
+    {
+        _adminLock.Lock();
+        FillAddresses(_addresses, addressInfo);
+        _adminLock.Unlock();
+    }
+
+    void DeviceInfo::SocketPortInfo(JsonData::DeviceInfo::SocketinfoData& socketPortInfo) const
+    {
+        _adminLock.Lock();
+        socketPortInfo.Runs = _runs;
+        _adminLock.Unlock();
+    }
+
+    void DeviceInfo::Dispatch()
+    {
+        UpdateSystemInfo();
+        UpdateSockets();
+
+        if (_addressMonitor.IsOpen() == false) {
+            UpdateAddresses();
+        }
+
+        _job.Schedule(Core::Time::Now().Add(_refresh * 1000));
+    }
+
+    void DeviceInfo::UpdateSystemInfo()
     {
         Core::SystemInfo& singleton(Core::SystemInfo::Instance());
 
-        systemInfo.Time = Core::Time::Now().ToRFC1123(true);
-        systemInfo.Version = _service->Version() + _T("#") + _subSystem->BuildTreeHash();
-        systemInfo.Uptime = singleton.GetUpTime();
-        systemInfo.Freeram = singleton.GetFreeRam();
-        systemInfo.Totalram = singleton.GetTotalRam();
-        systemInfo.Devicename = singleton.GetHostName();
-        systemInfo.Cpuload = Core::NumberType<uint32_t>(static_cast<uint32_t>(singleton.GetCpuLoad())).Text();
-        systemInfo.Serialnumber = _systemId;
+        // Only called from the job, so reading the static fields without the lock is fine.
+        SystemSnapshot system(_system);
+        system.Time = Core::Time::Now().ToRFC1123(true);
+        system.Uptime = singleton.GetUpTime();
+        system.Freeram = singleton.GetFreeRam();
+        system.Cpuload = Core::NumberType<uint32_t>(static_cast<uint32_t>(singleton.GetCpuLoad())).Text();
+
+        JsonData::DeviceInfo::SysteminfoData systemInfo;
+        FillSystemInfo(system, systemInfo);
+        string text;
+        systemInfo.ToString(text);
+
+        _adminLock.Lock();
+        _system = system;
+        _systemText = text;
+        RenderLocked();
+        _adminLock.Unlock();
     }
 
-    void DeviceInfo::AddressInfo(Core::JSON::ArrayType<JsonData::DeviceInfo::AddressesData>& addressInfo) const
+    void DeviceInfo::UpdateAddresses()
     {
+        std::list<AddressEntry> addresses;
+
         // Get the point of entry on WPEFramework..
         Core::AdapterIterator interfaces;
 
         while (interfaces.Next() == true) {
 
-            JsonData::DeviceInfo::AddressesData newElement;
-            newElement.Name = interfaces.Name();
-            newElement.Mac = interfaces.MACAddress(':');
-            JsonData::DeviceInfo::AddressesData& element(addressInfo.Add(newElement));
+            addresses.push_back(AddressEntry());
+            AddressEntry& entry(addresses.back());
+            entry.Name = interfaces.Name();
+            entry.Mac = interfaces.MACAddress(':');
 
             // get an interface with a public IP address, then we will have a proper MAC address..
             Core::IPV4AddressIterator selectedNode(interfaces.IPV4Addresses());
 
             while (selectedNode.Next() == true) {
-                Core::JSON::String nodeName;
-                nodeName = selectedNode.Address().HostAddress();
+                entry.Ips.push_back(selectedNode.Address().HostAddress());
+            }
+        }
 
-                element.Ip.Add(nodeName);
+        _adminLock.Lock();
+        bool changed = (addresses != _addresses) || _addressesText.empty();
+        _adminLock.Unlock();
+
+        if (changed == true) {
+            Core::JSON::ArrayType<JsonData::DeviceInfo::AddressesData> addressInfo;
+            FillAddresses(addresses, addressInfo);
+            string text;
+            if (addresses.empty() == true) {
+                text = _T("[]");
+            } else {
+                addressInfo.ToString(text);
             }
+
+            _adminLock.Lock();
+            _addresses = std::move(addresses);
+            _addressesText = text;
+            RenderLocked();
+            _adminLock.Unlock();
         }
     }
 
-    void DeviceInfo::SocketPortInfo(JsonData::DeviceInfo::SocketinfoData& socketPortInfo) const
+    void DeviceInfo::UpdateSockets()
+    {
+        uint32_t runs = Core::ResourceMonitor::Instance().Runs();
+
+        _adminLock.Lock();
+        if ((runs != _runs) || (_socketsText.empty() == true)) {
+            JsonData::DeviceInfo::SocketinfoData socketPortInfo;
+            socketPortInfo.Runs = runs;
+            _runs = runs;
+            socketPortInfo.ToString(_socketsText);
+            RenderLocked();
+        }
+        _adminLock.Unlock();
+    }
+
+    void DeviceInfo::RenderLocked()
+    {
+        // Nothing to render until every part has been taken once.
+        if ((_systemText.empty() == false) && (_addressesText.empty() == false) && (_socketsText.empty() == false)) {
+            _allText = _T("{\"addresses\":") + _addressesText + _T(",\"systeminfo\":") + _systemText + _T(",\"sockets\":") + _socketsText + _T("}");
+        }
+    }
+
+    bool DeviceInfo::AddressMonitor::Open()
     {
-        socketPortInfo.Runs = Core::ResourceMonitor::Instance().Runs();
+        ASSERT(_netlink == -1);
+
+        _netlink = ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+
+        if (_netlink != -1) {
+            struct sockaddr_nl address;
+            memset(&address, 0, sizeof(address));
+            address.nl_family = AF_NETLINK;
+            address.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+
+            _wakeup = ::eventfd(0, EFD_CLOEXEC);
+
+            if ((_wakeup == -1) || (::bind(_netlink, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0)) {
+                TRACE_L1("Could not listen for netlink notifications, error %d", errno);
+                if (_wakeup != -1) {
+                    ::close(_wakeup);
+                    _wakeup = -1;
+                }
+                ::close(_netlink);
+                _netlink = -1;
+            } else {
+                Run();
+            }
+        }
+
+        return (_netlink != -1);
+    }
+
+    void DeviceInfo::AddressMonitor::Close()
+    {
+        if (_netlink != -1) {
+            uint64_t wakeup = 1;
+
+            Stop();
+            if (::write(_wakeup, &wakeup, sizeof(wakeup)) != sizeof(wakeup)) {
+                TRACE_L1("Could not wake up the address monitor, error %d", errno);
+            }
+            Wait(Core::Thread::STOPPED | Core::Thread::BLOCKED, Core::infinite);
+
+            ::close(_wakeup);
+            ::close(_netlink);
+            _wakeup = -1;
+            _netlink = -1;
+        }
+    }
+
+    uint32_t DeviceInfo::AddressMonitor::Worker()
+    {
+        struct pollfd fds[2];
+        fds[0].fd = _netlink;
+        fds[0].events = POLLIN;
+        fds[1].fd = _wakeup;
+        fds[1].events = POLLIN;
+
+        if ((::poll(fds, 2, -1) > 0) && ((fds[1].revents & POLLIN) == 0) && ((fds[0].revents & POLLIN) != 0)) {
+            char buffer[4096];
+
+            // A link going up or down comes with a burst of messages, they all make up one update.
+            while (::recv(_netlink, buffer, sizeof(buffer), MSG_DONTWAIT) > 0) {
+            }
+
+            _parent.UpdateAddresses();
+        }
+
+        return (0);
     }
 
 } // namespace Plugin
@@ -28,29 +28,84 @@ namespace Plugin {
 
     class DeviceInfo : public PluginHost::IPlugin, public PluginHost::IWeb, public PluginHost::JSONRPC {
     public:
-        class Data : public Core::JSON::Container {
+        struct AddressEntry {
+            string Name;
+            string Mac;
+            std::list<string> Ips;
+
+            bool operator==(const AddressEntry& other) const
+            {
+                return ((Name == other.Name) && (Mac == other.Mac) && (Ips == other.Ips));
+            }
+        };
+
+        struct SystemSnapshot {
+            string Time;
+            string Version;
+            uint64_t Uptime;
+            uint64_t Freeram;
+            uint64_t Totalram;
+            string Devicename;
+            string Cpuload;
+            string Serialnumber;
+        };
+
+    private:
+        class Config : public Core::JSON::Container {
+        private:
+            Config(const Config&) = delete;
+            Config& operator=(const Config&) = delete;
+
         public:
-            Data()
+            Config()
                 : Core::JSON::Container()
-                , Addresses()
-                , SystemInfo()
+                , Refresh(5)
             {
-                Add(_T("addresses"), &Addresses);
-                Add(_T("systeminfo"), &SystemInfo);
-                Add(_T("sockets"), &Sockets);
+                Add(_T("refresh"), &Refresh);
             }
-
-            virtual ~Data()
+            ~Config()
             {
             }
 
         public:
-            Core::JSON::ArrayType<JsonData::DeviceInfo::AddressesData> Addresses;
-            JsonData::DeviceInfo::SysteminfoData SystemInfo;
-            JsonData::DeviceInfo::SocketinfoData Sockets;
+            Core::JSON::DecUInt16 Refresh; // Seconds between updates of the system and socket info
+        };
+
+        // Wakes up on netlink link and address notifications, so the addresses are only
+        // enumerated again when they changed.
+        class AddressMonitor : public Core::Thread {
+        public:
+            AddressMonitor() = delete;
+            AddressMonitor(const AddressMonitor&) = delete;
+            AddressMonitor& operator=(const AddressMonitor&) = delete;
+
+            AddressMonitor(DeviceInfo& parent)
+                : Core::Thread(Core::Thread::DefaultStackSize(), _T("DeviceInfoAddresses"))
+                , _parent(parent)
+                , _netlink(-1)
+                , _wakeup(-1)
+            {
+            }
+            ~AddressMonitor() override
+            {
+                Close();
+            }
+
+            bool Open();
+            void Close();
+            bool IsOpen() const
+            {
+                return (_netlink != -1);
+            }
+
+            uint32_t Worker() override;
+
+        private:
+            DeviceInfo& _parent;
+            int _netlink;
+            int _wakeup;
         };
 
-    private:
         DeviceInfo(const DeviceInfo&) = delete;
         DeviceInfo& operator=(const DeviceInfo&) = delete;
 
@@ -71,15 +126,32 @@ namespace Plugin {
         }
 
     public:
+#ifdef __WINDOWS__
+#pragma warning(disable : 4355)
+#endif
         DeviceInfo()
             : _skipURL(0)
             , _service(nullptr)
             , _subSystem(nullptr)
             , _systemId()
             , _deviceId()
+            , _adminLock()
+            , _refresh(0)
+            , _system()
+            , _addresses()
+            , _runs(0)
+            , _systemText()
+            , _addressesText()
+            , _socketsText()
+            , _allText()
+            , _job(*this)
+            , _addressMonitor(*this)
         {
             RegisterAll();
         }
+#ifdef __WINDOWS__
+#pragma warning(default : 4355)
+#endif
 
         virtual ~DeviceInfo()
         {
@@ -117,12 +189,33 @@ namespace Plugin {
         void SocketPortInfo(JsonData::DeviceInfo::SocketinfoData& socketPortInfo) const;
         string GetDeviceId() const;
 
+        // Snapshot maintenance, requests are served from what these left behind
+        friend Core::ThreadPool::JobType<DeviceInfo&>;
+        void Dispatch();
+        void UpdateSystemInfo();
+        void UpdateAddresses();
+        void UpdateSockets();
+        void RenderLocked();
+
     private:
         uint8_t _skipURL;
         PluginHost::IShell* _service;
         PluginHost::ISubSystem* _subSystem;
         string _systemId;
         mutable string _deviceId;
+
+        mutable Core::CriticalSection _adminLock;
+        uint16_t _refresh;
+        SystemSnapshot _system;
+        std::list<AddressEntry> _addresses;
+        uint32_t _runs;
+        // Pre-rendered web responses
+        string _systemText;
+        string _addressesText;
+        string _socketsText;
+        string _allText;
+        Core::WorkerPool::JobType<DeviceInfo&> _job;
+        AddressMonitor _addressMonitor;
     };
 
 } // namespace Plugin
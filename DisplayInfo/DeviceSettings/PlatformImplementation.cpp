@@ -32,14 +32,12 @@
 #include "audioOutputPortConfig.hpp"
 #include "manager.hpp"
 #include "utils.h"
+#include "EdidCache.h"
 
 #include "libIBus.h"
 #include "libIBusDaemon.h"
 #include "dsMgr.h"
 
-#define EDID_MAX_HORIZONTAL_SIZE 21
-#define EDID_MAX_VERTICAL_SIZE   22
-
 namespace WPEFramework {
 namespace Plugin {
 
@@ -60,6 +58,7 @@ public:
             IARM_Result_t res;
             IARM_CHECK( IARM_Bus_RegisterEventHandler(IARM_BUS_DSMGR_NAME,IARM_BUS_DSMGR_EVENT_RES_PRECHANGE,ResolutionChange) );
             IARM_CHECK( IARM_Bus_RegisterEventHandler(IARM_BUS_DSMGR_NAME,IARM_BUS_DSMGR_EVENT_RES_POSTCHANGE, ResolutionChange) );
+            IARM_CHECK( IARM_Bus_RegisterEventHandler(IARM_BUS_DSMGR_NAME,IARM_BUS_DSMGR_EVENT_HDMI_HOTPLUG, HdmiHotPlug) );
 
             //TODO: this is probably per process so we either need to be running in our own process or be carefull no other plugin is calling it
             device::Manager::Initialize();
@@ -80,6 +79,7 @@ public:
         IARM_Result_t res;
         IARM_CHECK( IARM_Bus_UnRegisterEventHandler(IARM_BUS_DSMGR_NAME,IARM_BUS_DSMGR_EVENT_RES_PRECHANGE) );
         IARM_CHECK( IARM_Bus_UnRegisterEventHandler(IARM_BUS_DSMGR_NAME,IARM_BUS_DSMGR_EVENT_RES_POSTCHANGE) );
+        IARM_CHECK( IARM_Bus_UnRegisterEventHandler(IARM_BUS_DSMGR_NAME,IARM_BUS_DSMGR_EVENT_HDMI_HOTPLUG) );
         DisplayInfoImplementation::_instance = nullptr;
     }
 
@@ -155,6 +155,17 @@ public:
         }
     }
 
+    static void HdmiHotPlug(const char *owner, IARM_EventId_t eventId, void *data, size_t len)
+    {
+        if (strcmp(owner, IARM_BUS_DSMGR_NAME) == 0 && eventId == IARM_BUS_DSMGR_EVENT_HDMI_HOTPLUG)
+        {
+            IARM_Bus_DSMgr_EventData_t *eventData = (IARM_Bus_DSMgr_EventData_t *)data;
+            LOGINFO("Received IARM_BUS_DSMGR_EVENT_HDMI_HOTPLUG event data:%d", eventData->data.hdmi_hpd.event);
+            // A new sink, or none at all: the next query reads its EDID again
+            EdidCache::instance()->invalidate();
+        }
+    }
+
     void ResolutionChangeImpl(IConnectionProperties::INotification::Source eventtype)
     {
         LOGINFO();
@@ -178,8 +189,8 @@ public:
     }
     uint32_t Connected(bool& connected) const override
     {
-        LOGINFO("Stubbed function. TODO: Implement using DeviceSettings");
-        connected = false; // TODO: Implement using DeviceSettings (or use HDCP Profile plugin for this)
+        LOGINFO();
+        connected = EdidCache::instance()->connected();
         return (Core::ERROR_NONE);
     }
     uint32_t Width(uint32_t& value) const override
@@ -270,29 +281,15 @@ public:
     uint32_t WidthInCentimeters(uint8_t& width /* @out */) const override
     {
         LOGINFO();
-        try
+        EdidInfo edid;
+        if (EdidCache::instance()->getInfo(edid))
         {
-            ::device::VideoOutputPort vPort = ::device::Host::getInstance().getVideoOutputPort("HDMI0");
-            if (vPort.isDisplayConnected())
-            {
-                std::vector<uint8_t> edidVec;
-
-                vPort.getDisplay().getEDIDBytes(edidVec);
-
-                if(edidVec.size() > EDID_MAX_VERTICAL_SIZE)
-                {
-                    width = edidVec[EDID_MAX_HORIZONTAL_SIZE];
-                    TRACE(Trace::Information, (_T("Width in cm = %d"), width));
-                }
-                else
-                {
-                    LOGWARN("Failed to get Display Size!\n");
-                }
-            }
+            width = edid.widthCm;
+            TRACE(Trace::Information, (_T("Width in cm = %d"), width));
         }
-        catch (const device::Exception& err)
+        else
         {
-           TRACE(Trace::Error, (_T("Exception during DeviceSetting library call. code = %d message = %s"), err.getCode(), err.what()));
+            LOGWARN("Failed to get Display Size!\n");
         }
         return (Core::ERROR_NONE);
     }
@@ -300,29 +297,15 @@ public:
     uint32_t HeightInCentimeters(uint8_t& height /* @out */) const override
     {
         LOGINFO();
-        try
+        EdidInfo edid;
+        if (EdidCache::instance()->getInfo(edid))
         {
-            ::device::VideoOutputPort vPort = ::device::Host::getInstance().getVideoOutputPort("HDMI0");
-            if (vPort.isDisplayConnected())
-            {
-                std::vector<uint8_t> edidVec;
-
-                vPort.getDisplay().getEDIDBytes(edidVec);
-
-                if(edidVec.size() > EDID_MAX_VERTICAL_SIZE)
-                {
-                    height = edidVec[EDID_MAX_VERTICAL_SIZE];
-                    TRACE(Trace::Information, (_T("Height in cm = %d"), height));
-                }
-                else
-                {
-                    LOGWARN("Failed to get Display Size!\n");
-                }
-            }
+            height = edid.heightCm;
+            TRACE(Trace::Information, (_T("Height in cm = %d"), height));
         }
-        catch (const device::Exception& err)
+        else
         {
-            TRACE(Trace::Error, (_T("Exception during DeviceSetting library call. code = %d message = %s"), err.getCode(), err.what()));
+            LOGWARN("Failed to get Display Size!\n");
         }
         return (Core::ERROR_NONE);
     }
@@ -331,23 +314,14 @@ public:
     {
         LOGINFO();
         vector<uint8_t> edidVec({'u','n','k','n','o','w','n' });
-        try
+        vector<uint8_t> edidVec2;
+        if (EdidCache::instance()->getBytes(edidVec2))
         {
-            vector<uint8_t> edidVec2;
-            device::VideoOutputPort vPort = device::Host::getInstance().getVideoOutputPort("HDMI0");
-            if (vPort.isDisplayConnected())
-            {
-                vPort.getDisplay().getEDIDBytes(edidVec2);
-                edidVec = edidVec2;//edidVec must be "unknown" unless we successfully get to this line
-            }
-            else
-            {
-                LOGWARN("failure: HDMI0 not connected!");
-            }
+            edidVec = edidVec2;//edidVec must be "unknown" unless we successfully get to this line
         }
-        catch (const device::Exception& err)
+        else
         {
-            LOG_DEVICE_EXCEPTION0();
+            LOGWARN("failure: HDMI0 not connected!");
         }
         //convert to base64
         uint16_t size = min(edidVec.size(), (size_t)numeric_limits<uint16_t>::max());
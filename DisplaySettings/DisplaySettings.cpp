@@ -44,6 +44,7 @@
 #include "tracing/Logging.h"
 #include <syscall.h>
 #include "utils.h"
+#include "EdidCache.h"
 
 using namespace std;
 
@@ -364,6 +365,7 @@ namespace WPEFramework {
                     IARM_Bus_DSMgr_EventData_t *eventData = (IARM_Bus_DSMgr_EventData_t *)data;
                     int hdmi_hotplug_event = eventData->data.hdmi_hpd.event;
                     LOGINFO("Received IARM_BUS_DSMGR_EVENT_HDMI_HOTPLUG  event data:%d ", hdmi_hotplug_event);
+                    EdidCache::instance()->invalidate();
                     if(DisplaySettings::_instance)
                         DisplaySettings::_instance->connectedVideoDisplaysUpdated(hdmi_hotplug_event);
                 }
@@ -941,23 +943,14 @@ namespace WPEFramework {
             LOGINFOMETHOD();
 
             vector<uint8_t> edidVec({'u','n','k','n','o','w','n' });
-            try
+            vector<uint8_t> edidVec2;
+            if (EdidCache::instance()->getBytes(edidVec2))
             {
-                vector<uint8_t> edidVec2;
-                device::VideoOutputPort vPort = device::Host::getInstance().getVideoOutputPort("HDMI0");
-                if (vPort.isDisplayConnected())
-                {
-                    vPort.getDisplay().getEDIDBytes(edidVec2);
-                    edidVec = edidVec2;//edidVec must be "unknown" unless we successfully get to this line
-                }
-                else
-                {
-                    LOGWARN("failure: HDMI0 not connected!");
-                }
+                edidVec = edidVec2;//edidVec must be "unknown" unless we successfully get to this line
             }
-            catch (const device::Exception& err)
+            else
             {
-                LOG_DEVICE_EXCEPTION0();
+                LOGWARN("failure: HDMI0 not connected!");
             }
             //convert to base64
             uint16_t size = min(edidVec.size(), (size_t)numeric_limits<uint16_t>::max());
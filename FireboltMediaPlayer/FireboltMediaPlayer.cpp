@@ -27,13 +27,26 @@ namespace WPEFramework {
 
         SERVICE_REGISTRATION(FireboltMediaPlayer, 1, 0);
 
+        // The events of IMediaPlayer::ICallback, named as the implementation sends them
+        static const TCHAR* const Events[] = {
+            _T("playbackStarted"),
+            _T("playbackStateChanged"),
+            _T("playbackProgressUpdate"),
+            _T("bufferingChanged"),
+            _T("playbackSpeedChanged"),
+            _T("playbackFailed")
+        };
+
         FireboltMediaPlayer::FireboltMediaPlayer()
         : _connectionId(0)
         , _notification(this)
         , _mediaPlayer(nullptr)
+        , _implementation(nullptr)
         , _mediaPlayerSink(this)
-        , _id()
-        , _idRefCnt(0)
+        , _instances()
+        , _subscribers()
+        , _adminLock()
+        , _lifecycleLock()
         {
             RegisterAll();
         }
@@ -54,11 +67,30 @@ namespace WPEFramework {
             // change to "register" the sink for these events !!! So do it ahead of instantiation.
             _service->Register(&_notification);
 
+            Config config;
+            config.FromString(service->ConfigLine());
+
             _mediaPlayer = _service->Root<Exchange::IMediaPlayer>(_connectionId, 2000, "AampPlayerImplementation");
 
             if (_mediaPlayer) {
                 LOGINFO("Successfully instantiated Firebolt Media Player");
 
+                // IMediaPlayer has no configuration call, the pool can only be sized when it runs in our process
+                AampPlayerImplementation* implementation = dynamic_cast<AampPlayerImplementation*>(_mediaPlayer);
+                if (implementation != nullptr) {
+                    implementation->Configure(config.MaxInstances.Value(), config.PrewarmedInstances.Value(), config.IdleTimeout.Value());
+
+                    // From now on only the events somebody subscribed to are built
+                    _adminLock.Lock();
+                    _implementation = implementation;
+                    for (const TCHAR* event : Events) {
+                        _implementation->Subscribe(event, _subscribers[event] > 0);
+                    }
+                    _adminLock.Unlock();
+                } else {
+                    LOGWARN("Firebolt Media Player runs out of process, using the default player pool");
+                }
+
                 // Register events callback
                 _mediaPlayer->RegisterCallback(&_mediaPlayerSink);
 
@@ -79,6 +111,10 @@ namespace WPEFramework {
 
             service->Unregister(&_notification);
 
+            _adminLock.Lock();
+            _implementation = nullptr;
+            _adminLock.Unlock();
+
             if (_mediaPlayer->Release() != Core::ERROR_DESTRUCTION_SUCCEEDED) {
 
                 ASSERT(_connectionId != 0);
@@ -121,6 +157,13 @@ namespace WPEFramework {
 
         void FireboltMediaPlayer::RegisterAll()
         {
+            for (const TCHAR* event : Events) {
+                const string name(event);
+                RegisterEventStatusListener(name, [this, name](const string& client, Status status) {
+                    EventSubscription(name, status == Status::registered);
+                });
+            }
+
             Register(_T("create"), &FireboltMediaPlayer::create, this);
             Register(_T("release"), &FireboltMediaPlayer::release, this);
             Register(_T("load"), &FireboltMediaPlayer::load, this);
@@ -143,6 +186,10 @@ namespace WPEFramework {
             Unregister(_T("stop"));
             Unregister(_T("initConfig"));
             Unregister(_T("initDRMConfig"));
+
+            for (const TCHAR* event : Events) {
+                UnregisterEventStatusListener(event);
+            }
         }
 
         uint32_t FireboltMediaPlayer::create(const JsonObject& parameters, JsonObject& response)
@@ -159,20 +206,24 @@ namespace WPEFramework {
 
             uint32_t result = Core::ERROR_NONE;
             string newId = parameters[keyId].String();
-            if(newId == _id)
-            {
-                _idRefCnt++;
-            }
-            else if( (result = _mediaPlayer->Create(newId)) == Core::ERROR_NONE )
+
+            _lifecycleLock.Lock();
+            _adminLock.Lock();
+            std::map<string, uint32_t>::iterator index = _instances.find(newId);
+            bool exists = (index != _instances.end());
+            if(exists)
             {
-                _id = newId;
-                _idRefCnt = 1;
+                index->second++;
             }
-            else
+            _adminLock.Unlock();
+
+            if(!exists && (result = _mediaPlayer->Create(newId)) == Core::ERROR_NONE)
             {
-                _id.clear();
-                _idRefCnt = 0;
+                _adminLock.Lock();
+                _instances[newId] = 1;
+                _adminLock.Unlock();
             }
+            _lifecycleLock.Unlock();
 
             returnResponse(result == Core::ERROR_NONE);
         }
@@ -182,29 +233,34 @@ namespace WPEFramework {
             LOGINFOMETHOD();
             const char *keyId = "id";
             returnIfStringParamNotFound(parameters, keyId);
-            if(parameters[keyId].String() != _id)
+            string id = parameters[keyId].String();
+
+            _lifecycleLock.Lock();
+            _adminLock.Lock();
+            std::map<string, uint32_t>::iterator index = _instances.find(id);
+            if(index == _instances.end())
             {
-                LOGERR("Instace \'%s\' does not exist", parameters[keyId].String().c_str());
+                _adminLock.Unlock();
+                _lifecycleLock.Unlock();
+                LOGERR("Instace \'%s\' does not exist", id.c_str());
                 returnResponse(false);
             }
 
-            uint32_t result = Core::ERROR_NONE;
-            if(_idRefCnt > 1)
-            {
-                _idRefCnt--;
-            }
-            else if(_idRefCnt == 1)
+            bool last = (index->second == 1);
+            if(!last)
             {
-                if((result = _mediaPlayer->Destroy(_id)) == Core::ERROR_NONE)
-                {
-                    _idRefCnt = 0;
-                    _id.clear();
-                }
+                index->second--;
             }
-            else
+            _adminLock.Unlock();
+
+            uint32_t result = Core::ERROR_NONE;
+            if(last && (result = _mediaPlayer->Destroy(id)) == Core::ERROR_NONE)
             {
-                result == Core::ERROR_GENERAL;
+                _adminLock.Lock();
+                _instances.erase(id);
+                _adminLock.Unlock();
             }
+            _lifecycleLock.Unlock();
 
             returnResponse(result == Core::ERROR_NONE);
         }
@@ -218,7 +274,7 @@ namespace WPEFramework {
             returnIfStringParamNotFound(parameters, keyId);
             returnIfParamNotFound(parameters, keyUrl);
 
-            if(parameters[keyId].String() != _id)
+            if(!HasInstance(parameters[keyId].String()))
             {
                 LOGERR("Instace \'%s\' does not exist", parameters[keyId].String().c_str());
                 returnResponse(false);
@@ -232,7 +288,7 @@ namespace WPEFramework {
                 autoPlay = parameters[keyUrl].Boolean();
             }
 
-            returnResponse( _mediaPlayer->Load(_id, url, autoPlay) == Core::ERROR_NONE);
+            returnResponse( _mediaPlayer->Load(parameters[keyId].String(), url, autoPlay) == Core::ERROR_NONE);
         }
 
         uint32_t FireboltMediaPlayer::play(const JsonObject& parameters, JsonObject& response)
@@ -240,13 +296,13 @@ namespace WPEFramework {
             LOGINFOMETHOD();
             const char *keyId = "id";
             returnIfStringParamNotFound(parameters, keyId);
-            if(parameters[keyId].String() != _id)
+            if(!HasInstance(parameters[keyId].String()))
             {
                 LOGERR("Instace \'%s\' does not exist", parameters[keyId].String().c_str());
                 returnResponse(false);
             }
 
-            returnResponse(_mediaPlayer->Play(_id) == Core::ERROR_NONE);
+            returnResponse(_mediaPlayer->Play(parameters[keyId].String()) == Core::ERROR_NONE);
         }
 
         uint32_t FireboltMediaPlayer::pause(const JsonObject& parameters, JsonObject& response)
@@ -254,13 +310,13 @@ namespace WPEFramework {
             LOGINFOMETHOD();
             const char *keyId = "id";
             returnIfStringParamNotFound(parameters, keyId);
-            if(parameters[keyId].String() != _id)
+            if(!HasInstance(parameters[keyId].String()))
             {
                 LOGERR("Instace \'%s\' does not exist", parameters[keyId].String().c_str());
                 returnResponse(false);
             }
 
-            returnResponse(_mediaPlayer->Pause(_id) == Core::ERROR_NONE);
+            returnResponse(_mediaPlayer->Pause(parameters[keyId].String()) == Core::ERROR_NONE);
         }
 
         uint32_t FireboltMediaPlayer::seekTo(const JsonObject& parameters, JsonObject& response)
@@ -270,14 +326,14 @@ namespace WPEFramework {
             const char *keyPositionSec = "positionSec";
             returnIfStringParamNotFound(parameters, keyId);
             returnIfNumberParamNotFound(parameters, keyPositionSec);
-            if(parameters[keyId].String() != _id)
+            if(!HasInstance(parameters[keyId].String()))
             {
                 LOGERR("Instace \'%s\' does not exist", parameters[keyId].String().c_str());
                 returnResponse(false);
             }
 
             int positionSec = parameters[keyPositionSec].Number();
-            returnResponse(_mediaPlayer->SeekTo(_id, positionSec) == Core::ERROR_NONE);
+            returnResponse(_mediaPlayer->SeekTo(parameters[keyId].String(), positionSec) == Core::ERROR_NONE);
         }
 
         uint32_t FireboltMediaPlayer::stop(const JsonObject& parameters, JsonObject& response)
@@ -285,13 +341,13 @@ namespace WPEFramework {
             LOGINFOMETHOD();
             const char *keyId = "id";
             returnIfStringParamNotFound(parameters, keyId);
-            if(parameters[keyId].String() != _id)
+            if(!HasInstance(parameters[keyId].String()))
             {
                 LOGERR("Instace \'%s\' does not exist", parameters[keyId].String().c_str());
                 returnResponse(false);
             }
 
-            returnResponse(_mediaPlayer->Stop(_id) == Core::ERROR_NONE);
+            returnResponse(_mediaPlayer->Stop(parameters[keyId].String()) == Core::ERROR_NONE);
         }
 
         uint32_t FireboltMediaPlayer::initConfig(const JsonObject& parameters, JsonObject& response)
@@ -301,14 +357,14 @@ namespace WPEFramework {
             const char *keyConfig = "config";
             returnIfStringParamNotFound(parameters, keyId);
             returnIfParamNotFound(parameters, keyConfig);
-            if(parameters[keyId].String() != _id)
+            if(!HasInstance(parameters[keyId].String()))
             {
                 LOGERR("Instace \'%s\' does not exist", parameters[keyId].String().c_str());
                 returnResponse(false);
             }
 
             string config = parameters[keyId].Value();
-            returnResponse(_mediaPlayer->InitConfig(_id, config) == Core::ERROR_NONE);
+            returnResponse(_mediaPlayer->InitConfig(parameters[keyId].String(), config) == Core::ERROR_NONE);
         }
 
         uint32_t FireboltMediaPlayer::initDRMConfig(const JsonObject& parameters, JsonObject& response)
@@ -318,14 +374,39 @@ namespace WPEFramework {
             const char *keyConfig = "config";
             returnIfStringParamNotFound(parameters, keyId);
             returnIfParamNotFound(parameters, keyConfig);
-            if(parameters[keyId].String() != _id)
+            if(!HasInstance(parameters[keyId].String()))
             {
                 LOGERR("Instace \'%s\' does not exist", parameters[keyId].String().c_str());
                 returnResponse(false);
             }
 
             string config = parameters[keyId].Value();
-            returnResponse(_mediaPlayer->InitDRMConfig(_id, config) == Core::ERROR_NONE);
+            returnResponse(_mediaPlayer->InitDRMConfig(parameters[keyId].String(), config) == Core::ERROR_NONE);
+        }
+
+        bool FireboltMediaPlayer::HasInstance(const string& id) const
+        {
+            _adminLock.Lock();
+            bool result = (_instances.find(id) != _instances.end());
+            _adminLock.Unlock();
+            return result;
+        }
+
+        void FireboltMediaPlayer::EventSubscription(const string& event, bool subscribed)
+        {
+            _adminLock.Lock();
+            uint32_t& count = _subscribers[event];
+            if (subscribed) {
+                count++;
+            } else if (count > 0) {
+                count--;
+            }
+
+            // Out of process the implementation cannot be told, it builds all of them
+            if (_implementation != nullptr) {
+                _implementation->Subscribe(event, count > 0);
+            }
+            _adminLock.Unlock();
         }
 
         void FireboltMediaPlayer::onMediaPlayerEvent(const string& id, const string &eventName, const string &parametersJson)
@@ -20,16 +20,45 @@
 #pragma once
 
 #include "Module.h"
+#include "Implementation/AampPlayerImplementation.h"
 #include <interfaces/IMediaPlayer.h>
 
+#include <map>
+
 namespace WPEFramework {
     namespace Plugin {
 
-        class FireboltMediaPlayer : public PluginHost::IPlugin, public PluginHost::JSONRPC {
+        class FireboltMediaPlayer : public PluginHost::IPlugin, public PluginHost::JSONRPCSupportsEventStatus {
         private:
             FireboltMediaPlayer(const FireboltMediaPlayer&) = delete;
             FireboltMediaPlayer& operator=(const FireboltMediaPlayer&) = delete;
 
+            class Config : public Core::JSON::Container {
+            private:
+                Config(const Config&) = delete;
+                Config& operator=(const Config&) = delete;
+
+            public:
+                Config()
+                    : Core::JSON::Container()
+                    , MaxInstances(4)           // Players in use at the same time
+                    , PrewarmedInstances(1)     // Idle players kept ready for create
+                    , IdleTimeout(30)           // Seconds before an extra idle player is released
+                {
+                    Add(_T("maxinstances"), &MaxInstances);
+                    Add(_T("prewarmedinstances"), &PrewarmedInstances);
+                    Add(_T("idletimeout"), &IdleTimeout);
+                }
+                ~Config() override
+                {
+                }
+
+            public:
+                Core::JSON::DecUInt8 MaxInstances;
+                Core::JSON::DecUInt8 PrewarmedInstances;
+                Core::JSON::DecUInt16 IdleTimeout;
+            };
+
             class Notification : public RPC::IRemoteConnection::INotification {
             private:
                 Notification() = delete;
@@ -125,6 +154,8 @@ namespace WPEFramework {
 
             private:
             void Deactivated(RPC::IRemoteConnection* connection);
+            bool HasInstance(const string& id) const;
+            void EventSubscription(const string& event, bool subscribed);
 
             // JsonRpc
             void RegisterAll();
@@ -138,10 +169,18 @@ namespace WPEFramework {
             // Media Player with AAMP implementation running in separate process
             //TODO: consider list of different MediaPlayers
             Exchange::IMediaPlayer* _mediaPlayer;
+            // The same object when it runs in our process, nullptr otherwise
+            AampPlayerImplementation* _implementation;
             Core::Sink<MediaPlayerSink> _mediaPlayerSink;
-            //TODO: for multi-instance case consider map of ID's
-            string _id;
-            uint32_t _idRefCnt;
+            // Reference count of each created id
+            std::map<string, uint32_t> _instances;
+            // Subscribers of each event
+            std::map<string, uint32_t> _subscribers;
+            // Guards _instances, _subscribers and _implementation, never held across a call into the
+            // implementation that could go out of process
+            mutable Core::CriticalSection _adminLock;
+            // Keeps create and release in order, so the other methods never wait for a player to be built or stopped
+            Core::CriticalSection _lifecycleLock;
         };
 
     } //namespace Plugin
@@ -20,60 +20,177 @@
 #include "AampPlayerImplementation.h"
 #include "utils.h"
 
+#include <algorithm>
+
 namespace WPEFramework {
 
     namespace Plugin {
 
         SERVICE_REGISTRATION(AampPlayerImplementation, 1, 0);
 
+        // Player pool defaults, until the plugin passes its configuration to Configure
+        static constexpr uint32_t DefaultMaxInstances = 4;
+        static constexpr uint32_t DefaultPrewarmedInstances = 1;
+        static constexpr uint32_t DefaultIdleTimeout = 30; // seconds
+
+        // By EventType. Of a coalescing type only the latest pending event of an instance is delivered.
+        static const struct {
+            const TCHAR* name;
+            bool coalesce;
+        } EventTypes[] = {
+            { _T("playbackStarted"), false },
+            { _T("playbackStateChanged"), false },
+            { _T("playbackProgressUpdate"), true },
+            { _T("bufferingChanged"), false },
+            { _T("playbackSpeedChanged"), false },
+            { _T("playbackFailed"), false }
+        };
+
         AampPlayerImplementation::AampPlayerImplementation()
         : _adminLock()
-        , _callback(nullptr)
-        , _initialized(false)
-        , _aampPlayer(nullptr)
-        , _aampEventListener(nullptr)
+        , _eventDispatcher()
+        , _eventMask((1 << EVENT_COUNT) - 1)
+        , _instances()
+        , _idle()
+        , _pending(0)
+        , _creating(0)
+        , _maxInstances(DefaultMaxInstances)
+        , _prewarmedInstances(DefaultPrewarmedInstances)
+        , _idleTimeout(DefaultIdleTimeout)
+        , _stopping(false)
         , _aampGstPlayerMainLoop(nullptr)
+        , _poolWorker(this)
         {
             //temporary back door for AAMP configuration
             Core::SystemInfo::SetEnvironment(_T("AAMP_ENABLE_OPT_OVERRIDE"), _T("1"));
             //TODO: should be set accordingly to platform set-up
             Core::SystemInfo::SetEnvironment(_T("AAMP_ENABLE_WESTEROS_SINK"), _T("1"));
+
+            // One GStreamer set-up and main loop for all instances, for the lifetime of the implementation
+            gst_init(0, nullptr);
+            _aampGstPlayerMainLoop = g_main_loop_new(nullptr, false);
+            Run();
+
+            _poolWorker.Run();
         }
 
         AampPlayerImplementation::~AampPlayerImplementation()
         {
             LOGINFO();
             _adminLock.Lock();
-            DeinitializePlayerInstance();
-            ASSERT(_aampPlayer == nullptr);
-            ASSERT(_aampEventListener == nullptr);
+            _stopping = true;
+            InstanceList instances;
+            instances.swap(_idle);
+            for (auto& entry : _instances) {
+                instances.push_back(entry.second);
+            }
+            _instances.clear();
+            _adminLock.Unlock();
+
+            _poolWorker.Block();
+            _poolWorker.Wait(Thread::BLOCKED | Thread::STOPPED, Core::infinite);
+
+            for (PlayerInstance* instance : instances) {
+                instance->Player()->Stop();
+                delete instance;
+            }
+
+            _eventDispatcher.Stop();
+
+            Block();
+            if(_aampGstPlayerMainLoop)
+            {
+                g_main_loop_quit(_aampGstPlayerMainLoop);
+            }
+            Wait(Thread::BLOCKED | Thread::STOPPED, Core::infinite);
             ASSERT(_aampGstPlayerMainLoop == nullptr);
         }
 
+        void AampPlayerImplementation::Configure(uint32_t maxInstances, uint32_t prewarmedInstances, uint32_t idleTimeout)
+        {
+            LOGINFO("Player pool: up to %u instances, %u pre-warmed, idle timeout %u s",
+                    maxInstances, prewarmedInstances, idleTimeout);
+
+            _adminLock.Lock();
+            _maxInstances = std::max(maxInstances, 1u);
+            _prewarmedInstances = prewarmedInstances;
+            _idleTimeout = idleTimeout;
+            _adminLock.Unlock();
+
+            // Fill or trim the pool to the new size
+            _poolWorker.Run();
+        }
+
+        void AampPlayerImplementation::Subscribe(const string& event, bool subscribed)
+        {
+            for (uint8_t type = 0; type < EVENT_COUNT; type++) {
+                if (event == EventTypes[type].name) {
+                    if (subscribed) {
+                        _eventMask |= (1 << type);
+                    }
+                    else {
+                        _eventMask &= ~(1 << type);
+                    }
+                }
+            }
+        }
+
         uint32_t AampPlayerImplementation::Create(const string& id)
         {
             LOGINFO("Create with id: %s", id.c_str());
+            uint32_t result = Core::ERROR_NONE;
+
             _adminLock.Lock();
-            if(id == _id && _initialized)
+            PlayerInstance* instance = nullptr;
+            if(_instances.find(id) == _instances.end())
             {
-                _adminLock.Unlock();
-                return Core::ERROR_NONE;
+                if(_instances.size() + _creating >= _maxInstances)
+                {
+                    LOGERR("All %u player instances are in use, cannot create %s", _maxInstances, id.c_str());
+                    result = Core::ERROR_UNAVAILABLE;
+                }
+                else if(_idle.empty())
+                {
+                    // Built outside of the lock, it counts against the limit meanwhile
+                    _creating++;
+                    _adminLock.Unlock();
+
+                    LOGWARN("No pre-warmed player left, creating one for %s", id.c_str());
+                    instance = new PlayerInstance(this);
+
+                    _adminLock.Lock();
+                    _creating--;
+                }
+                else
+                {
+                    // The most recently used one
+                    instance = _idle.back();
+                    _idle.pop_back();
+                }
             }
 
-            if(_initialized)
+            if(instance != nullptr)
             {
-                DeinitializePlayerInstance();
-                _initialized = false;
+                if(_instances.find(id) == _instances.end())
+                {
+                    instance->Id(id);
+                    _instances[id] = instance;
+                    instance = nullptr;
+                }
+                else if(!_stopping)
+                {
+                    // Created under the same id meanwhile, keep this one for the next
+                    instance->IdleSince(Core::Time::Now().Ticks());
+                    _idle.push_back(instance);
+                    instance = nullptr;
+                }
             }
+            _adminLock.Unlock();
 
-            uint32_t result = InitializePlayerInstance();
-            if(result == Core::ERROR_NONE)
-            {
-                _initialized = true;
-                _id = id;
-            }
+            delete instance;
 
-            _adminLock.Unlock();
+            // Get the next one ready
+            _poolWorker.Run();
 
             return result;
         }
@@ -82,14 +199,39 @@ namespace WPEFramework {
         {
             LOGINFO("Destroy with id=%s", id.c_str());
             _adminLock.Lock();
-            if(_initialized)
+            InstanceMap::iterator index = _instances.find(id);
+            if(index == _instances.end())
             {
-                DeinitializePlayerInstance();
-                _initialized = false;
+                _adminLock.Unlock();
+                return Core::ERROR_NONE;
             }
 
-            _id.clear();
+            PlayerInstance* instance = index->second;
+            _instances.erase(index);
+            _adminLock.Unlock();
+
+            // Outside of the lock, the state change it causes is reported through SendEvent
+            instance->Player()->Stop();
+
+            // Back to the pool rather than torn down, the reaper deletes it if nobody needs it for a while
+            _adminLock.Lock();
+            instance->Id(string());
+            bool recycle = (!_stopping) &&
+                    ((_instances.size() + _idle.size() + _pending + _creating) < (_maxInstances + _prewarmedInstances));
+            if(recycle)
+            {
+                instance->IdleSince(Core::Time::Now().Ticks());
+                _idle.push_back(instance);
+            }
             _adminLock.Unlock();
+
+            if(!recycle)
+            {
+                delete instance;
+            }
+
+            _poolWorker.Run();
+
             return Core::ERROR_NONE;
         }
 
@@ -98,15 +240,14 @@ namespace WPEFramework {
             LOGINFO("Load with id=%s, url=%s, autoPlay=%d",
                     id.c_str(), url.c_str(), autoPlay);
             _adminLock.Lock();
-            uint32_t result = AssertPlayerStateAndIdNoBlocking(id);
-            if(result != Core::ERROR_NONE)
+            PlayerInstanceAAMP* player = FindPlayerNoBlocking(id);
+            if(player == nullptr)
             {
                 _adminLock.Unlock();
-                return result;
+                return Core::ERROR_UNAVAILABLE;
             }
 
-            ASSERT(_aampPlayer != nullptr);
-            _aampPlayer->Tune(url.c_str(), autoPlay);
+            player->Tune(url.c_str(), autoPlay);
 
             _adminLock.Unlock();
             return Core::ERROR_NONE;
@@ -116,15 +257,14 @@ namespace WPEFramework {
         {
             LOGINFO("Play with id=%s", id.c_str());
             _adminLock.Lock();
-            uint32_t result = AssertPlayerStateAndIdNoBlocking(id);
-            if(result != Core::ERROR_NONE)
+            PlayerInstanceAAMP* player = FindPlayerNoBlocking(id);
+            if(player == nullptr)
             {
                 _adminLock.Unlock();
-                return result;
+                return Core::ERROR_UNAVAILABLE;
             }
 
-            ASSERT(_aampPlayer != nullptr);
-            _aampPlayer->SetRate(1);
+            player->SetRate(1);
 
             _adminLock.Unlock();
             return Core::ERROR_NONE;
@@ -134,15 +274,14 @@ namespace WPEFramework {
         {
             LOGINFO("Pause with id=%s", id.c_str());
             _adminLock.Lock();
-            uint32_t result = AssertPlayerStateAndIdNoBlocking(id);
-            if(result != Core::ERROR_NONE)
+            PlayerInstanceAAMP* player = FindPlayerNoBlocking(id);
+            if(player == nullptr)
             {
                 _adminLock.Unlock();
-                return result;
+                return Core::ERROR_UNAVAILABLE;
             }
 
-            ASSERT(_aampPlayer != nullptr);
-            _aampPlayer->SetRate(0);
+            player->SetRate(0);
 
             _adminLock.Unlock();
             return Core::ERROR_NONE;
@@ -152,15 +291,14 @@ namespace WPEFramework {
         {
             LOGINFO("SetPosition with id=%s",id.c_str());
             _adminLock.Lock();
-            uint32_t result = AssertPlayerStateAndIdNoBlocking(id);
-            if(result != Core::ERROR_NONE)
+            PlayerInstanceAAMP* player = FindPlayerNoBlocking(id);
+            if(player == nullptr)
             {
                 _adminLock.Unlock();
-                return result;
+                return Core::ERROR_UNAVAILABLE;
             }
 
-            ASSERT(_aampPlayer != nullptr);
-            _aampPlayer->Seek(static_cast<double>(positionSec));
+            player->Seek(static_cast<double>(positionSec));
 
             _adminLock.Unlock();
             return Core::ERROR_NONE;
@@ -170,15 +308,14 @@ namespace WPEFramework {
         {
             LOGINFO("Stop with id=%s", id.c_str());
             _adminLock.Lock();
-            uint32_t result = AssertPlayerStateAndIdNoBlocking(id);
-            if(result != Core::ERROR_NONE)
+            PlayerInstanceAAMP* player = FindPlayerNoBlocking(id);
+            if(player == nullptr)
             {
                 _adminLock.Unlock();
-                return result;
+                return Core::ERROR_UNAVAILABLE;
             }
 
-            ASSERT(_aampPlayer != nullptr);
-            _aampPlayer->Stop();
+            player->Stop();
 
             _adminLock.Unlock();
             return Core::ERROR_NONE;
@@ -207,8 +344,39 @@ namespace WPEFramework {
         void AampPlayerImplementation::RegisterCallback(IMediaPlayer::ICallback* callback)
         {
             LOGINFO("RegisterCallback");
+            _eventDispatcher.Callback(callback);
+        }
+
+        void AampPlayerImplementation::SendEvent(const PlayerInstance* instance, EventType type, const string& parameters)
+        {
             _adminLock.Lock();
+            const string id = instance->Id();
+            _adminLock.Unlock();
+
+            // Idle in the pool, nobody to tell
+            if(!id.empty())
+            {
+                _eventDispatcher.Post(id, type, parameters);
+            }
+        }
+
+        AampPlayerImplementation::EventDispatcher::EventDispatcher()
+        : Core::Thread(Core::Thread::DefaultStackSize(), _T("AampPlayerEvents"))
+        , _lock()
+        , _callback(nullptr)
+        , _events()
+        , _stopped(false)
+        {
+        }
+
+        AampPlayerImplementation::EventDispatcher::~EventDispatcher()
+        {
+            Stop();
+        }
 
+        void AampPlayerImplementation::EventDispatcher::Callback(IMediaPlayer::ICallback* callback)
+        {
+            _lock.Lock();
             if (_callback != nullptr) {
                 _callback->Release();
             }
@@ -216,22 +384,85 @@ namespace WPEFramework {
                 callback->AddRef();
             }
             _callback = callback;
-            _adminLock.Unlock();
+            _lock.Unlock();
         }
 
-        void AampPlayerImplementation::SendEvent(const string& eventName, const string& parameters)
+        void AampPlayerImplementation::EventDispatcher::Post(const string& id, EventType type, const string& parameters)
         {
-            LOGINFO("SendEvent for id=%s, eventName=%s, parameters=%s",
-                    _id.c_str(), eventName.c_str(), parameters.c_str());
-            _adminLock.Lock();
-            if(!_callback)
+            _lock.Lock();
+            if(_stopped)
             {
-                LOGERR("SendEvent: callback is null");
-                _adminLock.Unlock();
+                _lock.Unlock();
                 return;
             }
-            _callback->Event(_id, eventName, parameters);
-            _adminLock.Unlock();
+
+            std::list<Event>::iterator index = _events.end();
+            if(EventTypes[type].coalesce)
+            {
+                index = std::find_if(_events.begin(), _events.end(), [&](const Event& event) {
+                    return ((event.type == type) && (event.id == id));
+                });
+            }
+
+            if(index != _events.end())
+            {
+                // The consumer is behind, it only gets to see the latest one, after whatever came in between
+                _events.erase(index);
+            }
+
+            _events.push_back({ id, type, parameters });
+            Run();
+            _lock.Unlock();
+        }
+
+        void AampPlayerImplementation::EventDispatcher::Stop()
+        {
+            _lock.Lock();
+            _stopped = true;
+            _events.clear();
+            Block();
+            _lock.Unlock();
+
+            Wait(Thread::BLOCKED | Thread::STOPPED, Core::infinite);
+
+            _lock.Lock();
+            if (_callback != nullptr) {
+                _callback->Release();
+                _callback = nullptr;
+            }
+            _lock.Unlock();
+        }
+
+        uint32_t AampPlayerImplementation::EventDispatcher::Worker()
+        {
+            while(IsRunning() == true) {
+                _lock.Lock();
+                if(_events.empty() == true)
+                {
+                    // Checked and blocked under the lock, so an event posted meanwhile cannot be missed
+                    Block();
+                    _lock.Unlock();
+                    break;
+                }
+
+                Event event(std::move(_events.front()));
+                _events.pop_front();
+                IMediaPlayer::ICallback* callback = _callback;
+                if (callback != nullptr) {
+                    callback->AddRef();
+                }
+                _lock.Unlock();
+
+                if (callback != nullptr) {
+                    callback->Event(event.id, EventTypes[event.type].name, event.parameters);
+                    callback->Release();
+                }
+                else {
+                    LOGERR("SendEvent: callback is null");
+                }
+            }
+
+            return Core::infinite;
         }
 
         // Thread overrides
@@ -246,92 +477,102 @@ namespace WPEFramework {
             return WPEFramework::Core::infinite;
         }
 
-        uint32_t AampPlayerImplementation::InitializePlayerInstance()
+        PlayerInstanceAAMP* AampPlayerImplementation::FindPlayerNoBlocking(const string& id) const
         {
-            ASSERT(_aampPlayer == nullptr);
-            ASSERT(_aampEventListener == nullptr);
-            ASSERT(_aampGstPlayerMainLoop == nullptr);
-
-            gst_init(0, nullptr);
-            _aampPlayer = new PlayerInstanceAAMP();
-            if(_aampPlayer == nullptr)
-            {
-                return Core::ERROR_GENERAL;
-            }
-
-            _aampEventListener = new AampEventListener(this);
-            if(_aampEventListener == nullptr)
+            InstanceMap::const_iterator index = _instances.find(id);
+            if(index == _instances.end())
             {
-                //cleanup
-                DeinitializePlayerInstance();
-                return Core::ERROR_GENERAL;
+                LOGERR("Instance %s does not exist, call Create method first!", id.c_str());
+                return nullptr;
             }
 
-            _aampPlayer->RegisterEvents(_aampEventListener);
-            _aampPlayer->SetReportInterval(1000 /* ms */);
-
-            _aampGstPlayerMainLoop = g_main_loop_new(nullptr, false);
-
-            // Run thread with _aampGstPlayerMainLoop
-            Run();
-
-            return Core::ERROR_NONE;
+            ASSERT(index->second->Player() != nullptr);
+            return index->second->Player();
         }
 
-        uint32_t AampPlayerImplementation::AssertPlayerStateAndIdNoBlocking(const string& id)
+        // Runs on the pool worker, returns the time in ms until it needs to run again
+        uint32_t AampPlayerImplementation::MaintainPool()
         {
-            if(!_initialized)
+            const uint64_t now = Core::Time::Now().Ticks();
+            const uint64_t timeout = static_cast<uint64_t>(_idleTimeout) * 1000 * Core::Time::TicksPerMillisecond;
+            uint32_t next = Core::infinite;
+            InstanceList expired;
+
+            _adminLock.Lock();
+
+            // Oldest first, but the pre-warmed ones are always kept
+            while((_idle.size() > _prewarmedInstances) && ((now - _idle.front()->IdleSince()) >= timeout))
             {
-                LOGERR("Player is uninitialized, call Create method first!");
-                return Core::ERROR_ILLEGAL_STATE;
+                expired.push_back(_idle.front());
+                _idle.pop_front();
             }
-
-            if(_id != id)
+            if(_idle.size() > _prewarmedInstances)
             {
-                LOGERR("Instace ID is incorrect! Current: %s, requested %s",
-                        _id.c_str(), id.c_str());
-                return Core::ERROR_UNAVAILABLE;
+                next = static_cast<uint32_t>((timeout - (now - _idle.front()->IdleSince())) / Core::Time::TicksPerMillisecond) + 1;
             }
 
-            return Core::ERROR_NONE;
-        }
-
-        void AampPlayerImplementation::DeinitializePlayerInstance()
-        {
-            if(_aampPlayer)
+            bool prewarm = (!_stopping) && ((_idle.size() + _pending) < _prewarmedInstances) &&
+                    ((_instances.size() + _idle.size() + _pending + _creating) < (_maxInstances + _prewarmedInstances));
+            if(prewarm)
             {
-                _aampPlayer->Stop();
+                _pending++;
             }
 
             _adminLock.Unlock();
-            Block();
-            if(_aampGstPlayerMainLoop)
-            {
-                g_main_loop_quit(_aampGstPlayerMainLoop);
+
+            for (PlayerInstance* instance : expired) {
+                LOGINFO("Reaping a player that was idle for more than %u s", _idleTimeout);
+                delete instance;
             }
 
-            Wait(Thread::BLOCKED | Thread::STOPPED, Core::infinite);
+            if(prewarm)
+            {
+                PlayerInstance* instance = new PlayerInstance(this);
+
+                _adminLock.Lock();
+                _pending--;
+                bool keep = !_stopping;
+                if(keep)
+                {
+                    instance->IdleSince(Core::Time::Now().Ticks());
+                    _idle.push_back(instance);
+                }
+                _adminLock.Unlock();
 
-            _adminLock.Lock();
+                if(!keep)
+                {
+                    delete instance;
+                }
 
-            if(_aampPlayer)
-            {
-                _aampPlayer->RegisterEvents(nullptr);
-                delete _aampPlayer;
-                _aampPlayer = nullptr;
+                // See whether more are needed right away
+                next = 0;
             }
 
-            if(_aampEventListener)
-            {
-                delete _aampEventListener;
-                _aampEventListener = nullptr;
-            }
+            return next;
+        }
+
+        AampPlayerImplementation::PlayerInstance::PlayerInstance(AampPlayerImplementation* player)
+        : _id()
+        , _idleSince(0)
+        , _aampEventListener(player, this)
+        , _aampPlayer(new PlayerInstanceAAMP())
+        {
+            _aampPlayer->RegisterEvents(&_aampEventListener);
+            _aampPlayer->SetReportInterval(1000 /* ms */);
+        }
+
+        AampPlayerImplementation::PlayerInstance::~PlayerInstance()
+        {
+            _aampPlayer->RegisterEvents(nullptr);
+            delete _aampPlayer;
         }
 
-        AampPlayerImplementation::AampEventListener::AampEventListener(AampPlayerImplementation* player)
+        AampPlayerImplementation::AampEventListener::AampEventListener(AampPlayerImplementation* player, PlayerInstance* instance)
         : _player(player)
+        , _instance(instance)
         {
             ASSERT(_player != nullptr);
+            ASSERT(_instance != nullptr);
         }
 
         AampPlayerImplementation::AampEventListener::~AampEventListener()
@@ -340,26 +581,32 @@ namespace WPEFramework {
 
         void AampPlayerImplementation::AampEventListener::Event(const AAMPEvent& event)
         {
-            LOGINFO("Event: handling event: %d", event.type);
+            // Nothing is built for event types nobody listens to
             switch(event.type)
             {
                 case AAMP_EVENT_TUNED:
-                    HandlePlaybackStartedEvent();
+                    if(_player->IsSubscribed(EVENT_PLAYBACK_STARTED))
+                        HandlePlaybackStartedEvent();
                     break;
                 case AAMP_EVENT_TUNE_FAILED:
-                    HandlePlaybackFailed(event);
+                    if(_player->IsSubscribed(EVENT_PLAYBACK_FAILED))
+                        HandlePlaybackFailed(event);
                     break;
                 case AAMP_EVENT_SPEED_CHANGED:
-                    HandlePlaybackSpeedChanged(event);
+                    if(_player->IsSubscribed(EVENT_PLAYBACK_SPEED_CHANGED))
+                        HandlePlaybackSpeedChanged(event);
                     break;
                 case AAMP_EVENT_PROGRESS:
-                    HandlePlaybackProgressUpdateEvent(event);
+                    if(_player->IsSubscribed(EVENT_PLAYBACK_PROGRESS_UPDATE))
+                        HandlePlaybackProgressUpdateEvent(event);
                     break;
                 case AAMP_EVENT_STATE_CHANGED:
-                    HandlePlaybackStateChangedEvent(event);
+                    if(_player->IsSubscribed(EVENT_PLAYBACK_STATE_CHANGED))
+                        HandlePlaybackStateChangedEvent(event);
                     break;
                 case AAMP_EVENT_BUFFERING_CHANGED:
-                    HandleBufferingChangedEvent(event);
+                    if(_player->IsSubscribed(EVENT_BUFFERING_CHANGED))
+                        HandleBufferingChangedEvent(event);
                     break;
                 default:
                     LOGWARN("Event: AAMP event is not supported: %d", event.type);
@@ -368,7 +615,7 @@ namespace WPEFramework {
 
         void AampPlayerImplementation::AampEventListener::HandlePlaybackStartedEvent()
         {
-            _player->SendEvent(_T("playbackStarted"), string());
+            _player->SendEvent(_instance, EVENT_PLAYBACK_STARTED, string());
         }
 
         void AampPlayerImplementation::AampEventListener::HandlePlaybackStateChangedEvent(const AAMPEvent& event)
@@ -378,7 +625,7 @@ namespace WPEFramework {
 
             string s;
             parameters.ToString(s);
-            _player->SendEvent(_T("playbackStateChanged"), s);
+            _player->SendEvent(_instance, EVENT_PLAYBACK_STATE_CHANGED, s);
         }
 
         void AampPlayerImplementation::AampEventListener::HandlePlaybackProgressUpdateEvent(const AAMPEvent& event)
@@ -392,7 +639,7 @@ namespace WPEFramework {
 
             string s;
             parameters.ToString(s);
-            _player->SendEvent(_T("playbackProgressUpdate"), s);
+            _player->SendEvent(_instance, EVENT_PLAYBACK_PROGRESS_UPDATE, s);
         }
 
         void AampPlayerImplementation::AampEventListener::HandleBufferingChangedEvent(const AAMPEvent& event)
@@ -402,7 +649,7 @@ namespace WPEFramework {
 
             string s;
             parameters.ToString(s);
-            _player->SendEvent(_T("bufferingChanged"), s);
+            _player->SendEvent(_instance, EVENT_BUFFERING_CHANGED, s);
         }
 
         void AampPlayerImplementation::AampEventListener::HandlePlaybackSpeedChanged(const AAMPEvent& event)
@@ -412,7 +659,7 @@ namespace WPEFramework {
 
             string s;
             parameters.ToString(s);
-            _player->SendEvent(_T("playbackSpeedChanged"), s);
+            _player->SendEvent(_instance, EVENT_PLAYBACK_SPEED_CHANGED, s);
         }
 
         void AampPlayerImplementation::AampEventListener::HandlePlaybackFailed(const AAMPEvent& event)
@@ -424,7 +671,7 @@ namespace WPEFramework {
 
             string s;
             parameters.ToString(s);
-            _player->SendEvent(_T("playbackFailed"), s);
+            _player->SendEvent(_instance, EVENT_PLAYBACK_FAILED, s);
         }
 
 
@@ -25,6 +25,10 @@
 #include <main_aamp.h>
 #include <interfaces/IStream.h>
 
+#include <atomic>
+#include <list>
+#include <map>
+
 namespace WPEFramework {
 
     namespace Plugin {
@@ -47,6 +51,11 @@ namespace WPEFramework {
             virtual uint32_t InitDRMConfig(const string& id, const string& configurationJson) override;
             void RegisterCallback(IMediaPlayer::ICallback* callback) override;
 
+            // Not part of IMediaPlayer, the plugin calls it when the implementation runs in its process
+            void Configure(uint32_t maxInstances, uint32_t prewarmedInstances, uint32_t idleTimeout);
+            // Whether anybody listens to the event of that name, they are all delivered until told otherwise
+            void Subscribe(const string& event, bool subscribed);
+
             BEGIN_INTERFACE_MAP(AampPlayerImplementation)
             INTERFACE_ENTRY(Exchange::IMediaPlayer)
             END_INTERFACE_MAP
@@ -61,13 +70,25 @@ namespace WPEFramework {
 
             //Helper types/classes
             typedef struct _GMainLoop GMainLoop;
+            class PlayerInstance;
+
+            enum EventType : uint8_t {
+                EVENT_PLAYBACK_STARTED = 0,
+                EVENT_PLAYBACK_STATE_CHANGED,
+                EVENT_PLAYBACK_PROGRESS_UPDATE,
+                EVENT_BUFFERING_CHANGED,
+                EVENT_PLAYBACK_SPEED_CHANGED,
+                EVENT_PLAYBACK_FAILED,
+                EVENT_COUNT
+            };
+
             class AampEventListener : public AAMPEventListener {
             public:
                 AampEventListener() = delete;
                 AampEventListener(const AampEventListener&) = delete;
                 AampEventListener& operator=(const AampEventListener&) = delete;
 
-                AampEventListener(AampPlayerImplementation* player);
+                AampEventListener(AampPlayerImplementation* player, PlayerInstance* instance);
                 ~AampEventListener() override;
 
                 void Event(const AAMPEvent& event) override;
@@ -81,22 +102,137 @@ namespace WPEFramework {
                 void HandlePlaybackFailed(const AAMPEvent& event);
 
                 AampPlayerImplementation* _player;
+                PlayerInstance* _instance;
             };
 
-            void SendEvent(const string& eventName, const string& parameters);
-            void DeinitializePlayerInstance();
-            uint32_t InitializePlayerInstance();
-            uint32_t AssertPlayerStateAndIdNoBlocking(const string& id);
+            // One AAMP player, either in use under an id or idle in the pool
+            class PlayerInstance {
+            public:
+                PlayerInstance() = delete;
+                PlayerInstance(const PlayerInstance&) = delete;
+                PlayerInstance& operator=(const PlayerInstance&) = delete;
+
+                explicit PlayerInstance(AampPlayerImplementation* player);
+                ~PlayerInstance();
+
+                PlayerInstanceAAMP* Player() const
+                {
+                    return _aampPlayer;
+                }
+
+                // Id and idle time are guarded by the implementation's _adminLock
+                const string& Id() const
+                {
+                    return _id;
+                }
+                void Id(const string& id)
+                {
+                    _id = id;
+                }
+                uint64_t IdleSince() const
+                {
+                    return _idleSince;
+                }
+                void IdleSince(uint64_t ticks)
+                {
+                    _idleSince = ticks;
+                }
 
-            mutable Core::CriticalSection _adminLock;
-            IMediaPlayer::ICallback *_callback;
+            private:
+                string _id;
+                uint64_t _idleSince;
+                AampEventListener _aampEventListener;
+                PlayerInstanceAAMP* _aampPlayer;
+            };
+
+            // Keeps the idle pool filled and reaps instances that stayed idle too long
+            class PoolWorker : public Core::Thread {
+            public:
+                PoolWorker() = delete;
+                PoolWorker(const PoolWorker&) = delete;
+                PoolWorker& operator=(const PoolWorker&) = delete;
+
+                explicit PoolWorker(AampPlayerImplementation* player)
+                : Core::Thread(Core::Thread::DefaultStackSize(), _T("AampPlayerPool"))
+                , _player(player)
+                {
+                }
+                ~PoolWorker() override
+                {
+                }
 
-            //TODO: for multi-instances case consider separate instance class with thread
-            bool _initialized;
-            string _id;
-            PlayerInstanceAAMP* _aampPlayer;
-            AampEventListener *_aampEventListener;
+            private:
+                uint32_t Worker() override
+                {
+                    return _player->MaintainPool();
+                }
+
+                AampPlayerImplementation* _player;
+            };
+
+            // Delivers events to the callback on its own thread, so that neither the players nor the
+            // API calls ever wait for the consumer. While the consumer is behind, a pending event of a
+            // coalescing type is dropped when a newer one of the same instance is queued, so the consumer
+            // never sees an older state after a newer one.
+            class EventDispatcher : public Core::Thread {
+            public:
+                EventDispatcher(const EventDispatcher&) = delete;
+                EventDispatcher& operator=(const EventDispatcher&) = delete;
+
+                EventDispatcher();
+                ~EventDispatcher() override;
+
+                void Callback(IMediaPlayer::ICallback* callback);
+                void Post(const string& id, EventType type, const string& parameters);
+                void Stop();
+
+            private:
+                uint32_t Worker() override;
+
+                struct Event {
+                    string id;
+                    EventType type;
+                    string parameters;
+                };
+
+                Core::CriticalSection _lock;
+                IMediaPlayer::ICallback* _callback;
+                std::list<Event> _events;
+                bool _stopped;
+            };
+
+            typedef std::map<string, PlayerInstance*> InstanceMap;
+            typedef std::list<PlayerInstance*> InstanceList;
+
+            bool IsSubscribed(EventType type) const
+            {
+                return ((_eventMask & (1 << type)) != 0);
+            }
+            void SendEvent(const PlayerInstance* instance, EventType type, const string& parameters);
+            PlayerInstanceAAMP* FindPlayerNoBlocking(const string& id) const;
+            uint32_t MaintainPool();
+
+            mutable Core::CriticalSection _adminLock;
+            EventDispatcher _eventDispatcher;
+            // Event types anybody listens to, the others are never built
+            std::atomic<uint32_t> _eventMask;
+
+            // Instances in use, by id
+            InstanceMap _instances;
+            // Ready to be handed out by Create, oldest first
+            InstanceList _idle;
+            // Being pre-warmed by the pool worker, not yet in _idle
+            uint32_t _pending;
+            // Being built by Create for an id, not yet in _instances
+            uint32_t _creating;
+            uint32_t _maxInstances;
+            uint32_t _prewarmedInstances;
+            uint32_t _idleTimeout;
+            bool _stopping;
+
+            // Drives the GStreamer/AAMP callbacks of all instances
             GMainLoop *_aampGstPlayerMainLoop;
+            PoolWorker _poolWorker;
         };
 
     } //Plugin
@@ -26,6 +26,8 @@
 #define METHOD_START_FPS_COLLECTION "startFpsCollection"
 #define METHOD_STOP_FPS_COLLECTION "stopFpsCollection"
 #define METHOD_UPDATE_FPS_COLLECTION "updateFps"
+#define METHOD_UPDATE_FRAME_TIMES "updateFrameTimes"
+#define METHOD_GET_FRAME_STATS "getFrameStats"
 
 // Events
 #define EVENT_FPS_UPDATE "onFpsEvent"
@@ -46,6 +48,7 @@ namespace WPEFramework
 
         FrameRate::FrameRate()
         : AbstractPlugin()
+        , m_lastFrameTimestamp(0)
         {
             LOGINFO();
             FrameRate::_instance = this;
@@ -54,6 +57,8 @@ namespace WPEFramework
             Register(METHOD_START_FPS_COLLECTION, &FrameRate::startFpsCollectionWrapper, this);
             Register(METHOD_STOP_FPS_COLLECTION, &FrameRate::stopFpsCollectionWrapper, this);
             Register(METHOD_UPDATE_FPS_COLLECTION, &FrameRate::updateFpsWrapper, this);
+            Register(METHOD_UPDATE_FRAME_TIMES, &FrameRate::updateFrameTimesWrapper, this);
+            Register(METHOD_GET_FRAME_STATS, &FrameRate::getFrameStatsWrapper, this);
             
             m_reportFpsTimer.connect( std::bind( &FrameRate::onReportFpsTimer, this ) );
         }
@@ -113,6 +118,71 @@ namespace WPEFramework
 
             returnResponse(true);
         }
+
+        uint32_t FrameRate::updateFrameTimesWrapper(const JsonObject& parameters, JsonObject& response)
+        {
+            std::lock_guard<std::mutex> guard(m_callMutex);
+
+            // No LOGINFO() here, this is called for every batch of frames
+
+            if (!parameters.HasLabel("frameTimes") && !parameters.HasLabel("timestamps"))
+            {
+                returnResponse(false);
+            }
+
+            if (parameters.HasLabel("refreshRate"))
+            {
+                int64_t refreshRate = parameters["refreshRate"].Number();
+                if (refreshRate < 1 || refreshRate > 1000)
+                {
+                    LOGERR("refreshRate %lld Hz is out of range", (long long)refreshRate);
+                    returnResponse(false);
+                }
+                m_frameTimes.setRefreshRate(static_cast<uint32_t>(refreshRate));
+            }
+
+            // Check the whole batch first, a bad entry must not leave half of it recorded
+            bool isFrameTimes = parameters.HasLabel("frameTimes");
+            JsonArray values = isFrameTimes ? parameters["frameTimes"].Array() : parameters["timestamps"].Array();
+            JsonArray::Iterator index(values.Elements());
+            while (index.Next() == true)
+            {
+                int64_t value = index.Current().Number();
+                if (isFrameTimes ? value < 0 : value <= 0)
+                {
+                    LOGERR("%s %lld is out of range", isFrameTimes ? "frameTime" : "timestamp", (long long)value);
+                    returnResponse(false);
+                }
+            }
+
+            index.Reset();
+            while (index.Next() == true)
+            {
+                uint64_t value = static_cast<uint64_t>(index.Current().Number());
+                if (isFrameTimes)
+                {
+                    // Clamped like a gap between timestamps, the histogram clamps far below this anyway
+                    updateFrameTime(value > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(value));
+                }
+                else
+                {
+                    updateFrameTimestamp(value);
+                }
+            }
+
+            returnResponse(true);
+        }
+
+        uint32_t FrameRate::getFrameStatsWrapper(const JsonObject& parameters, JsonObject& response)
+        {
+            std::lock_guard<std::mutex> guard(m_callMutex);
+
+            LOGINFO();
+
+            getFrameStats(response);
+
+            returnResponse(true);
+        }
         
         /**
         * @brief This function is used to get the amount of collection interval per milliseconds.
@@ -158,6 +228,8 @@ namespace WPEFramework
             m_maxFpsValue = DEFAULT_MAX_FPS_VALUE;
             m_totalFpsValues = 0;
             m_numberOfFpsUpdates = 0;
+            m_frameTimes.reset();
+            m_lastFrameTimestamp = 0;
             m_fpsCollectionInProgress = true;
             int fpsCollectionFrequency = m_fpsCollectionFrequencyInMs;
             if (fpsCollectionFrequency < MINIMUM_FPS_COLLECTION_TIME_IN_MILLISECONDS)
@@ -221,6 +293,55 @@ namespace WPEFramework
             m_numberOfFpsUpdates++;
             m_lastFpsValue = newFpsValue;
         }
+
+        /**
+        * @brief This function is used to add the time one frame took to the frame time statistics
+        * of the current collection interval.
+        *
+        * @param[in] frameTimeUs Time since the previous frame in microseconds.
+        * @ingroup SERVMGR_ABSFRAMERATE_API
+        */
+        void FrameRate::updateFrameTime(uint32_t frameTimeUs)
+        {
+            m_frameTimes.add(frameTimeUs);
+        }
+
+        /**
+        * @brief This function is used to add a frame by its presentation time. The first timestamp
+        * after the collection is started only serves as the reference for the next one.
+        *
+        * @param[in] timestampUs Monotonic presentation time of the frame in microseconds.
+        * @ingroup SERVMGR_ABSFRAMERATE_API
+        */
+        void FrameRate::updateFrameTimestamp(uint64_t timestampUs)
+        {
+            if (m_lastFrameTimestamp != 0 && timestampUs > m_lastFrameTimestamp)
+            {
+                // A gap that does not fit is a stall anyway, the histogram clamps far below this
+                uint64_t frameTimeUs = timestampUs - m_lastFrameTimestamp;
+                updateFrameTime(frameTimeUs > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(frameTimeUs));
+            }
+            m_lastFrameTimestamp = timestampUs;
+        }
+
+        /**
+        * @brief This function is used to get the frame time statistics of the current collection
+        * interval. Times are in microseconds.
+        *
+        * @param[out] stats Frame count, frame time percentiles, dropped and janky frames and the longest stall.
+        * @ingroup SERVMGR_ABSFRAMERATE_API
+        */
+        void FrameRate::getFrameStats(JsonObject& stats)
+        {
+            stats["frames"] = m_frameTimes.frames();
+            stats["averageFrameTime"] = m_frameTimes.averageFrameTime();
+            stats["p50FrameTime"] = m_frameTimes.percentile(50);
+            stats["p90FrameTime"] = m_frameTimes.percentile(90);
+            stats["p99FrameTime"] = m_frameTimes.percentile(99);
+            stats["droppedFrames"] = m_frameTimes.droppedFrames();
+            stats["jankFrames"] = m_frameTimes.jankFrames();
+            stats["longestStall"] = m_frameTimes.longestFrameTime();
+        }
         
         void FrameRate::fpsCollectionUpdate( int averageFps, int minFps, int maxFps )
         {
@@ -228,6 +349,10 @@ namespace WPEFramework
             params["average"] = averageFps;
             params["min"] = minFps;
             params["max"] = maxFps;
+            if (m_frameTimes.frames() > 0)
+            {
+                getFrameStats(params);
+            }
             
             sendNotify(EVENT_FPS_UPDATE, params);
         }
@@ -246,6 +371,7 @@ namespace WPEFramework
                 maxFps = m_maxFpsValue;
             }
             fpsCollectionUpdate(averageFps, minFps, maxFps);
+            m_frameTimes.reset();
             if (m_lastFpsValue >= 0)
             {
                 // store the last fps value just in case there are no updates
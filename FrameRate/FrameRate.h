@@ -22,6 +22,7 @@
 #include <mutex>
 
 #include "tptimer.h"
+#include "FrameTimeHistogram.h"
 
 #include "Module.h"
 #include "utils.h"
@@ -55,6 +56,8 @@ namespace WPEFramework {
             uint32_t startFpsCollectionWrapper(const JsonObject& parameters, JsonObject& response);
             uint32_t stopFpsCollectionWrapper(const JsonObject& parameters, JsonObject& response);
             uint32_t updateFpsWrapper(const JsonObject& parameters, JsonObject& response);
+            uint32_t updateFrameTimesWrapper(const JsonObject& parameters, JsonObject& response);
+            uint32_t getFrameStatsWrapper(const JsonObject& parameters, JsonObject& response);
             //End methods
             
             int getCollectionFrequency();
@@ -62,6 +65,9 @@ namespace WPEFramework {
             bool startFpsCollection();
             bool stopFpsCollection();
             void updateFps(int newFpsValue);
+            void updateFrameTime(uint32_t frameTimeUs);
+            void updateFrameTimestamp(uint64_t timestampUs);
+            void getFrameStats(JsonObject& stats);
 
             void fpsCollectionUpdate( int averageFps, int minFps, int maxFps );
             
@@ -87,6 +93,8 @@ namespace WPEFramework {
             //QTimer m_reportFpsTimer;
             TpTimer m_reportFpsTimer;
             int m_lastFpsValue;
+            FrameTimeHistogram m_frameTimes;
+            uint64_t m_lastFrameTimestamp;
             
             std::mutex m_callMutex;
         };
@@ -0,0 +1,139 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2019 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#include "FrameTimeHistogram.h"
+
+#include <string.h>
+
+#define DEFAULT_REFRESH_RATE_HZ 60
+
+namespace WPEFramework
+{
+    namespace Plugin
+    {
+        FrameTimeHistogram::FrameTimeHistogram()
+        : m_refreshPeriodUs(1000000 / DEFAULT_REFRESH_RATE_HZ)
+        {
+            reset();
+        }
+
+        void FrameTimeHistogram::reset()
+        {
+            memset(m_counts, 0, sizeof(m_counts));
+            m_frames = 0;
+            m_totalFrameTime = 0;
+            m_maxFrameTime = 0;
+            m_lastFrameTime = 0;
+            m_droppedFrames = 0;
+            m_jankFrames = 0;
+        }
+
+        void FrameTimeHistogram::setRefreshRate(uint32_t refreshRateHz)
+        {
+            if (refreshRateHz > 0)
+            {
+                // Never 0, add() divides by it
+                m_refreshPeriodUs = refreshRateHz < 1000000 ? 1000000 / refreshRateHz : 1;
+            }
+        }
+
+        void FrameTimeHistogram::add(uint32_t frameTimeUs)
+        {
+            m_counts[bucketFor(frameTimeUs)]++;
+            m_frames++;
+            m_totalFrameTime += frameTimeUs;
+            if (frameTimeUs > m_maxFrameTime)
+            {
+                m_maxFrameTime = frameTimeUs;
+            }
+
+            // Vsyncs the frame took, rounded, so that timestamp jitter does not count as a drop.
+            // In 64 bits, a stall clamped to UINT32_MAX must not wrap to no drop at all.
+            uint64_t vsyncs = (static_cast<uint64_t>(frameTimeUs) + m_refreshPeriodUs / 2) / m_refreshPeriodUs;
+            if (vsyncs > 1)
+            {
+                uint64_t dropped = m_droppedFrames + vsyncs - 1;
+                m_droppedFrames = dropped > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(dropped);
+                if (frameTimeUs > static_cast<uint64_t>(m_lastFrameTime) + m_refreshPeriodUs / 2)
+                {
+                    m_jankFrames++;
+                }
+            }
+            m_lastFrameTime = frameTimeUs;
+        }
+
+        uint32_t FrameTimeHistogram::percentile(uint32_t percent) const
+        {
+            if (m_frames == 0)
+            {
+                return 0;
+            }
+
+            uint64_t rank = (static_cast<uint64_t>(m_frames) * percent + 99) / 100;
+            if (rank == 0)
+            {
+                rank = 1;
+            }
+
+            uint64_t seen = 0;
+            for (unsigned bucket = 0; bucket < BUCKETS; bucket++)
+            {
+                seen += m_counts[bucket];
+                if (seen >= rank)
+                {
+                    uint32_t value = valueFor(bucket);
+                    return value < m_maxFrameTime ? value : m_maxFrameTime;
+                }
+            }
+            return m_maxFrameTime;
+        }
+
+        unsigned FrameTimeHistogram::bucketFor(uint32_t value)
+        {
+            if (value < LINEAR_BUCKETS)
+            {
+                return value;
+            }
+
+            static const uint32_t maxValue = (1U << (MAX_SHIFT + 6)) - 1;
+            if (value > maxValue)
+            {
+                value = maxValue;
+            }
+
+            // Shift the value into [SUB_BUCKETS, 2 * SUB_BUCKETS), the shift picks the power of two
+            unsigned shift = (31 - __builtin_clz(value)) - 5;
+            return LINEAR_BUCKETS + (shift - 1) * SUB_BUCKETS + ((value >> shift) - SUB_BUCKETS);
+        }
+
+        uint32_t FrameTimeHistogram::valueFor(unsigned bucket)
+        {
+            if (bucket < LINEAR_BUCKETS)
+            {
+                return bucket;
+            }
+
+            unsigned shift = (bucket - LINEAR_BUCKETS) / SUB_BUCKETS + 1;
+            uint32_t low = static_cast<uint32_t>((bucket - LINEAR_BUCKETS) % SUB_BUCKETS + SUB_BUCKETS) << shift;
+            // Middle of the bucket
+            return low + (1U << (shift - 1));
+        }
+
+    } // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,75 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2019 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#pragma once
+
+#include <stdint.h>
+
+namespace WPEFramework {
+
+    namespace Plugin {
+
+        /*
+         * Frame times of one reporting window, in microseconds. Values go into log-scale buckets of 32
+         * sub-buckets per power of two (exact below 64 us, within about 3% above), so adding a frame is
+         * a couple of shifts and an increment and percentiles need no sorting. Frame times are also
+         * checked against the display refresh period: every vsync a frame overran counts as a dropped
+         * frame, and a frame that overran and took longer than the one before it counts as jank, so a
+         * steady lower frame rate is not reported as stutter.
+         */
+        class FrameTimeHistogram
+        {
+        public:
+            FrameTimeHistogram();
+
+            void reset();
+            void setRefreshRate(uint32_t refreshRateHz);
+            void add(uint32_t frameTimeUs);
+
+            uint32_t frames() const { return m_frames; }
+            uint32_t droppedFrames() const { return m_droppedFrames; }
+            uint32_t jankFrames() const { return m_jankFrames; }
+            uint32_t longestFrameTime() const { return m_maxFrameTime; }
+            uint32_t averageFrameTime() const { return m_frames ? static_cast<uint32_t>(m_totalFrameTime / m_frames) : 0; }
+
+            /* Frame time below which percent of the frames are, 0 if there are none */
+            uint32_t percentile(uint32_t percent) const;
+
+        private:
+            enum {
+                SUB_BUCKETS = 32,
+                LINEAR_BUCKETS = 2 * SUB_BUCKETS,
+                MAX_SHIFT = 21,                     /* Up to 2^27 us, longer frames are clamped */
+                BUCKETS = LINEAR_BUCKETS + MAX_SHIFT * SUB_BUCKETS
+            };
+
+            static unsigned bucketFor(uint32_t value);
+            static uint32_t valueFor(unsigned bucket);
+
+            uint32_t m_counts[BUCKETS];
+            uint32_t m_frames;
+            uint64_t m_totalFrameTime;
+            uint32_t m_maxFrameTime;
+            uint32_t m_lastFrameTime;
+            uint32_t m_droppedFrames;
+            uint32_t m_jankFrames;
+            uint32_t m_refreshPeriodUs;
+        };
+    } // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,471 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2019 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#include "CecTransactionScheduler.h"
+
+#include <algorithm>
+#include <string.h>
+
+#define CEC_OPCODE_FEATURE_ABORT					0x00
+#define CEC_BROADCAST_ADDRESS						0x0F
+
+#define CECSCHEDULER_MAX_ATTEMPTS					3
+/* Backoff after a NACK or a failed transmission, doubled for every further attempt */
+#define CECSCHEDULER_RETRY_BACKOFF_MS				50
+/* Wait for a reply, scaled from what the destination took so far; the spec allows 1 second */
+#define CECSCHEDULER_REPLY_TIMEOUT_MIN_MS			500
+#define CECSCHEDULER_REPLY_TIMEOUT_MAX_MS			2000
+
+namespace WPEFramework {
+
+    namespace Plugin {
+
+		CecTransactionScheduler::CecTransactionScheduler()
+		: m_running(false)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				m_latency[i] = Clock::duration::zero();
+			}
+			memset(&m_statistics, 0, sizeof(m_statistics));
+		}
+
+		CecTransactionScheduler::~CecTransactionScheduler()
+		{
+			stop();
+		}
+
+		void CecTransactionScheduler::start(const Sender &sender)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			if (m_running)
+				return;
+
+			m_sender = sender;
+			m_running = true;
+			m_thread = std::thread(&CecTransactionScheduler::run, this, (int)PRIORITY_POWER_ROUTING, PRIORITY_COUNT - 1);
+			m_userThread = std::thread(&CecTransactionScheduler::run, this, (int)PRIORITY_USER_ACTION, (int)PRIORITY_USER_ACTION);
+		}
+
+		void CecTransactionScheduler::stop()
+		{
+			std::vector<TransactionPtr> dropped;
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_running = false;
+				m_condition.notify_all();
+			}
+
+			if (m_thread.joinable())
+				m_thread.join();
+			if (m_userThread.joinable())
+				m_userThread.join();
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				for (int priority = 0; priority < PRIORITY_COUNT; priority++)
+				{
+					dropped.insert(dropped.end(), m_queue[priority].begin(), m_queue[priority].end());
+					m_queue[priority].clear();
+				}
+				for (int i = 0; i < 16; i++)
+				{
+					if (m_awaiting[i])
+						dropped.push_back(m_awaiting[i]);
+					m_awaiting[i].reset();
+				}
+			}
+
+			for (auto &transaction : dropped)
+			{
+				complete(transaction, RESULT_DROPPED);
+			}
+		}
+
+		bool CecTransactionScheduler::send(int priority, uint8_t destination, const std::vector<uint8_t> &message, int reply,
+				const Callback &callback, const Predicate &needed)
+		{
+			priority = std::min(std::max(priority, 0), PRIORITY_COUNT - 1);
+			destination &= 0x0F;
+
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			if (!m_running)
+			{
+				lock.unlock();
+				if (callback)
+					callback(RESULT_DROPPED);
+				return false;
+			}
+
+			if (reply != NO_REPLY)
+			{
+				auto isSame = [&](const TransactionPtr &transaction) {
+					return transaction->destination == destination && transaction->message == message;
+				};
+
+				TransactionPtr existing;
+				if (m_awaiting[destination] && isSame(m_awaiting[destination]))
+				{
+					existing = m_awaiting[destination];
+				}
+
+				for (int i = 0; !existing && i < PRIORITY_COUNT; i++)
+				{
+					auto it = std::find_if(m_queue[i].begin(), m_queue[i].end(), isSame);
+					if (it != m_queue[i].end())
+					{
+						existing = *it;
+						if (priority < i)
+						{
+							/* Asked for by something more urgent now, move it up */
+							m_queue[i].erase(it);
+							existing->priority = priority;
+							m_queue[priority].push_back(existing);
+							m_condition.notify_all();
+						}
+					}
+				}
+
+				if (existing)
+				{
+					if (callback)
+						existing->callbacks.push_back(callback);
+					m_statistics.coalesced++;
+					return false;
+				}
+			}
+
+			TransactionPtr transaction = std::make_shared<Transaction>();
+			transaction->priority = priority;
+			transaction->destination = destination;
+			transaction->message = message;
+			transaction->reply = reply;
+			transaction->attempts = 0;
+			transaction->notBefore = Clock::now();
+			transaction->deadline = Clock::time_point::max();
+			transaction->needed = needed;
+			if (callback)
+				transaction->callbacks.push_back(callback);
+
+			m_queue[priority].push_back(transaction);
+			m_condition.notify_all();
+
+			return true;
+		}
+
+		int CecTransactionScheduler::sendAndWait(int priority, uint8_t destination, const std::vector<uint8_t> &message, int reply)
+		{
+			struct Outcome {
+				std::mutex mutex;
+				std::condition_variable condition;
+				bool done;
+				int result;
+			};
+
+			std::shared_ptr<Outcome> outcome = std::make_shared<Outcome>();
+			outcome->done = false;
+			outcome->result = RESULT_DROPPED;
+
+			send(priority, destination, message, reply, [outcome](int result) {
+				std::lock_guard<std::mutex> lock(outcome->mutex);
+				outcome->result = result;
+				outcome->done = true;
+				outcome->condition.notify_all();
+			});
+
+			std::unique_lock<std::mutex> lock(outcome->mutex);
+			outcome->condition.wait(lock, [&outcome]() { return outcome->done; });
+
+			return outcome->result;
+		}
+
+		void CecTransactionScheduler::onMessage(uint8_t from, const uint8_t *message, size_t length)
+		{
+			int result;
+			TransactionPtr transaction;
+
+			if (from >= CEC_BROADCAST_ADDRESS || message == NULL || length == 0)
+				return;
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+
+				transaction = m_awaiting[from];
+				if (!transaction)
+					return;
+
+				if (message[0] == transaction->reply)
+				{
+					result = RESULT_DONE;
+					if (transaction->deadline != Clock::time_point::max())
+						updateLatencyLocked(from, Clock::now() - transaction->sentAt);
+				}
+				else if (message[0] == CEC_OPCODE_FEATURE_ABORT && length >= 2 &&
+						!transaction->message.empty() && message[1] == transaction->message[0])
+				{
+					result = RESULT_ABORTED;
+				}
+				else
+				{
+					return;
+				}
+
+				m_awaiting[from].reset();
+				m_statistics.replies++;
+				/* A query held back for this destination can go now */
+				m_condition.notify_all();
+			}
+
+			complete(transaction, result);
+		}
+
+		bool CecTransactionScheduler::isBusy(uint8_t destination) const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			destination &= 0x0F;
+			if (m_awaiting[destination])
+				return true;
+
+			for (int priority = 0; priority < PRIORITY_COUNT; priority++)
+			{
+				for (auto &transaction : m_queue[priority])
+				{
+					if (transaction->destination == destination && transaction->reply != NO_REPLY)
+						return true;
+				}
+			}
+
+			return false;
+		}
+
+		CecTransactionScheduler::Statistics CecTransactionScheduler::statistics() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_statistics;
+		}
+
+		void CecTransactionScheduler::run(int first, int last)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			while (m_running)
+			{
+				std::vector<std::pair<TransactionPtr, int>> completed;
+				Clock::time_point now = Clock::now();
+				Clock::time_point wakeup = Clock::time_point::max();
+
+				expireLocked(now, completed);
+				TransactionPtr transaction = nextLocked(now, wakeup, first, last);
+
+				if (!transaction && completed.empty())
+				{
+					if (wakeup == Clock::time_point::max())
+						m_condition.wait(lock);
+					else
+						m_condition.wait_until(lock, wakeup);
+					continue;
+				}
+
+				lock.unlock();
+
+				for (auto &entry : completed)
+				{
+					complete(entry.first, entry.second);
+				}
+
+				if (!transaction)
+				{
+					lock.lock();
+					continue;
+				}
+
+				if (transaction->needed && !transaction->needed())
+				{
+					lock.lock();
+					if (m_awaiting[transaction->destination] == transaction)
+						m_awaiting[transaction->destination].reset();
+					m_statistics.skipped++;
+					lock.unlock();
+
+					complete(transaction, RESULT_DROPPED);
+					lock.lock();
+					continue;
+				}
+
+				Clock::time_point sending = Clock::now();
+				int sendResult = m_sender(transaction->destination, transaction->message);
+				int result = -1;
+
+				lock.lock();
+				now = Clock::now();
+				m_statistics.sent++;
+				transaction->attempts++;
+
+				/* Nobody could answer while our own frame held the bus, that time doesn't count against their replies */
+				for (int i = 0; i < 16; i++)
+				{
+					if (m_awaiting[i] && m_awaiting[i] != transaction && m_awaiting[i]->deadline != Clock::time_point::max())
+						m_awaiting[i]->deadline += now - std::max(sending, m_awaiting[i]->sentAt);
+				}
+
+				if (sendResult == SEND_ACKED)
+				{
+					if (transaction->reply == NO_REPLY)
+					{
+						result = RESULT_DONE;
+					}
+					else if (m_awaiting[transaction->destination] == transaction)
+					{
+						/* Not answered while it was being sent, start waiting for the reply */
+						transaction->sentAt = now;
+						transaction->deadline = now + replyTimeoutLocked(transaction->destination, transaction->attempts);
+					}
+				}
+				else
+				{
+					if (m_awaiting[transaction->destination] == transaction)
+						m_awaiting[transaction->destination].reset();
+
+					if (sendResult == SEND_NACKED)
+						m_statistics.nacks++;
+
+					/* A poll that isn't acked is an answer: nobody is there */
+					bool isPoll = transaction->message.empty();
+					if ((sendResult == SEND_NACKED && isPoll) || transaction->attempts >= CECSCHEDULER_MAX_ATTEMPTS)
+					{
+						result = (sendResult == SEND_NACKED) ? RESULT_NACKED : RESULT_FAILED;
+					}
+					else
+					{
+						retryLocked(transaction, now + std::chrono::milliseconds(CECSCHEDULER_RETRY_BACKOFF_MS << (transaction->attempts - 1)));
+					}
+				}
+
+				if (result != -1)
+				{
+					lock.unlock();
+					complete(transaction, result);
+					lock.lock();
+				}
+			}
+		}
+
+		CecTransactionScheduler::TransactionPtr CecTransactionScheduler::nextLocked(Clock::time_point now, Clock::time_point &wakeup,
+				int first, int last)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				if (m_awaiting[i])
+					wakeup = std::min(wakeup, m_awaiting[i]->deadline);
+			}
+
+			for (int priority = first; priority <= last; priority++)
+			{
+				for (auto it = m_queue[priority].begin(); it != m_queue[priority].end(); ++it)
+				{
+					TransactionPtr transaction = *it;
+
+					if (transaction->notBefore > now)
+					{
+						wakeup = std::min(wakeup, transaction->notBefore);
+						continue;
+					}
+
+					/* One query per destination at a time, the others wait for its reply */
+					if (transaction->reply != NO_REPLY && m_awaiting[transaction->destination])
+						continue;
+
+					m_queue[priority].erase(it);
+					if (transaction->reply != NO_REPLY)
+					{
+						transaction->deadline = Clock::time_point::max();
+						m_awaiting[transaction->destination] = transaction;
+					}
+					return transaction;
+				}
+			}
+
+			return TransactionPtr();
+		}
+
+		void CecTransactionScheduler::expireLocked(Clock::time_point now, std::vector<std::pair<TransactionPtr, int>> &completed)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				TransactionPtr transaction = m_awaiting[i];
+
+				if (!transaction || transaction->deadline > now)
+					continue;
+
+				m_awaiting[i].reset();
+				m_statistics.timeouts++;
+
+				if (transaction->attempts >= CECSCHEDULER_MAX_ATTEMPTS)
+					completed.push_back(std::make_pair(transaction, (int)RESULT_TIMEOUT));
+				else
+					retryLocked(transaction, now);
+			}
+		}
+
+		void CecTransactionScheduler::retryLocked(const TransactionPtr &transaction, Clock::time_point notBefore)
+		{
+			m_statistics.retries++;
+			transaction->notBefore = notBefore;
+			transaction->deadline = Clock::time_point::max();
+			/* Ahead of what was queued after it in the same class */
+			m_queue[transaction->priority].push_front(transaction);
+			/* Possibly expired by the thread that doesn't send its class */
+			m_condition.notify_all();
+		}
+
+		void CecTransactionScheduler::updateLatencyLocked(uint8_t destination, Clock::duration latency)
+		{
+			if (m_latency[destination] == Clock::duration::zero())
+				m_latency[destination] = latency;
+			else
+				m_latency[destination] = (m_latency[destination] * 7 + latency) / 8;
+		}
+
+		CecTransactionScheduler::Clock::duration CecTransactionScheduler::replyTimeoutLocked(uint8_t destination, int attempts) const
+		{
+			Clock::duration timeout = std::chrono::milliseconds(CECSCHEDULER_REPLY_TIMEOUT_MAX_MS);
+
+			/* Devices known to answer quickly are given up on sooner, each retry waits twice as long */
+			if (m_latency[destination] != Clock::duration::zero())
+			{
+				timeout = std::max<Clock::duration>(m_latency[destination] * 4, std::chrono::milliseconds(CECSCHEDULER_REPLY_TIMEOUT_MIN_MS));
+				timeout = timeout * (1 << (attempts - 1));
+			}
+
+			return std::min<Clock::duration>(timeout, std::chrono::milliseconds(CECSCHEDULER_REPLY_TIMEOUT_MAX_MS));
+		}
+
+		void CecTransactionScheduler::complete(const TransactionPtr &transaction, int result)
+		{
+			for (auto &callback : transaction->callbacks)
+			{
+				callback(result);
+			}
+		}
+	} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,155 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2019 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace WPEFramework {
+
+    namespace Plugin {
+
+		/*
+		 * Serializes everything the plugin sends on the CEC bus. Transactions are picked by priority
+		 * class first, and queries are correlated with their replies so that several devices can be
+		 * asked at the same time while each device only has one query outstanding. User actions have
+		 * a sender of their own: they are handed to the driver even while a discovery frame is on the
+		 * wire, so they go out right after it instead of behind the device replies it caused. Messages
+		 * are the CEC opcode followed by its operands, without the header; an empty message is a poll
+		 * (ping).
+		 */
+		class CecTransactionScheduler {
+			public:
+
+			enum {
+				PRIORITY_USER_ACTION = 0,	/* setActivePath, setRoutingChange, setActiveSource, ... */
+				PRIORITY_POWER_ROUTING,		/* power status, physical address reports, answers to other devices */
+				PRIORITY_DISCOVERY,			/* polls and Give* device info queries */
+				PRIORITY_COUNT,
+			};
+
+			enum {
+				SEND_ACKED = 0,
+				SEND_NACKED,
+				SEND_FAILED,
+			};
+
+			enum {
+				RESULT_DONE = 0,			/* acked and, for queries, replied to */
+				RESULT_NACKED,
+				RESULT_TIMEOUT,				/* acked but never replied to */
+				RESULT_ABORTED,				/* answered with a Feature Abort */
+				RESULT_FAILED,
+				RESULT_DROPPED,				/* not needed any more or the scheduler stopped */
+			};
+
+			static const int NO_REPLY = -1;
+
+			/* Puts one message on the bus, returns one of SEND_*. Called from two threads at a time */
+			typedef std::function<int (uint8_t destination, const std::vector<uint8_t> &message)> Sender;
+			typedef std::function<void (int result)> Callback;
+			/* Asked right before sending, a query whose answer already came in (e.g. broadcast) is not sent */
+			typedef std::function<bool ()> Predicate;
+
+			struct Statistics {
+				uint32_t sent;
+				uint32_t retries;
+				uint32_t coalesced;
+				uint32_t skipped;
+				uint32_t replies;
+				uint32_t timeouts;
+				uint32_t nacks;
+			};
+
+			CecTransactionScheduler();
+			~CecTransactionScheduler();
+
+			void start(const Sender &sender);
+			void stop();
+
+			/*
+			 * Queues a message. If reply is not NO_REPLY the transaction only completes when that opcode
+			 * comes back from the destination. A query equal to one that is already queued or waiting for
+			 * its reply is coalesced with it, taking over the higher of the two priorities.
+			 * Returns false if the message was coalesced or the scheduler is not running.
+			 */
+			bool send(int priority, uint8_t destination, const std::vector<uint8_t> &message, int reply = NO_REPLY,
+					const Callback &callback = Callback(), const Predicate &needed = Predicate());
+
+			/* Same as send() but waits for the outcome, returns one of RESULT_* */
+			int sendAndWait(int priority, uint8_t destination, const std::vector<uint8_t> &message, int reply = NO_REPLY);
+
+			/* To be called for every message received, completes the query it answers */
+			void onMessage(uint8_t from, const uint8_t *message, size_t length);
+
+			/* True while a query to destination is queued or waiting for its reply */
+			bool isBusy(uint8_t destination) const;
+
+			Statistics statistics() const;
+
+			private:
+			typedef std::chrono::steady_clock Clock;
+
+			struct Transaction {
+				int priority;
+				uint8_t destination;
+				std::vector<uint8_t> message;
+				int reply;
+				int attempts;
+				Clock::time_point notBefore;
+				Clock::time_point deadline;
+				Clock::time_point sentAt;
+				Predicate needed;
+				std::vector<Callback> callbacks;
+			};
+
+			typedef std::shared_ptr<Transaction> TransactionPtr;
+
+			void run(int first, int last);
+			TransactionPtr nextLocked(Clock::time_point now, Clock::time_point &wakeup, int first, int last);
+			void expireLocked(Clock::time_point now, std::vector<std::pair<TransactionPtr, int>> &completed);
+			void retryLocked(const TransactionPtr &transaction, Clock::time_point now);
+			void updateLatencyLocked(uint8_t destination, Clock::duration latency);
+			Clock::duration replyTimeoutLocked(uint8_t destination, int attempts) const;
+			static void complete(const TransactionPtr &transaction, int result);
+
+			mutable std::mutex m_mutex;
+			std::condition_variable m_condition;
+			std::thread m_thread;
+			/* Sends PRIORITY_USER_ACTION only, m_thread everything else */
+			std::thread m_userThread;
+			Sender m_sender;
+			bool m_running;
+			std::deque<TransactionPtr> m_queue[PRIORITY_COUNT];
+			/* The query each destination is waiting for a reply to */
+			TransactionPtr m_awaiting[16];
+			/* Smoothed reply latency per destination, 0 until the first reply */
+			Clock::duration m_latency[16];
+			Statistics m_statistics;
+		};
+	} // namespace Plugin
+} // namespace WPEFramework
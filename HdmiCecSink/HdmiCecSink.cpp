@@ -119,6 +119,9 @@ namespace WPEFramework
         SERVICE_REGISTRATION(HdmiCecSink, 1, 0);
 
         HdmiCecSink* HdmiCecSink::_instance = nullptr;
+#ifdef HDMICECSINK_BENCHMARK
+        VirtualCecBus* HdmiCecSink::_virtualBus = nullptr;
+#endif
         static int libcecInitStatus = 0;
 
 //=========================================== HdmiCecSinkFrameListener =========================================
@@ -134,6 +137,9 @@ namespace WPEFramework
                 LOGINFO("   >>>>>    Received CEC Frame: :%s \n",strBuffer);
 
                 MessageDecoder(processor).decode(in);
+
+                if (HdmiCecSink::_instance)
+                    HdmiCecSink::_instance->onMessageReceived(buf, len);
        }
 
 //=========================================== HdmiCecSinkProcessor =========================================
@@ -183,7 +189,7 @@ namespace WPEFramework
              LOGINFO("Command: GetCECVersion sending CECVersion response \n");
              try
              { 
-                 conn.sendTo(header.from, MessageEncoder().encode(CECVersion(Version::V_1_4)));
+                 HdmiCecSink::_instance->sendMessage(CecTransactionScheduler::PRIORITY_POWER_ROUTING, header.from, MessageEncoder().encode(CECVersion(Version::V_1_4)));
              } 
              catch(...)
              {
@@ -209,7 +215,7 @@ namespace WPEFramework
              LOGINFO("Command: GiveOSDName sending SetOSDName : %s\n",osdName.toString().c_str());
              try
              { 
-                 conn.sendTo(header.from, MessageEncoder().encode(SetOSDName(osdName)));
+                 HdmiCecSink::_instance->sendMessage(CecTransactionScheduler::PRIORITY_POWER_ROUTING, header.from, MessageEncoder().encode(SetOSDName(osdName)));
              } 
              catch(...)
              {
@@ -224,7 +230,7 @@ namespace WPEFramework
                  try
                  { 
                      LOGINFO(" sending ReportPhysicalAddress response physical_addr :%s logicalAddress :%x \n",physical_addr.toString().c_str(), logicalAddress.toInt());
-                     conn.sendTo(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(ReportPhysicalAddress(physical_addr,logicalAddress.toInt()))); 
+                     HdmiCecSink::_instance->sendMessage(CecTransactionScheduler::PRIORITY_POWER_ROUTING, LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(ReportPhysicalAddress(physical_addr,logicalAddress.toInt())));
                  } 
                  catch(...)
                  {
@@ -238,7 +244,7 @@ namespace WPEFramework
              try
              {
                  LOGINFO("Command: GiveDeviceVendorID sending VendorID response :%s\n",appVendorId.toString().c_str());
-                 conn.sendTo(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(DeviceVendorID(appVendorId)));
+                 HdmiCecSink::_instance->sendMessage(CecTransactionScheduler::PRIORITY_POWER_ROUTING, LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(DeviceVendorID(appVendorId)));
              }
              catch(...)
              {
@@ -307,7 +313,7 @@ namespace WPEFramework
              LOGINFO("Command: GiveDevicePowerStatus sending powerState :%d \n",powerState);
              try
              { 
-                 conn.sendTo(header.from, MessageEncoder().encode(ReportPowerStatus(PowerStatus(powerState))));
+                 HdmiCecSink::_instance->sendMessage(CecTransactionScheduler::PRIORITY_POWER_ROUTING, header.from, MessageEncoder().encode(ReportPowerStatus(PowerStatus(powerState))));
              } 
              catch(...)
              {
@@ -388,6 +394,9 @@ namespace WPEFramework
 		   m_isHdmiInConnected = false;
 		   m_pollNextState = POLL_THREAD_STATE_NONE;
 		   m_pollThreadState = POLL_THREAD_STATE_NONE;
+		   m_pollExit = false;
+		   m_logicalAddressAllocated = LogicalAddress::UNREGISTERED;
+		   smConnection = NULL;
 		   dsHdmiInGetNumberOfInputsParam_t hdmiInput;
 
            InitializeIARM();
@@ -482,6 +491,8 @@ namespace WPEFramework
        HdmiCecSink::~HdmiCecSink()
        {
            LOGINFO();
+           /* The poll thread and the scheduler use the instance */
+           CECDisable();
            HdmiCecSink::_instance = nullptr;
            DeinitializeIARM();
        }
@@ -1272,8 +1283,8 @@ namespace WPEFramework
 				return;
 			}
 
-			_instance->smConnection->sendTo(LogicalAddress::BROADCAST, 
-										MessageEncoder().encode(RequestActiveSource()), 5000);	
+			_instance->sendMessage(CecTransactionScheduler::PRIORITY_USER_ACTION, LogicalAddress::BROADCAST,
+										MessageEncoder().encode(RequestActiveSource()));
 		}
 		
 		void HdmiCecSink::setActiveSource(bool isResponse)
@@ -1292,8 +1303,8 @@ namespace WPEFramework
 				return;
 			}
 		
-			_instance->smConnection->sendTo(LogicalAddress::BROADCAST, 
-										MessageEncoder().encode(ActiveSource(_instance->deviceList[_instance->m_logicalAddressAllocated].m_physicalAddr)), 5000);	
+			_instance->sendMessage(CecTransactionScheduler::PRIORITY_USER_ACTION, LogicalAddress::BROADCAST,
+										MessageEncoder().encode(ActiveSource(_instance->deviceList[_instance->m_logicalAddressAllocated].m_physicalAddr)));
 
 			_instance->m_currentActiveSource = _instance->m_logicalAddressAllocated;
 		}
@@ -1324,7 +1335,7 @@ namespace WPEFramework
 
 			lang = _instance->deviceList[_instance->m_logicalAddressAllocated].m_currentLanguage;
 
-			_instance->smConnection->sendTo(LogicalAddress::BROADCAST, MessageEncoder().encode(SetMenuLanguage(lang)), 5000);	
+			_instance->sendMessage(CecTransactionScheduler::PRIORITY_USER_ACTION, LogicalAddress::BROADCAST, MessageEncoder().encode(SetMenuLanguage(lang)));
 		}
 
 		void HdmiCecSink::updateInActiveSource(const int logical_address, const InActiveSource &source )
@@ -1396,52 +1407,32 @@ namespace WPEFramework
 				if ( i != _instance->m_logicalAddressAllocated )
 				{
 					//LOGWARN("PING for  0x%x \r\n",i);
-					try {
-						_instance->smConnection->ping(LogicalAddress(_instance->m_logicalAddressAllocated), LogicalAddress(i), Throw_e());
-					}
-					catch(CECNoAckException &e)
+					/* Goes through the scheduler so that user actions get in between the pings */
+					int result = _instance->m_scheduler.sendAndWait(CecTransactionScheduler::PRIORITY_DISCOVERY, i, std::vector<uint8_t>());
+
+					if ( result == CecTransactionScheduler::RESULT_NACKED )
 					{
 						if ( _instance->deviceList[i].m_isDevicePresent ) {
 							disconnected.push_back(i);
 						}
-						//LOGWARN("Ping caught %s \r\n",e.what());
-						usleep(50000);
 						continue;
 					}
-					  catch(Exception &e)
-					  {
-						LOGINFO("Ping caught %s \r\n",e.what());
-					  }
-					  
+					else if ( result != CecTransactionScheduler::RESULT_DONE )
+					{
+						LOGINFO("Ping 0x%x failed %d \r\n", i, result);
+						continue;
+					}
+
 					  LOGINFO("PING got Device ACK 0x%x \r\n",i);
 					  /* If we get ACK, then the device is present in the network*/
 					  if ( !_instance->deviceList[i].m_isDevicePresent )
 					  {
 					  	connected.push_back(i);
 					  }
-					  usleep(50000);      
 				}
            	}
         }
 
-		int HdmiCecSink::requestType( const int logicalAddress ) {
-			int requestType = CECDeviceParams::REQUEST_NONE;
-			
-			if ( !_instance->deviceList[logicalAddress].m_isPAUpdated || !_instance->deviceList[logicalAddress].m_isDeviceTypeUpdated ) {
-				requestType = CECDeviceParams::REQUEST_PHISICAL_ADDRESS; 	
-			}else if ( !_instance->deviceList[logicalAddress].m_isVersionUpdated ) {
-				requestType = CECDeviceParams::REQUEST_CEC_VERSION;
-			}else if ( !_instance->deviceList[logicalAddress].m_isVendorIDUpdated ) {
-				requestType = CECDeviceParams::REQUEST_DEVICE_VENDOR_ID;
-			}else if ( !_instance->deviceList[logicalAddress].m_isOSDNameUpdated ) {
-				requestType = CECDeviceParams::REQUEST_OSD_NAME;
-			}else if ( !_instance->deviceList[logicalAddress].m_isPowerStatusUpdated ) {
-				requestType = CECDeviceParams::REQUEST_POWER_STATUS;
-			}
-
-			return requestType;
-		}
-
 		void HdmiCecSink::printDeviceList() {
 			int i;
 
@@ -1463,7 +1454,7 @@ namespace WPEFramework
 			if(!HdmiCecSink::_instance)
 				return;
 
-			_instance->smConnection->sendTo(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(SetStreamPath(physical_addr)), 5000);	
+			_instance->sendMessage(CecTransactionScheduler::PRIORITY_USER_ACTION, LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(SetStreamPath(physical_addr)));
 		}
 
 		void HdmiCecSink::setRoutingChange(const std::string &from, const std::string &to) {
@@ -1520,7 +1511,7 @@ namespace WPEFramework
 				}
 			}
 			
-			_instance->smConnection->sendTo(LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(RoutingChange(oldPhyAddr, newPhyAddr)), 5000); 
+			_instance->sendMessage(CecTransactionScheduler::PRIORITY_USER_ACTION, LogicalAddress(LogicalAddress::BROADCAST), MessageEncoder().encode(RoutingChange(oldPhyAddr, newPhyAddr)));
 		}
 
 		void HdmiCecSink::addDevice(const int logicalAddress) {
@@ -1569,22 +1560,16 @@ namespace WPEFramework
 		}
 
 		void HdmiCecSink::requestPowerStatus(const int logicalAddress) {
-			int i;
-			int requestType;
-			
 			if(!HdmiCecSink::_instance)
 				return;
 			if ( _instance->m_logicalAddressAllocated == LogicalAddress::UNREGISTERED || logicalAddress >= LogicalAddress::UNREGISTERED + TEST_ADD ){
 				LOGERR("Logical Address NOT Allocated Or its not valid");
 				return;
 			}
-			_instance->smConnection->sendTo(LogicalAddress(logicalAddress), MessageEncoder().encode(GiveDevicePowerStatus()), 5000);	
+			_instance->requestInfo(logicalAddress, CECDeviceParams::REQUEST_POWER_STATUS);
 		}
 
 		void HdmiCecSink::request(const int logicalAddress) {
-			int i;
-			int requestType;
-			
 			if(!HdmiCecSink::_instance)
 				return;
 			if ( _instance->m_logicalAddressAllocated == LogicalAddress::UNREGISTERED || logicalAddress >= LogicalAddress::UNREGISTERED + TEST_ADD ){
@@ -1592,184 +1577,213 @@ namespace WPEFramework
 				return;
 			}
 
-			requestType = _instance->requestType(logicalAddress);
-			_instance->deviceList[logicalAddress].m_isRequested = requestType;
-			
+			/* Everything still missing is queued at once. The scheduler asks the device one thing at a time
+			 * and leaves out what the device broadcast by itself in the meantime. */
+			for (int requestType = CECDeviceParams::REQUEST_PHISICAL_ADDRESS; requestType <= CECDeviceParams::REQUEST_OSD_NAME; requestType++)
+			{
+				if ( _instance->isInfoMissing(logicalAddress, requestType) )
+				{
+					_instance->requestInfo(logicalAddress, requestType);
+				}
+			}
+		}
+
+		void HdmiCecSink::requestInfo(const int logicalAddress, int requestType) {
+			int priority = CecTransactionScheduler::PRIORITY_DISCOVERY;
+			std::vector<uint8_t> message;
+			int reply;
+
 			switch (requestType)
 			{
 				case CECDeviceParams::REQUEST_PHISICAL_ADDRESS :
 				{
-					_instance->smConnection->sendTo(LogicalAddress(logicalAddress), MessageEncoder().encode(GivePhysicalAddress()), 5000);	
+					message = toMessage(MessageEncoder().encode(GivePhysicalAddress()));
+					reply = REPORT_PHYSICAL_ADDRESS;
 				}
 					break;
 
 				case CECDeviceParams::REQUEST_CEC_VERSION :
 				{
-					_instance->smConnection->sendTo(LogicalAddress(logicalAddress), MessageEncoder().encode(GetCECVersion()), 5000);	
+					message = toMessage(MessageEncoder().encode(GetCECVersion()));
+					reply = CEC_VERSION;
 				}
 					break;
 
 				case CECDeviceParams::REQUEST_DEVICE_VENDOR_ID :
 				{
-					_instance->smConnection->sendTo(LogicalAddress(logicalAddress), MessageEncoder().encode(GiveDeviceVendorID()), 5000);	
+					message = toMessage(MessageEncoder().encode(GiveDeviceVendorID()));
+					reply = DEVICE_VENDOR_ID;
 				}
 					break;
 
 				case CECDeviceParams::REQUEST_OSD_NAME :	
 				{
-					_instance->smConnection->sendTo(LogicalAddress(logicalAddress), MessageEncoder().encode(GiveOSDName()), 5000);	
+					message = toMessage(MessageEncoder().encode(GiveOSDName()));
+					reply = SET_OSD_NAME;
 				}
 					break;
 
 				case CECDeviceParams::REQUEST_POWER_STATUS :	
 				{
-					_instance->smConnection->sendTo(LogicalAddress(logicalAddress), MessageEncoder().encode(GiveDevicePowerStatus()), 5000);	
+					priority = CecTransactionScheduler::PRIORITY_POWER_ROUTING;
+					message = toMessage(MessageEncoder().encode(GiveDevicePowerStatus()));
+					reply = REPORT_POWER_STATUS;
 				}
 					break;
 				default:
-				{
-					_instance->deviceList[logicalAddress].m_isRequested = CECDeviceParams::REQUEST_NONE;
-				}
-					break;
+					return;
 			}
 
-			_instance->deviceList[logicalAddress].m_requestTime = std::chrono::system_clock::now();
-			LOGINFO("request type %d", _instance->deviceList[logicalAddress].m_isRequested);
+			LOGINFO("request type %d for %d", requestType, logicalAddress);
+
+			m_scheduler.send(priority, logicalAddress, message, reply,
+					[this, logicalAddress, requestType](int result) {
+						if ( result != CecTransactionScheduler::RESULT_DONE )
+							requestFailed(logicalAddress, requestType, result);
+					},
+					[this, logicalAddress, requestType]() {
+						return isInfoMissing(logicalAddress, requestType);
+					});
 		}
 
-		int HdmiCecSink::requestStatus(const int logicalAddress) {
-			std::chrono::duration<double,std::milli> elapsed;
-			bool isElapsed = false;
-			
-			if(!HdmiCecSink::_instance)
-				return -1;
+		bool HdmiCecSink::isInfoMissing(const int logicalAddress, int requestType) {
+			CECDeviceParams &device = deviceList[logicalAddress];
 
+			if ( !device.m_isDevicePresent )
+				return false;
 
-			if ( _instance->m_logicalAddressAllocated == LogicalAddress::UNREGISTERED || logicalAddress >= LogicalAddress::UNREGISTERED + TEST_ADD ) {
-				LOGERR("Logical Address NOT Allocated Or its not valid");
-				return -1;
+			switch (requestType)
+			{
+				case CECDeviceParams::REQUEST_PHISICAL_ADDRESS :
+					return !device.m_isPAUpdated || !device.m_isDeviceTypeUpdated;
+				case CECDeviceParams::REQUEST_CEC_VERSION :
+					return !device.m_isVersionUpdated;
+				case CECDeviceParams::REQUEST_DEVICE_VENDOR_ID :
+					return !device.m_isVendorIDUpdated;
+				case CECDeviceParams::REQUEST_OSD_NAME :
+					return !device.m_isOSDNameUpdated;
+				case CECDeviceParams::REQUEST_POWER_STATUS :
+					return !device.m_isPowerStatusUpdated;
+				default:
+					return false;
 			}
+		}
+
+		void HdmiCecSink::requestFailed(const int logicalAddress, int requestType, int result) {
+			/* Stopped, or the answer came in some other way */
+			if ( result == CecTransactionScheduler::RESULT_DROPPED || !isInfoMissing(logicalAddress, requestType) )
+				return;
+
+			LOGINFO("request type %d for %d failed %d", requestType, logicalAddress, result);
 
-			switch ( _instance->deviceList[logicalAddress].m_isRequested ) {
+			/* The scheduler already retried, fill in defaults so that the device is not asked over and over */
+			switch( requestType )
+			{
 				case CECDeviceParams::REQUEST_PHISICAL_ADDRESS :
 				{
-					if( _instance->deviceList[logicalAddress].m_isPAUpdated &&
-							_instance->deviceList[logicalAddress].m_isDeviceTypeUpdated )
-					{
-						_instance->deviceList[logicalAddress].m_isRequested = CECDeviceParams::REQUEST_NONE;
-					}
+					/* Update with Invalid Physical Address */
+					deviceList[logicalAddress].update(PhysicalAddress(0xF,0xF,0xF,0xF));
+					deviceList[logicalAddress].update(DeviceType(DeviceType::RESERVED));
 				}
 					break;
-
+				
 				case CECDeviceParams::REQUEST_CEC_VERSION :
 				{
-					if( _instance->deviceList[logicalAddress].m_isVersionUpdated )
-					{
-						_instance->deviceList[logicalAddress].m_isRequested = CECDeviceParams::REQUEST_NONE;
-					}
+					/*Defaulting to 1.4*/
+					deviceList[logicalAddress].update(Version(Version::V_1_4));
 				}
 					break;
 
 				case CECDeviceParams::REQUEST_DEVICE_VENDOR_ID :
 				{
-					if( _instance->deviceList[logicalAddress].m_isVendorIDUpdated )
-					{
-						_instance->deviceList[logicalAddress].m_isRequested = CECDeviceParams::REQUEST_NONE;
-					}
+					deviceList[logicalAddress].update(VendorID(0,0,0));
 				}
 					break;
 
 				case CECDeviceParams::REQUEST_OSD_NAME :	
 				{
-					if( _instance->deviceList[logicalAddress].m_isOSDNameUpdated )
-					{
-						_instance->deviceList[logicalAddress].m_isRequested = CECDeviceParams::REQUEST_NONE;
-					}
+					deviceList[logicalAddress].update(OSDName("NA"));
 				}
 					break;
 
 				case CECDeviceParams::REQUEST_POWER_STATUS :	
 				{
-					if( _instance->deviceList[logicalAddress].m_isPowerStatusUpdated )
-					{
-						_instance->deviceList[logicalAddress].m_isRequested = CECDeviceParams::REQUEST_NONE;
-					}
+					deviceList[logicalAddress].update(PowerStatus(PowerStatus::POWER_STATUS_NOT_KNOWN));
 				}
 					break;
 				default:
 					break;	
 			}
+		}
 
-			if ( _instance->deviceList[logicalAddress].m_isRequested != CECDeviceParams::REQUEST_NONE )
-			{
-				elapsed = std::chrono::system_clock::now() - _instance->deviceList[logicalAddress].m_requestTime;
+		std::vector<uint8_t> HdmiCecSink::toMessage(const CECFrame &frame) {
+			const uint8_t *buf = NULL;
+			size_t len = 0;
 
-				if ( elapsed.count() > HDMICECSINK_REQUEST_MAX_WAIT_TIME_MS )
+			frame.getBuffer(&buf, &len);
+			return std::vector<uint8_t>(buf, buf + len);
+		}
+
+		void HdmiCecSink::sendMessage(int priority, const LogicalAddress &to, const CECFrame &frame) {
+			m_scheduler.send(priority, to.toInt(), toMessage(frame));
+		}
+
+		int HdmiCecSink::sendToBus(uint8_t destination, const std::vector<uint8_t> &message) {
+#ifdef HDMICECSINK_BENCHMARK
+			if ( _virtualBus != NULL )
+			{
+				switch ( _virtualBus->transmit(m_logicalAddressAllocated, destination, message) )
 				{
-					LOGINFO("request elapsed ");
-					isElapsed = true;	
+					case VirtualCecBus::TX_ACKED :
+						return CecTransactionScheduler::SEND_ACKED;
+					case VirtualCecBus::TX_NACKED :
+						return CecTransactionScheduler::SEND_NACKED;
+					default :
+						return CecTransactionScheduler::SEND_FAILED;
 				}
 			}
+#endif
 
-			if (isElapsed)
+			try
 			{
-				/* For some request it should be retry, like report physical address etc for other we can have default values */
-				switch( _instance->deviceList[logicalAddress].m_isRequested )
+				if ( message.empty() )
 				{
-					case CECDeviceParams::REQUEST_PHISICAL_ADDRESS :
-					{
-						LOGINFO("Retry for REQUEST_PHISICAL_ADDRESS = %d", _instance->deviceList[logicalAddress].m_isRequestRetry);
-						/* Update with Invalid Physical Address */
-						if ( _instance->deviceList[logicalAddress].m_isRequestRetry++ >= HDMICECSINK_REQUEST_MAX_RETRY )
-						{
-							LOGINFO("Max retry for REQUEST_PHISICAL_ADDRESS = %d", _instance->deviceList[logicalAddress].m_isRequestRetry);
-							_instance->deviceList[logicalAddress].update(PhysicalAddress(0xF,0xF,0xF,0xF));
-							_instance->deviceList[logicalAddress].update(DeviceType(DeviceType::RESERVED));
-							_instance->deviceList[logicalAddress].m_isRequestRetry = 0;
-						}
-					}
-						break;
-					
-					case CECDeviceParams::REQUEST_CEC_VERSION :
-					{
-						/*Defaulting to 1.4*/
-						_instance->deviceList[logicalAddress].update(Version(Version::V_1_4));
-					}
-						break;
-
-					case CECDeviceParams::REQUEST_DEVICE_VENDOR_ID :
-					{
-						_instance->deviceList[logicalAddress].update(VendorID(0,0,0));
-					}
-						break;
+					smConnection->ping(LogicalAddress(m_logicalAddressAllocated), LogicalAddress(destination), Throw_e());
+				}
+				else
+				{
+					smConnection->sendTo(LogicalAddress(destination), CECFrame(message.data(), message.size()), 5000, Throw_e());
+				}
+			}
+			catch(CECNoAckException &e)
+			{
+				return CecTransactionScheduler::SEND_NACKED;
+			}
+			catch(Exception &e)
+			{
+				LOGWARN("Send to 0x%x caught %s \r\n", destination, e.what());
+				return CecTransactionScheduler::SEND_FAILED;
+			}
 
-					case CECDeviceParams::REQUEST_OSD_NAME :	
-					{
-						_instance->deviceList[logicalAddress].update(OSDName("NA"));
-					}
-						break;
+			return CecTransactionScheduler::SEND_ACKED;
+		}
 
-					case CECDeviceParams::REQUEST_POWER_STATUS :	
-					{
-						_instance->deviceList[logicalAddress].update(PowerStatus(PowerStatus::POWER_STATUS_NOT_KNOWN));
-					}
-						break;
-					default:
-						break;	
-				}
+#ifdef HDMICECSINK_BENCHMARK
+		void HdmiCecSink::onVirtualBusFrame(uint8_t from, uint8_t to, const std::vector<uint8_t> &message) {
+			/* Same path as frames from the driver: header, then opcode and operands */
+			std::vector<uint8_t> frame(1, (uint8_t)((from << 4) | (to & 0x0F)));
+			frame.insert(frame.end(), message.begin(), message.end());
 
+			msgFrameListener->notify(CECFrame(frame.data(), frame.size()));
+		}
+#endif
 
-				_instance->deviceList[logicalAddress].m_isRequested = CECDeviceParams::REQUEST_NONE;	
-			}
-			
-			if( _instance->deviceList[logicalAddress].m_isRequested == CECDeviceParams::REQUEST_NONE)
+		void HdmiCecSink::onMessageReceived(const uint8_t *frame, size_t length) {
+			/* Header first, then opcode and operands */
+			if ( frame != NULL && length >= 2 )
 			{
-				LOGINFO("Request Done");
-				return CECDeviceParams::REQUEST_DONE;
+				m_scheduler.onMessage(frame[0] >> 4, frame + 1, length - 1);
 			}
-
-			//LOGINFO("Request NOT Done");
-			return CECDeviceParams::REQUEST_NOT_DONE;
 		}
 		
 		void HdmiCecSink::threadRun()
@@ -1777,7 +1791,6 @@ namespace WPEFramework
         	int i;
 			std::vector <int> connected;
 			std::vector <int> disconnected;
-			int logicalAddressRequested = LogicalAddress::UNREGISTERED + TEST_ADD;
 			bool isExit = false;
 
 			if(!HdmiCecSink::_instance)
@@ -1810,17 +1823,32 @@ namespace WPEFramework
 					if ( _instance->m_logicalAddressAllocated != LogicalAddress::UNREGISTERED)
 					{
 						logicalAddress = LogicalAddress(_instance->m_logicalAddressAllocated);
-						LibCCEC::getInstance().addLogicalAddress(logicalAddress);
-						_instance->smConnection->setSource(logicalAddress);
+#ifdef HDMICECSINK_BENCHMARK
+						if ( _virtualBus == NULL )
+#endif
+						{
+							LibCCEC::getInstance().addLogicalAddress(logicalAddress);
+							_instance->smConnection->setSource(logicalAddress);
+						}
 						_instance->m_numberOfDevices = 0;
 						_instance->deviceList[_instance->m_logicalAddressAllocated].m_deviceType = DeviceType::TV;
 						_instance->deviceList[_instance->m_logicalAddressAllocated].m_isDevicePresent = true;
 						_instance->deviceList[_instance->m_logicalAddressAllocated].m_cecVersion = Version::V_1_4;
 						_instance->deviceList[_instance->m_logicalAddressAllocated].m_vendorID = appVendorId;
 						_instance->deviceList[_instance->m_logicalAddressAllocated].m_currentLanguage = defaultLanguage;
-						_instance->smConnection->addFrameListener(_instance->msgFrameListener);
-						_instance->smConnection->sendTo(LogicalAddress(LogicalAddress::BROADCAST), 
-								MessageEncoder().encode(ReportPhysicalAddress(physical_addr, _instance->deviceList[_instance->m_logicalAddressAllocated].m_deviceType)), 5000);	
+#ifdef HDMICECSINK_BENCHMARK
+						if ( _virtualBus != NULL )
+						{
+							_virtualBus->attach(_instance->m_logicalAddressAllocated, std::bind(&HdmiCecSink::onVirtualBusFrame, _instance,
+									std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+						}
+						else
+#endif
+						{
+							_instance->smConnection->addFrameListener(_instance->msgFrameListener);
+						}
+						_instance->sendMessage(CecTransactionScheduler::PRIORITY_POWER_ROUTING, LogicalAddress(LogicalAddress::BROADCAST),
+								MessageEncoder().encode(ReportPhysicalAddress(physical_addr, _instance->deviceList[_instance->m_logicalAddressAllocated].m_deviceType)));
 
 						 if ( powerState == 0 )
 						 {
@@ -1876,42 +1904,34 @@ namespace WPEFramework
 				case POLL_THREAD_STATE_INFO :
 				{
 					LOGINFO("POLL_THREAD_STATE_INFO");
+					bool isPending = false;
 
-					if ( logicalAddressRequested == LogicalAddress::UNREGISTERED + TEST_ADD )
+					/* All devices are asked at the same time, the scheduler keeps one query per device on the bus */
+					for(i=0;i<LogicalAddress::UNREGISTERED + TEST_ADD;i++)
 					{
-						for(i=0;i<LogicalAddress::UNREGISTERED + TEST_ADD;i++)
+						if( i != _instance->m_logicalAddressAllocated &&
+							_instance->deviceList[i].m_isDevicePresent &&
+							!_instance->deviceList[i].isAllUpdated() )
 						{
-							if( i != _instance->m_logicalAddressAllocated &&
-								_instance->deviceList[i].m_isDevicePresent &&
-								!_instance->deviceList[i].isAllUpdated() )
+							if ( !_instance->m_scheduler.isBusy(i) )
 							{
 								LOGINFO("POLL_THREAD_STATE_INFO -> request for %d", i);
-								logicalAddressRequested = i;
-								_instance->request(logicalAddressRequested);
-								_instance->m_sleepTime = HDMICECSINK_REQUEST_INTERVAL_TIME_MS;
-								break;
+								_instance->request(i);
 							}
+							isPending = true;
 						}
+					}
 
-						if ( i ==  LogicalAddress::UNREGISTERED)
-						{
-							/*So there is no update required, try to ping after some seconds*/
-							_instance->m_pollThreadState = POLL_THREAD_STATE_IDLE;		
-							_instance->m_sleepTime = 0;
-							//LOGINFO("POLL_THREAD_STATE_INFO -> state change to Ping", i);
-						}
+					if ( isPending )
+					{
+						/* Check back for what is still missing */
+						_instance->m_sleepTime = HDMICECSINK_REQUEST_INTERVAL_TIME_MS;
 					}
 					else
 					{
-						/*So there is request sent for logical address, so wait and check the status */
-						if ( _instance->requestStatus(logicalAddressRequested) == CECDeviceParams::REQUEST_DONE )
-						{
-							logicalAddressRequested = LogicalAddress::UNREGISTERED;
-						}
-						else
-						{
-							_instance->m_sleepTime = HDMICECSINK_REQUEST_INTERVAL_TIME_MS;							
-						}
+						/*So there is no update required, try to ping after some seconds*/
+						_instance->m_pollThreadState = POLL_THREAD_STATE_IDLE;		
+						_instance->m_sleepTime = 0;
 					}
 				}
 				break;
@@ -1972,8 +1992,15 @@ namespace WPEFramework
 				break;
 				}
 
-				if ( _instance->m_sleepTime ) {
-					usleep(_instance->m_sleepTime*1000);
+				{
+					/* CECDisable() wakes us up to exit */
+					std::unique_lock<std::mutex> lock(_instance->m_pollMutex);
+					if ( _instance->m_sleepTime ) {
+						_instance->m_pollCondition.wait_for(lock, std::chrono::milliseconds(_instance->m_sleepTime),
+								[]() { return _instance->m_pollExit; });
+					}
+					if ( _instance->m_pollExit )
+						isExit = true;
 				}
 			}
         }
@@ -1987,6 +2014,20 @@ namespace WPEFramework
 			for ( i =0; i<HDMICECSINK_NUMBER_TV_ADDR; i++ )
 			{
         	/* poll for TV logical address */
+#ifdef HDMICECSINK_BENCHMARK
+			  if ( _virtualBus != NULL )
+			  {
+				/* Nobody acknowledging a poll to the address means it is free */
+				if ( _virtualBus->transmit(addr, addr, std::vector<uint8_t>()) == VirtualCecBus::TX_NACKED )
+				{
+					gotLogicalAddress = true;
+					break;
+				}
+				addr = LogicalAddress::SPECIFIC_USE;
+				continue;
+			  }
+#endif
+
 			  try {
 			   	smConnection->poll(LogicalAddress(addr), Throw_e());
 			  }
@@ -2032,30 +2073,46 @@ namespace WPEFramework
                 return;
             }
 
-            if(0 == libcecInitStatus)
+#ifdef HDMICECSINK_BENCHMARK
+            if (_virtualBus != NULL)
             {
-                try
-                {
-                    LibCCEC::getInstance().init();
-                }
-                catch (const std::exception e)
+                /* The TV is the root of the virtual bus */
+                physical_addr = {0x00,0x00,0x00,0x00};
+            }
+            else
+#endif
+            {
+                if(0 == libcecInitStatus)
                 {
-                    LOGWARN("CEC exception caught from LibCCEC::getInstance().init()");
+                    try
+                    {
+                        LibCCEC::getInstance().init();
+                    }
+                    catch (const std::exception e)
+                    {
+                        LOGWARN("CEC exception caught from LibCCEC::getInstance().init()");
+                    }
                 }
+                libcecInitStatus++;
+
+                //Acquire CEC Addresses
+                getPhysicalAddress();
+
+                smConnection = new Connection(LogicalAddress::UNREGISTERED,false,"ServiceManager::Connection::");
+                smConnection->open();
             }
-            libcecInitStatus++;
-          
-            //Acquire CEC Addresses
-            getPhysicalAddress();
-
-			smConnection = new Connection(LogicalAddress::UNREGISTERED,false,"ServiceManager::Connection::");
-            smConnection->open();
-            msgProcessor = new HdmiCecSinkProcessor(*smConnection);
+            msgProcessor = new HdmiCecSinkProcessor();
             msgFrameListener = new HdmiCecSinkFrameListener(*msgProcessor);
             
             cecEnableStatus = true;
 
+            m_scheduler.start(std::bind(&HdmiCecSink::sendToBus, this, std::placeholders::_1, std::placeholders::_2));
+
+#ifdef HDMICECSINK_BENCHMARK
+            if(smConnection || _virtualBus)
+#else
             if(smConnection)
+#endif
             {
            		LOGWARN("Start Thread %p", smConnection );
 			    m_pollThreadState = POLL_THREAD_STATE_POLL;
@@ -2063,6 +2120,10 @@ namespace WPEFramework
 				if (m_pollThread.joinable())
 				m_pollThread.join();
 
+				{
+					std::lock_guard<std::mutex> lock(m_pollMutex);
+					m_pollExit = false;
+				}
 				m_pollThread = std::thread(threadRun);
             }
 
@@ -2080,14 +2141,45 @@ namespace WPEFramework
                 return;
             }
 
+            {
+                std::lock_guard<std::mutex> lock(m_pollMutex);
+                m_pollExit = true;
+            }
+            m_pollCondition.notify_all();
+
+            /* Nothing may be sent any more once the connection is gone, this also ends a ping the poll thread waits for */
+            m_scheduler.stop();
+
+            if (m_pollThread.joinable())
+                m_pollThread.join();
+
+#ifdef HDMICECSINK_BENCHMARK
+            if (_virtualBus != NULL)
+            {
+                _virtualBus->attach(LogicalAddress::BROADCAST, VirtualCecBus::Listener());
+            }
+#endif
+
             if (smConnection != NULL)
             {
                 smConnection->close();
                 delete smConnection;
                 smConnection = NULL;
             }
+
+            /* Nothing delivers frames to them any more */
+            delete msgFrameListener;
+            msgFrameListener = NULL;
+            delete msgProcessor;
+            msgProcessor = NULL;
+
             cecEnableStatus = false;
 
+#ifdef HDMICECSINK_BENCHMARK
+            if (_virtualBus != NULL)
+                return;
+#endif
+
             if(1 == libcecInitStatus)
             {
                 try
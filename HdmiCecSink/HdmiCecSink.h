@@ -34,9 +34,14 @@
 #include "Module.h"
 #include "utils.h"
 #include "AbstractPlugin.h"
+#include "CecTransactionScheduler.h"
+#ifdef HDMICECSINK_BENCHMARK
+#include "VirtualCecBus.h"
+#endif
 
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 
 
 namespace WPEFramework {
@@ -55,7 +60,7 @@ namespace WPEFramework {
         class HdmiCecSinkProcessor : public MessageProcessor
         {
         public:
-            HdmiCecSinkProcessor(Connection &conn) : conn(conn) {}
+            HdmiCecSinkProcessor() {}
                 void process (const ActiveSource &msg, const Header &header);
 	        void process (const InActiveSource &msg, const Header &header);
 	        void process (const ImageViewOn &msg, const Header &header);
@@ -82,7 +87,6 @@ namespace WPEFramework {
 	        void process (const Abort &msg, const Header &header);
 	        void process (const Polling &msg, const Header &header);
         private:
-            Connection conn;
             void printHeader(const Header &header)
             {
                 printf("Header : From : %s \n", header.from.toString().c_str());
@@ -103,12 +107,6 @@ namespace WPEFramework {
 				REQUEST_OSD_NAME,
 			};
 
-			enum {
-				REQUEST_DONE = 0,
-				REQUEST_NOT_DONE,
-				REQUEST_TIME_ELAPSED,
-			};
-			
 			DeviceType m_deviceType;
 			LogicalAddress m_logicalAddress;
 			PhysicalAddress m_physicalAddr;
@@ -126,9 +124,6 @@ namespace WPEFramework {
 			bool m_isOSDNameUpdated;
 			bool m_isVendorIDUpdated;
 			bool m_isPowerStatusUpdated;
-			int  m_isRequested;
-			int  m_isRequestRetry;
-			std::chrono::system_clock::time_point m_requestTime;
 			std::vector<FeatureAbort> m_featureAborts;
 			std::chrono::system_clock::time_point m_lastPowerUpdateTime;
 			
@@ -144,7 +139,6 @@ namespace WPEFramework {
 				m_isPowerStatusUpdated = false;
 				m_isDeviceDisconnected = false;
 				m_isDeviceTypeUpdated = false;
-				m_isRequestRetry = 0;
 			}
 
 			void clear( ) 
@@ -237,7 +231,7 @@ namespace WPEFramework {
 
 			DeviceNode() {
 				int i;
-				for (i; i < LogicalAddress::UNREGISTERED; i++ )
+				for (i = 0; i < LogicalAddress::UNREGISTERED; i++ )
 				{
 					m_childsLogicalAddr[i] = LogicalAddress::UNREGISTERED;
 				}
@@ -391,6 +385,13 @@ namespace WPEFramework {
             HdmiCecSink();
             virtual ~HdmiCecSink();
             static HdmiCecSink* _instance;
+#ifdef HDMICECSINK_BENCHMARK
+            /*
+             * Benchmark builds only: the plugin talks to this bus instead of the CEC driver. Set before the
+             * plugin is created; the bus has to be started before and stopped after the plugin's lifetime.
+             */
+            static VirtualCecBus* _virtualBus;
+#endif
 			CECDeviceParams deviceList[16];
 			std::vector<HdmiPortMap> hdmiInputs;
 			int m_currentActiveSource;
@@ -409,6 +410,8 @@ namespace WPEFramework {
 			void sendMenuLanguage();
 			void setActiveSource(bool isResponse);
 			void requestActiveSource();
+			void onMessageReceived(const uint8_t *frame, size_t length);
+			void sendMessage(int priority, const LogicalAddress &to, const CECFrame &frame);
 			int m_numberOfDevices; /* Number of connected devices othethan own device */
         private:
             // We do not allow this plugin to be copied !!
@@ -447,7 +450,10 @@ namespace WPEFramework {
 			uint32_t m_pollNextState;
 			uint32_t m_sleepTime;
             std::mutex m_pollMutex;
+            std::condition_variable m_pollCondition;
+            bool m_pollExit;
             Connection *smConnection;
+			CecTransactionScheduler m_scheduler;
 			std::vector<uint8_t> m_connectedDevices;
             HdmiCecSinkProcessor *msgProcessor;
             HdmiCecSinkFrameListener *msgFrameListener;
@@ -458,9 +464,15 @@ namespace WPEFramework {
 			void pingDevices(std::vector<int> &connected , std::vector<int> &disconnected);
 			void CheckHdmiInState();
 			void request(const int logicalAddress);
-			int requestType(const int logicalAddress);
-			int requestStatus(const int logicalAddress);
+			void requestInfo(const int logicalAddress, int requestType);
+			bool isInfoMissing(const int logicalAddress, int requestType);
+			void requestFailed(const int logicalAddress, int requestType, int result);
 			void requestPowerStatus(const int logicalAddress);
+			static std::vector<uint8_t> toMessage(const CECFrame &frame);
+			int sendToBus(uint8_t destination, const std::vector<uint8_t> &message);
+#ifdef HDMICECSINK_BENCHMARK
+			void onVirtualBusFrame(uint8_t from, uint8_t to, const std::vector<uint8_t> &message);
+#endif
 			static void threadRun();
 			void cecMonitoringThread();
             static void cecMgrEventHandler(const char *owner, IARM_EventId_t eventId, void *data, size_t len);
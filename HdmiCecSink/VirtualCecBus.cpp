@@ -0,0 +1,403 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2019 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#include "VirtualCecBus.h"
+
+#include <string.h>
+
+/* CEC timing, in microseconds */
+#define CECBUS_START_BIT_US						4500
+#define CECBUS_BIT_PERIOD_US					2400
+#define CECBUS_BITS_PER_BLOCK					10		/* 8 data bits, EOM and ACK */
+/* Signal free time before a frame, in bit periods */
+#define CECBUS_SIGNAL_FREE_NEW_INITIATOR		7
+#define CECBUS_SIGNAL_FREE_SAME_INITIATOR		5
+
+#define CECBUS_BROADCAST						0x0F
+
+#define CEC_FEATURE_ABORT						0x00
+#define CEC_ROUTING_CHANGE						0x80
+#define CEC_ACTIVE_SOURCE						0x82
+#define CEC_GIVE_PHYSICAL_ADDRESS				0x83
+#define CEC_REPORT_PHYSICAL_ADDRESS				0x84
+#define CEC_REQUEST_ACTIVE_SOURCE				0x85
+#define CEC_SET_STREAM_PATH						0x86
+#define CEC_DEVICE_VENDOR_ID					0x87
+#define CEC_GIVE_DEVICE_VENDOR_ID				0x8C
+#define CEC_GIVE_DEVICE_POWER_STATUS			0x8F
+#define CEC_REPORT_POWER_STATUS					0x90
+#define CEC_SET_MENU_LANGUAGE					0x32
+#define CEC_GIVE_OSD_NAME						0x46
+#define CEC_SET_OSD_NAME						0x47
+#define CEC_CEC_VERSION							0x9E
+#define CEC_GET_CEC_VERSION						0x9F
+
+#define CEC_ABORT_UNRECOGNIZED_OPCODE			0x00
+
+namespace WPEFramework {
+
+    namespace Plugin {
+
+		VirtualCecBus::VirtualCecBus(double timeScale)
+		: m_running(false), m_timeScale(timeScale > 0 ? timeScale : 1.0), m_hostAddress(CECBUS_BROADCAST),
+		  m_random(1), m_lastInitiator(CECBUS_BROADCAST)
+		{
+			memset(&m_statistics, 0, sizeof(m_statistics));
+		}
+
+		VirtualCecBus::~VirtualCecBus()
+		{
+			stop();
+		}
+
+		void VirtualCecBus::addDevice(const Device &device)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_devices.push_back(device);
+		}
+
+		void VirtualCecBus::setFaults(const Faults &faults)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_faults = faults;
+			m_random.seed(faults.seed);
+		}
+
+		void VirtualCecBus::attach(uint8_t logicalAddress, const Listener &listener)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_hostAddress = logicalAddress & 0x0F;
+			m_listener = listener;
+		}
+
+		void VirtualCecBus::setMonitor(const Listener &monitor)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_monitor = monitor;
+		}
+
+		void VirtualCecBus::start()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			if (m_running)
+				return;
+
+			memset(&m_statistics, 0, sizeof(m_statistics));
+			m_started = Clock::now();
+			m_running = true;
+
+			for (auto &device : m_devices)
+			{
+				if (device.announce)
+				{
+					std::vector<uint8_t> report = { CEC_REPORT_PHYSICAL_ADDRESS, (uint8_t)(device.physicalAddress >> 8),
+						(uint8_t)(device.physicalAddress & 0xFF), device.deviceType };
+					std::vector<uint8_t> vendor = { CEC_DEVICE_VENDOR_ID, (uint8_t)(device.vendorId >> 16),
+						(uint8_t)(device.vendorId >> 8), (uint8_t)device.vendorId };
+					reply(device, CECBUS_BROADCAST, report);
+					reply(device, CECBUS_BROADCAST, vendor);
+				}
+			}
+
+			m_thread = std::thread(&VirtualCecBus::run, this);
+		}
+
+		void VirtualCecBus::stop()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_running = false;
+				m_condition.notify_all();
+			}
+
+			if (m_thread.joinable())
+				m_thread.join();
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (auto &transmission : m_pending)
+			{
+				transmission->result = TX_FAILED;
+				transmission->done = true;
+			}
+			m_pending.clear();
+			m_done.notify_all();
+		}
+
+		int VirtualCecBus::transmit(uint8_t initiator, uint8_t destination, const std::vector<uint8_t> &message)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			if (!m_running)
+				return TX_FAILED;
+
+			TransmissionPtr transmission = std::make_shared<Transmission>();
+			transmission->initiator = initiator & 0x0F;
+			transmission->destination = destination & 0x0F;
+			transmission->message = message;
+			transmission->due = Clock::now();
+			transmission->fromHost = true;
+			transmission->done = false;
+			transmission->result = TX_FAILED;
+
+			m_pending.push_back(transmission);
+			m_condition.notify_all();
+			m_done.wait(lock, [&transmission]() { return transmission->done; });
+
+			return transmission->result;
+		}
+
+		VirtualCecBus::Statistics VirtualCecBus::statistics() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			Statistics statistics = m_statistics;
+
+			if (m_running)
+			{
+				std::chrono::duration<double, std::micro> elapsed = Clock::now() - m_started;
+				statistics.elapsedUs = (uint64_t)(elapsed.count() / m_timeScale);
+			}
+			return statistics;
+		}
+
+		unsigned VirtualCecBus::frameTimeUs(size_t messageLength)
+		{
+			return CECBUS_START_BIT_US + (1 + messageLength) * CECBUS_BITS_PER_BLOCK * CECBUS_BIT_PERIOD_US;
+		}
+
+		void VirtualCecBus::run()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			while (m_running)
+			{
+				Clock::time_point now = Clock::now();
+				Clock::time_point wakeup = Clock::time_point::max();
+				auto winner = m_pending.end();
+				uint32_t contenders = 0;
+
+				/* Arbitration: of everyone wanting the bus the lowest initiator address wins, the others retry after it */
+				for (auto it = m_pending.begin(); it != m_pending.end(); ++it)
+				{
+					if ((*it)->due > now)
+					{
+						wakeup = std::min(wakeup, (*it)->due);
+						continue;
+					}
+					contenders++;
+					if (winner == m_pending.end() || (*it)->initiator < (*winner)->initiator)
+						winner = it;
+				}
+
+				if (winner == m_pending.end())
+				{
+					if (wakeup == Clock::time_point::max())
+						m_condition.wait(lock);
+					else
+						m_condition.wait_until(lock, wakeup);
+					continue;
+				}
+
+				TransmissionPtr transmission = *winner;
+				m_pending.erase(winner);
+				m_statistics.arbitrationLosses += contenders - 1;
+
+				unsigned signalFree = (transmission->initiator == m_lastInitiator) ?
+					CECBUS_SIGNAL_FREE_SAME_INITIATOR : CECBUS_SIGNAL_FREE_NEW_INITIATOR;
+				unsigned frameUs = frameTimeUs(transmission->message.size());
+
+				lock.unlock();
+				sleepBusTime(signalFree * CECBUS_BIT_PERIOD_US + frameUs);
+				lock.lock();
+
+				m_lastInitiator = transmission->initiator;
+				m_statistics.frames++;
+				m_statistics.busyUs += frameUs;
+
+				/* Directed frames need someone at the destination to acknowledge them */
+				bool isBroadcast = transmission->destination == CECBUS_BROADCAST;
+				bool isPresent = isBroadcast || transmission->destination == m_hostAddress || findDevice(transmission->destination) != NULL;
+				std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+				if (!isPresent || (!isBroadcast && chance(m_random) < m_faults.nackRate))
+				{
+					transmission->result = TX_NACKED;
+					m_statistics.nacks++;
+				}
+				else
+				{
+					transmission->result = TX_ACKED;
+
+					if (!transmission->message.empty() && chance(m_random) < m_faults.lossRate)
+					{
+						m_statistics.lost++;
+					}
+					else if (!transmission->message.empty())
+					{
+						deliverLocked(*transmission);
+
+						bool toHost = (transmission->destination == m_hostAddress || isBroadcast) &&
+							transmission->initiator != m_hostAddress;
+						if (toHost && m_listener)
+						{
+							Listener listener = m_listener;
+							lock.unlock();
+							listener(transmission->initiator, transmission->destination, transmission->message);
+							lock.lock();
+						}
+					}
+				}
+
+				if (m_monitor)
+				{
+					Listener monitor = m_monitor;
+					lock.unlock();
+					monitor(transmission->initiator, transmission->destination, transmission->message);
+					lock.lock();
+				}
+
+				if (transmission->fromHost)
+				{
+					transmission->done = true;
+					m_done.notify_all();
+				}
+			}
+		}
+
+		void VirtualCecBus::deliverLocked(const Transmission &transmission)
+		{
+			const std::vector<uint8_t> &message = transmission.message;
+			uint8_t opcode = message[0];
+
+			for (auto &device : m_devices)
+			{
+				if (device.logicalAddress == transmission.initiator)
+					continue;
+
+				bool isDirected = transmission.destination == device.logicalAddress;
+				if (!isDirected && transmission.destination != CECBUS_BROADCAST)
+					continue;
+
+				switch (opcode)
+				{
+					case CEC_GIVE_PHYSICAL_ADDRESS:
+						if (isDirected)
+							reply(device, CECBUS_BROADCAST, { CEC_REPORT_PHYSICAL_ADDRESS, (uint8_t)(device.physicalAddress >> 8),
+								(uint8_t)(device.physicalAddress & 0xFF), device.deviceType });
+						break;
+
+					case CEC_GET_CEC_VERSION:
+						if (isDirected)
+							reply(device, transmission.initiator, { CEC_CEC_VERSION, device.cecVersion });
+						break;
+
+					case CEC_GIVE_DEVICE_VENDOR_ID:
+						if (isDirected)
+							reply(device, CECBUS_BROADCAST, { CEC_DEVICE_VENDOR_ID, (uint8_t)(device.vendorId >> 16),
+								(uint8_t)(device.vendorId >> 8), (uint8_t)device.vendorId });
+						break;
+
+					case CEC_GIVE_OSD_NAME:
+						if (isDirected && device.supportsOsdName)
+						{
+							std::vector<uint8_t> name = { CEC_SET_OSD_NAME };
+							name.insert(name.end(), device.osdName.begin(), device.osdName.end());
+							reply(device, transmission.initiator, name);
+						}
+						else if (isDirected)
+						{
+							reply(device, transmission.initiator, { CEC_FEATURE_ABORT, opcode, CEC_ABORT_UNRECOGNIZED_OPCODE });
+						}
+						break;
+
+					case CEC_GIVE_DEVICE_POWER_STATUS:
+						if (isDirected)
+							reply(device, transmission.initiator, { CEC_REPORT_POWER_STATUS, device.powerStatus });
+						break;
+
+					case CEC_REQUEST_ACTIVE_SOURCE:
+						if (device.activeSource)
+							reply(device, CECBUS_BROADCAST, { CEC_ACTIVE_SOURCE, (uint8_t)(device.physicalAddress >> 8),
+								(uint8_t)(device.physicalAddress & 0xFF) });
+						break;
+
+					case CEC_SET_STREAM_PATH:
+						if (message.size() >= 3)
+						{
+							uint16_t path = (message[1] << 8) | message[2];
+							bool wasActive = device.activeSource;
+							device.activeSource = (path == device.physicalAddress);
+							if (device.activeSource && !wasActive)
+								reply(device, CECBUS_BROADCAST, { CEC_ACTIVE_SOURCE, message[1], message[2] });
+						}
+						break;
+
+					case CEC_ACTIVE_SOURCE:
+					case CEC_ROUTING_CHANGE:
+						device.activeSource = false;
+						break;
+
+					case CEC_FEATURE_ABORT:
+					case CEC_REPORT_PHYSICAL_ADDRESS:
+					case CEC_DEVICE_VENDOR_ID:
+					case CEC_SET_MENU_LANGUAGE:
+					case CEC_CEC_VERSION:
+					case CEC_SET_OSD_NAME:
+					case CEC_REPORT_POWER_STATUS:
+						break;
+
+					default:
+						if (isDirected)
+							reply(device, transmission.initiator, { CEC_FEATURE_ABORT, opcode, CEC_ABORT_UNRECOGNIZED_OPCODE });
+						break;
+				}
+			}
+		}
+
+		void VirtualCecBus::reply(const Device &device, uint8_t destination, const std::vector<uint8_t> &message)
+		{
+			TransmissionPtr transmission = std::make_shared<Transmission>();
+			transmission->initiator = device.logicalAddress;
+			transmission->destination = destination;
+			transmission->message = message;
+			transmission->due = Clock::now() + std::chrono::microseconds((uint64_t)(device.replyDelayMs * 1000 * m_timeScale));
+			transmission->fromHost = false;
+			transmission->done = false;
+			transmission->result = TX_FAILED;
+
+			m_pending.push_back(transmission);
+			m_condition.notify_all();
+		}
+
+		VirtualCecBus::Device *VirtualCecBus::findDevice(uint8_t logicalAddress)
+		{
+			for (auto &device : m_devices)
+			{
+				if (device.logicalAddress == logicalAddress)
+					return &device;
+			}
+			return NULL;
+		}
+
+		void VirtualCecBus::sleepBusTime(unsigned us)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds((uint64_t)(us * m_timeScale)));
+		}
+	} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,156 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2019 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace WPEFramework {
+
+    namespace Plugin {
+
+		/*
+		 * An in-process CEC bus, to be used instead of LibCCEC's Connection (e.g. as the
+		 * CecTransactionScheduler sender) where there is no HDMI hardware. Frames take the time they
+		 * take on a real bus (start bit, 10 bit periods of 2.4 ms per block, signal free time), initiators
+		 * that want the bus at the same time are arbitrated by logical address, and emulated devices
+		 * answer the usual discovery and routing messages after their own processing delay. NACKs and
+		 * lost frames can be injected. Messages are the opcode followed by its operands; an empty
+		 * message is a poll.
+		 */
+		class VirtualCecBus {
+			public:
+
+			enum {
+				TX_ACKED = 0,
+				TX_NACKED,
+				TX_FAILED,
+			};
+
+			struct Device {
+				Device()
+				: logicalAddress(0x0F), physicalAddress(0xFFFF), deviceType(0), vendorId(0), osdName(),
+				  cecVersion(0x05), powerStatus(0), replyDelayMs(100), supportsOsdName(true), announce(false), activeSource(false)
+				{
+				}
+
+				uint8_t logicalAddress;
+				uint16_t physicalAddress;
+				uint8_t deviceType;
+				uint32_t vendorId;
+				std::string osdName;
+				uint8_t cecVersion;
+				uint8_t powerStatus;
+				unsigned replyDelayMs;		/* Time the device takes before it answers */
+				bool supportsOsdName;		/* Otherwise Give OSD Name is Feature Aborted */
+				bool announce;				/* Broadcasts its physical address and vendor id once the bus starts */
+				bool activeSource;
+			};
+
+			struct Faults {
+				Faults() : nackRate(0.0), lossRate(0.0), seed(1) { }
+
+				double nackRate;			/* Directed frames not acknowledged */
+				double lossRate;			/* Frames acknowledged but never processed by the receiver */
+				unsigned seed;
+			};
+
+			struct Statistics {
+				uint32_t frames;
+				uint32_t nacks;
+				uint32_t lost;
+				uint32_t arbitrationLosses;
+				uint64_t busyUs;			/* Bus time spent on frames, in bus (unscaled) time */
+				uint64_t elapsedUs;			/* Since start(), in bus (unscaled) time */
+			};
+
+			/* Called for frames addressed to an attached address or broadcast, from the bus thread */
+			typedef std::function<void (uint8_t from, uint8_t to, const std::vector<uint8_t> &message)> Listener;
+
+			/* timeScale < 1 runs the bus faster than real time, e.g. 0.1 for ten times as fast */
+			explicit VirtualCecBus(double timeScale = 1.0);
+			~VirtualCecBus();
+
+			void addDevice(const Device &device);
+			void setFaults(const Faults &faults);
+			void attach(uint8_t logicalAddress, const Listener &listener);
+			/* Called for every frame that went out, whoever sent it and whether it was acked, from the bus thread */
+			void setMonitor(const Listener &monitor);
+
+			void start();
+			void stop();
+
+			/* Puts a frame on the bus and waits until it went out, returns one of TX_* */
+			int transmit(uint8_t initiator, uint8_t destination, const std::vector<uint8_t> &message);
+
+			Statistics statistics() const;
+
+			/* Time a frame carrying message takes on the bus, header included */
+			static unsigned frameTimeUs(size_t messageLength);
+
+			private:
+			typedef std::chrono::steady_clock Clock;
+
+			struct Transmission {
+				uint8_t initiator;
+				uint8_t destination;
+				std::vector<uint8_t> message;
+				Clock::time_point due;
+				bool fromHost;
+				bool done;
+				int result;
+			};
+
+			typedef std::shared_ptr<Transmission> TransmissionPtr;
+
+			void run();
+			void deliverLocked(const Transmission &transmission);
+			void reply(const Device &device, uint8_t destination, const std::vector<uint8_t> &message);
+			Device *findDevice(uint8_t logicalAddress);
+			void sleepBusTime(unsigned us);
+
+			mutable std::mutex m_mutex;
+			std::condition_variable m_condition;
+			std::condition_variable m_done;
+			std::thread m_thread;
+			bool m_running;
+			double m_timeScale;
+			std::vector<Device> m_devices;
+			uint8_t m_hostAddress;
+			Listener m_listener;
+			Listener m_monitor;
+			Faults m_faults;
+			std::mt19937 m_random;
+			std::list<TransmissionPtr> m_pending;
+			uint8_t m_lastInitiator;
+			Clock::time_point m_started;
+			Statistics m_statistics;
+		};
+	} // namespace Plugin
+} // namespace WPEFramework
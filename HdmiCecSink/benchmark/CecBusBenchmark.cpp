@@ -0,0 +1,567 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2019 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+/*
+ * Measures how long HdmiCecSink takes to learn the whole topology and how long user commands wait
+ * for the bus while it does, on a VirtualCecBus. Two strategies are run against the same scripted
+ * scenarios: "plugin", the HdmiCecSink plugin itself with HdmiCecSink::_virtualBus pointing at the
+ * bus, and "legacy", the serial ping/query loop with fixed sleeps the plugin used before.
+ *
+ * All times are reported in bus time. The plugin's reply timeouts and poll intervals are wall clock,
+ * so its results are only exact at --scale 1.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "HdmiCecSink.h"
+#include "VirtualCecBus.h"
+
+using namespace WPEFramework;
+using namespace WPEFramework::Plugin;
+
+#define HOST_LOGICAL_ADDRESS				0	/* HdmiCecSink is the TV */
+
+#define CEC_FEATURE_ABORT					0x00
+#define CEC_GIVE_OSD_NAME					0x46
+#define CEC_SET_OSD_NAME					0x47
+#define CEC_GIVE_PHYSICAL_ADDRESS			0x83
+#define CEC_REPORT_PHYSICAL_ADDRESS			0x84
+#define CEC_SET_STREAM_PATH					0x86
+#define CEC_DEVICE_VENDOR_ID				0x87
+#define CEC_GIVE_DEVICE_VENDOR_ID			0x8C
+#define CEC_GIVE_DEVICE_POWER_STATUS		0x8F
+#define CEC_REPORT_POWER_STATUS				0x90
+#define CEC_CEC_VERSION						0x9E
+#define CEC_GET_CEC_VERSION					0x9F
+
+/* Legacy timings, as HdmiCecSink had them */
+#define LEGACY_PING_SLEEP_MS				50
+#define LEGACY_POLL_MS						200
+#define LEGACY_REQUEST_TIMEOUT_MS			2000
+
+#define PING_INTERVAL_MS					5000
+
+#define COMMAND_INTERVAL_MS					250
+#define COMMAND_TIMEOUT_MS					5000
+#define TOPOLOGY_CHECK_MS					20
+#define MIN_COMMANDS						20
+#define DISCOVERY_DEADLINE_MS				60000
+
+typedef std::chrono::steady_clock Clock;
+
+enum {
+	INFO_PHYSICAL_ADDRESS = 0,
+	INFO_VENDOR_ID,
+	INFO_OSD_NAME,
+	INFO_CEC_VERSION,
+	INFO_POWER_STATUS,
+	INFO_COUNT,
+};
+
+static const struct {
+	uint8_t query;
+	uint8_t reply;
+} infoQueries[INFO_COUNT] = {
+	{ CEC_GIVE_PHYSICAL_ADDRESS, CEC_REPORT_PHYSICAL_ADDRESS },
+	{ CEC_GIVE_DEVICE_VENDOR_ID, CEC_DEVICE_VENDOR_ID },
+	{ CEC_GIVE_OSD_NAME, CEC_SET_OSD_NAME },
+	{ CEC_GET_CEC_VERSION, CEC_CEC_VERSION },
+	{ CEC_GIVE_DEVICE_POWER_STATUS, CEC_REPORT_POWER_STATUS },
+};
+
+struct Scenario {
+	const char *name;
+	const char *description;
+	std::vector<VirtualCecBus::Device> devices;
+	VirtualCecBus::Faults faults;
+};
+
+struct Result {
+	bool complete;
+	double topologyMs;
+	std::vector<double> latencies;
+	VirtualCecBus::Statistics bus;
+};
+
+static VirtualCecBus::Device makeDevice(uint8_t logicalAddress, uint16_t physicalAddress, uint8_t deviceType,
+		const char *osdName, unsigned replyDelayMs = 100)
+{
+	VirtualCecBus::Device device;
+	device.logicalAddress = logicalAddress;
+	device.physicalAddress = physicalAddress;
+	device.deviceType = deviceType;
+	device.vendorId = 0x00E091 + logicalAddress;
+	device.osdName = osdName;
+	device.replyDelayMs = replyDelayMs;
+	return device;
+}
+
+static std::vector<Scenario> makeScenarios()
+{
+	std::vector<Scenario> scenarios;
+
+	Scenario livingRoom;
+	livingRoom.name = "living-room";
+	livingRoom.description = "AVR with a player behind it and a second player";
+	livingRoom.devices.push_back(makeDevice(5, 0x1000, 5, "AVR"));
+	livingRoom.devices.push_back(makeDevice(4, 0x1100, 4, "Player"));
+	livingRoom.devices.push_back(makeDevice(8, 0x2000, 4, "Console"));
+	livingRoom.devices[1].announce = true;
+	scenarios.push_back(livingRoom);
+
+	Scenario fullChain;
+	fullChain.name = "full-chain";
+	fullChain.description = "eight devices on four inputs, two of them announcing";
+	fullChain.devices.push_back(makeDevice(1, 0x1000, 1, "Recorder 1"));
+	fullChain.devices.push_back(makeDevice(2, 0x1100, 1, "Recorder 2"));
+	fullChain.devices.push_back(makeDevice(3, 0x2000, 3, "Tuner"));
+	fullChain.devices.push_back(makeDevice(4, 0x3100, 4, "Player 1"));
+	fullChain.devices.push_back(makeDevice(5, 0x3000, 5, "AVR"));
+	fullChain.devices.push_back(makeDevice(6, 0x3200, 3, "Tuner 2"));
+	fullChain.devices.push_back(makeDevice(8, 0x4000, 4, "Player 2"));
+	fullChain.devices.push_back(makeDevice(11, 0x4100, 4, "Player 3"));
+	fullChain.devices[0].announce = true;
+	fullChain.devices[4].announce = true;
+	scenarios.push_back(fullChain);
+
+	Scenario lossy = livingRoom;
+	lossy.name = "lossy";
+	lossy.description = "living-room with 5% NACKs and 5% lost frames";
+	lossy.faults.nackRate = 0.05;
+	lossy.faults.lossRate = 0.05;
+	lossy.faults.seed = 7;
+	scenarios.push_back(lossy);
+
+	Scenario slow = livingRoom;
+	slow.name = "slow-devices";
+	slow.description = "living-room with devices answering after 600 - 900 ms, one without an OSD name";
+	slow.devices[0].replyDelayMs = 900;
+	slow.devices[1].replyDelayMs = 600;
+	slow.devices[2].replyDelayMs = 750;
+	slow.devices[2].supportsOsdName = false;
+	scenarios.push_back(slow);
+
+	return scenarios;
+}
+
+/*
+ * What the legacy loop knows about the bus, fed by every frame it receives.
+ */
+class Topology {
+	public:
+	explicit Topology(const Scenario &scenario)
+	{
+		memset(m_expected, 0, sizeof(m_expected));
+		memset(m_present, 0, sizeof(m_present));
+		memset(m_known, 0, sizeof(m_known));
+		for (auto &device : scenario.devices)
+			m_expected[device.logicalAddress] = true;
+	}
+
+	void onMessage(uint8_t from, const std::vector<uint8_t> &message)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (message.empty() || from >= 15)
+			return;
+
+		for (int info = 0; info < INFO_COUNT; info++)
+		{
+			if (message[0] == infoQueries[info].reply)
+				m_known[from][info] = true;
+		}
+
+		/* A device without an OSD name is as known as it gets */
+		if (message[0] == CEC_FEATURE_ABORT && message.size() >= 2 && message[1] == CEC_GIVE_OSD_NAME)
+			m_known[from][INFO_OSD_NAME] = true;
+
+		m_condition.notify_all();
+	}
+
+	void setPresent(uint8_t logicalAddress)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_present[logicalAddress] = true;
+	}
+
+	bool isPresent(uint8_t logicalAddress) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_present[logicalAddress];
+	}
+
+	bool isKnown(uint8_t logicalAddress, int info) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_known[logicalAddress][info];
+	}
+
+	bool isComplete() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return isCompleteLocked();
+	}
+
+	/* Waits for the topology to complete, returns isComplete() */
+	bool waitFor(Clock::duration timeout)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_condition.wait_for(lock, timeout, [this]() { return isCompleteLocked(); });
+	}
+
+	private:
+	bool isCompleteLocked() const
+	{
+		for (int address = 0; address < 15; address++)
+		{
+			if (!m_expected[address])
+				continue;
+			if (!m_present[address])
+				return false;
+			for (int info = 0; info < INFO_COUNT; info++)
+			{
+				if (!m_known[address][info])
+					return false;
+			}
+		}
+		return true;
+	}
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_expected[15];
+	bool m_present[15];
+	bool m_known[15][INFO_COUNT];
+};
+
+class Benchmark {
+	public:
+	Benchmark(const Scenario &scenario, double scale)
+	: m_scenario(scenario), m_scale(scale), m_bus(scale), m_topology(scenario), m_stopCommands(false), m_commandSeen(false)
+	{
+		for (auto &device : scenario.devices)
+			m_bus.addDevice(device);
+		m_bus.setFaults(scenario.faults);
+		m_bus.setMonitor([this](uint8_t, uint8_t, const std::vector<uint8_t> &message) {
+			onFrame(message);
+		});
+	}
+
+	Result run(bool usePlugin)
+	{
+		Result result;
+		PluginHost::IPlugin *plugin = NULL;
+
+		if (usePlugin)
+		{
+			HdmiCecSink::_virtualBus = &m_bus;
+		}
+		else
+		{
+			m_bus.attach(HOST_LOGICAL_ADDRESS, [this](uint8_t from, uint8_t, const std::vector<uint8_t> &message) {
+				m_topology.onMessage(from, message);
+			});
+		}
+
+		m_bus.start();
+
+		Clock::time_point started = Clock::now();
+		if (usePlugin)
+			plugin = Core::Service<HdmiCecSink>::Create<PluginHost::IPlugin>();
+
+		std::thread commands(&Benchmark::sendCommands, this, usePlugin);
+
+		if (usePlugin)
+		{
+			while (!isPluginComplete() && !pastDeadline(started))
+				sleepBusMs(TOPOLOGY_CHECK_MS);
+			result.complete = isPluginComplete();
+		}
+		else
+		{
+			discoverLegacy(started);
+			result.complete = m_topology.isComplete();
+		}
+		result.topologyMs = busMs(Clock::now() - started);
+
+		m_stopCommands = true;
+		commands.join();
+
+		result.bus = m_bus.statistics();
+		if (plugin != NULL)
+			plugin->Release();
+		m_bus.stop();
+		HdmiCecSink::_virtualBus = NULL;
+
+		result.latencies = m_latencies;
+		return result;
+	}
+
+	private:
+	double busMs(Clock::duration duration) const
+	{
+		return std::chrono::duration<double, std::milli>(duration).count() / m_scale;
+	}
+
+	Clock::duration busDuration(unsigned ms) const
+	{
+		return std::chrono::microseconds((uint64_t)(ms * 1000 * m_scale));
+	}
+
+	void sleepBusMs(unsigned ms) const
+	{
+		std::this_thread::sleep_for(busDuration(ms));
+	}
+
+	bool pastDeadline(Clock::time_point started) const
+	{
+		return busMs(Clock::now() - started) > DISCOVERY_DEADLINE_MS;
+	}
+
+	/* Absent addresses are polled again every PING_INTERVAL_MS, as the plugin does */
+	bool isPingDue(Clock::time_point &lastPing) const
+	{
+		if (lastPing != Clock::time_point() && busMs(Clock::now() - lastPing) < PING_INTERVAL_MS)
+			return false;
+		lastPing = Clock::now();
+		return true;
+	}
+
+	/* Every device of the scenario is in the plugin's device list with everything it asks for */
+	bool isPluginComplete() const
+	{
+		HdmiCecSink *sink = HdmiCecSink::_instance;
+
+		if (sink == NULL)
+			return false;
+
+		for (auto &device : m_scenario.devices)
+		{
+			CECDeviceParams &params = sink->deviceList[device.logicalAddress];
+			if (!params.m_isDevicePresent || !params.isAllUpdated())
+				return false;
+		}
+		return true;
+	}
+
+	/* The old loop: a fixed sleep after every poll, then one query at a time polled for its answer */
+	void discoverLegacy(Clock::time_point started)
+	{
+		Clock::time_point lastPing;
+
+		while (!m_topology.isComplete() && !pastDeadline(started))
+		{
+			bool ping = isPingDue(lastPing);
+
+			for (uint8_t address = 1; address < 15 && ping; address++)
+			{
+				if (m_topology.isPresent(address))
+					continue;
+				if (m_bus.transmit(HOST_LOGICAL_ADDRESS, address, std::vector<uint8_t>()) == VirtualCecBus::TX_ACKED)
+					m_topology.setPresent(address);
+				sleepBusMs(LEGACY_PING_SLEEP_MS);
+			}
+
+			for (uint8_t address = 1; address < 15; address++)
+			{
+				if (!m_topology.isPresent(address))
+					continue;
+
+				for (int info = 0; info < INFO_COUNT; info++)
+				{
+					if (m_topology.isKnown(address, info))
+						continue;
+
+					if (m_bus.transmit(HOST_LOGICAL_ADDRESS, address, std::vector<uint8_t>(1, infoQueries[info].query)) !=
+						VirtualCecBus::TX_ACKED)
+						continue;
+
+					for (unsigned waited = 0; waited < LEGACY_REQUEST_TIMEOUT_MS && !m_topology.isKnown(address, info);
+						waited += LEGACY_POLL_MS)
+						sleepBusMs(LEGACY_POLL_MS);
+				}
+			}
+
+			sleepBusMs(LEGACY_POLL_MS);
+		}
+	}
+
+	/* Completes the command waiting for its frame to go out */
+	void onFrame(const std::vector<uint8_t> &message)
+	{
+		std::lock_guard<std::mutex> lock(m_commandMutex);
+
+		if (!m_commandSeen && message == m_command)
+		{
+			m_commandSeen = true;
+			m_commandCondition.notify_all();
+		}
+	}
+
+	/* A remote control user switching inputs while discovery runs */
+	void sendCommands(bool usePlugin)
+	{
+		unsigned count = 0;
+
+		while (!m_stopCommands || count < MIN_COMMANDS)
+		{
+			sleepBusMs(COMMAND_INTERVAL_MS);
+
+			const VirtualCecBus::Device &device = m_scenario.devices[count % m_scenario.devices.size()];
+			uint16_t path = device.physicalAddress;
+			std::vector<uint8_t> message = { CEC_SET_STREAM_PATH, (uint8_t)(path >> 8), (uint8_t)(path & 0xFF) };
+			count++;
+
+			Clock::time_point sent = Clock::now();
+			if (usePlugin)
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_commandMutex);
+					m_command = message;
+					m_commandSeen = false;
+				}
+
+				/* What setActivePath does after it worked out the path */
+				HdmiCecSink::_instance->setStreamPath(PhysicalAddress((path >> 12) & 0x0F, (path >> 8) & 0x0F,
+					(path >> 4) & 0x0F, path & 0x0F));
+
+				std::unique_lock<std::mutex> lock(m_commandMutex);
+				if (!m_commandCondition.wait_for(lock, busDuration(COMMAND_TIMEOUT_MS), [this]() { return m_commandSeen; }))
+				{
+					printf("Set Stream Path to %04x never went out\n", path);
+					continue;
+				}
+			}
+			else
+			{
+				m_bus.transmit(HOST_LOGICAL_ADDRESS, 0x0F, message);
+			}
+			m_latencies.push_back(busMs(Clock::now() - sent));
+		}
+	}
+
+	const Scenario &m_scenario;
+	double m_scale;
+	VirtualCecBus m_bus;
+	Topology m_topology;
+	std::atomic<bool> m_stopCommands;
+	std::vector<double> m_latencies;
+	std::mutex m_commandMutex;
+	std::condition_variable m_commandCondition;
+	std::vector<uint8_t> m_command;
+	bool m_commandSeen;
+};
+
+static double percentile(std::vector<double> values, double p)
+{
+	if (values.empty())
+		return 0;
+
+	std::sort(values.begin(), values.end());
+	size_t index = (size_t)(p * values.size() + 0.999999);
+	return values[index > 0 ? index - 1 : 0];
+}
+
+static void report(const Scenario &scenario, const char *strategy, const Result &result)
+{
+	double utilisation = result.bus.elapsedUs ? 100.0 * result.bus.busyUs / result.bus.elapsedUs : 0;
+
+	printf("%-13s %-9s topology %s %8.0f ms  commands %3zu  p50 %6.1f  p95 %6.1f  p99 %6.1f ms  bus %5.1f%%\n",
+		scenario.name, strategy, result.complete ? "   " : "(!)", result.topologyMs, result.latencies.size(),
+		percentile(result.latencies, 0.50), percentile(result.latencies, 0.95), percentile(result.latencies, 0.99),
+		utilisation);
+	printf("%-13s %-9s frames %u nacks %u lost %u arbitration losses %u\n", "", "", result.bus.frames, result.bus.nacks,
+		result.bus.lost, result.bus.arbitrationLosses);
+}
+
+static void usage(const char *name, const std::vector<Scenario> &scenarios)
+{
+	printf("Usage: %s [--scenario <name>|all] [--strategy plugin|legacy|both] [--scale <factor>]\n", name);
+	printf("  --scale 0.1 runs the bus ten times as fast as real time\n\nScenarios:\n");
+	for (auto &scenario : scenarios)
+		printf("  %-13s %s\n", scenario.name, scenario.description);
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<Scenario> scenarios = makeScenarios();
+	std::string selected = "all";
+	std::string strategy = "both";
+	double scale = 1.0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--scenario") == 0 && i + 1 < argc)
+			selected = argv[++i];
+		else if (strcmp(argv[i], "--strategy") == 0 && i + 1 < argc)
+			strategy = argv[++i];
+		else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc)
+			scale = atof(argv[++i]);
+		else
+		{
+			usage(argv[0], scenarios);
+			return (strcmp(argv[i], "--help") == 0) ? 0 : 1;
+		}
+	}
+
+	if (scale <= 0 || (strategy != "plugin" && strategy != "legacy" && strategy != "both"))
+	{
+		usage(argv[0], scenarios);
+		return 1;
+	}
+
+	bool found = false;
+	for (auto &scenario : scenarios)
+	{
+		if (selected != "all" && selected != scenario.name)
+			continue;
+		found = true;
+
+		if (strategy != "legacy")
+		{
+			Benchmark benchmark(scenario, scale);
+			report(scenario, "plugin", benchmark.run(true));
+		}
+		if (strategy != "plugin")
+		{
+			Benchmark benchmark(scenario, scale);
+			report(scenario, "legacy", benchmark.run(false));
+		}
+	}
+
+	Core::Singleton::Dispose();
+
+	if (!found)
+	{
+		usage(argv[0], scenarios);
+		return 1;
+	}
+	return 0;
+}
@@ -19,6 +19,7 @@
  
 #include "Module.h"
 #include "Messenger.h"
+#include "RoomImpl.h"
 #include "cryptalgo/Hash.h"
 
 namespace WPEFramework {
@@ -40,9 +41,24 @@ namespace Plugin {
         _service = service;
         _service->AddRef();
 
+        Config config;
+        config.FromString(service->ConfigLine());
+
         _roomAdmin = service->Root<Exchange::IRoomAdministrator>(_connectionId, 2000, _T("RoomMaintainer"));
         ASSERT(_roomAdmin != nullptr);
 
+        // IRoomAdministrator has no configuration call, the delivery settings can only be applied in process.
+        RoomMaintainer* maintainer = dynamic_cast<RoomMaintainer*>(_roomAdmin);
+
+        if (maintainer != nullptr) {
+            maintainer->Configure(
+                (config.QueueDepth.Value() != 0 ? config.QueueDepth.Value() : RoomMaintainer::DefaultQueueDepth),
+                (config.HistoryDepth.IsSet() == true ? config.HistoryDepth.Value() : RoomMaintainer::DefaultHistoryDepth),
+                (config.Overflow.Value() == _T("disconnect") ? RoomMaintainer::overflow::DISCONNECT : RoomMaintainer::overflow::DROP_OLDEST));
+        } else if ((config.QueueDepth.IsSet() == true) || (config.HistoryDepth.IsSet() == true) || (config.Overflow.IsSet() == true)) {
+            TRACE(Trace::Warning, (_T("Messenger: Delivery settings require an in-process room maintainer, using the defaults")));
+        }
+
         _roomAdmin->Register(this);
 
         return { };
@@ -58,6 +74,7 @@ namespace Plugin {
         }
 
         _roomIds.clear();
+        _held.clear();
 
         _roomAdmin->Unregister(this);
         _rooms.clear();
@@ -71,23 +88,45 @@ namespace Plugin {
 
     // Web request handlers
 
+    string Messenger::JoinRoom(const string& roomName, const string& userName, const uint64_t sinceSequence)
+    {
+        return (Enter(roomName, userName, true, sinceSequence));
+    }
+
     string Messenger::JoinRoom(const string& roomName, const string& userName)
+    {
+        return (Enter(roomName, userName, false, 0));
+    }
+
+    string Messenger::Enter(const string& roomName, const string& userName, bool catchUp, const uint64_t sinceSequence)
     {
         bool result = false;
 
         string roomId = GenerateRoomId(roomName, userName);
 
+        // The history lives in the room maintainer, catching up only works if it runs in our process.
+        RoomMaintainer* maintainer = (catchUp == true ? dynamic_cast<RoomMaintainer*>(_roomAdmin) : nullptr);
+
+        if ((catchUp == true) && (maintainer == nullptr)) {
+            TRACE(Trace::Error, (_T("Messenger: Catching up on room '%s' requires an in-process room maintainer"), roomName.c_str()));
+            catchUp = false;
+        }
+
         MsgNotification* sink = Core::Service<MsgNotification>::Create<MsgNotification>(this, roomId);
         ASSERT(sink != nullptr);
 
         if (sink != nullptr) {
-            Exchange::IRoomAdministrator::IRoom* room = _roomAdmin->Join(roomName, userName, sink);
+            Exchange::IRoomAdministrator::IRoom* room = (catchUp == true ? maintainer->Join(roomName, userName, sink, sinceSequence)
+                                                                         : _roomAdmin->Join(roomName, userName, sink));
 
             // Note: Join() can return nullptr if the user has already joined the room.
             if (room != nullptr) {
 
                 _adminLock.Lock();
                 result = _roomIds.emplace(roomId, room).second;
+                if ((result == true) && (catchUp == true)) {
+                    _held.insert(roomId);
+                }
                 _adminLock.Unlock();
                 ASSERT(result);
             }
@@ -128,6 +167,31 @@ namespace Plugin {
         return result;
     }
 
+    void Messenger::CatchUp(const string& roomId)
+    {
+        _adminLock.Lock();
+
+        auto held(_held.find(roomId));
+
+        if (held != _held.end()) {
+            auto it(_roomIds.find(roomId));
+
+            if (it != _roomIds.end()) {
+                // Only rooms joined through an in-process maintainer are held.
+                RoomImpl* room = dynamic_cast<RoomImpl*>((*it).second);
+                ASSERT(room != nullptr);
+
+                if (room != nullptr) {
+                    room->Resume();
+                }
+            }
+
+            _held.erase(held);
+        }
+
+        _adminLock.Unlock();
+    }
+
     bool Messenger::LeaveRoom(const string& roomId)
     {
         bool result = false;
@@ -141,6 +205,7 @@ namespace Plugin {
             (*it).second->Release();
             // Invalidate the room ID.
             _roomIds.erase(it);
+            _held.erase(roomId);
             result = true;
         }
 
@@ -22,6 +22,7 @@
 #include "Module.h"
 #include <interfaces/IMessenger.h>
 #include <interfaces/json/JsonData_Messenger.h>
+#include "RoomMaintainer.h"
 #include <map>
 #include <set>
 #include <functional>
@@ -33,6 +34,63 @@ namespace Plugin {
     class Messenger : public PluginHost::IPlugin
                     , public Exchange::IRoomAdministrator::INotification
                     , public PluginHost::JSONRPCSupportsEventStatus {
+    private:
+        class Config : public Core::JSON::Container {
+        public:
+            Config(const Config&) = delete;
+            Config& operator=(const Config&) = delete;
+
+            Config()
+                : Core::JSON::Container()
+                , QueueDepth(0)
+                , HistoryDepth(0)
+                , Overflow()
+            {
+                Add(_T("queuedepth"), &QueueDepth);
+                Add(_T("historydepth"), &HistoryDepth);
+                Add(_T("overflow"), &Overflow);
+            }
+
+        public:
+            Core::JSON::DecUInt32 QueueDepth;
+            Core::JSON::DecUInt32 HistoryDepth;
+            Core::JSON::String Overflow;
+        };
+
+        // "join" accepts the sequence number of the last message seen, to catch up on missed ones.
+        class CatchUpJoinParamsData : public JsonData::Messenger::JoinParamsData {
+        public:
+            CatchUpJoinParamsData(const CatchUpJoinParamsData&) = delete;
+            CatchUpJoinParamsData& operator=(const CatchUpJoinParamsData&) = delete;
+
+            CatchUpJoinParamsData()
+                : JsonData::Messenger::JoinParamsData()
+                , Since(0)
+            {
+                Add(_T("since"), &Since);
+            }
+
+        public:
+            Core::JSON::DecUInt64 Since;
+        };
+
+        // "message" carries the room sequence number of the message, if known.
+        class SequencedMessageParamsData : public JsonData::Messenger::MessageParamsData {
+        public:
+            SequencedMessageParamsData(const SequencedMessageParamsData&) = delete;
+            SequencedMessageParamsData& operator=(const SequencedMessageParamsData&) = delete;
+
+            SequencedMessageParamsData()
+                : JsonData::Messenger::MessageParamsData()
+                , Seq(0)
+            {
+                Add(_T("seq"), &Seq);
+            }
+
+        public:
+            Core::JSON::DecUInt64 Seq;
+        };
+
     public:
         Messenger(const Messenger&) = delete;
         Messenger& operator=(const Messenger&) = delete;
@@ -42,6 +100,7 @@ namespace Plugin {
             , _service(nullptr)
             , _roomAdmin(nullptr)
             , _roomIds()
+            , _held()
             , _adminLock()
         {
             RegisterAll();
@@ -58,7 +117,8 @@ namespace Plugin {
         virtual string Information() const override  { return { }; }
 
         // Notification handling
-        class MsgNotification : public Exchange::IRoomAdministrator::IRoom::IMsgNotification {
+        class MsgNotification : public Exchange::IRoomAdministrator::IRoom::IMsgNotification
+                              , public SequencedMsgNotification {
         public:
             MsgNotification(const MsgNotification&) = delete;
             MsgNotification& operator=(const MsgNotification&) = delete;
@@ -72,7 +132,14 @@ namespace Plugin {
             virtual void Message(const string& senderName, const string& message) override
             {
                 ASSERT(_messenger != nullptr);
-                _messenger->MessageHandler(_roomId, senderName, message);
+                _messenger->MessageHandler(_roomId, senderName, message, 0);
+            }
+
+            // SequencedMsgNotification methods
+            virtual void Message(const string& senderName, const string& message, const uint64_t sequence) override
+            {
+                ASSERT(_messenger != nullptr);
+                _messenger->MessageHandler(_roomId, senderName, message, sequence);
             }
 
             // QueryInterface implementation
@@ -128,6 +195,7 @@ namespace Plugin {
         END_INTERFACE_MAP
 
         string JoinRoom(const string& roomId, const string& userName);
+        string JoinRoom(const string& roomId, const string& userName, const uint64_t sinceSequence);
         bool LeaveRoom(const string& roomId);
         bool SendMessage(const string& roomId, const string& message);
 
@@ -141,9 +209,9 @@ namespace Plugin {
             event_userupdate(roomId, userName, JsonData::Messenger::UserupdateParamsData::ActionType::LEFT);
         }
 
-        void MessageHandler(const string& roomId, const string& senderName, const string& message)
+        void MessageHandler(const string& roomId, const string& senderName, const string& message, const uint64_t sequence)
         {
-            event_message(roomId, senderName, message);
+            event_message(roomId, senderName, message, sequence);
         }
 
         // IMessenger::INotification methods
@@ -169,22 +237,26 @@ namespace Plugin {
 
     private:
         string GenerateRoomId(const string& roomName, const string& userName);
+        string Enter(const string& roomName, const string& userName, bool catchUp, const uint64_t sinceSequence);
         bool SubscribeUserUpdate(const string& roomId, bool subscribe);
+        void CatchUp(const string& roomId);
 
         // JSON-RPC
         void RegisterAll();
         void UnregisterAll();
-        uint32_t endpoint_join(const JsonData::Messenger::JoinParamsData& params, JsonData::Messenger::JoinResultInfo& response);
+        uint32_t endpoint_join(const CatchUpJoinParamsData& params, JsonData::Messenger::JoinResultInfo& response);
         uint32_t endpoint_leave(const JsonData::Messenger::JoinResultInfo& params);
         uint32_t endpoint_send(const JsonData::Messenger::SendParamsData& params);
         void event_roomupdate(const string& room, const JsonData::Messenger::RoomupdateParamsData::ActionType& action);
         void event_userupdate(const string& id, const string& user, const JsonData::Messenger::UserupdateParamsData::ActionType& action);
-        void event_message(const string& id, const string& user, const string& message);
+        void event_message(const string& id, const string& user, const string& message, const uint64_t sequence);
 
         uint32_t _connectionId;
         PluginHost::IShell* _service;
         Exchange::IRoomAdministrator* _roomAdmin;
         std::map<string, Exchange::IRoomAdministrator::IRoom*> _roomIds;
+        // Rooms joined with a catch-up request; nothing is delivered until the client listens for their messages.
+        std::set<string> _held;
         std::set<string> _rooms;
         mutable Core::CriticalSection _adminLock;
     }; // class Messenger
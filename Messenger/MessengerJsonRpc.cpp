@@ -46,7 +46,14 @@ namespace Plugin {
             SubscribeUserUpdate(roomId, status == Status::registered);
         });
 
-        Register<JoinParamsData,JoinResultInfo>(_T("join"), &Messenger::endpoint_join, this);
+        RegisterEventStatusListener(_T("message"), [this](const string& client, Status status) {
+            // Deliver the missed and the held messages only now, so they cannot arrive before anybody listens.
+            if (status == Status::registered) {
+                CatchUp(client.substr(0, client.find('.')));
+            }
+        });
+
+        Register<CatchUpJoinParamsData,JoinResultInfo>(_T("join"), &Messenger::endpoint_join, this);
         Register<JoinResultInfo,void>(_T("leave"), &Messenger::endpoint_leave, this);
         Register<SendParamsData,void>(_T("send"), &Messenger::endpoint_send, this);
     }
@@ -56,6 +63,7 @@ namespace Plugin {
         Unregister(_T("send"));
         Unregister(_T("leave"));
         Unregister(_T("join"));
+        UnregisterEventStatusListener(_T("message"));
         UnregisterEventStatusListener(_T("userupdate"));
         UnregisterEventStatusListener(_T("roomupdate"));
     }
@@ -68,14 +76,14 @@ namespace Plugin {
     //  - ERROR_NONE: Success
     //  - ERROR_ILLEGAL_STATE: User name is already taken (i.e. the user has already joined the room)
     //  - ERROR_BAD_REQUEST: User name or room name was invalid
-    uint32_t Messenger::endpoint_join(const JoinParamsData& params, JoinResultInfo& response)
+    uint32_t Messenger::endpoint_join(const CatchUpJoinParamsData& params, JoinResultInfo& response)
     {
         uint32_t result = Core::ERROR_BAD_REQUEST;
         const string& user = params.User.Value();
         const string& room = params.Room.Value();
 
         if (!user.empty() && !room.empty()) {
-            string roomId = JoinRoom(room, user);
+            string roomId = (params.Since.IsSet() == true ? JoinRoom(room, user, params.Since.Value()) : JoinRoom(room, user));
             if (!roomId.empty()) {
                 response.Roomid = roomId;
                 result = Core::ERROR_NONE;
@@ -139,11 +147,14 @@ namespace Plugin {
     }
 
     // Notifies about new messages in a room.
-    void Messenger::event_message(const string& id, const string& user, const string& message)
+    void Messenger::event_message(const string& id, const string& user, const string& message, const uint64_t sequence)
     {
-        MessageParamsData params;
+        SequencedMessageParamsData params;
         params.User = user;
         params.Message = message;
+        if (sequence != 0) {
+            params.Seq = sequence;
+        }
 
         Notify(_T("message"), params, [&](const string& designator) -> bool {
             const string designator_id = designator.substr(0, designator.find('.'));
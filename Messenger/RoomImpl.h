@@ -22,33 +22,271 @@
 #include "Module.h"
 #include <interfaces/IMessenger.h>
 #include "RoomMaintainer.h"
+#include <deque>
+#include <memory>
+#include <vector>
 
 namespace WPEFramework {
 
 namespace Plugin {
 
     class RoomImpl : public Exchange::IRoomAdministrator::IRoom {
+    private:
+        // The delivery queue of a member. It lives apart from the room and a pending
+        // delivery job only holds on to this, so RoomMaintainer::Send can still queue
+        // to a member whose last reference is gone and that is exiting the room.
+        // A held mailbox queues but does not deliver until it is resumed.
+        class Mailbox {
+        public:
+            Mailbox() = delete;
+            Mailbox(const Mailbox&) = delete;
+            Mailbox& operator=(const Mailbox&) = delete;
+
+            Mailbox(IMsgNotification* messageSink, const uint32_t queueDepth, const RoomMaintainer::overflow policy,
+                    const std::shared_ptr<RoomStatistics>& statistics, const bool held)
+                : _messageSink(messageSink)
+                , _sequencedSink(dynamic_cast<SequencedMsgNotification*>(messageSink))
+                , _queueDepth(queueDepth)
+                , _overflow(policy)
+                , _statistics(statistics)
+                , _queue()
+                , _backlog(0)
+                , _scheduled(false)
+                , _held(held)
+                , _disconnected(false)
+                , _lock()
+            {
+                if (_messageSink != nullptr) {
+                    _messageSink->AddRef();
+                }
+            }
+            ~Mailbox()
+            {
+                if (_messageSink != nullptr) {
+                    _messageSink->Release();
+                }
+            }
+
+        public:
+            // Queues a catch-up batch ahead of anything sent live. The batch does not count
+            // against the queue depth. Returns true if the caller has to schedule a delivery job.
+            bool Post(const std::vector<RoomMessagePtr>& messages)
+            {
+                bool schedule = false;
+
+                _lock.Lock();
+
+                if ((_messageSink != nullptr) && (_disconnected == false) && (messages.empty() == false)) {
+                    _queue.insert(_queue.begin() + _backlog, messages.begin(), messages.end());
+                    _backlog += static_cast<uint32_t>(messages.size());
+                    schedule = Schedule();
+                }
+
+                _lock.Unlock();
+
+                return (schedule);
+            }
+
+            // Returns true if the caller has to schedule a delivery job, overflowed is
+            // set if this message disconnected the member.
+            bool Post(const RoomMessagePtr& message, bool& overflowed)
+            {
+                bool schedule = false;
+
+                overflowed = false;
+
+                _lock.Lock();
+
+                if ((_messageSink != nullptr) && (_disconnected == false)) {
+                    if ((_queue.size() - _backlog) >= _queueDepth) {
+                        if (_overflow == RoomMaintainer::overflow::DISCONNECT) {
+                            _statistics->Dropped += static_cast<uint32_t>(_queue.size() + 1);
+                            _statistics->Disconnected++;
+                            _queue.clear();
+                            _backlog = 0;
+                            _disconnected = true;
+                            overflowed = true;
+                        } else {
+                            _statistics->Dropped++;
+                            _queue.erase(_queue.begin() + _backlog);
+                        }
+                    }
+
+                    if (_disconnected == false) {
+                        _queue.push_back(message);
+                    }
+
+                    // A disconnect is also scheduled, so the sink gets released outside the lock.
+                    schedule = Schedule();
+                }
+
+                _lock.Unlock();
+
+                return (schedule);
+            }
+
+            // Starts delivering a held mailbox. Returns true if the caller has to schedule a delivery job.
+            bool Resume()
+            {
+                bool schedule = false;
+
+                _lock.Lock();
+
+                _held = false;
+
+                if ((_messageSink != nullptr) && ((_queue.empty() == false) || (_disconnected == true))) {
+                    schedule = Schedule();
+                }
+
+                _lock.Unlock();
+
+                return (schedule);
+            }
+
+            // The member left, nothing queued is delivered anymore.
+            void Close()
+            {
+                IMsgNotification* revoked = nullptr;
+
+                _lock.Lock();
+
+                _queue.clear();
+                _backlog = 0;
+                _disconnected = true;
+
+                // A running job releases the sink once it is done with it.
+                if (_scheduled == false) {
+                    revoked = _messageSink;
+                    _messageSink = nullptr;
+                    _sequencedSink = nullptr;
+                }
+
+                _lock.Unlock();
+
+                if (revoked != nullptr) {
+                    revoked->Release();
+                }
+            }
+
+            // Runs on the worker pool; at most one job per member is in flight, so
+            // messages reach the member in the order they were sent.
+            void Deliver()
+            {
+                _lock.Lock();
+
+                while (_queue.empty() == false) {
+                    RoomMessagePtr message(std::move(_queue.front()));
+                    _queue.pop_front();
+
+                    if (_backlog != 0) {
+                        _backlog--;
+                    }
+
+                    _lock.Unlock();
+
+                    // The sink is only revoked here or by Close(), which leaves it to this job.
+                    if (_sequencedSink != nullptr) {
+                        _sequencedSink->Message(message->Sender, message->Text, message->Sequence);
+                    } else {
+                        _messageSink->Message(message->Sender, message->Text);
+                    }
+                    _statistics->Delivered++;
+
+                    _lock.Lock();
+                }
+
+                IMsgNotification* revoked = nullptr;
+
+                if ((_disconnected == true) && (_messageSink != nullptr)) {
+                    revoked = _messageSink;
+                    _messageSink = nullptr;
+                    _sequencedSink = nullptr;
+                }
+
+                _scheduled = false;
+
+                _lock.Unlock();
+
+                if (revoked != nullptr) {
+                    revoked->Release();
+                }
+            }
+
+        private:
+            bool Schedule()
+            {
+                bool schedule = ((_held == false) && (_scheduled == false));
+
+                if (schedule == true) {
+                    _scheduled = true;
+                }
+
+                return (schedule);
+            }
+
+        private:
+            IMsgNotification* _messageSink;
+            SequencedMsgNotification* _sequencedSink;
+            const uint32_t _queueDepth;
+            const RoomMaintainer::overflow _overflow;
+            std::shared_ptr<RoomStatistics> _statistics;
+            std::deque<RoomMessagePtr> _queue;
+            // Catch-up messages at the head of the queue.
+            uint32_t _backlog;
+            bool _scheduled;
+            bool _held;
+            bool _disconnected;
+            Core::CriticalSection _lock;
+        };
+
+        class DeliveryJob : public Core::IDispatch {
+        protected:
+            DeliveryJob(const std::shared_ptr<Mailbox>& mailbox)
+                : _mailbox(mailbox)
+            {
+                ASSERT(_mailbox != nullptr);
+            }
+
+        public:
+            DeliveryJob() = delete;
+            DeliveryJob(const DeliveryJob&) = delete;
+            DeliveryJob& operator=(const DeliveryJob&) = delete;
+            ~DeliveryJob() = default;
+
+        public:
+            static Core::ProxyType<Core::IDispatch> Create(const std::shared_ptr<Mailbox>& mailbox)
+            {
+                return (Core::proxy_cast<Core::IDispatch>(Core::ProxyType<DeliveryJob>::Create(mailbox)));
+            }
+
+            virtual void Dispatch() override
+            {
+                _mailbox->Deliver();
+            }
+
+        private:
+            std::shared_ptr<Mailbox> _mailbox;
+        };
+
     public:
         RoomImpl() = delete;
         RoomImpl(const RoomImpl&) = delete;
         RoomImpl& operator=(const RoomImpl&) = delete;
 
-        RoomImpl(RoomMaintainer* admin, const string& roomId, const string& userId, IMsgNotification* messageSink)
+        RoomImpl(RoomMaintainer* admin, const string& roomId, const string& userId, IMsgNotification* messageSink,
+                 const std::shared_ptr<RoomStatistics>& statistics, const bool held = false)
             : _roomId(roomId)
             , _userId(userId)
             , _roomAdmin(admin)
             , _callback(nullptr)
-            , _messageSink(messageSink)
             , _adminLock()
+            , _mailbox(std::make_shared<Mailbox>(messageSink, admin->QueueDepth(), admin->OverflowPolicy(), statistics, held))
         {
+            ASSERT(statistics != nullptr);
             ASSERT(admin != nullptr);
 
             _roomAdmin->AddRef();
 
-            if (_messageSink) {
-                _messageSink->AddRef();
-            }
-
             if (userId.size() == 0) {
                 TRACE(Trace::Warning, (_T("Created a user with empty userId")));
             }
@@ -58,15 +296,15 @@ namespace Plugin {
         {
             ASSERT(_roomAdmin != nullptr);
 
+            // Send may still queue to this member until Exit returns; that only
+            // touches the mailbox, never the reference count of the room.
             _roomAdmin->Exit(this);
 
+            _mailbox->Close();
+
             // Release the callback if necessary.
             SetCallback(nullptr);
 
-            if (_messageSink) {
-                _messageSink->Release();
-            }
-
             _roomAdmin->Release();
         }
 
@@ -135,10 +373,34 @@ namespace Plugin {
             _adminLock.Unlock();
         }
 
-        void MessageReceived(const string& userId, const string& message)
+        // Starts delivering to a member that joined held, see RoomMaintainer::Join().
+        void Resume()
+        {
+            if (_mailbox->Resume() == true) {
+                Core::IWorkerPool::Instance().Submit(DeliveryJob::Create(_mailbox));
+            }
+        }
+
+        // Queues a catch-up batch for this user; it is bounded by the room history, not the queue depth.
+        void MessagesReceived(const std::vector<RoomMessagePtr>& messages)
+        {
+            if (_mailbox->Post(messages) == true) {
+                Core::IWorkerPool::Instance().Submit(DeliveryJob::Create(_mailbox));
+            }
+        }
+
+        // Queues the message for this user, the worker pool delivers it.
+        void MessageReceived(const RoomMessagePtr& message)
         {
-            if (_messageSink != nullptr) {
-                _messageSink->Message(userId, message);
+            bool overflowed;
+
+            if (_mailbox->Post(message, overflowed) == true) {
+                Core::IWorkerPool::Instance().Submit(DeliveryJob::Create(_mailbox));
+            }
+
+            if (overflowed == true) {
+                TRACE(Trace::Error, (_T("User '%s': Delivery queue of room '%s' overflowed, disconnecting"),
+                        UserId().c_str(), RoomId().c_str()));
             }
         }
 
@@ -155,8 +417,8 @@ namespace Plugin {
         string _userId;
         RoomMaintainer* _roomAdmin;
         Exchange::IRoomAdministrator::IRoom::ICallback* _callback;
-        Exchange::IRoomAdministrator::IRoom::IMsgNotification* _messageSink;
         mutable Core::CriticalSection _adminLock;
+        std::shared_ptr<Mailbox> _mailbox;
     };
 
 } // namespace Plugin
@@ -27,8 +27,49 @@ namespace Plugin {
 
     SERVICE_REGISTRATION(RoomMaintainer, 1, 0);
 
+    RoomMaintainer::RoomMaintainer()
+        : _observers()
+        , _roomMap()
+        , _roomState()
+        , _queueDepth(DefaultQueueDepth)
+        , _historyDepth(DefaultHistoryDepth)
+        , _overflow(overflow::DROP_OLDEST)
+        , _adminLock()
+    {
+    }
+
+    // Applies to members joining from now on, each member keeps the queue settings it joined with.
+    void RoomMaintainer::Configure(const uint32_t queueDepth, const uint32_t historyDepth, const overflow policy)
+    {
+        ASSERT(queueDepth != 0);
+
+        _adminLock.Lock();
+
+        _queueDepth = queueDepth;
+        _historyDepth = historyDepth;
+        _overflow = policy;
+
+        _adminLock.Unlock();
+
+        TRACE(Trace::Information, (_T("Room Maintainer: Delivery queue depth %u, %s on overflow, history depth %u"),
+                _queueDepth, (_overflow == overflow::DISCONNECT ? _T("disconnect") : _T("drop oldest")), _historyDepth));
+    }
+
     /* virtual */ Exchange::IRoomAdministrator::IRoom* RoomMaintainer::Join(const string& roomId, const string& userId,
                                                                             Exchange::IRoomAdministrator::IRoom::IMsgNotification* messageSink)
+    {
+        return (Enter(roomId, userId, messageSink, false, 0));
+    }
+
+    Exchange::IRoomAdministrator::IRoom* RoomMaintainer::Join(const string& roomId, const string& userId,
+                                                              Exchange::IRoomAdministrator::IRoom::IMsgNotification* messageSink, const uint64_t sinceSequence)
+    {
+        return (Enter(roomId, userId, messageSink, true, sinceSequence));
+    }
+
+    Exchange::IRoomAdministrator::IRoom* RoomMaintainer::Enter(const string& roomId, const string& userId,
+                                                               Exchange::IRoomAdministrator::IRoom::IMsgNotification* messageSink,
+                                                               const bool catchUp, const uint64_t sinceSequence)
     {
         // Note: Nullptr message sink is allowed (e.g. for broadcast-only users).
 
@@ -40,7 +81,9 @@ namespace Plugin {
 
         if (it == _roomMap.end()) {
             // Room not found, so create one, already emplacing the first user.
-            newRoomUser = Core::Service<RoomImpl>::Create<RoomImpl>(this, roomId, userId, messageSink);
+            const RoomState& state(_roomState[roomId]);
+
+            newRoomUser = Core::Service<RoomImpl>::Create<RoomImpl>(this, roomId, userId, messageSink, state.Statistics, catchUp);
             it = _roomMap.emplace(roomId, std::list<RoomImpl*>({newRoomUser})).first;
 
             TRACE(Trace::Information, (_T("Room Maintainer: Room '%s' created"), roomId.c_str()));
@@ -58,7 +101,7 @@ namespace Plugin {
             std::list<RoomImpl*>& users = (*it).second;
 
             if (std::find_if(users.begin(), users.end(), [&userId](const RoomImpl* user) { return (user->UserId() == userId);}) == users.end()) {
-                newRoomUser = Core::Service<RoomImpl>::Create<RoomImpl>(this, roomId, userId, messageSink);
+                newRoomUser = Core::Service<RoomImpl>::Create<RoomImpl>(this, roomId, userId, messageSink, _roomState[roomId].Statistics, catchUp);
 
                 // Notify the room about a joining user.
                 // No point in sending the notification to the joining user as it cannot have its callback registered yet.
@@ -77,6 +120,24 @@ namespace Plugin {
         if (newRoomUser) {
             TRACE(Trace::Information, (_T("Room Maintainer: User '%s' has joined room '%s'"),
                     userId.c_str(), roomId.c_str()));
+
+            if (catchUp == true) {
+                // Still under the lock, so no message sent from now on can get ahead of these.
+                const std::deque<RoomMessagePtr>& history(_roomState[roomId].History);
+
+                // Sequence numbers in the history are consecutive, so the start can be computed.
+                std::deque<RoomMessagePtr>::const_iterator first(history.begin());
+                if ((history.empty() == false) && (sinceSequence >= history.front()->Sequence)) {
+                    first += static_cast<size_t>(std::min<uint64_t>(sinceSequence - history.front()->Sequence + 1, history.size()));
+                }
+
+                if (first != history.end()) {
+                    TRACE(Trace::Information, (_T("Room Maintainer: Replaying %u messages of room '%s' to user '%s'"),
+                            static_cast<uint32_t>(history.end() - first), roomId.c_str(), userId.c_str()));
+
+                    newRoomUser->MessagesReceived(std::vector<RoomMessagePtr>(first, history.end()));
+                }
+            }
         }
 
         _adminLock.Unlock();
@@ -115,6 +176,17 @@ namespace Plugin {
                 if (users.size() == 0) {
                     _roomMap.erase(it);
 
+                    auto sit(_roomState.find(roomUser->RoomId()));
+                    if (sit != _roomState.end()) {
+                        const RoomStatistics& statistics(*(sit->second.Statistics));
+
+                        TRACE(Trace::Information, (_T("Room Maintainer: Room '%s' sent %u, delivered %u, dropped %u messages, disconnected %u users"),
+                                roomUser->RoomId().c_str(), statistics.Sent.load(), statistics.Delivered.load(),
+                                statistics.Dropped.load(), statistics.Disconnected.load()));
+
+                        _roomState.erase(sit);
+                    }
+
                     TRACE(Trace::Information, (_T("Room Maintainer: Room '%s' has been destroyed"), roomUser->RoomId().c_str()));
 
                     // Notify the observers about the destruction of this room.
@@ -156,8 +228,20 @@ namespace Plugin {
         ASSERT(it != _roomMap.end());
 
         if (it != _roomMap.end()) {
+            // Only queued here; every member is delivered to from the worker pool,
+            // so a slow member does not hold up the room (or this lock).
+            RoomState& state(_roomState[roomUser->RoomId()]);
+            RoomMessagePtr shared(std::make_shared<const RoomMessage>(roomUser->UserId(), message, ++state.LastSequence));
+
+            state.Statistics->Sent++;
+
+            state.History.push_back(shared);
+            while (state.History.size() > _historyDepth) {
+                state.History.pop_front();
+            }
+
             for (RoomImpl* user : (*it).second) {
-                user->MessageReceived(roomUser->UserId(), message);
+                user->MessageReceived(shared);
             }
         }
 
@@ -21,6 +21,10 @@
 
 #include "Module.h"
 #include <interfaces/IMessenger.h>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
 
 namespace WPEFramework {
 
@@ -28,16 +32,60 @@ namespace Plugin {
 
     class RoomImpl;
 
+    // A message is allocated once per Send and shared by the delivery queues of all room members.
+    struct RoomMessage {
+        RoomMessage(const string& sender, const string& text, const uint64_t sequence)
+            : Sender(sender)
+            , Text(text)
+            , Sequence(sequence)
+        { /* empty */ }
+
+        const string Sender;
+        const string Text;
+        // Increases by one for every message sent to the room, starting at 1 when the room is created.
+        const uint64_t Sequence;
+    };
+
+    using RoomMessagePtr = std::shared_ptr<const RoomMessage>;
+
+    // Message sinks living in the same process as the maintainer can implement this
+    // as well to learn the sequence number of each delivered message.
+    class SequencedMsgNotification {
+    public:
+        virtual ~SequencedMsgNotification() = default;
+        virtual void Message(const string& senderName, const string& message, const uint64_t sequence) = 0;
+    };
+
+    // Throughput counters of a room, shared by its members.
+    struct RoomStatistics {
+        RoomStatistics()
+            : Sent(0)
+            , Delivered(0)
+            , Dropped(0)
+            , Disconnected(0)
+        { /* empty */ }
+
+        std::atomic<uint32_t> Sent;
+        std::atomic<uint32_t> Delivered;
+        std::atomic<uint32_t> Dropped;
+        std::atomic<uint32_t> Disconnected;
+    };
+
     class RoomMaintainer : public Exchange::IRoomAdministrator {
     public:
+        // What to do with a member whose delivery queue is full.
+        enum class overflow : uint8_t {
+            DROP_OLDEST,
+            DISCONNECT
+        };
+
+        static constexpr uint32_t DefaultQueueDepth = 64;
+        static constexpr uint32_t DefaultHistoryDepth = 128;
+
         RoomMaintainer(const RoomMaintainer&) = delete;
         RoomMaintainer& operator=(const RoomMaintainer&) = delete;
 
-        RoomMaintainer()
-            : _observers()
-            , _roomMap()
-            , _adminLock()
-        { /* empty */}
+        RoomMaintainer();
 
         // IRoomAdministrator methods
         virtual IRoom* Join(const string& roomId, const string& userId, IRoom::IMsgNotification* messageSink) override;
@@ -45,18 +93,44 @@ namespace Plugin {
         virtual void Unregister(const INotification* sink) override;
 
         // RoomMaintainer methods
+        void Configure(const uint32_t queueDepth, const uint32_t historyDepth, const overflow policy);
+        // Joins with the remembered messages newer than sinceSequence queued ahead of anything sent
+        // from now on. Nothing is delivered to the new member until RoomImpl::Resume() is called.
+        IRoom* Join(const string& roomId, const string& userId, IRoom::IMsgNotification* messageSink, const uint64_t sinceSequence);
         void Exit(const RoomImpl* roomUser);
         void Send(const string& message, RoomImpl* roomUser);
         void Notify(RoomImpl* roomUser);
 
+        uint32_t QueueDepth() const { return _queueDepth; }
+        overflow OverflowPolicy() const { return _overflow; }
+
         // QueryInterface implementation
         BEGIN_INTERFACE_MAP(RoomMaintainer)
             INTERFACE_ENTRY(Exchange::IRoomAdministrator)
         END_INTERFACE_MAP
 
     private:
+        IRoom* Enter(const string& roomId, const string& userId, IRoom::IMsgNotification* messageSink, const bool catchUp, const uint64_t sinceSequence);
+
+        struct RoomState {
+            RoomState()
+                : Statistics(std::make_shared<RoomStatistics>())
+                , History()
+                , LastSequence(0)
+            { /* empty */ }
+
+            std::shared_ptr<RoomStatistics> Statistics;
+            // The most recent messages, oldest first, at most _historyDepth of them.
+            std::deque<RoomMessagePtr> History;
+            uint64_t LastSequence;
+        };
+
         std::list<INotification*> _observers;
         std::map<string, std::list<RoomImpl*>> _roomMap;
+        std::map<string, RoomState> _roomState;
+        uint32_t _queueDepth;
+        uint32_t _historyDepth;
+        overflow _overflow;
         mutable Core::CriticalSection _adminLock;
     };
 
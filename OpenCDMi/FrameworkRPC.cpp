@@ -17,12 +17,16 @@
  * limitations under the License.
  */
 
+#include <atomic>
+#include <deque>
 #include <regex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "Module.h"
 #include "CENCParser.h"
+#include "SampleBatch.h"
 
 // Get in the definitions required for access to the sepcific
 // DRM engines.
@@ -69,27 +73,108 @@ namespace Plugin {
         return tokens;
     }
 
+    static bool IsMimeTokenChar(const char c)
+    {
+        return ((std::isalnum(static_cast<unsigned char>(c)) != 0) || (c == '-') || (c == '+'));
+    }
+
+    static bool IsCodecsChar(const char c)
+    {
+        return ((std::isalnum(static_cast<unsigned char>(c)) != 0) || (std::isspace(static_cast<unsigned char>(c)) != 0)
+            || (c == ',') || (c == '+') || (c == '-') || (c == '.') || (c == '\''));
+    }
+
+    static void SkipWs(const std::string& str, size_t& pos)
+    {
+        while ((pos < str.length()) && (std::isspace(static_cast<unsigned char>(str[pos])) != 0)) {
+            ++pos;
+        }
+    }
+
+    // Accepts: <type>/<subtype> [; codecs[*]=["]<codec>[,<codec>...]["]]
+    // On anything else, mimeType is left untouched and no codecs are returned.
     static void ParseContentType(const std::string& contentType, std::string& mimeType, std::vector<std::string>& codecsList) {
+        static const char kCodecs[] = "codecs";
+        const size_t length = contentType.length();
+        size_t pos = 0;
+
         codecsList.clear();
-        if (contentType.empty() == false) {
-            std::smatch matches;
-            const size_t kCaptureGroupsNumber = 4;
-            std::regex expr("\\s*([a-zA-Z0-9\\-\\+]+/[a-zA-Z0-9\\-\\+]+)\\s*(;\\s*codecs\\*?\\s*=\\s*\"?([a-zA-Z0-9,\\s\\+\\-\\.']+)\"?\\s*)?");
-            bool matched = std::regex_match(contentType, matches, expr, std::regex_constants::match_default);
-
-            if (matched && matches.size() == kCaptureGroupsNumber) {
-                ASSERT(matches[0] == contentType);
-                mimeType = matches[1];
-                if (matches[2].str().empty() == false) {
-                    std::vector<std::string> codecs = Tokenize(matches[3], ',');
-                    codecsList.swap(codecs);
-                }
-            }
+
+        SkipWs(contentType, pos);
+
+        const size_t typeStart = pos;
+        while ((pos < length) && (IsMimeTokenChar(contentType[pos]) == true)) {
+            ++pos;
+        }
+        if ((pos == typeStart) || (pos >= length) || (contentType[pos] != '/')) {
+            return;
+        }
+        const size_t subTypeStart = ++pos;
+        while ((pos < length) && (IsMimeTokenChar(contentType[pos]) == true)) {
+            ++pos;
+        }
+        if (pos == subTypeStart) {
+            return;
+        }
+        const size_t typeEnd = pos;
+
+        SkipWs(contentType, pos);
+
+        if (pos == length) {
+            mimeType.assign(contentType, typeStart, typeEnd - typeStart);
+            return;
+        }
+
+        if (contentType[pos] != ';') {
+            return;
+        }
+        ++pos;
+        SkipWs(contentType, pos);
+
+        if (contentType.compare(pos, sizeof(kCodecs) - 1, kCodecs) != 0) {
+            return;
+        }
+        pos += sizeof(kCodecs) - 1;
+        if ((pos < length) && (contentType[pos] == '*')) {
+            ++pos;
+        }
+        SkipWs(contentType, pos);
+        if ((pos >= length) || (contentType[pos] != '=')) {
+            return;
+        }
+        ++pos;
+        SkipWs(contentType, pos);
+        if ((pos < length) && (contentType[pos] == '"')) {
+            ++pos;
+        }
+
+        const size_t codecsStart = pos;
+        while ((pos < length) && (IsCodecsChar(contentType[pos]) == true)) {
+            ++pos;
+        }
+        const size_t codecsEnd = pos;
+        if (codecsEnd == codecsStart) {
+            return;
+        }
+
+        if ((pos < length) && (contentType[pos] == '"')) {
+            ++pos;
         }
+        SkipWs(contentType, pos);
+        if (pos != length) {
+            return;
+        }
+
+        mimeType.assign(contentType, typeStart, typeEnd - typeStart);
+        std::vector<std::string> codecs = Tokenize(contentType.substr(codecsStart, codecsEnd - codecsStart), ',');
+        codecsList.swap(codecs);
     }
 
     static const TCHAR BufferFileName[] = _T("ocdmbuffer.");
 
+    // Upper bound on the number of remembered IsTypeSupported answers.
+    static constexpr uint32_t TypeSupportedCacheSize = 256;
+
     class OCDMImplementation : public Exchange::IContentDecryption {
     private:
         OCDMImplementation(const OCDMImplementation&) = delete;
@@ -156,38 +241,32 @@ namespace Plugin {
 
             public:
                 BufferAdministrator(const string pathName)
-                    : _adminLock()
-                    , _basePath(Core::Directory::Normalize(pathName))
-                    , _occupation(0)
+                    : _basePath(Core::Directory::Normalize(pathName))
                 {
+                    for (uint8_t index = 0; index < BufferSlotChunks; index++) {
+                        _chunks[index].store(nullptr, std::memory_order_relaxed);
+                    }
                 }
                 ~BufferAdministrator()
                 {
+                    for (uint8_t index = 0; index < BufferSlotChunks; index++) {
+                        delete _chunks[index].load(std::memory_order_relaxed);
+                    }
                 }
 
             public:
                 bool AquireBuffer(string& locator)
                 {
-                    uint8_t index = 0;
+                    uint16_t slot = 0;
 
                     locator.clear();
 
-                    _adminLock.Lock();
-
-                    while ((index < (sizeof(_occupation) * 8)) && ((_occupation & (1 << index)) != 0)) {
-                        index++;
-                    }
-
-                    // We do not expect more that 4 buffers to be allocated concurrently,
-                    // so more than X would be dramatic
-                    ASSERT(index < (sizeof(_occupation) * 8));
-
-                    if (index < (sizeof(_occupation) * 8)) {
-                        _occupation |= (1 << index);
-                        locator = _basePath + BufferFileName + Core::NumberType<uint8_t>(index).Text();
+                    if (Allocate(slot) == true) {
+                        locator = _basePath + BufferFileName + Core::NumberType<uint16_t>(slot).Text();
                     }
 
-                    _adminLock.Unlock();
+                    // Running out of BufferSlotChunks * 64 concurrent buffers would be dramatic.
+                    ASSERT(locator.empty() == false);
 
                     return (locator.empty() == false);
                 }
@@ -202,30 +281,76 @@ namespace Plugin {
 
                         if (actualFile.compare(0, baseLength, BufferFileName) == 0) {
                             // Than the last part is the number..
-                            uint8_t number(Core::NumberType<uint8_t>(&(actualFile.c_str()[baseLength]), static_cast<uint32_t>(actualFile.length() - baseLength)).Value());
+                            uint16_t number(Core::NumberType<uint16_t>(&(actualFile.c_str()[baseLength]), static_cast<uint32_t>(actualFile.length() - baseLength)).Value());
 
-                            if (number <= (sizeof(_occupation) * 8)) {
-                                _adminLock.Lock();
+                            released = Free(number);
 
-                                if ((_occupation & (1 << number)) != 0) {
-                                    _occupation ^= (1 << number);
-                                    released = true;
-                                } else {
-                                    // Freeing a buffer that is already free sounds dangerous !!!
-                                    ASSERT(false);
-                                }
+                            // Freeing a buffer that is already free sounds dangerous !!!
+                            ASSERT(released == true);
+                        }
+                    }
+                    return (released);
+                }
 
-                                _adminLock.Unlock();
+            private:
+                // Slots are handed out from 64 bit occupation words. The words are only
+                // allocated once a slot in them is needed and are never moved or freed
+                // while the administrator lives, so claiming and freeing a slot is a
+                // single compare-and-swap without any lock.
+                bool Allocate(uint16_t& slot)
+                {
+                    for (uint8_t chunk = 0; chunk < BufferSlotChunks; chunk++) {
+                        std::atomic<uint64_t>* word = _chunks[chunk].load(std::memory_order_acquire);
+
+                        if (word == nullptr) {
+                            std::atomic<uint64_t>* created = new std::atomic<uint64_t>(0);
+
+                            if (_chunks[chunk].compare_exchange_strong(word, created, std::memory_order_acq_rel) == true) {
+                                word = created;
+                            } else {
+                                // Someone else grew the administrator first, use theirs.
+                                delete created;
+                            }
+                        }
+
+                        uint64_t occupation = word->load(std::memory_order_relaxed);
+
+                        while (occupation != ~static_cast<uint64_t>(0)) {
+                            uint8_t bit = 0;
+                            while ((occupation & (static_cast<uint64_t>(1) << bit)) != 0) {
+                                bit++;
+                            }
+
+                            if (word->compare_exchange_weak(occupation, occupation | (static_cast<uint64_t>(1) << bit), std::memory_order_acq_rel) == true) {
+                                slot = static_cast<uint16_t>((chunk * 64) + bit);
+                                return (true);
                             }
                         }
                     }
-                    return (released);
+
+                    return (false);
+                }
+                bool Free(const uint16_t slot)
+                {
+                    bool result = false;
+
+                    if (slot < (BufferSlotChunks * 64)) {
+                        std::atomic<uint64_t>* word = _chunks[slot / 64].load(std::memory_order_acquire);
+
+                        if (word != nullptr) {
+                            const uint64_t mask = (static_cast<uint64_t>(1) << (slot % 64));
+                            result = ((word->fetch_and(~mask, std::memory_order_acq_rel) & mask) != 0);
+                        }
+                    }
+
+                    return (result);
                 }
 
             private:
-                Core::CriticalSection _adminLock;
+                static constexpr uint8_t BufferSlotChunks = 64;
+
                 string _basePath;
-                uint16_t _occupation;
+                std::atomic<std::atomic<uint64_t>*> _chunks[BufferSlotChunks];
             };
 
             // IMediaKeys defines the MediaKeys interface.
@@ -271,42 +396,14 @@ namespace Plugin {
 
                         while (IsRunning() == true) {
 
-                            uint32_t clearContentSize = 0;
-                            uint8_t* clearContent = nullptr;
-
                             RequestConsume(Core::infinite);
 
                             if (IsRunning() == true) {
-                                uint8_t keyIdLength = 0;
-                                const uint8_t* keyIdData = KeyId(keyIdLength);
-
-                                int cr = _mediaKeys->Decrypt(
-                                    _sessionKey,
-                                    _sessionKeyLength,
-                                    nullptr, //subsamples
-                                    0, //number of subsamples
-                                    IVKey(),
-                                    IVKeyLength(),
-                                    Buffer(),
-                                    BytesWritten(),
-                                    &clearContentSize,
-                                    &clearContent,
-                                    keyIdLength,
-                                    keyIdData,
-                                    InitWithLast15());
-                                if ((cr == 0) && (clearContentSize != 0)) {
-                                    if (clearContentSize != BytesWritten()) {
-                                        TRACE_L1("Returned clear sample size (%d) differs from encrypted buffer size (%d)", clearContentSize, BytesWritten());
-                                        Size(clearContentSize);
-                                    }
-
-                                    // Adjust the buffer on our sied (this process) on what we will write back
-                                    SetBuffer(0, clearContentSize, clearContent);
+                                // A batch never carries an IV on the exchange itself.
+                                if ((IVKeyLength() != 0) || (DecryptBatch() == false)) {
+                                    DecryptSample();
                                 }
 
-                                // Store the status we have for the other side.
-                                Status(static_cast<uint32_t>(cr));
-
                                 // Whatever the result, we are done with the buffer..
                                 Consumed();
                             }
@@ -315,6 +412,67 @@ namespace Plugin {
                         return (Core::infinite);
                     }
 
+                    void DecryptSample()
+                    {
+                        uint32_t clearContentSize = 0;
+                        uint8_t* clearContent = nullptr;
+                        uint8_t keyIdLength = 0;
+                        const uint8_t* keyIdData = KeyId(keyIdLength);
+
+                        int cr = _mediaKeys->Decrypt(
+                            _sessionKey,
+                            _sessionKeyLength,
+                            nullptr, //subsamples
+                            0, //number of subsamples
+                            IVKey(),
+                            IVKeyLength(),
+                            Buffer(),
+                            BytesWritten(),
+                            &clearContentSize,
+                            &clearContent,
+                            keyIdLength,
+                            keyIdData,
+                            InitWithLast15());
+                        if ((cr == 0) && (clearContentSize != 0)) {
+                            if (clearContentSize != BytesWritten()) {
+                                TRACE_L1("Returned clear sample size (%d) differs from encrypted buffer size (%d)", clearContentSize, BytesWritten());
+                                Size(clearContentSize);
+                            }
+
+                            // Adjust the buffer on our sied (this process) on what we will write back,
+                            // unless the CDM already decrypted in place.
+                            if (clearContent != Buffer()) {
+                                SetBuffer(0, clearContentSize, clearContent);
+                            }
+                        }
+
+                        // Store the status we have for the other side.
+                        Status(static_cast<uint32_t>(cr));
+                    }
+
+                    bool DecryptBatch()
+                    {
+                        auto decrypt = [this](const uint32_t* subSamples, uint32_t subSampleEntries, const uint8_t* iv, uint8_t ivLength,
+                                           uint8_t* data, uint32_t length, uint32_t* clearContentSize, uint8_t** clearContent,
+                                           uint8_t keyIdLength, const uint8_t* keyId, bool initWithLast15) -> int {
+                            return (_mediaKeys->Decrypt(_sessionKey, _sessionKeyLength, subSamples, subSampleEntries, iv, ivLength,
+                                data, length, clearContentSize, clearContent, keyIdLength, keyId, initWithLast15));
+                        };
+                        int result = 0;
+
+                        if (::OCDM::ProcessSampleBatch(Buffer(), BytesWritten(), decrypt, result) == false) {
+                            return (false);
+                        }
+
+                        if (result != 0) {
+                            TRACE_L1("Decrypt batch had failing samples, first result %d", result);
+                        }
+
+                        Status(static_cast<uint32_t>(result));
+
+                        return (true);
+                    }
+
                 private:
                     CDMi::IMediaKeySession* _mediaKeys;
                     CDMi::IMediaKeySessionExt* _mediaKeysExt;
@@ -936,6 +1094,8 @@ namespace Plugin {
             {
                 ::OCDM::ISession* result = nullptr;
 
+                _adminLock.Lock();
+
                 std::list<SessionImplementation*>::const_iterator index(_sessionList.begin());
 
                 while ((index != _sessionList.end()) && (result == nullptr)) {
@@ -947,6 +1107,9 @@ namespace Plugin {
                         index++;
                     }
                 }
+
+                _adminLock.Unlock();
+
                 return (result);
             }
             void Remove(SessionImplementation* session, const string& keySystem, CDMi::IMediaKeySession* mediaKeySession)
@@ -1080,6 +1243,9 @@ namespace Plugin {
             , _compliant(false)
             , _systemToFactory()
             , _systemLibraries()
+            , _typeSupportedLock()
+            , _typeSupported()
+            , _typeSupportedOrder()
         {
             TRACE_L1("Constructing OCDMImplementation Service: %p", this);
         }
@@ -1280,30 +1446,34 @@ namespace Plugin {
                         std::vector<std::string> codecs;
                         ParseContentType(contentType, mimeType, codecs);
                         if (mimeType.empty() == false) {
-                            Blacklist::iterator systemMediaTypeRegexps = _systemBlacklistedMediaTypeRegexps.find(index->second.Name);
-                            if (systemMediaTypeRegexps != _systemBlacklistedMediaTypeRegexps.end()) {
-                                for (auto& systemMediaTypeRegexp : systemMediaTypeRegexps->second) {
-                                    if (std::regex_match(mimeType, std::regex(systemMediaTypeRegexp))) {
-                                        TRACE(Trace::Information, ("%s mime type matches blacklisted %s regexp", mimeType.c_str(), systemMediaTypeRegexp.c_str()));
-                                        result = false;
-                                        break;
-                                    }
-                                }
+                            std::string key(keySystem);
+                            key += '\n';
+                            key += mimeType;
+                            for (const std::string& codec : codecs) {
+                                key += '\n';
+                                key += codec;
                             }
 
-                            if (result == true && codecs.size() > 0) {
-                                Blacklist::iterator systemCodecRegexps = _systemBlacklistedCodecRegexps.find(index->second.Name);
-                                if (systemCodecRegexps != _systemBlacklistedCodecRegexps.end()) {
-                                    for (const std::string& codec : codecs) {
-                                        for (const std::string& codecRegexp : systemCodecRegexps->second) {
-                                            if (std::regex_match(codec, std::regex(codecRegexp))) {
-                                                TRACE(Trace::Information, ("%s codec matches blacklisted %s regexp", codec.c_str(), codecRegexp.c_str()));
-                                                result = false;
-                                                break;
-                                            }
-                                        }
+                            _typeSupportedLock.Lock();
+                            std::unordered_map<std::string, bool>::const_iterator cached(_typeSupported.find(key));
+                            const bool known = (cached != _typeSupported.end());
+                            if (known == true) {
+                                result = cached->second;
+                            }
+                            _typeSupportedLock.Unlock();
+
+                            if (known == false) {
+                                result = IsAllowed(index->second.Name, mimeType, codecs);
+
+                                _typeSupportedLock.Lock();
+                                if (_typeSupported.emplace(key, result).second == true) {
+                                    _typeSupportedOrder.push_back(std::move(key));
+                                    if (_typeSupportedOrder.size() > TypeSupportedCacheSize) {
+                                        _typeSupported.erase(_typeSupportedOrder.front());
+                                        _typeSupportedOrder.pop_front();
                                     }
                                 }
+                                _typeSupportedLock.Unlock();
                             }
                         }
                     }
@@ -1332,6 +1502,34 @@ namespace Plugin {
         }
 
     private:
+        bool IsAllowed(const std::string& system, const std::string& mimeType, const std::vector<std::string>& codecs) const
+        {
+            Blacklist::const_iterator systemMediaTypeRegexps = _systemBlacklistedMediaTypeRegexps.find(system);
+            if (systemMediaTypeRegexps != _systemBlacklistedMediaTypeRegexps.end()) {
+                for (const BlacklistEntry& systemMediaTypeRegexp : systemMediaTypeRegexps->second) {
+                    if (std::regex_match(mimeType, systemMediaTypeRegexp.Expression)) {
+                        TRACE(Trace::Information, ("%s mime type matches blacklisted %s regexp", mimeType.c_str(), systemMediaTypeRegexp.Pattern.c_str()));
+                        return (false);
+                    }
+                }
+            }
+
+            if (codecs.empty() == false) {
+                Blacklist::const_iterator systemCodecRegexps = _systemBlacklistedCodecRegexps.find(system);
+                if (systemCodecRegexps != _systemBlacklistedCodecRegexps.end()) {
+                    for (const std::string& codec : codecs) {
+                        for (const BlacklistEntry& codecRegexp : systemCodecRegexps->second) {
+                            if (std::regex_match(codec, codecRegexp.Expression)) {
+                                TRACE(Trace::Information, ("%s codec matches blacklisted %s regexp", codec.c_str(), codecRegexp.Pattern.c_str()));
+                                return (false);
+                            }
+                        }
+                    }
+                }
+            }
+
+            return (true);
+        }
         void LoadDesignators(const string& keySystem, std::list<string>& designators) const
         {
             std::map<const std::string, SystemFactory>::const_iterator index(_systemToFactory.begin());
@@ -1362,20 +1560,30 @@ namespace Plugin {
         END_INTERFACE_MAP
 
     private:
-        using Blacklist = std::map<const std::string, std::vector<std::string>>;
+        struct BlacklistEntry {
+            std::string Pattern;
+            std::regex Expression;
+        };
+        using Blacklist = std::map<const std::string, std::vector<BlacklistEntry>>;
+
+        // The expressions are compiled once here, IsTypeSupported only matches against them.
         void FillBlacklist(Blacklist& blacklist, const std::string& system, const Core::JSON::ArrayType<Core::JSON::String>& list)
         {
             Core::JSON::ArrayType<Core::JSON::String>::ConstIterator iter(list.Elements());
 
-            std::vector<std::string> elements;
+            std::vector<BlacklistEntry> elements;
             while (iter.Next() == true) {
                 const string element(iter.Current().Value());
                 if (element.empty() == false) {
-                    elements.emplace_back(std::move(element));
+                    try {
+                        elements.push_back({ element, std::regex(element, std::regex::ECMAScript | std::regex::optimize) });
+                    } catch (const std::regex_error& error) {
+                        SYSLOG(Logging::Startup, (_T("Ignoring invalid blacklist regexp [%s] for [%s]: %s"), element.c_str(), system.c_str(), error.what()));
+                    }
                 }
             }
 
-            blacklist.insert(std::pair<const std::string, std::vector<std::string>>(system, elements));
+            blacklist.insert(std::pair<const std::string, std::vector<BlacklistEntry>>(system, std::move(elements)));
         }
 
         ::OCDM::IAccessorOCDM* _entryPoint;
@@ -1386,6 +1594,9 @@ namespace Plugin {
         Blacklist _systemBlacklistedMediaTypeRegexps;
         std::list<Core::Library> _systemLibraries;
         std::list<string> _keySystems;
+        Core::CriticalSection _typeSupportedLock;
+        std::unordered_map<std::string, bool> _typeSupported;
+        std::deque<std::string> _typeSupportedOrder;
     };
 
     SERVICE_REGISTRATION(OCDMImplementation, 1, 0);
@@ -0,0 +1,265 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __OCDM_SAMPLEBATCH_H
+#define __OCDM_SAMPLEBATCH_H
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+// Layout of a multi-sample decrypt request carried in the payload of the
+// session DataExchange buffer. A client signals a batch by leaving the IV of
+// the exchange empty (IVKeyLength() == 0) and starting the payload with a
+// SampleBatchHeader. The header is followed by "count" SampleDescriptors; the
+// subsample maps and the sample data are placed anywhere after those, each
+// referenced by its byte offset from the start of the payload.
+//
+// All samples are decrypted in one RequestConsume()/Consumed() round trip.
+// The clear data of each sample is written back over its encrypted data (in
+// place if the CDM decrypted in place) and the per-sample result is stored in
+// the descriptor. The DataExchange status holds the first failing result.
+//
+// SampleBatchWriter builds a batch on the client side, ProcessSampleBatch()
+// takes it apart on the server side.
+
+namespace OCDM {
+
+    static const uint32_t SampleBatchMagic = 0x4243444F; // "OCDB"
+    static const uint16_t SampleBatchVersion = 1;
+    static const uint8_t SampleBatchMaxIVLength = 16;
+    static const uint8_t SampleBatchMaxKeyIdLength = 16;
+    static const int32_t SampleBatchInvalidSample = -1;
+
+    struct SampleBatchHeader {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t count;
+    };
+
+    struct SampleDescriptor {
+        // Filled in by the client.
+        uint32_t offset;
+        uint32_t length;
+        uint32_t subSampleOffset; // array of (clear, encrypted) uint32_t pairs
+        uint16_t subSampleCount;  // number of pairs; 0 means fully encrypted
+        uint8_t ivLength;
+        uint8_t keyIdLength;
+        uint8_t iv[SampleBatchMaxIVLength];
+        uint8_t keyId[SampleBatchMaxKeyIdLength];
+        uint8_t initWithLast15;
+        uint8_t reserved[3];
+
+        // Filled in by the server.
+        int32_t status;
+        uint32_t clearLength;
+    };
+
+    // Lays out a batch of "count" samples in a caller provided buffer, normally
+    // the payload area of the session DataExchange.
+    class SampleBatchWriter {
+    public:
+        SampleBatchWriter() = delete;
+        SampleBatchWriter(const SampleBatchWriter&) = delete;
+        SampleBatchWriter& operator=(const SampleBatchWriter&) = delete;
+
+        SampleBatchWriter(uint8_t* buffer, const uint32_t size, const uint16_t count)
+            : _buffer(buffer)
+            , _size(size)
+            , _count(count)
+            , _added(0)
+            , _used(sizeof(SampleBatchHeader) + (static_cast<uint32_t>(count) * sizeof(SampleDescriptor)))
+        {
+            if (_used <= _size) {
+                SampleBatchHeader header;
+                header.magic = SampleBatchMagic;
+                header.version = SampleBatchVersion;
+                header.count = count;
+                ::memcpy(_buffer, &header, sizeof(header));
+            }
+        }
+
+        // subSamples holds subSampleCount (clear, encrypted) pairs. Returns false
+        // if all samples were added already or the sample does not fit.
+        bool Add(const uint8_t* data, const uint32_t length, const uint32_t subSamples[], const uint16_t subSampleCount,
+            const uint8_t iv[], const uint8_t ivLength, const uint8_t keyId[], const uint8_t keyIdLength, const bool initWithLast15)
+        {
+            const uint32_t mapBytes = static_cast<uint32_t>(subSampleCount) * 2 * sizeof(uint32_t);
+
+            if ((_added >= _count) || (ivLength > SampleBatchMaxIVLength) || (keyIdLength > SampleBatchMaxKeyIdLength)
+                || ((static_cast<uint64_t>(_used) + mapBytes + length) > _size)) {
+                return (false);
+            }
+
+            SampleDescriptor sample;
+            ::memset(&sample, 0, sizeof(sample));
+            sample.subSampleOffset = _used;
+            sample.subSampleCount = subSampleCount;
+            sample.offset = _used + mapBytes;
+            sample.length = length;
+            sample.ivLength = ivLength;
+            sample.keyIdLength = keyIdLength;
+            if (ivLength != 0) {
+                ::memcpy(sample.iv, iv, ivLength);
+            }
+            if (keyIdLength != 0) {
+                ::memcpy(sample.keyId, keyId, keyIdLength);
+            }
+            sample.initWithLast15 = (initWithLast15 ? 1 : 0);
+            sample.status = SampleBatchInvalidSample;
+
+            if (mapBytes != 0) {
+                ::memcpy(_buffer + sample.subSampleOffset, subSamples, mapBytes);
+            }
+            if (length != 0) {
+                ::memcpy(_buffer + sample.offset, data, length);
+            }
+            ::memcpy(Descriptor(_added), &sample, sizeof(sample));
+
+            _used += mapBytes + length;
+            _added++;
+
+            return (true);
+        }
+
+        // Bytes of the buffer to hand over, 0 until every sample was added.
+        uint32_t Size() const
+        {
+            return (_added == _count ? _used : 0);
+        }
+
+        // After the round trip: the result of a sample and its clear data.
+        int32_t Result(const uint16_t index, const uint8_t*& clear, uint32_t& clearLength) const
+        {
+            SampleDescriptor sample;
+            ::memcpy(&sample, Descriptor(index), sizeof(sample));
+            clear = _buffer + sample.offset;
+            clearLength = sample.clearLength;
+            return (sample.status);
+        }
+
+    private:
+        uint8_t* Descriptor(const uint16_t index) const
+        {
+            return (_buffer + sizeof(SampleBatchHeader) + (static_cast<uint32_t>(index) * sizeof(SampleDescriptor)));
+        }
+
+    private:
+        uint8_t* _buffer;
+        uint32_t _size;
+        uint16_t _count;
+        uint16_t _added;
+        uint32_t _used;
+    };
+
+    // Decrypts every sample of a batch with decrypt(subSamples, subSampleEntries,
+    // iv, ivLength, data, length, &clearLength, &clearContent, keyIdLength, keyId,
+    // initWithLast15), the shape of the CDMi Decrypt() call minus the session key.
+    // subSampleEntries counts uint32_t entries, i.e. twice the number of pairs.
+    // Returns false if the payload is not a batch, otherwise result holds the first
+    // failing sample result (0 if all succeeded).
+    template <typename DECRYPT>
+    bool ProcessSampleBatch(uint8_t payload[], const uint32_t payloadSize, DECRYPT& decrypt, int& result)
+    {
+        SampleBatchHeader header;
+
+        if ((payload == nullptr) || (payloadSize < sizeof(header))) {
+            return (false);
+        }
+
+        ::memcpy(&header, payload, sizeof(header));
+
+        // Samples and maps have to stay clear of the header and the descriptors,
+        // those are written back while the batch is processed.
+        const uint64_t headerEnd = sizeof(header) + (static_cast<uint64_t>(header.count) * sizeof(SampleDescriptor));
+
+        if ((header.magic != SampleBatchMagic) || (header.version != SampleBatchVersion) || (header.count == 0) || (headerEnd > payloadSize)) {
+            return (false);
+        }
+
+        std::vector<uint32_t> subSamples;
+
+        result = 0;
+
+        for (uint16_t index = 0; index < header.count; index++) {
+            uint8_t* location = payload + sizeof(header) + (index * sizeof(SampleDescriptor));
+            SampleDescriptor sample;
+            ::memcpy(&sample, location, sizeof(sample));
+
+            const uint32_t subSampleEntries = static_cast<uint32_t>(sample.subSampleCount) * 2;
+            const uint64_t subSampleBytes = static_cast<uint64_t>(subSampleEntries) * sizeof(uint32_t);
+            int cr = SampleBatchInvalidSample;
+
+            sample.clearLength = 0;
+
+            if ((sample.offset >= headerEnd) && ((static_cast<uint64_t>(sample.offset) + sample.length) <= payloadSize)
+                && ((subSampleBytes == 0) || ((sample.subSampleOffset >= headerEnd) && ((static_cast<uint64_t>(sample.subSampleOffset) + subSampleBytes) <= payloadSize)))
+                && (sample.ivLength <= SampleBatchMaxIVLength)
+                && (sample.keyIdLength <= SampleBatchMaxKeyIdLength)) {
+
+                uint32_t clearContentSize = 0;
+                uint8_t* clearContent = nullptr;
+                uint8_t* sampleData = payload + sample.offset;
+
+                // The map may not be aligned in the payload, so copy it out.
+                subSamples.resize(subSampleEntries);
+                if (subSampleBytes != 0) {
+                    ::memcpy(subSamples.data(), payload + sample.subSampleOffset, subSampleBytes);
+                }
+
+                cr = decrypt(
+                    (subSampleEntries != 0 ? subSamples.data() : nullptr),
+                    subSampleEntries,
+                    sample.iv,
+                    sample.ivLength,
+                    sampleData,
+                    sample.length,
+                    &clearContentSize,
+                    &clearContent,
+                    sample.keyIdLength,
+                    (sample.keyIdLength != 0 ? sample.keyId : nullptr),
+                    (sample.initWithLast15 != 0));
+
+                if ((cr == 0) && (clearContentSize != 0)) {
+                    if (clearContentSize > sample.length) {
+                        // More clear than encrypted data does not fit back, fail the sample.
+                        cr = SampleBatchInvalidSample;
+                    } else {
+                        if (clearContent != sampleData) {
+                            ::memcpy(sampleData, clearContent, clearContentSize);
+                        }
+                        sample.clearLength = clearContentSize;
+                    }
+                }
+            }
+
+            sample.status = cr;
+            ::memcpy(location, &sample, sizeof(sample));
+
+            if ((result == 0) && (cr != 0)) {
+                result = cr;
+            }
+        }
+
+        return (true);
+    }
+
+} // namespace OCDM
+
+#endif // __OCDM_SAMPLEBATCH_H
@@ -0,0 +1,299 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Builds batches with SampleBatchWriter, runs them through ProcessSampleBatch()
+// with a fake CDM that XORs the encrypted ranges with the first IV byte, and
+// checks the results the client reads back. Exits non-zero on the first failure.
+
+#include "SampleBatch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace {
+
+    static int failures = 0;
+
+#define EXPECT(condition)                                                        \
+    do {                                                                         \
+        if (!(condition)) {                                                      \
+            fprintf(stderr, "%s:%d: expected %s\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                          \
+        }                                                                        \
+    } while (0)
+
+    // Stands in for CDMi::IMediaKeySession::Decrypt(): subSampleEntries counts
+    // uint32_t entries, a map of pairs alternates clear and encrypted bytes.
+    class FakeCDM {
+    public:
+        FakeCDM()
+            : calls(0)
+            , lastEntries(0)
+            , outOfPlace(false)
+        {
+        }
+
+        int operator()(const uint32_t* subSamples, uint32_t subSampleEntries, const uint8_t* iv, uint8_t ivLength,
+            uint8_t* data, uint32_t length, uint32_t* clearContentSize, uint8_t** clearContent,
+            uint8_t /* keyIdLength */, const uint8_t* /* keyId */, bool /* initWithLast15 */)
+        {
+            calls++;
+            lastEntries = subSampleEntries;
+
+            if ((ivLength == 0) || ((subSampleEntries % 2) != 0)) {
+                return (1);
+            }
+
+            uint8_t* target = data;
+            if (outOfPlace == true) {
+                _scratch.assign(data, data + length);
+                target = _scratch.data();
+            }
+
+            uint32_t position = 0;
+            if (subSampleEntries == 0) {
+                for (; position < length; position++) {
+                    target[position] ^= iv[0];
+                }
+            } else {
+                for (uint32_t entry = 0; entry < subSampleEntries; entry += 2) {
+                    position += subSamples[entry];
+                    if ((position + subSamples[entry + 1]) > length) {
+                        return (2);
+                    }
+                    for (uint32_t index = 0; index < subSamples[entry + 1]; index++, position++) {
+                        target[position] ^= iv[0];
+                    }
+                }
+                if (position != length) {
+                    return (3);
+                }
+            }
+
+            *clearContentSize = length;
+            *clearContent = target;
+            return (0);
+        }
+
+        uint32_t calls;
+        uint32_t lastEntries;
+        bool outOfPlace;
+
+    private:
+        std::vector<uint8_t> _scratch;
+    };
+
+    void Encrypt(uint8_t data[], const uint32_t length, const uint32_t subSamples[], const uint16_t pairs, const uint8_t key)
+    {
+        uint32_t position = 0;
+        if (pairs == 0) {
+            for (; position < length; position++) {
+                data[position] ^= key;
+            }
+        }
+        for (uint16_t pair = 0; pair < pairs; pair++) {
+            position += subSamples[2 * pair];
+            for (uint32_t index = 0; index < subSamples[(2 * pair) + 1]; index++, position++) {
+                data[position] ^= key;
+            }
+        }
+    }
+
+    void TestRoundTrip(const bool outOfPlace)
+    {
+        uint8_t buffer[1024];
+        uint8_t first[64];
+        uint8_t second[48];
+        uint8_t expectedFirst[sizeof(first)];
+        uint8_t expectedSecond[sizeof(second)];
+        const uint32_t firstMap[] = { 8, 24, 16, 16 }; // two pairs, 64 bytes
+        const uint8_t firstIV[] = { 0x5A, 1, 2, 3, 4, 5, 6, 7 };
+        const uint8_t secondIV[] = { 0xC3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+        const uint8_t keyId[] = { 0xAA, 0xBB, 0xCC, 0xDD };
+
+        for (uint32_t index = 0; index < sizeof(first); index++) {
+            first[index] = expectedFirst[index] = static_cast<uint8_t>(index);
+        }
+        for (uint32_t index = 0; index < sizeof(second); index++) {
+            second[index] = expectedSecond[index] = static_cast<uint8_t>(0x80 + index);
+        }
+        Encrypt(first, sizeof(first), firstMap, 2, firstIV[0]);
+        Encrypt(second, sizeof(second), nullptr, 0, secondIV[0]);
+
+        OCDM::SampleBatchWriter writer(buffer, sizeof(buffer), 2);
+        EXPECT(writer.Size() == 0);
+        EXPECT(writer.Add(first, sizeof(first), firstMap, 2, firstIV, sizeof(firstIV), keyId, sizeof(keyId), false) == true);
+        EXPECT(writer.Add(second, sizeof(second), nullptr, 0, secondIV, sizeof(secondIV), nullptr, 0, true) == true);
+        EXPECT(writer.Add(second, sizeof(second), nullptr, 0, secondIV, sizeof(secondIV), nullptr, 0, true) == false);
+        EXPECT(writer.Size() != 0);
+
+        FakeCDM cdm;
+        cdm.outOfPlace = outOfPlace;
+        int result = -1;
+
+        EXPECT(OCDM::ProcessSampleBatch(buffer, writer.Size(), cdm, result) == true);
+        EXPECT(result == 0);
+        EXPECT(cdm.calls == 2);
+
+        const uint8_t* clear = nullptr;
+        uint32_t clearLength = 0;
+
+        EXPECT(writer.Result(0, clear, clearLength) == 0);
+        EXPECT(clearLength == sizeof(first));
+        EXPECT(::memcmp(clear, expectedFirst, sizeof(first)) == 0);
+
+        EXPECT(writer.Result(1, clear, clearLength) == 0);
+        EXPECT(clearLength == sizeof(second));
+        EXPECT(::memcmp(clear, expectedSecond, sizeof(second)) == 0);
+    }
+
+    void TestEntryCount()
+    {
+        uint8_t buffer[512];
+        uint8_t data[30] = {};
+        const uint32_t map[] = { 2, 8, 4, 6, 5, 5 }; // three pairs, six entries
+        const uint8_t iv[] = { 0x11 };
+
+        OCDM::SampleBatchWriter writer(buffer, sizeof(buffer), 1);
+        EXPECT(writer.Add(data, sizeof(data), map, 3, iv, sizeof(iv), nullptr, 0, false) == true);
+
+        FakeCDM cdm;
+        int result = -1;
+
+        EXPECT(OCDM::ProcessSampleBatch(buffer, writer.Size(), cdm, result) == true);
+        EXPECT(cdm.lastEntries == 6);
+        EXPECT(result == 0);
+    }
+
+    void TestNotABatch()
+    {
+        uint8_t buffer[256] = {};
+        FakeCDM cdm;
+        int result = 0;
+
+        EXPECT(OCDM::ProcessSampleBatch(buffer, sizeof(buffer), cdm, result) == false);
+        EXPECT(OCDM::ProcessSampleBatch(buffer, 2, cdm, result) == false);
+
+        // Header claiming more descriptors than the payload holds.
+        OCDM::SampleBatchHeader header = { OCDM::SampleBatchMagic, OCDM::SampleBatchVersion, 100 };
+        ::memcpy(buffer, &header, sizeof(header));
+        EXPECT(OCDM::ProcessSampleBatch(buffer, sizeof(buffer), cdm, result) == false);
+        EXPECT(cdm.calls == 0);
+    }
+
+    // Rewrites a field of descriptor "index" the way a broken client could.
+    OCDM::SampleDescriptor Descriptor(uint8_t buffer[], const uint16_t index)
+    {
+        OCDM::SampleDescriptor sample;
+        ::memcpy(&sample, buffer + sizeof(OCDM::SampleBatchHeader) + (index * sizeof(sample)), sizeof(sample));
+        return (sample);
+    }
+
+    void Descriptor(uint8_t buffer[], const uint16_t index, const OCDM::SampleDescriptor& sample)
+    {
+        ::memcpy(buffer + sizeof(OCDM::SampleBatchHeader) + (index * sizeof(sample)), &sample, sizeof(sample));
+    }
+
+    void TestMalformedRegions()
+    {
+        const uint32_t headerEnd = sizeof(OCDM::SampleBatchHeader) + (2 * sizeof(OCDM::SampleDescriptor));
+        const uint32_t map[] = { 4, 12 };
+        const uint8_t iv[] = { 0x77 };
+        uint8_t data[16] = {};
+
+        struct Case {
+            const char* name;
+            void (*mangle)(OCDM::SampleDescriptor&, uint32_t headerEnd, uint32_t size);
+        };
+
+        const Case cases[] = {
+            { "data over descriptors", [](OCDM::SampleDescriptor& sample, uint32_t, uint32_t) { sample.offset = sizeof(OCDM::SampleBatchHeader); } },
+            { "data over header", [](OCDM::SampleDescriptor& sample, uint32_t, uint32_t) { sample.offset = 0; } },
+            { "data ends in descriptors", [](OCDM::SampleDescriptor& sample, uint32_t headerEnd, uint32_t) { sample.offset = headerEnd - 4; } },
+            { "data past payload", [](OCDM::SampleDescriptor& sample, uint32_t, uint32_t size) { sample.offset = size - 8; } },
+            { "length wraps", [](OCDM::SampleDescriptor& sample, uint32_t, uint32_t) { sample.length = 0xFFFFFFF0; } },
+            { "map over descriptors", [](OCDM::SampleDescriptor& sample, uint32_t headerEnd, uint32_t) { sample.subSampleOffset = headerEnd - 8; } },
+            { "map past payload", [](OCDM::SampleDescriptor& sample, uint32_t, uint32_t size) { sample.subSampleOffset = size - 4; } },
+            { "iv too long", [](OCDM::SampleDescriptor& sample, uint32_t, uint32_t) { sample.ivLength = OCDM::SampleBatchMaxIVLength + 1; } },
+        };
+
+        for (const Case& entry : cases) {
+            uint8_t buffer[512];
+            OCDM::SampleBatchWriter writer(buffer, sizeof(buffer), 2);
+            EXPECT(writer.Add(data, sizeof(data), map, 1, iv, sizeof(iv), nullptr, 0, false) == true);
+            EXPECT(writer.Add(data, sizeof(data), map, 1, iv, sizeof(iv), nullptr, 0, false) == true);
+
+            const uint32_t size = writer.Size();
+            OCDM::SampleDescriptor sample = Descriptor(buffer, 0);
+            entry.mangle(sample, headerEnd, size);
+            Descriptor(buffer, 0, sample);
+
+            uint8_t before[512];
+            ::memcpy(before, buffer, sizeof(before));
+
+            FakeCDM cdm;
+            int result = 0;
+
+            EXPECT(OCDM::ProcessSampleBatch(buffer, size, cdm, result) == true);
+            if (cdm.calls != 1) {
+                fprintf(stderr, "case '%s': CDM called %u times\n", entry.name, cdm.calls);
+                failures++;
+            }
+            EXPECT(result == OCDM::SampleBatchInvalidSample);
+            EXPECT(Descriptor(buffer, 0).status == OCDM::SampleBatchInvalidSample);
+            EXPECT(Descriptor(buffer, 0).clearLength == 0);
+            EXPECT(Descriptor(buffer, 1).status == 0);
+
+            // The rejected sample left the rest of the header untouched.
+            EXPECT(::memcmp(buffer, before, sizeof(OCDM::SampleBatchHeader)) == 0);
+        }
+    }
+
+    void TestWriterLimits()
+    {
+        uint8_t buffer[sizeof(OCDM::SampleBatchHeader) + sizeof(OCDM::SampleDescriptor) + 16];
+        uint8_t data[32] = {};
+        const uint8_t iv[OCDM::SampleBatchMaxIVLength + 1] = {};
+
+        OCDM::SampleBatchWriter writer(buffer, sizeof(buffer), 1);
+        EXPECT(writer.Add(data, sizeof(data), nullptr, 0, iv, 1, nullptr, 0, false) == false);
+        EXPECT(writer.Add(data, 16, nullptr, 0, iv, sizeof(iv), nullptr, 0, false) == false);
+        EXPECT(writer.Add(data, 16, nullptr, 0, iv, 1, nullptr, 0, false) == true);
+        EXPECT(writer.Size() == sizeof(buffer));
+    }
+
+} // namespace
+
+int main()
+{
+    TestRoundTrip(false);
+    TestRoundTrip(true);
+    TestEntryCount();
+    TestNotABatch();
+    TestMalformedRegions();
+    TestWriterLimits();
+
+    if (failures != 0) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return (EXIT_FAILURE);
+    }
+
+    printf("SampleBatch: all checks passed\n");
+    return (EXIT_SUCCESS);
+}
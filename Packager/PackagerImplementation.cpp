@@ -21,17 +21,31 @@
 
 #if defined (DO_NOT_USE_DEPRECATED_API)
 #include <opkg_cmd.h>
+#include <pkg_hash.h>
 #else
 #include <opkg.h>
 #endif
 #include <opkg_download.h>
 
+#include <curl/curl.h>
+#include <utime.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
 
 namespace WPEFramework {
 namespace Plugin {
 
     SERVICE_REGISTRATION(PackagerImplementation, 1, 0);
 
+    // Upper bound for asking a feed whether its index changed, in seconds. A feed that does not
+    // answer in time counts as changed, so opkg's own update gets to deal with it.
+    static constexpr long FeedQueryTimeout = 15;
+
     void PackagerImplementation::UpdateConfig() const {
         ASSERT(!_configFile.empty() && !_tempPath.empty() && !_cachePath.empty());
         opkg_config->conf_file = strdup(_configFile.c_str());
@@ -98,6 +112,10 @@ namespace Plugin {
              _volatileCache = config.MakeCacheVolatile.Value();
          }
 
+        if ((config.MaxDownloads.IsSet() == true) && (config.MaxDownloads.Value() != 0)) {
+            _maxDownloads = config.MaxDownloads.Value();
+        }
+
         if (Core::File(_configFile).Exists() == false) {
             result = Core::ERROR_GENERAL;
         } else if (Core::Directory(_tempPath.c_str()).CreatePath() == false) {
@@ -117,6 +135,8 @@ namespace Plugin {
 
     PackagerImplementation::~PackagerImplementation()
     {
+        _worker.Stop();
+        _worker.Wait(Core::Thread::STOPPED | Core::Thread::BLOCKED, Core::infinite);
         FreeOPKG();
     }
 
@@ -126,9 +146,11 @@ namespace Plugin {
         _adminLock.Lock();
         notification->AddRef();
         _notifications.push_back(notification);
-        if (_inProgress.Install != nullptr) {
-            ASSERT(_inProgress.Package != nullptr);
-            notification->StateChange(_inProgress.Package, _inProgress.Install);
+        for (const auto& data : _batch) {
+            notification->StateChange(data->Package, data->Install);
+        }
+        for (const auto& data : _queue) {
+            notification->StateChange(data->Package, data->Install);
         }
         _adminLock.Unlock();
     }
@@ -156,72 +178,231 @@ namespace Plugin {
 
     uint32_t PackagerImplementation::DoWork(const string* name, const string* version, const string* arch)
     {
-        uint32_t result = Core::ERROR_INPROGRESS;
+        uint32_t result = Core::ERROR_NONE;
 
         _adminLock.Lock();
-        if (_inProgress.Install == nullptr && _isSyncing == false) {
-            ASSERT(_inProgress.Package == nullptr);
-            result = Core::ERROR_NONE;
-            // OPKG bug: it marks it checked dependency for a package as cyclic dependency handling fix
-            // but since in our case it's not an process which dies when done, this info survives and makes the
-            // deps check to be skipped on subsequent calls. This is why hash_deinit() is called below
-            // and needs to be initialized here agian.
-            if (_opkgInitialized == true)  // it was initialized
-                FreeOPKG();
-            _opkgInitialized = InitOPKG();
-
-            if (_opkgInitialized) {
-                if (name && version && arch) {
-                    _inProgress.Package = Core::Service<PackageInfo>::Create<PackageInfo>(*name, *version, *arch);
-                    _inProgress.Install = Core::Service<InstallInfo>::Create<InstallInfo>();
-                } else {
-                    _isSyncing = true;
-                }
-                _worker.Run();
+        if (name && version && arch) {
+            auto isQueued = [name](const std::unique_ptr<InstallationData>& data) {
+                return data->Package->Name() == *name;
+            };
+            if (std::find_if(_queue.begin(), _queue.end(), isQueued) != _queue.end() ||
+                std::find_if(_batch.begin(), _batch.end(), isQueued) != _batch.end()) {
+                result = Core::ERROR_INPROGRESS;
             } else {
-                result = Core::ERROR_GENERAL;
+                std::unique_ptr<InstallationData> data(new InstallationData());
+                data->Package = Core::Service<PackageInfo>::Create<PackageInfo>(*name, *version, *arch);
+                data->Install = Core::Service<InstallInfo>::Create<InstallInfo>();
+                _queue.push_back(std::move(data));
             }
+        } else if (_syncPending == true || _isSyncing == true) {
+            result = Core::ERROR_INPROGRESS;
+        } else {
+            _syncPending = true;
+        }
+
+        if (result == Core::ERROR_NONE) {
+            _worker.Run();
         }
         _adminLock.Unlock();
 
         return result;
+    }
 
+    void PackagerImplementation::BlockingProcessBatchNoLock(bool forceSync)
+    {
+        // OPKG bug: it marks it checked dependency for a package as cyclic dependency handling fix
+        // but since in our case it's not an process which dies when done, this info survives and makes the
+        // deps check to be skipped on subsequent calls. This is why hash_deinit() is called below
+        // and needs to be initialized here agian. Once per batch is enough as every package is only in it once.
+        if (_opkgInitialized == true)  // it was initialized
+            FreeOPKG();
+        _opkgInitialized = InitOPKG();
+
+        if (_opkgInitialized == false) {
+            TRACE_L1("Failed to initialize opkg, dropping %d queued installs", static_cast<int>(_batch.size()));
+            for (const auto& data : _batch) {
+                data->Install->SetError(Core::ERROR_GENERAL);
+                NotifyStateChange(*data);
+            }
+            if (forceSync == true) {
+                NotifyRepoSynced(Core::ERROR_GENERAL);
+            }
+        } else {
+            // One feed sync for the whole batch.
+            BlockingSetupLocalRepoNoLock(forceSync == true ? RepoSyncMode::FORCED : RepoSyncMode::SETUP);
+
+            if (_batch.empty() == false) {
+                BlockingDownloadBatchNoLock();
+
+                for (const auto& data : _batch) {
+                    BlockingInstallUntilCompletionNoLock(*data);
+                }
+            }
+        }
     }
 
-    void PackagerImplementation::BlockingInstallUntilCompletionNoLock() {
-        ASSERT(_inProgress.Install != nullptr && _inProgress.Package != nullptr);
+    void PackagerImplementation::BlockingDownloadBatchNoLock()
+    {
+        // Resolving uses the opkg package hash, which is not thread safe, so it is done up front.
+        std::vector<InstallationData*> downloads;
+        for (const auto& data : _batch) {
+            if (ResolveDownloadNoLock(*data) == true) {
+                downloads.push_back(data.get());
+            }
+        }
+
+        if (downloads.empty() == true) {
+            return;
+        }
+
+        // opkg's own downloader shares one curl handle, so the prefetch uses its own, one per thread. Whatever
+        // fails here is left for opkg to download itself while installing.
+        curl_global_init(CURL_GLOBAL_ALL);
+
+        std::atomic<uint32_t> next(0);
+        std::vector<std::thread> threads;
+        const uint32_t threadCount = std::min<uint32_t>(_maxDownloads, downloads.size());
+        for (uint32_t index = 0; index < threadCount; index++) {
+            threads.emplace_back([this, &downloads, &next]() {
+                uint32_t item;
+                while ((item = next++) < downloads.size()) {
+                    InstallationData& data = *downloads[item];
+                    data.Install->SetState(Exchange::IPackager::DOWNLOADING);
+                    NotifyStateChange(data);
+                    if (Download(data) == true) {
+                        data.Install->SetState(Exchange::IPackager::DOWNLOADED);
+                        NotifyStateChange(data);
+                    } else {
+                        TRACE_L1("Failed to prefetch %s, opkg will retry", data.Url.c_str());
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        curl_global_cleanup();
+    }
 
+    bool PackagerImplementation::ResolveDownloadNoLock(InstallationData& data) const
+    {
+#if defined (DO_NOT_USE_DEPRECATED_API)
+        pkg_t* package = pkg_hash_fetch_best_installation_candidate_by_name(data.Package->Name().c_str());
+#else
+        pkg_t* package = opkg_find_package(data.Package->Name().c_str(),
+                                           data.Package->Version().empty() ? nullptr : data.Package->Version().c_str(),
+                                           data.Package->Architecture().empty() ? nullptr : data.Package->Architecture().c_str(),
+                                           nullptr);
+#endif
+        // Not in a feed (e.g. given as an URL or a file path) or nothing to download.
+        if (package == nullptr || package->src == nullptr || package->src->value == nullptr ||
+            package->filename == nullptr || package->state_status == SS_INSTALLED) {
+            return false;
+        }
+
+        data.Url = string(package->src->value) + '/' + package->filename;
+
+        // Named the way opkg names its cache entries, so the install stage picks it up from there.
+        string cacheName(data.Url);
+        std::replace(cacheName.begin(), cacheName.end(), '/', '_');
+        data.CachedFile = _cachePath + '/' + cacheName;
+
+        return Core::File(data.CachedFile).Exists() == false;
+    }
+
+    bool PackagerImplementation::Download(InstallationData& data)
+    {
+        struct Transfer {
+            static int Progress(void* user, curl_off_t total, curl_off_t now, curl_off_t, curl_off_t)
+            {
+                if (total > 0) {
+                    static_cast<InstallInfo*>(user)->SetProgress(static_cast<uint8_t>((now * 100) / total));
+                }
+                return 0;
+            }
+        };
+
+        // Written next to the final name and renamed when complete, so opkg never sees a partial package.
+        const string partial = data.CachedFile + _T(".part");
+        FILE* file = fopen(partial.c_str(), "wb");
+        if (file == nullptr) {
+            return false;
+        }
+
+        CURL* curl = curl_easy_init();
+        bool result = false;
+        if (curl != nullptr) {
+            curl_easy_setopt(curl, CURLOPT_URL, data.Url.c_str());
+            curl_easy_setopt(curl, CURLOPT_WRITEDATA, file);
+            curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+            curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+            curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+            curl_easy_setopt(curl, CURLOPT_FILETIME, 1L);
+            curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+            curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, &Transfer::Progress);
+            curl_easy_setopt(curl, CURLOPT_XFERINFODATA, data.Install);
+
+            result = (curl_easy_perform(curl) == CURLE_OK);
+
+            // opkg compares the cached file's time against the server's to decide whether it is still valid.
+            long fileTime = -1;
+            if (result == true && curl_easy_getinfo(curl, CURLINFO_FILETIME, &fileTime) == CURLE_OK && fileTime >= 0) {
+                fflush(file);
+                struct utimbuf times;
+                times.actime = static_cast<time_t>(fileTime);
+                times.modtime = static_cast<time_t>(fileTime);
+                utime(partial.c_str(), &times);
+            }
+            curl_easy_cleanup(curl);
+        }
+        fclose(file);
+
+        if (result == true) {
+            result = (rename(partial.c_str(), data.CachedFile.c_str()) == 0);
+        }
+        if (result == false) {
+            unlink(partial.c_str());
+        }
+
+        return result;
+    }
+
+    void PackagerImplementation::BlockingInstallUntilCompletionNoLock(InstallationData& data) {
+        ASSERT(data.Install != nullptr && data.Package != nullptr);
+
+        _current = &data;
 #if defined (DO_NOT_USE_DEPRECATED_API)
         opkg_cmd_t* command = opkg_cmd_find("install");
         if (command) {
-            _inProgress.Install->SetState(Exchange::IPackager::INSTALLING);
-            NotifyStateChange();
+            data.Install->SetState(Exchange::IPackager::INSTALLING);
+            NotifyStateChange(data);
             opkg_config->pfm = command->pfm;
-            std::unique_ptr<char[]> targetCopy(new char [_inProgress.Package->Name().length() + 1]);
-            std::copy_n(_inProgress.Package->Name().begin(), _inProgress.Package->Name().length(), targetCopy.get());
-            (targetCopy.get())[_inProgress.Package->Name().length()] = 0;
+            std::unique_ptr<char[]> targetCopy(new char [data.Package->Name().length() + 1]);
+            std::copy_n(data.Package->Name().begin(), data.Package->Name().length(), targetCopy.get());
+            (targetCopy.get())[data.Package->Name().length()] = 0;
             const char* argv[1];
             argv[0] = targetCopy.get();
             if (opkg_cmd_exec(command, 1, argv) == 0) {
-                _inProgress.Install->SetProgress(100);
-                _inProgress.Install->SetState(Exchange::IPackager::INSTALLED);
+                data.Install->SetProgress(100);
+                data.Install->SetState(Exchange::IPackager::INSTALLED);
             } else {
-                _inProgress.Install->SetError(Core::ERROR_GENERAL);
+                data.Install->SetError(Core::ERROR_GENERAL);
             }
-            NotifyStateChange();
+            NotifyStateChange(data);
         } else {
-            _inProgress.Install->SetError(Core::ERROR_GENERAL);
-            NotifyStateChange();
+            data.Install->SetError(Core::ERROR_GENERAL);
+            NotifyStateChange(data);
         }
 #else
         _isUpgrade = false;
         opkg_package_callback_t checkUpgrade = [](pkg* pkg, void* user_data) {
             PackagerImplementation* self = static_cast<PackagerImplementation*>(user_data);
             if (self->_isUpgrade == false) {
-                self->_isUpgrade = self->_inProgress.Package->Name() == pkg->name;
-                if (self->_isUpgrade && self->_inProgress.Package->Version().empty() == false) {
+                self->_isUpgrade = self->_current->Package->Name() == pkg->name;
+                if (self->_isUpgrade && self->_current->Package->Version().empty() == false) {
                     self->_isUpgrade = opkg_compare_versions(pkg->version,
-                                                             self->_inProgress.Package->Version().c_str()) < 0;
+                                                             self->_current->Package->Version().c_str()) < 0;
                 }
             }
         };
@@ -234,12 +415,13 @@ namespace Plugin {
         }
         _isUpgrade = false;
 
-        if (installFunction(_inProgress.Package->Name().c_str(), PackagerImplementation::InstallationProgessNoLock,
+        if (installFunction(data.Package->Name().c_str(), PackagerImplementation::InstallationProgessNoLock,
                             this) != 0) {
-            _inProgress.Install->SetError(Core::ERROR_GENERAL);
-            NotifyStateChange();
+            data.Install->SetError(Core::ERROR_GENERAL);
+            NotifyStateChange(data);
         }
 #endif
+        _current = nullptr;
     }
 
 #if !defined (DO_NOT_USE_DEPRECATED_API)
@@ -247,43 +429,44 @@ namespace Plugin {
                                                                         void* data)
     {
         PackagerImplementation* self = static_cast<PackagerImplementation*>(data);
-        self->_inProgress.Install->SetProgress(progress->percentage);
+        ASSERT(self->_current != nullptr);
+        self->_current->Install->SetProgress(progress->percentage);
         if (progress->action == OPKG_INSTALL &&
-            self->_inProgress.Install->State() == Exchange::IPackager::DOWNLOADING) {
-            self->_inProgress.Install->SetState(Exchange::IPackager::DOWNLOADED);
-            self->NotifyStateChange();
+            self->_current->Install->State() == Exchange::IPackager::DOWNLOADING) {
+            self->_current->Install->SetState(Exchange::IPackager::DOWNLOADED);
+            self->NotifyStateChange(*self->_current);
         }
         bool stateChanged = false;
         switch (progress->action) {
             case OPKG_DOWNLOAD:
-                if (self->_inProgress.Install->State() != Exchange::IPackager::DOWNLOADING) {
-                    self->_inProgress.Install->SetState(Exchange::IPackager::DOWNLOADING);
+                if (self->_current->Install->State() != Exchange::IPackager::DOWNLOADING) {
+                    self->_current->Install->SetState(Exchange::IPackager::DOWNLOADING);
                     stateChanged = true;
                 }
                 break;
             case OPKG_INSTALL:
-                if (self->_inProgress.Install->State() != Exchange::IPackager::INSTALLING) {
-                    self->_inProgress.Install->SetState(Exchange::IPackager::INSTALLING);
+                if (self->_current->Install->State() != Exchange::IPackager::INSTALLING) {
+                    self->_current->Install->SetState(Exchange::IPackager::INSTALLING);
                     stateChanged = true;
                 }
                 break;
         }
 
         if (stateChanged == true)
-            self->NotifyStateChange();
+            self->NotifyStateChange(*self->_current);
         if (progress->percentage == 100) {
-            self->_inProgress.Install->SetState(Exchange::IPackager::INSTALLED);
-            self->NotifyStateChange();
+            self->_current->Install->SetState(Exchange::IPackager::INSTALLED);
+            self->NotifyStateChange(*self->_current);
         }
     }
 #endif
 
-    void PackagerImplementation::NotifyStateChange()
+    void PackagerImplementation::NotifyStateChange(const InstallationData& data)
     {
         _adminLock.Lock();
-        TRACE_L1("State for %s changed to %d (%d %%, %d)", _inProgress.Package->Name().c_str(), _inProgress.Install->State(), _inProgress.Install->Progress(), _inProgress.Install->ErrorCode());
+        TRACE_L1("State for %s changed to %d (%d %%, %d)", data.Package->Name().c_str(), data.Install->State(), data.Install->Progress(), data.Install->ErrorCode());
         for (auto* notification : _notifications) {
-            notification->StateChange(_inProgress.Package, _inProgress.Install);
+            notification->StateChange(data.Package, data.Install);
         }
         _adminLock.Unlock();
     }
@@ -331,7 +514,11 @@ namespace Plugin {
             }
         }
         ASSERT(mode == RepoSyncMode::SETUP || _isSyncing == true);
-        if (containFiles == false) {
+        FeedValidators validators;
+        if (containFiles == false && FeedsChangedNoLock(validators) == false) {
+            TRACE_L1("Feed indexes are unchanged, skipping the update");
+            NotifyRepoSynced(Core::ERROR_NONE);
+        } else if (containFiles == false) {
             uint32_t result = Core::ERROR_NONE;
 #if defined DO_NOT_USE_DEPRECATED_API
             opkg_cmd_t* command = opkg_cmd_find("update");
@@ -344,10 +531,145 @@ namespace Plugin {
             {
                 TRACE_L1("Failed to set up local repo. Installing might not work");
                 result = Core::ERROR_GENERAL;
+            } else {
+                SaveFeedValidators(validators);
             }
             NotifyRepoSynced(result);
         }
     }
 
+    bool PackagerImplementation::FeedsChangedNoLock(FeedValidators& validators) const
+    {
+        const FeedValidators saved = LoadFeedValidators();
+        bool changed = false;
+
+        curl_global_init(CURL_GLOBAL_ALL);
+
+        // Same URLs and list files as opkg's own update uses. Every feed is asked, also when an earlier one
+        // already changed, so all validators are current once the update succeeds.
+        pkg_src_list_elt_t* iter;
+        list_for_each_entry(iter, &opkg_config->pkg_src_list.head, node) {
+            const pkg_src_t* src = static_cast<const pkg_src_t*>(iter->data);
+            const string url = string(src->value) + (src->gzip ? _T("/Packages.gz") : _T("/Packages"));
+            const string listFile = string(opkg_config->lists_dir) + '/' + src->name;
+
+            auto entry = saved.find(url);
+            const FeedValidator* known = ((entry != saved.end()) && (Core::File(listFile).Exists() == true)) ? &(entry->second) : nullptr;
+
+            FeedValidator& current = validators[url];
+            if (QueryFeed(url, known, current) == 304 && known != nullptr) {
+                current = *known;
+            } else {
+                changed = true;
+            }
+        }
+
+        curl_global_cleanup();
+
+        return (changed == true || validators.empty() == true);
+    }
+
+    /* static */ long PackagerImplementation::QueryFeed(const string& url, const FeedValidator* known, FeedValidator& current)
+    {
+        struct Headers {
+            static size_t Collect(char* buffer, size_t size, size_t count, void* user)
+            {
+                const size_t length = size * count;
+                string line(buffer, length);
+                const size_t colon = line.find(':');
+                if (colon != string::npos) {
+                    string name = line.substr(0, colon);
+                    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+                    const size_t begin = line.find_first_not_of(" \t", colon + 1);
+                    const size_t end = line.find_last_not_of(" \t\r\n");
+                    const string value = (begin != string::npos && end >= begin) ? line.substr(begin, end - begin + 1) : string();
+
+                    FeedValidator* validator = static_cast<FeedValidator*>(user);
+                    if (name == _T("etag")) {
+                        validator->ETag = value;
+                    } else if (name == _T("last-modified")) {
+                        validator->LastModified = value;
+                    }
+                }
+                return length;
+            }
+        };
+
+        long code = 0;
+        CURL* curl = curl_easy_init();
+        if (curl != nullptr) {
+            struct curl_slist* headers = nullptr;
+            if (known != nullptr) {
+                if (known->ETag.empty() == false) {
+                    headers = curl_slist_append(headers, (_T("If-None-Match: ") + known->ETag).c_str());
+                }
+                if (known->LastModified.empty() == false) {
+                    headers = curl_slist_append(headers, (_T("If-Modified-Since: ") + known->LastModified).c_str());
+                }
+            }
+
+            // Only the status and the validators are needed, opkg fetches the index itself if it changed.
+            curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+            curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+            curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+            curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+            curl_easy_setopt(curl, CURLOPT_TIMEOUT, FeedQueryTimeout);
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+            curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, &Headers::Collect);
+            curl_easy_setopt(curl, CURLOPT_HEADERDATA, &current);
+
+            if (curl_easy_perform(curl) == CURLE_OK) {
+                curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+            }
+
+            curl_slist_free_all(headers);
+            curl_easy_cleanup(curl);
+        }
+
+        TRACE_L1("Feed %s answered %ld", url.c_str(), code);
+
+        return code;
+    }
+
+    PackagerImplementation::FeedValidators PackagerImplementation::LoadFeedValidators() const
+    {
+        // One feed per line: URL, ETag and Last-Modified separated by tabs.
+        FeedValidators validators;
+        std::ifstream file(_cachePath + _T("/feeds"));
+        string line;
+        while (std::getline(file, line)) {
+            const size_t first = line.find('\t');
+            const size_t second = (first != string::npos ? line.find('\t', first + 1) : string::npos);
+            if (second != string::npos) {
+                FeedValidator& validator = validators[line.substr(0, first)];
+                validator.ETag = line.substr(first + 1, second - first - 1);
+                validator.LastModified = line.substr(second + 1);
+            }
+        }
+        return validators;
+    }
+
+    void PackagerImplementation::SaveFeedValidators(const FeedValidators& validators) const
+    {
+        // Written aside and renamed over the old file, so an interrupted write never leaves a
+        // truncated file behind.
+        const string path(_cachePath + _T("/feeds"));
+        const string temporary(path + _T(".tmp"));
+        bool written = false;
+        {
+            std::ofstream file(temporary, std::ios::trunc);
+            for (const auto& entry : validators) {
+                file << entry.first << '\t' << entry.second.ETag << '\t' << entry.second.LastModified << '\n';
+            }
+            file.flush();
+            written = file.good();
+        }
+
+        if (written == false || ::rename(temporary.c_str(), path.c_str()) != 0) {
+            TRACE_L1("Failed to save the feed validators to %s", path.c_str());
+            ::remove(temporary.c_str());
+        }
+    }
+
 }  // namespace Plugin
 }  // namespace WPEFramework
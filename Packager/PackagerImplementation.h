@@ -23,6 +23,8 @@
 #include <interfaces/IPackager.h>
 
 #include <list>
+#include <map>
+#include <memory>
 #include <string>
 
 // Forward declarations so we do not need to include the OPKG headers here.
@@ -48,6 +50,7 @@ namespace Plugin {
                 , NoDeps()
                 , NoSignatureCheck()
                 , AlwaysUpdateFirst()
+                , MaxDownloads(4)               // Packages downloaded at the same time ahead of installing them
             {
                 Add(_T("config"), &ConfigFile);
                 Add(_T("temppath"), &TempDir);
@@ -57,6 +60,7 @@ namespace Plugin {
                 Add(_T("nodeps"), &NoDeps);
                 Add(_T("nosignaturecheck"), &NoSignatureCheck);
                 Add(_T("alwaysupdatefirst"), &AlwaysUpdateFirst);
+                Add(_T("maxdownloads"), &MaxDownloads);
             }
 
             ~Config() override
@@ -74,6 +78,7 @@ namespace Plugin {
             Core::JSON::Boolean NoDeps;
             Core::JSON::Boolean NoSignatureCheck;
             Core::JSON::Boolean AlwaysUpdateFirst;
+            Core::JSON::DecUInt8 MaxDownloads;
         };
 
         PackagerImplementation()
@@ -86,9 +91,14 @@ namespace Plugin {
             , _skipSignatureChecking(false)
             , _alwaysUpdateFirst(false)
             , _volatileCache(false)
+            , _maxDownloads(4)
             , _opkgInitialized(false)
+            , _queue()
+            , _batch()
+            , _current(nullptr)
             , _worker(this)
             , _isUpgrade(false)
+            , _syncPending(false)
             , _isSyncing(false)
         {
         }
@@ -225,8 +235,20 @@ namespace Plugin {
             }
             PackageInfo* Package = nullptr;
             InstallInfo* Install = nullptr;
+            string Url;                 // Where the package is fetched from ahead of installing, empty if it is not
+            string CachedFile;          // Where opkg looks for it in the cache
         };
 
+        using InstallationQueue = std::list<std::unique_ptr<InstallationData>>;
+
+        // HTTP validators of a feed index as of the last successful update.
+        struct FeedValidator {
+            string ETag;
+            string LastModified;
+        };
+
+        using FeedValidators = std::map<string, FeedValidator>;
+
         class InstallThread : public Core::Thread {
         public:
             InstallThread(PackagerImplementation* parent)
@@ -239,26 +261,24 @@ namespace Plugin {
             uint32_t Worker() override {
                 while(IsRunning() == true) {
                     _parent->_adminLock.Lock(); // The parent may have lock when this starts so wait for it to release.
-                    bool isInstall = _parent->_inProgress.Install != nullptr;
-                    ASSERT(isInstall != true || _parent->_inProgress.Package != nullptr);
+                    // Everything queued so far makes up one batch, what is queued while it runs makes up the next.
+                    _parent->_batch.splice(_parent->_batch.end(), _parent->_queue);
+                    bool isSync = _parent->_syncPending;
+                    _parent->_syncPending = false;
+                    _parent->_isSyncing = isSync;
                     _parent->_adminLock.Unlock();
 
-                    // After this point locking is not needed because API running on other threads only read if in
-                    // progress is filled in.
-                    _parent->BlockingSetupLocalRepoNoLock(isInstall == true ? RepoSyncMode::SETUP : RepoSyncMode::FORCED);
-                    if (isInstall)
-                        _parent->BlockingInstallUntilCompletionNoLock();
-
-                    if (isInstall) {
-                        _parent->_adminLock.Lock();
-                        _parent->_inProgress.Install->Release();
-                        _parent->_inProgress.Package->Release();
-                        _parent->_inProgress.Install = nullptr;
-                        _parent->_inProgress.Package = nullptr;
-                        _parent->_adminLock.Unlock();
-                    }
-
-                    Block();
+                    // After this point locking is not needed for the batch because API running on other threads
+                    // only read it.
+                    if (_parent->_batch.empty() == false || isSync == true)
+                        _parent->BlockingProcessBatchNoLock(isSync);
+
+                    _parent->_adminLock.Lock();
+                    _parent->_batch.clear();
+                    // Checked and blocked under the lock, so a request coming in meanwhile cannot be missed.
+                    if (_parent->_queue.empty() == true && _parent->_syncPending == false)
+                        Block();
+                    _parent->_adminLock.Unlock();
                 }
 
                 return Core::infinite;
@@ -278,10 +298,18 @@ namespace Plugin {
 #if !defined (DO_NOT_USE_DEPRECATED_API)
         static void InstallationProgessNoLock(const _opkg_progress_data_t* progress, void* data);
 #endif
-        void NotifyStateChange();
+        void NotifyStateChange(const InstallationData& data);
         void NotifyRepoSynced(uint32_t status);
-        void BlockingInstallUntilCompletionNoLock();
+        void BlockingProcessBatchNoLock(bool forceSync);
+        void BlockingDownloadBatchNoLock();
+        void BlockingInstallUntilCompletionNoLock(InstallationData& data);
         void BlockingSetupLocalRepoNoLock(RepoSyncMode mode);
+        bool FeedsChangedNoLock(FeedValidators& validators) const;
+        FeedValidators LoadFeedValidators() const;
+        void SaveFeedValidators(const FeedValidators& validators) const;
+        static long QueryFeed(const string& url, const FeedValidator* known, FeedValidator& current);
+        bool ResolveDownloadNoLock(InstallationData& data) const;
+        bool Download(InstallationData& data);
         bool InitOPKG();
         void FreeOPKG();
 
@@ -294,12 +322,16 @@ namespace Plugin {
         bool _skipSignatureChecking;
         bool _alwaysUpdateFirst;
         bool _volatileCache;
+        uint8_t _maxDownloads;
         bool _opkgInitialized;
         std::vector<Exchange::IPackager::INotification*> _notifications;
-        InstallationData _inProgress;
+        InstallationQueue _queue;
+        InstallationQueue _batch;
+        InstallationData* _current;
         InstallThread _worker;
         bool _isUpgrade;
-        bool _isSyncing;
+        bool _syncPending;  // Forced sync requested, taken up by the next batch
+        bool _isSyncing;    // Forced sync run by the current batch
     };
 
 }  // namespace Plugin
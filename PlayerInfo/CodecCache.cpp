@@ -0,0 +1,152 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CodecCache.h"
+
+#include <gst/gst.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    namespace {
+
+        // FNV-1a
+        uint64_t Hash(const string& text, uint64_t hash = 0xcbf29ce484222325ULL)
+        {
+            for (const char c : text) {
+                hash ^= static_cast<uint8_t>(c);
+                hash *= 0x100000001b3ULL;
+            }
+            return (hash);
+        }
+
+        bool ReadList(std::istream& input, const char tag, std::list<uint32_t>& codecs)
+        {
+            string line;
+            bool result = false;
+
+            if ((std::getline(input, line)) && (line.empty() == false) && (line[0] == tag)) {
+                std::istringstream values(line.substr(1));
+                uint32_t codec;
+                while (values >> codec) {
+                    codecs.push_back(codec);
+                }
+                result = true;
+            }
+            return (result);
+        }
+
+        void WriteList(std::ostream& output, const char tag, const std::list<uint32_t>& codecs)
+        {
+            output << tag;
+            for (const uint32_t codec : codecs) {
+                output << ' ' << codec;
+            }
+            output << '\n';
+        }
+    }
+
+    /* static */ uint64_t CodecCache::RegistryKey(const std::list<string>& probedCaps)
+    {
+        gchar* version = gst_version_string();
+        uint64_t key = Hash(version);
+        g_free(version);
+
+        for (const string& caps : probedCaps) {
+            key = Hash(caps, key);
+        }
+
+        // The registry hands the features out in no particular order, so they are combined order independent
+        uint64_t features = 0;
+        GList* list = gst_registry_get_feature_list(gst_registry_get(), GST_TYPE_ELEMENT_FACTORY);
+        for (GList* iterator = list; iterator != nullptr; iterator = iterator->next) {
+            GstPluginFeature* feature = GST_PLUGIN_FEATURE(iterator->data);
+            GstPlugin* plugin = gst_plugin_feature_get_plugin(feature);
+
+            string entry(GST_OBJECT_NAME(feature));
+            entry += '/' + std::to_string(gst_plugin_feature_get_rank(feature));
+            if (plugin != nullptr) {
+                entry += '/';
+                entry += gst_plugin_get_name(plugin);
+                entry += '/';
+                entry += gst_plugin_get_version(plugin);
+                gst_object_unref(plugin);
+            }
+            features += Hash(entry);
+        }
+        gst_plugin_feature_list_free(list);
+
+        return (key ^ features);
+    }
+
+    bool CodecCache::Load(uint64_t& key, std::list<uint32_t>& audioCodecs, std::list<uint32_t>& videoCodecs) const
+    {
+        bool result = false;
+
+        if (IsEnabled() == true) {
+            std::ifstream input(_fileName);
+            string line;
+
+            if ((input.is_open() == true) && (std::getline(input, line))) {
+                std::list<uint32_t> audio;
+                std::list<uint32_t> video;
+
+                key = std::strtoull(line.c_str(), nullptr, 16);
+                if ((ReadList(input, 'a', audio) == true) && (ReadList(input, 'v', video) == true)) {
+                    audioCodecs.swap(audio);
+                    videoCodecs.swap(video);
+                    result = true;
+                }
+            }
+        }
+        return (result);
+    }
+
+    bool CodecCache::Save(const uint64_t key, const std::list<uint32_t>& audioCodecs, const std::list<uint32_t>& videoCodecs) const
+    {
+        bool result = false;
+
+        if (IsEnabled() == true) {
+            // Written aside and renamed, so a reader never sees half a file
+            const string temporary(_fileName + _T(".tmp"));
+            std::ofstream output(temporary, std::ios::trunc);
+
+            if (output.is_open() == true) {
+                output << std::hex << key << std::dec << '\n';
+                WriteList(output, 'a', audioCodecs);
+                WriteList(output, 'v', videoCodecs);
+                output.close();
+
+                result = ((output.fail() == false) && (::rename(temporary.c_str(), _fileName.c_str()) == 0));
+            }
+            if (result == false) {
+                TRACE_L1(_T("Could not store the codec cache in %s"), _fileName.c_str());
+                ::remove(temporary.c_str());
+            }
+        }
+        return (result);
+    }
+
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,62 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Codec lists found by probing the GStreamer registry, kept on disk so they only need to be
+    // probed again when the registry changed. The key covers every element factory with its rank
+    // and plugin version, plus the caps that were probed for.
+    class CodecCache {
+    public:
+        CodecCache() = delete;
+        CodecCache(const CodecCache&) = delete;
+        CodecCache& operator=(const CodecCache&) = delete;
+
+        explicit CodecCache(const string& fileName)
+            : _fileName(fileName)
+        {
+        }
+        ~CodecCache()
+        {
+        }
+
+    public:
+        bool IsEnabled() const
+        {
+            return (_fileName.empty() == false);
+        }
+
+        // Needs gst_init() to have been called
+        static uint64_t RegistryKey(const std::list<string>& probedCaps);
+
+        // Returns false if there is no (readable) cache, key is the one the lists were stored with
+        bool Load(uint64_t& key, std::list<uint32_t>& audioCodecs, std::list<uint32_t>& videoCodecs) const;
+        bool Save(const uint64_t key, const std::list<uint32_t>& audioCodecs, const std::list<uint32_t>& videoCodecs) const;
+
+    private:
+        string _fileName;
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
@@ -26,8 +26,10 @@
 #include "audioOutputPortConfig.hpp"
 #include "audioOutputPort.hpp"
 #include "utils.h"
+#include "../CodecCache.h"
 
 #include <gst/gst.h>
+#include <thread>
 
 #include "libIBus.h"
 #include "libIBusDaemon.h"
@@ -114,10 +116,10 @@ private:
 
 public:
     PlayerInfoImplementation()
+        : _codecCache(CodecCacheFileName())
     {
         gst_init(0, nullptr);
-        UpdateAudioCodecInfo();
-        UpdateVideoCodecInfo();
+        LoadCodecInfo();
         IARM_Result_t res;
         IARM_CHECK( IARM_Bus_RegisterEventHandler(IARM_BUS_DSMGR_NAME,IARM_BUS_DSMGR_EVENT_AUDIO_MODE, AudioModeHandler) );
         PlayerInfoImplementation::_instance = this;
@@ -127,6 +129,9 @@ public:
     PlayerInfoImplementation& operator= (const PlayerInfoImplementation&) = delete;
     ~PlayerInfoImplementation() override
     {
+        if (_codecProbe.joinable() == true) {
+            _codecProbe.join();
+        }
         _audioCodecs.clear();
         _videoCodecs.clear();
         IARM_Result_t res;
@@ -137,12 +142,16 @@ public:
 public:
     uint32_t AudioCodecs(Exchange::IPlayerProperties::IAudioCodecIterator*& iterator) const override
     {
+        _adminLock.Lock();
         iterator = Core::Service<AudioIteratorImplementation>::Create<Exchange::IPlayerProperties::IAudioCodecIterator>(_audioCodecs);
+        _adminLock.Unlock();
         return (iterator != nullptr ? Core::ERROR_NONE : Core::ERROR_GENERAL);
     }
     uint32_t VideoCodecs(Exchange::IPlayerProperties::IVideoCodecIterator*& iterator) const override
     {
+        _adminLock.Lock();
         iterator = Core::Service<VideoIteratorImplementation>::Create<Exchange::IPlayerProperties::IVideoCodecIterator>(_videoCodecs);
+        _adminLock.Unlock();
         return (iterator != nullptr ? Core::ERROR_NONE : Core::ERROR_GENERAL);
     }
 
@@ -386,9 +395,17 @@ public:
 private:
 
 
-    void UpdateAudioCodecInfo()
+    static string CodecCacheFileName()
     {
-        AudioCaps audioCaps = {
+        // Set by the plugin, no caching if it is not
+        string fileName;
+        Core::SystemInfo::GetEnvironment(_T("PLAYERINFO_CODEC_CACHE"), fileName);
+        return (fileName);
+    }
+
+    static const AudioCaps& AudioCapsTable()
+    {
+        static const AudioCaps audioCaps = {
             {"audio/mpeg, mpegversion=(int)1", Exchange::IPlayerProperties::AudioCodec::AUDIO_MPEG1},
             {"audio/mpeg, mpegversion=(int)2", Exchange::IPlayerProperties::AudioCodec::AUDIO_MPEG2},
             {"audio/mpeg, mpegversion=(int)4", Exchange::IPlayerProperties::AudioCodec::AUDIO_MPEG4},
@@ -401,14 +418,11 @@ private:
             {"audio/x-vorbis", Exchange::IPlayerProperties::AUDIO_VORBIS_OGG},
             {"audio/x-wav", Exchange::IPlayerProperties::AUDIO_WAV},
         };
-        if (GstUtils::GstRegistryCheckElementsForMediaTypes(audioCaps, _audioCodecs) != true) {
-            TRACE_L1(_T("There is no Audio Codec support available"));
-        }
-
+        return (audioCaps);
     }
-    void UpdateVideoCodecInfo()
+    static const VideoCaps& VideoCapsTable()
     {
-        VideoCaps videoCaps = {
+        static const VideoCaps videoCaps = {
             {"video/x-h263", Exchange::IPlayerProperties::VideoCodec::VIDEO_H263},
             {"video/x-h264, profile=(string)high", Exchange::IPlayerProperties::VideoCodec::VIDEO_H264},
             {"video/x-h265", Exchange::IPlayerProperties::VideoCodec::VIDEO_H265},
@@ -417,17 +431,95 @@ private:
             {"video/x-vp9", Exchange::IPlayerProperties::VideoCodec::VIDEO_VP9},
             {"video/x-vp10", Exchange::IPlayerProperties::VideoCodec::VIDEO_VP10}
         };
-        if (GstUtils::GstRegistryCheckElementsForMediaTypes(videoCaps, _videoCodecs) != true) {
+        return (videoCaps);
+    }
+
+    void UpdateAudioCodecInfo(std::list<Exchange::IPlayerProperties::AudioCodec>& audioCodecs) const
+    {
+        if (GstUtils::GstRegistryCheckElementsForMediaTypes(AudioCapsTable(), audioCodecs) != true) {
+            TRACE_L1(_T("There is no Audio Codec support available"));
+        }
+    }
+    void UpdateVideoCodecInfo(std::list<Exchange::IPlayerProperties::VideoCodec>& videoCodecs) const
+    {
+        if (GstUtils::GstRegistryCheckElementsForMediaTypes(VideoCapsTable(), videoCodecs) != true) {
             TRACE_L1(_T("There is no Video Codec support available"));
         }
     }
 
+    // Probing the registry is slow when it is big, so the outcome is cached until the registry changes
+    void LoadCodecInfo()
+    {
+        std::list<string> probedCaps;
+        for (const auto& entry : AudioCapsTable()) {
+            probedCaps.push_back(entry.first);
+        }
+        for (const auto& entry : VideoCapsTable()) {
+            probedCaps.push_back(entry.first);
+        }
+        const uint64_t key = CodecCache::RegistryKey(probedCaps);
+
+        uint64_t cachedKey = 0;
+        std::list<uint32_t> audioCodecs;
+        std::list<uint32_t> videoCodecs;
+        if (_codecCache.Load(cachedKey, audioCodecs, videoCodecs) == true) {
+            for (const uint32_t codec : audioCodecs) {
+                _audioCodecs.push_back(static_cast<Exchange::IPlayerProperties::AudioCodec>(codec));
+            }
+            for (const uint32_t codec : videoCodecs) {
+                _videoCodecs.push_back(static_cast<Exchange::IPlayerProperties::VideoCodec>(codec));
+            }
+
+            if (cachedKey != key) {
+                // Serve what was there until the registry has been probed again
+                TRACE_L1(_T("GStreamer registry changed, probing the codecs in the background"));
+                _codecProbe = std::thread(&PlayerInfoImplementation::RefreshCodecInfo, this, key);
+            }
+        } else {
+            UpdateAudioCodecInfo(_audioCodecs);
+            UpdateVideoCodecInfo(_videoCodecs);
+            SaveCodecInfo(key);
+        }
+    }
+    void RefreshCodecInfo(const uint64_t key)
+    {
+        std::list<Exchange::IPlayerProperties::AudioCodec> audioCodecs;
+        std::list<Exchange::IPlayerProperties::VideoCodec> videoCodecs;
+        UpdateAudioCodecInfo(audioCodecs);
+        UpdateVideoCodecInfo(videoCodecs);
+
+        _adminLock.Lock();
+        _audioCodecs.swap(audioCodecs);
+        _videoCodecs.swap(videoCodecs);
+        _adminLock.Unlock();
+
+        SaveCodecInfo(key);
+    }
+    void SaveCodecInfo(const uint64_t key) const
+    {
+        std::list<uint32_t> audioCodecs;
+        std::list<uint32_t> videoCodecs;
+
+        _adminLock.Lock();
+        for (const auto codec : _audioCodecs) {
+            audioCodecs.push_back(static_cast<uint32_t>(codec));
+        }
+        for (const auto codec : _videoCodecs) {
+            videoCodecs.push_back(static_cast<uint32_t>(codec));
+        }
+        _adminLock.Unlock();
+
+        _codecCache.Save(key, audioCodecs, videoCodecs);
+    }
+
 private:
     std::list<Exchange::IPlayerProperties::AudioCodec> _audioCodecs;
     std::list<Exchange::IPlayerProperties::VideoCodec> _videoCodecs;
 
     std::list<Exchange::Dolby::IOutput::INotification*> _observers;
     mutable Core::CriticalSection _adminLock;
+    CodecCache _codecCache;
+    std::thread _codecProbe;
 public:
     static PlayerInfoImplementation* _instance;
 };
@@ -38,44 +38,35 @@ namespace Plugin {
         config.FromString(service->ConfigLine());
         _skipURL = static_cast<uint8_t>(service->WebPrefix().length());
 
+        // Lets the implementation skip probing GStreamer for codecs as long as its registry did not change.
+        // It loads the cache while it is constructed, so the file name is handed over through the environment.
+        string codecCache = config.CodecCache.Value();
+        if ((codecCache.empty() == false) && (codecCache[0] != '/')) {
+            codecCache = service->PersistentPath() + codecCache;
+        }
+        if ((codecCache.empty() == false) && (Core::Directory(Core::File::PathName(codecCache).c_str()).CreatePath() == false)) {
+            SYSLOG(Logging::Startup, (_T("Cannot create the directory of %s, codecs are not cached."), codecCache.c_str()));
+            codecCache.clear();
+        }
+        Core::SystemInfo::SetEnvironment(_T("PLAYERINFO_CODEC_CACHE"), codecCache);
+
         _player = service->Root<Exchange::IPlayerProperties>(_connectionId, 2000, _T("PlayerInfoImplementation"));
 
         if (_player != nullptr) {
             Exchange::JPlayerProperties::Register(*this, _player);
-            if ( (_player->AudioCodecs(_audioCodecs) != Core::ERROR_NONE)  || (_audioCodecs == nullptr) ) {
-                if (_audioCodecs != nullptr) {
-                    _audioCodecs->Release();
-                    _audioCodecs = nullptr;
-                }
-                _player->Release();
-                _player = nullptr;
-            }
-            else if ((_player->VideoCodecs(_videoCodecs) != Core::ERROR_NONE) || (_videoCodecs == nullptr) ) {
-                if (_videoCodecs != nullptr) {
-
-                    _videoCodecs->Release();
-                    _videoCodecs = nullptr;
-                }
-                _audioCodecs->Release();
-                _audioCodecs = nullptr;
-                _player->Release();
-                _player = nullptr;
-            } else {
-
-                // The code execution should proceed regardless of the _dolbyOut
-                // value, as it is not a essential.
-                // The relevant JSONRPC endpoints will return ERROR_UNAVAILABLE,
-                // if it hasn't been initialized.
-                _dolbyOut = _player->QueryInterface<Exchange::Dolby::IOutput>();
-                if(_dolbyOut == nullptr){
-                    SYSLOG(Logging::Startup, (_T("Dolby output switching service is unavailable.")));
-                }
-                else
-                {
-                    _notification.Initialize(_dolbyOut);
-                    Exchange::Dolby::JOutput::Register(*this, _dolbyOut);
-                }
 
+            // The code execution should proceed regardless of the _dolbyOut
+            // value, as it is not a essential.
+            // The relevant JSONRPC endpoints will return ERROR_UNAVAILABLE,
+            // if it hasn't been initialized.
+            _dolbyOut = _player->QueryInterface<Exchange::Dolby::IOutput>();
+            if(_dolbyOut == nullptr){
+                SYSLOG(Logging::Startup, (_T("Dolby output switching service is unavailable.")));
+            }
+            else
+            {
+                _notification.Initialize(_dolbyOut);
+                Exchange::Dolby::JOutput::Register(*this, _dolbyOut);
             }
         }
 
@@ -143,18 +134,25 @@ namespace Plugin {
 
     void PlayerInfo::Info(JsonData::PlayerInfo::CodecsData& playerInfo) const
     {
-        Core::JSON::EnumType<JsonData::PlayerInfo::CodecsData::AudiocodecsType> audioCodec;
-        _audioCodecs->Reset(0);
-        Exchange::IPlayerProperties::AudioCodec audio;
-        while(_audioCodecs->Next(audio)) {
-            playerInfo.Audio.Add(audioCodec = static_cast<JsonData::PlayerInfo::CodecsData::AudiocodecsType>(audio));
+        // Asked for every time, the implementation may have probed the codecs again since activation
+        Exchange::IPlayerProperties::IAudioCodecIterator* audioCodecs = nullptr;
+        if ((_player->AudioCodecs(audioCodecs) == Core::ERROR_NONE) && (audioCodecs != nullptr)) {
+            Core::JSON::EnumType<JsonData::PlayerInfo::CodecsData::AudiocodecsType> audioCodec;
+            Exchange::IPlayerProperties::AudioCodec audio;
+            while(audioCodecs->Next(audio)) {
+                playerInfo.Audio.Add(audioCodec = static_cast<JsonData::PlayerInfo::CodecsData::AudiocodecsType>(audio));
+            }
+            audioCodecs->Release();
         }
 
-        Core::JSON::EnumType<JsonData::PlayerInfo::CodecsData::VideocodecsType> videoCodec;
-        Exchange::IPlayerProperties::VideoCodec video;
-        _videoCodecs->Reset(0);
-        while(_videoCodecs->Next(video)) {
-            playerInfo.Video.Add(videoCodec = static_cast<JsonData::PlayerInfo::CodecsData::VideocodecsType>(video));
+        Exchange::IPlayerProperties::IVideoCodecIterator* videoCodecs = nullptr;
+        if ((_player->VideoCodecs(videoCodecs) == Core::ERROR_NONE) && (videoCodecs != nullptr)) {
+            Core::JSON::EnumType<JsonData::PlayerInfo::CodecsData::VideocodecsType> videoCodec;
+            Exchange::IPlayerProperties::VideoCodec video;
+            while(videoCodecs->Next(video)) {
+                playerInfo.Video.Add(videoCodec = static_cast<JsonData::PlayerInfo::CodecsData::VideocodecsType>(video));
+            }
+            videoCodecs->Release();
         }
     }
 
@@ -29,6 +29,26 @@ namespace Plugin {
 
     class PlayerInfo : public PluginHost::IPlugin, public PluginHost::IWeb, public PluginHost::JSONRPC {
     private:
+        class Config : public Core::JSON::Container {
+        private:
+            Config(const Config&) = delete;
+            Config& operator=(const Config&) = delete;
+
+        public:
+            Config()
+                : Core::JSON::Container()
+                , CodecCache(_T("codecs"))     // Relative to the persistent path, no caching if empty
+            {
+                Add(_T("codeccache"), &CodecCache);
+            }
+            ~Config() override
+            {
+            }
+
+        public:
+            Core::JSON::String CodecCache;
+        };
+
         class Notification : protected Exchange::Dolby::IOutput::INotification {
         private:
             Notification() = delete;
@@ -80,8 +100,7 @@ namespace Plugin {
             : _skipURL(0)
             , _connectionId(0)
             , _player(nullptr)
-            , _audioCodecs(nullptr)
-            , _videoCodecs(nullptr)
+            , _dolbyOut(nullptr)
             , _notification(this)
         {
         }
@@ -122,8 +141,6 @@ namespace Plugin {
         uint32_t _connectionId;
 
         Exchange::IPlayerProperties* _player;
-        Exchange::IPlayerProperties::IAudioCodecIterator* _audioCodecs;
-        Exchange::IPlayerProperties::IVideoCodecIterator* _videoCodecs;
         Exchange::Dolby::IOutput* _dolbyOut;
         Core::Sink<Notification> _notification;
     };
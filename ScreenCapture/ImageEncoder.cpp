@@ -0,0 +1,478 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2020 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#include "ImageEncoder.h"
+
+#include "utils.h"
+
+#include <setjmp.h>
+#include <string.h>
+#include <algorithm>
+
+#include <png.h>
+#include <zlib.h>
+
+#ifdef HAS_JPEG
+#include <stdio.h>
+#include <jpeglib.h>
+#endif
+
+#ifdef HAS_WEBP
+#include <webp/encode.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace WPEFramework
+{
+    namespace Plugin
+    {
+        void ImageEncoder::ConvertRow(const unsigned char* in, int width, PixelOrder order, bool alpha, unsigned char* out)
+        {
+            const bool swap = (order == PixelOrder::BGRA);
+            int i = 0;
+
+            if (alpha)
+            {
+                if (!swap)
+                {
+                    memcpy(out, in, width * 4);
+                    return;
+                }
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+                for (; i + 16 <= width; i += 16)
+                {
+                    uint8x16x4_t bgra = vld4q_u8(in + i * 4);
+                    uint8x16_t b = bgra.val[0];
+                    bgra.val[0] = bgra.val[2];
+                    bgra.val[2] = b;
+                    vst4q_u8(out + i * 4, bgra);
+                }
+#elif defined(__SSE2__)
+                // Keep G and A, swap B and R within each 32 bit pixel
+                const __m128i ga = _mm_set1_epi32((int)0xFF00FF00);
+                for (; i + 4 <= width; i += 4)
+                {
+                    __m128i p = _mm_loadu_si128((const __m128i*)(in + i * 4));
+                    __m128i br = _mm_andnot_si128(ga, p);
+                    br = _mm_or_si128(_mm_slli_epi32(br, 16), _mm_srli_epi32(br, 16));
+                    _mm_storeu_si128((__m128i*)(out + i * 4), _mm_or_si128(_mm_and_si128(p, ga), br));
+                }
+#endif
+                for (; i < width; ++i)
+                {
+                    out[i * 4 + 0] = in[i * 4 + 2];
+                    out[i * 4 + 1] = in[i * 4 + 1];
+                    out[i * 4 + 2] = in[i * 4 + 0];
+                    out[i * 4 + 3] = in[i * 4 + 3];
+                }
+                return;
+            }
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+            for (; i + 16 <= width; i += 16)
+            {
+                uint8x16x4_t pixel = vld4q_u8(in + i * 4);
+                uint8x16x3_t rgb;
+                rgb.val[0] = swap ? pixel.val[2] : pixel.val[0];
+                rgb.val[1] = pixel.val[1];
+                rgb.val[2] = swap ? pixel.val[0] : pixel.val[2];
+                vst3q_u8(out + i * 3, rgb);
+            }
+#elif defined(__SSSE3__)
+            // Drops A (and swaps B and R) of 4 pixels at a time. The store is 16 bytes wide for
+            // 12 bytes of output, so the loop stops while the rest of the row still covers it.
+            const __m128i shuffle = swap
+                ? _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)
+                : _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+            for (; i + 6 <= width; i += 4)
+            {
+                __m128i p = _mm_loadu_si128((const __m128i*)(in + i * 4));
+                _mm_storeu_si128((__m128i*)(out + i * 3), _mm_shuffle_epi8(p, shuffle));
+            }
+#endif
+            for (; i < width; ++i)
+            {
+                out[i * 3 + 0] = in[i * 4 + (swap ? 2 : 0)];
+                out[i * 3 + 1] = in[i * 4 + 1];
+                out[i * 3 + 2] = in[i * 4 + (swap ? 0 : 2)];
+            }
+        }
+
+        // libpng can't reuse its write struct, so only the row buffer (and the caller's output) outlive a capture
+        class PngEncoder : public ImageEncoder
+        {
+        public:
+            PngEncoder() : m_level(6), m_filters(PNG_FILTER_SUB | PNG_FILTER_UP), m_strategy(Z_FILTERED) { }
+
+            const char* ContentType() const override
+            {
+                return "image/png";
+            }
+
+            void Configure(const ImageSettings& settings) override
+            {
+                if (settings.fast)
+                {
+                    // Several times cheaper than the default, for a file about a quarter larger
+                    m_level = 1;
+                    m_filters = PNG_FILTER_SUB;
+                    m_strategy = Z_RLE;
+                }
+                else
+                {
+                    // Sub and up filters suit screen content and are much cheaper than adaptive filtering with paeth
+                    m_level = std::min(std::max(settings.compression, 0), 9);
+                    m_filters = PNG_FILTER_SUB | PNG_FILTER_UP;
+                    m_strategy = Z_FILTERED;
+                }
+            }
+
+            bool Encode(const unsigned char* pixels, int width, int height, int pitch, PixelOrder order, std::vector<unsigned char>& out) override
+            {
+                png_structp png_ptr = NULL;
+                png_infop info_ptr = NULL;
+
+                out.clear();
+
+                if (NULL == pixels || width <= 0 || height <= 0 || pitch < width * 4)
+                {
+                    LOGERR("Error: failed to save the png because the given data is invalid.");
+                    return false;
+                }
+
+                png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+                if (NULL == png_ptr)
+                {
+                    LOGERR("Error: failed to create the png write struct.");
+                    return false;
+                }
+
+                info_ptr = png_create_info_struct(png_ptr);
+                if (NULL == info_ptr)
+                {
+                    LOGERR("Error: failed to create the png info struct.");
+                    png_destroy_write_struct(&png_ptr, NULL);
+                    return false;
+                }
+
+                if (setjmp(png_jmpbuf(png_ptr)))
+                {
+                    LOGERR("Error: failed to encode the png.");
+                    png_destroy_write_struct(&png_ptr, &info_ptr);
+                    return false;
+                }
+
+                png_set_write_fn(png_ptr, &out, WriteCallback, NULL);
+                png_set_compression_level(png_ptr, m_level);
+                png_set_compression_strategy(png_ptr, m_strategy);
+                png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, m_filters);
+
+                png_set_IHDR(png_ptr,
+                                info_ptr,
+                                width,
+                                height,
+                                8,
+                                PNG_COLOR_TYPE_RGBA,
+                                PNG_INTERLACE_NONE,
+                                PNG_COMPRESSION_TYPE_BASE,
+                                PNG_FILTER_TYPE_BASE);
+                png_write_info(png_ptr, info_ptr);
+
+                if (order != PixelOrder::RGBA)
+                    m_row.resize(width * 4);
+
+                // Rows are taken from where they are, only BGRA goes through the row buffer
+                for (int y = 0; y < height; ++y)
+                {
+                    const unsigned char* row = pixels + y * pitch;
+                    if (order != PixelOrder::RGBA)
+                    {
+                        ConvertRow(row, width, order, true, &m_row[0]);
+                        row = &m_row[0];
+                    }
+                    png_write_row(png_ptr, const_cast<png_bytep>(row));
+                }
+
+                png_write_end(png_ptr, NULL);
+                png_destroy_write_struct(&png_ptr, &info_ptr);
+
+                return true;
+            }
+
+        private:
+            static void WriteCallback(png_structp png_ptr, png_bytep data, png_size_t length)
+            {
+                std::vector<unsigned char> *p = (std::vector<unsigned char>*)png_get_io_ptr(png_ptr);
+                p->insert(p->end(), data, data + length);
+            }
+
+            int m_level;
+            int m_filters;
+            int m_strategy;
+            std::vector<unsigned char> m_row;
+        };
+
+#ifdef HAS_JPEG
+        // The compress struct is created once and reused for every capture
+        class JpegEncoder : public ImageEncoder
+        {
+        private:
+            struct ErrorManager
+            {
+                jpeg_error_mgr manager;
+                jmp_buf jump;
+            };
+
+            struct Destination
+            {
+                jpeg_destination_mgr manager;
+                std::vector<unsigned char>* out;
+            };
+
+        public:
+            JpegEncoder() : m_quality(85), m_fast(false)
+            {
+                m_compress.err = jpeg_std_error(&m_error.manager);
+                m_error.manager.error_exit = ErrorExit;
+                jpeg_create_compress(&m_compress);
+
+                m_destination.manager.init_destination = InitDestination;
+                m_destination.manager.empty_output_buffer = EmptyOutputBuffer;
+                m_destination.manager.term_destination = TermDestination;
+                m_destination.out = NULL;
+                m_compress.dest = &m_destination.manager;
+            }
+
+            ~JpegEncoder() override
+            {
+                jpeg_destroy_compress(&m_compress);
+            }
+
+            const char* ContentType() const override
+            {
+                return "image/jpeg";
+            }
+
+            void Configure(const ImageSettings& settings) override
+            {
+                m_quality = std::min(std::max(settings.quality, 1), 100);
+                m_fast = settings.fast;
+            }
+
+            bool Encode(const unsigned char* pixels, int width, int height, int pitch, PixelOrder order, std::vector<unsigned char>& out) override
+            {
+                out.clear();
+
+                if (NULL == pixels || width <= 0 || height <= 0 || pitch < width * 4)
+                {
+                    LOGERR("Error: failed to save the jpeg because the given data is invalid.");
+                    return false;
+                }
+
+                m_destination.out = &out;
+
+                if (setjmp(m_error.jump))
+                {
+                    jpeg_abort_compress(&m_compress);
+                    return false;
+                }
+
+                m_compress.image_width = width;
+                m_compress.image_height = height;
+#ifdef JCS_EXTENSIONS
+                // libjpeg-turbo reads 32 bit pixels itself (with SIMD), so rows go in as they are
+                m_compress.input_components = 4;
+                m_compress.in_color_space = (order == PixelOrder::RGBA) ? JCS_EXT_RGBX : JCS_EXT_BGRX;
+#else
+                m_compress.input_components = 3;
+                m_compress.in_color_space = JCS_RGB;
+                m_row.resize(width * 3);
+#endif
+                jpeg_set_defaults(&m_compress);
+                jpeg_set_quality(&m_compress, m_quality, TRUE);
+                m_compress.dct_method = m_fast ? JDCT_IFAST : JDCT_ISLOW;
+
+                jpeg_start_compress(&m_compress, TRUE);
+                while (m_compress.next_scanline < m_compress.image_height)
+                {
+                    const unsigned char* row = pixels + m_compress.next_scanline * pitch;
+#ifndef JCS_EXTENSIONS
+                    ConvertRow(row, width, order, false, &m_row[0]);
+                    row = &m_row[0];
+#endif
+                    JSAMPROW rowPointer = const_cast<JSAMPROW>(row);
+                    jpeg_write_scanlines(&m_compress, &rowPointer, 1);
+                }
+                jpeg_finish_compress(&m_compress);
+
+                return true;
+            }
+
+        private:
+            static void ErrorExit(j_common_ptr cinfo)
+            {
+                char message[JMSG_LENGTH_MAX];
+                (*cinfo->err->format_message)(cinfo, message);
+                LOGERR("Error: failed to encode the jpeg: %s", message);
+                longjmp(reinterpret_cast<ErrorManager*>(cinfo->err)->jump, 1);
+            }
+
+            static void InitDestination(j_compress_ptr cinfo)
+            {
+                Destination* destination = reinterpret_cast<Destination*>(cinfo->dest);
+                // Start out with what the previous capture needed
+                destination->out->resize(std::max(destination->out->capacity(), (size_t)(64 * 1024)));
+                destination->manager.next_output_byte = &(*destination->out)[0];
+                destination->manager.free_in_buffer = destination->out->size();
+            }
+
+            static boolean EmptyOutputBuffer(j_compress_ptr cinfo)
+            {
+                Destination* destination = reinterpret_cast<Destination*>(cinfo->dest);
+                size_t used = destination->out->size();
+                destination->out->resize(used * 2);
+                destination->manager.next_output_byte = &(*destination->out)[used];
+                destination->manager.free_in_buffer = destination->out->size() - used;
+                return TRUE;
+            }
+
+            static void TermDestination(j_compress_ptr cinfo)
+            {
+                Destination* destination = reinterpret_cast<Destination*>(cinfo->dest);
+                destination->out->resize(destination->out->size() - destination->manager.free_in_buffer);
+            }
+
+            jpeg_compress_struct m_compress;
+            ErrorManager m_error;
+            Destination m_destination;
+            int m_quality;
+            bool m_fast;
+            std::vector<unsigned char> m_row;
+        };
+#endif
+
+#ifdef HAS_WEBP
+        // The config and picture (and its YUV planes) are reused for every capture
+        class WebPEncoder : public ImageEncoder
+        {
+        public:
+            WebPEncoder()
+            {
+                WebPConfigInit(&m_config);
+                WebPPictureInit(&m_picture);
+                m_picture.writer = WriteCallback;
+            }
+
+            ~WebPEncoder() override
+            {
+                WebPPictureFree(&m_picture);
+            }
+
+            const char* ContentType() const override
+            {
+                return "image/webp";
+            }
+
+            void Configure(const ImageSettings& settings) override
+            {
+                m_config.quality = std::min(std::max(settings.quality, 1), 100);
+                m_config.method = settings.fast ? 0 : 4;
+            }
+
+            bool Encode(const unsigned char* pixels, int width, int height, int pitch, PixelOrder order, std::vector<unsigned char>& out) override
+            {
+                out.clear();
+
+                if (NULL == pixels || width <= 0 || height <= 0 || pitch < width * 4)
+                {
+                    LOGERR("Error: failed to save the webp because the given data is invalid.");
+                    return false;
+                }
+
+                m_picture.width = width;
+                m_picture.height = height;
+                m_picture.custom_ptr = &out;
+
+                // libwebp converts straight from the 32 bit pixels to YUV
+                int imported = (order == PixelOrder::RGBA)
+                    ? WebPPictureImportRGBA(&m_picture, pixels, pitch)
+                    : WebPPictureImportBGRA(&m_picture, pixels, pitch);
+
+                if (!imported || !WebPEncode(&m_config, &m_picture))
+                {
+                    LOGERR("Error: failed to encode the webp: %d", m_picture.error_code);
+                    return false;
+                }
+
+                return true;
+            }
+
+        private:
+            static int WriteCallback(const uint8_t* data, size_t size, const WebPPicture* picture)
+            {
+                std::vector<unsigned char> *p = (std::vector<unsigned char>*)picture->custom_ptr;
+                p->insert(p->end(), data, data + size);
+                return 1;
+            }
+
+            WebPConfig m_config;
+            WebPPicture m_picture;
+        };
+#endif
+
+        ImageEncoder* ImageEncoder::Create(const std::string& format)
+        {
+            if (format == "png")
+                return new PngEncoder();
+#ifdef HAS_JPEG
+            if (format == "jpeg" || format == "jpg")
+                return new JpegEncoder();
+#endif
+#ifdef HAS_WEBP
+            if (format == "webp")
+                return new WebPEncoder();
+#endif
+            return nullptr;
+        }
+
+        bool ImageEncoder::IsSupported(const std::string& format)
+        {
+            if (format == "png")
+                return true;
+#ifdef HAS_JPEG
+            if (format == "jpeg" || format == "jpg")
+                return true;
+#endif
+#ifdef HAS_WEBP
+            if (format == "webp")
+                return true;
+#endif
+            return false;
+        }
+
+    } // namespace Plugin
+} // namespace WPEFramework
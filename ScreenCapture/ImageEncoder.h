@@ -0,0 +1,70 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2020 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace WPEFramework
+{
+    namespace Plugin
+    {
+        // How a screenshot is to be encoded
+        struct ImageSettings
+        {
+            ImageSettings() : format("png"), quality(85), compression(6), fast(false) { }
+
+            std::string format;     // png, jpeg or webp
+            int quality;            // jpeg and webp, 1 - 100
+            int compression;        // png zlib level, 0 - 9
+            bool fast;              // png: sub filter and run length only deflate, jpeg: fast DCT, webp: fastest method
+        };
+
+        // Byte order of the 32 bit pixels handed to an encoder
+        enum class PixelOrder
+        {
+            RGBA,
+            BGRA
+        };
+
+        // An encoder is kept across captures, so that its buffers and library state are set up once
+        class ImageEncoder
+        {
+        public:
+            virtual ~ImageEncoder() { }
+
+            // Returns nullptr if the format is unknown or was not built in
+            static ImageEncoder* Create(const std::string& format);
+            static bool IsSupported(const std::string& format);
+
+            virtual const char* ContentType() const = 0;
+            virtual void Configure(const ImageSettings& settings) = 0;
+
+            // Encodes width x height pixels whose rows are pitch bytes apart, straight from
+            // where they are (e.g. a locked surface). out is overwritten but keeps its capacity.
+            virtual bool Encode(const unsigned char* pixels, int width, int height, int pitch, PixelOrder order, std::vector<unsigned char>& out) = 0;
+
+        protected:
+            // Converts one row of pixels to RGBA (alpha) or RGB
+            static void ConvertRow(const unsigned char* in, int width, PixelOrder order, bool alpha, unsigned char* out);
+        };
+
+    } // namespace Plugin
+} // namespace WPEFramework
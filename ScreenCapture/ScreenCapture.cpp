@@ -26,7 +26,6 @@
 #include <nxclient.h>
 #endif
 
-#include <png.h>
 #include <curl/curl.h>
 
 #ifdef HAS_FRAMEBUFFER_API_HEADER
@@ -91,7 +90,24 @@ namespace WPEFramework
             if(parameters.HasLabel("callGUID"))
               callGUID = parameters["callGUID"].String();
 
-            screenShotDispatcher->Schedule( Core::Time::Now().Add(0), ScreenShotJob( this, parameters["url"].String(), callGUID ) );
+            ImageSettings settings;
+            if(parameters.HasLabel("format"))
+              settings.format = parameters["format"].String();
+            if(parameters.HasLabel("quality"))
+              settings.quality = parameters["quality"].Number();
+            if(parameters.HasLabel("compression"))
+              settings.compression = parameters["compression"].Number();
+            if(parameters.HasLabel("fast"))
+              settings.fast = parameters["fast"].Boolean();
+
+            if(!ImageEncoder::IsSupported(settings.format))
+            {
+                response["message"] = "Unsupported image format";
+
+                returnResponse(false);
+            }
+
+            screenShotDispatcher->Schedule( Core::Time::Now().Add(0), ScreenShotJob( this, parameters["url"].String(), callGUID, settings ) );
 
             returnResponse(true);
         }
@@ -104,35 +120,53 @@ namespace WPEFramework
                 return 0;
             }
 
-            m_screenCapture->doUploadScreenCapture(url, callGUID);
+            m_screenCapture->doUploadScreenCapture(url, callGUID, settings);
 
             return 0;
         }
 
-        bool ScreenCapture::doUploadScreenCapture(std::string url, std::string callGUID)
+        ImageEncoder* ScreenCapture::getEncoder(const ImageSettings &settings)
+        {
+            std::unique_ptr<ImageEncoder> &encoder = m_encoders[settings.format];
+
+            if(!encoder)
+                encoder.reset(ImageEncoder::Create(settings.format));
+
+            if(encoder)
+                encoder->Configure(settings);
+
+            return encoder.get();
+        }
+
+        bool ScreenCapture::doUploadScreenCapture(std::string url, std::string callGUID, const ImageSettings &settings)
         {
-            std::vector<unsigned char> png_data;
+            // The output buffer is reused, so a capture normally doesn't need to allocate it again
+            std::vector<unsigned char> &image_data = m_imageData;
+            ImageEncoder *encoder = getEncoder(settings);
             bool got_screenshot = false;
 
-            #ifdef PLATFORM_BROADCOM
-            got_screenshot = getScreenshotNexus(png_data);
-            #endif
+            if(encoder)
+            {
+                #ifdef PLATFORM_BROADCOM
+                got_screenshot = getScreenshotNexus(*encoder, image_data);
+                #endif
 
-            #ifdef PLATFORM_INTEL
-            got_screenshot = getScreenshotIntel(png_data);
-            #endif
+                #ifdef PLATFORM_INTEL
+                got_screenshot = getScreenshotIntel(*encoder, image_data);
+                #endif
 
-            #ifdef HAS_FRAMEBUFFER_API_HEADER
-            got_screenshot = getScreenshotRealtek(png_data);
-            #endif
+                #ifdef HAS_FRAMEBUFFER_API_HEADER
+                got_screenshot = getScreenshotRealtek(*encoder, image_data);
+                #endif
+            }
 
             if(got_screenshot)
             {
                 std::string error_str;
 
-                LOGWARN("uploading %d of png data to '%s'", png_data.size(), url.c_str() );
+                LOGWARN("uploading %d of %s data to '%s'", image_data.size(), settings.format.c_str(), url.c_str() );
 
-                if(uploadDataToUrl(png_data, url.c_str(), error_str))
+                if(uploadDataToUrl(image_data, encoder->ContentType(), url.c_str(), error_str))
                 {
                     JsonObject params;
                     params["status"] = true;
@@ -171,9 +205,8 @@ namespace WPEFramework
         }
 
 #ifdef PLATFORM_INTEL
-        bool ScreenCapture::getScreenshotIntel(std::vector<unsigned char> &png_out_data)
+        bool ScreenCapture::getScreenshotIntel(ImageEncoder &encoder, std::vector<unsigned char> &image_data)
         {
-            int i;
             char *filename = "/proc/gdl/dump/wbp";    //both video and guide graphics, potentially at lower 720x480
 //             char *filename = "/proc/gdl/dump/upp_d"; //graphics only, normally at higher 1280x720
 //             char *filename = "/proc/gdl/dump/upp_a"; //video only, normally at higher 1280x720
@@ -204,27 +237,14 @@ namespace WPEFramework
             }
 
             std::vector<unsigned char> data_v(size);
-            std::vector<unsigned char> new_data_v(size);
 
             unsigned char* data = &data_v[0];
-            unsigned char* new_data = &new_data_v[0];
 
             fread(data, sizeof(unsigned char), size, fp); // read the rest of the data at once
             fclose(fp);
 
-            for(i = 0; i < size; i += 4)
-            {
-                //r and b need swapped?
-                new_data[i+0] = data[i+2];
-                new_data[i+1] = data[i+1];
-                new_data[i+2] = data[i+0];
-                new_data[i+3] = data[i+3];
-            }
-
-            //convert to png
-            saveToPng(new_data, w, h, png_out_data);
-
-            return true;
+            //r and b are swapped, the encoder converts while it reads
+            return encoder.Encode(data, w, h, 4 * w, PixelOrder::BGRA, image_data);
         }
 #endif
 
@@ -254,7 +274,7 @@ namespace WPEFramework
             return true;
         }
 
-        bool ScreenCapture::getScreenshotNexus(std::vector<unsigned char> &png_out_data)
+        bool ScreenCapture::getScreenshotNexus(ImageEncoder &encoder, std::vector<unsigned char> &image_data)
         {
             if(!joinNexus())
             {
@@ -286,9 +306,6 @@ namespace WPEFramework
             //defSurfSettings.pixelFormat = NEXUS_PixelFormat_eA8_R8_G8_B8;
             defSurfSettings.pixelFormat = NEXUS_PixelFormat_eA8_B8_G8_R8;
             int bytesPerPixel = 4;
-            std::vector<unsigned char> data_v(1280 * 720 * 4);
-            unsigned char *bytes = &data_v[0];
-//             unsigned char bytes[1280 * 720 * 4];
 
 
             NEXUS_SurfaceHandle surface = NEXUS_Surface_Create( &defSurfSettings );
@@ -305,6 +322,9 @@ namespace WPEFramework
             NEXUS_SurfaceMemoryProperties properties;
             NEXUS_Surface_GetMemoryProperties(surface, &properties);
 
+            NEXUS_SurfaceStatus status;
+            NEXUS_Surface_GetStatus(surface, &status);
+
             void* pSurfaceMemory;
             err = NEXUS_Surface_Lock(surface, &pSurfaceMemory);
 
@@ -316,11 +336,17 @@ namespace WPEFramework
             }
             else
             {
-                LOGWARN("[SCREENCAP]: locked surface (pSurfaceMemory:%p pixelMemoryOffset:%d w:%d h:%d bpp:%d)",
-                        pSurfaceMemory, properties.pixelMemoryOffset, defSurfSettings.width, defSurfSettings.height, bytesPerPixel);
+                LOGWARN("[SCREENCAP]: locked surface (pSurfaceMemory:%p pixelMemoryOffset:%d w:%d h:%d pitch:%d bpp:%d)",
+                        pSurfaceMemory, properties.pixelMemoryOffset, defSurfSettings.width, defSurfSettings.height, status.pitch, bytesPerPixel);
             }
 
-            memcpy(bytes, (const char*) pSurfaceMemory + properties.pixelMemoryOffset, defSurfSettings.width * defSurfSettings.height * bytesPerPixel);
+            // Encode straight from the locked surface, A8_B8_G8_R8 is R, G, B, A in memory
+            if(!encoder.Encode((const unsigned char*) pSurfaceMemory + properties.pixelMemoryOffset,
+                    defSurfSettings.width, defSurfSettings.height, status.pitch, PixelOrder::RGBA, image_data))
+            {
+                LOGERR("could not encode Nexus screenshot");
+                res = false;
+            }
 
             NEXUS_Surface_Unlock( surface );
 
@@ -335,13 +361,7 @@ namespace WPEFramework
                 return false;
             }
 
-            if(!saveToPng(bytes, defSurfSettings.width, defSurfSettings.height, png_out_data))
-            {
-                LOGERR("could not convert Nexus screenshot to png");
-                return false;
-            }
-            else
-                return true;
+            return true;
         }
 #endif
 
@@ -363,7 +383,7 @@ namespace WPEFramework
             LOGWARN("VNCServerLogMessage called");
         }
 
-        bool ScreenCapture::getScreenshotRealtek(std::vector<unsigned char> &png_out_data)
+        bool ScreenCapture::getScreenshotRealtek(ImageEncoder &encoder, std::vector<unsigned char> &image_data)
         {
             ErrCode err;
             vnc_bool_t result;
@@ -421,9 +441,9 @@ namespace WPEFramework
             if(buffer) {
                 LOGINFO("fbGetFramebuffer=ok"); 
 
-                if(!saveToPng(buffer, w, h, png_out_data))
+                if(!encoder.Encode(buffer, w, h, 4 * w, PixelOrder::RGBA, image_data))
                 {
-                    LOGERR("could not convert Nexus screenshot to png");
+                    LOGERR("could not encode Realtek screenshot");
                     return false;
                 }
                 else
@@ -442,13 +462,7 @@ namespace WPEFramework
         }
 #endif
 
-        static void PngWriteCallback(png_structp  png_ptr, png_bytep data, png_size_t length)
-        {
-            std::vector<unsigned char> *p = (std::vector<unsigned char>*)png_get_io_ptr(png_ptr);
-            p->insert(p->end(), data, data + length);
-        }
-
-        bool ScreenCapture::uploadDataToUrl(std::vector<unsigned char> &data, const char *url, std::string &error_str)
+        bool ScreenCapture::uploadDataToUrl(std::vector<unsigned char> &data, const char *content_type, const char *url, std::string &error_str)
         {
             CURL *curl;
             CURLcode res;
@@ -460,7 +474,7 @@ namespace WPEFramework
                 return false;
             }
 
-            LOGWARN("uploading png data of size %u to '%s'", data.size(), url);
+            LOGWARN("uploading %s data of size %u to '%s'", content_type, data.size(), url);
 
             //init curl
             curl_global_init(CURL_GLOBAL_ALL);
@@ -474,7 +488,7 @@ namespace WPEFramework
 
             //create header
             struct curl_slist *chunk = NULL;
-            chunk = curl_slist_append(chunk, "Content-Type: image/png");
+            chunk = curl_slist_append(chunk, (std::string("Content-Type: ") + content_type).c_str());
 
             //set url and data
             curl_easy_setopt(curl, CURLOPT_URL, url);
@@ -515,91 +529,5 @@ namespace WPEFramework
             return call_succeeded;
         }
 
-        bool ScreenCapture::saveToPng(unsigned char *data, int width, int height, std::vector<unsigned char> &png_out_data)
-        {
-            int bitdepth = 8;
-            int colortype = PNG_COLOR_TYPE_RGBA;
-            int pitch = 4 * width;
-            int transform = PNG_TRANSFORM_IDENTITY;
-
-            int i = 0;
-            int r = 0;
-            png_structp png_ptr = NULL;
-            png_infop info_ptr = NULL;
-            png_bytep* row_pointers = NULL;
-
-            if (NULL == data)
-            {
-                LOGERR("Error: failed to save the png because the given data is NULL.");
-                r = -1;
-                goto error;
-            }
-
-            if (0 == pitch)
-            {
-                LOGERR("Error: failed to save the png because the given pitch is 0.");
-                r = -3;
-                goto error;
-            }
-
-            png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-            if (NULL == png_ptr)
-            {
-                LOGERR("Error: failed to create the png write struct.");
-                r = -5;
-                goto error;
-            }
-
-            info_ptr = png_create_info_struct(png_ptr);
-            if (NULL == info_ptr)
-            {
-                LOGERR("Error: failed to create the png info struct.");
-                r = -6;
-                goto error;
-            }
-
-            png_set_IHDR(png_ptr,
-                            info_ptr,
-                            width,
-                            height,
-                            bitdepth,                 /* e.g. 8 */
-                            colortype,                /* PNG_COLOR_TYPE_{GRAY, PALETTE, RGB, RGB_ALPHA, GRAY_ALPHA, RGBA, GA} */
-                            PNG_INTERLACE_NONE,       /* PNG_INTERLACE_{NONE, ADAM7 } */
-                            PNG_COMPRESSION_TYPE_BASE,
-                            PNG_FILTER_TYPE_BASE);
-
-            row_pointers = (png_bytep*)malloc(sizeof(png_bytep) * height);
-
-            for (i = 0; i < height; ++i)
-                row_pointers[i] = data + i * pitch;
-
-            png_set_write_fn(png_ptr, &png_out_data, PngWriteCallback, NULL);
-            png_set_rows(png_ptr, info_ptr, row_pointers);
-            png_write_png(png_ptr, info_ptr, transform, NULL);
-
-            error:
-
-            if (NULL != png_ptr)
-            {
-
-                if (NULL == info_ptr)
-                {
-                    LOGERR("Error: info ptr is null. not supposed to happen here.\n");
-                }
-
-                png_destroy_write_struct(&png_ptr, &info_ptr);
-                png_ptr = NULL;
-                info_ptr = NULL;
-            }
-
-            if (NULL != row_pointers)
-            {
-                free(row_pointers);
-                row_pointers = NULL;
-            }
-
-            return (r==0);
-        }
-
     } // namespace Plugin
 } // namespace WPEFramework
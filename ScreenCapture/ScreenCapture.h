@@ -19,10 +19,13 @@
 
 #pragma once
 
+#include <map>
+#include <memory>
 #include <mutex>
 #include <vector>
 
 #include "tptimer.h"
+#include "ImageEncoder.h"
 
 #include "Module.h"
 #include "utils.h"
@@ -41,8 +44,8 @@ namespace WPEFramework {
             ScreenShotJob& operator=(const ScreenShotJob& RHS) = delete;
 
         public:
-            ScreenShotJob(WPEFramework::Plugin::ScreenCapture* tpt, std::string _url, std::string _callGUID) : m_screenCapture(tpt), url(_url), callGUID(_callGUID) { }
-            ScreenShotJob(const ScreenShotJob& copy) : m_screenCapture(copy.m_screenCapture), url(copy.url), callGUID(copy.callGUID) { }
+            ScreenShotJob(WPEFramework::Plugin::ScreenCapture* tpt, std::string _url, std::string _callGUID, const ImageSettings& _settings) : m_screenCapture(tpt), url(_url), callGUID(_callGUID), settings(_settings) { }
+            ScreenShotJob(const ScreenShotJob& copy) : m_screenCapture(copy.m_screenCapture), url(copy.url), callGUID(copy.callGUID), settings(copy.settings) { }
             ~ScreenShotJob() {}
 
             inline bool operator==(const ScreenShotJob& RHS) const
@@ -59,6 +62,7 @@ namespace WPEFramework {
             WPEFramework::Plugin::ScreenCapture* m_screenCapture;
             std::string url;
             std::string callGUID;
+            ImageSettings settings;
         };
 
         // This is a server for a JSONRPC communication channel.
@@ -85,21 +89,21 @@ namespace WPEFramework {
             //End methods
 
             #ifdef PLATFORM_BROADCOM
-            bool getScreenshotNexus(std::vector<unsigned char> &png_data);
+            bool getScreenshotNexus(ImageEncoder &encoder, std::vector<unsigned char> &image_data);
             bool joinNexus();
             #endif
 
             #ifdef PLATFORM_INTEL
-            bool getScreenshotIntel(std::vector<unsigned char> &png_data);
+            bool getScreenshotIntel(ImageEncoder &encoder, std::vector<unsigned char> &image_data);
             #endif
 
             #ifdef HAS_FRAMEBUFFER_API_HEADER
-            bool getScreenshotRealtek(std::vector<unsigned char> &png_data);
+            bool getScreenshotRealtek(ImageEncoder &encoder, std::vector<unsigned char> &image_data);
             #endif
 
-            bool saveToPng(unsigned char *bytes, int w, int h, std::vector<unsigned char> &png_out_data);
-            bool uploadDataToUrl(std::vector<unsigned char> &data, const char *url, std::string &error_str);
-            bool doUploadScreenCapture(std::string url, std::string callGUID);
+            ImageEncoder* getEncoder(const ImageSettings &settings);
+            bool uploadDataToUrl(std::vector<unsigned char> &data, const char *content_type, const char *url, std::string &error_str);
+            bool doUploadScreenCapture(std::string url, std::string callGUID, const ImageSettings &settings);
 
         public:
             ScreenCapture();
@@ -112,6 +116,10 @@ namespace WPEFramework {
 
             WPEFramework::Core::TimerType<ScreenShotJob> *screenShotDispatcher;
 
+            // Only used from the dispatcher thread, kept across captures
+            std::map<std::string, std::unique_ptr<ImageEncoder>> m_encoders;
+            std::vector<unsigned char> m_imageData;
+
             #ifdef PLATFORM_BROADCOM
             bool inNexus;
             #endif
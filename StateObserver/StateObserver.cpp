@@ -32,6 +32,7 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <thread>
 
 #include "StateObserver.h"
 #include "libIARM.h"
@@ -60,11 +61,148 @@ namespace WPEFramework {
 
 		std::vector<string> registeredPropertyNames;
 
+		namespace {
+
+			enum StateProperty {
+				PROPERTY_CHANNEL_MAP = 0,
+				PROPERTY_CARD_DISCONNECTED,
+				PROPERTY_TUNE_READY,
+				PROPERTY_EXIT_OK,
+				PROPERTY_CMAC,
+				PROPERTY_MOTO_ENTITLEMENT,
+				PROPERTY_DAC_INIT_TIMESTAMP,
+				PROPERTY_CARD_SERIAL_NO,
+				PROPERTY_STB_SERIAL_NO,
+				PROPERTY_ECM_MAC,
+				PROPERTY_MOTO_HRV_RX,
+				PROPERTY_CARD_CISCO_STATUS,
+				PROPERTY_VIDEO_PRESENTING,
+				PROPERTY_HDMI_OUT,
+				PROPERTY_HDCP_ENABLED,
+				PROPERTY_HDMI_EDID_READ,
+				PROPERTY_FIRMWARE_DWNLD,
+				PROPERTY_TIME_SOURCE,
+				PROPERTY_TIME_ZONE,
+				PROPERTY_CA_SYSTEM,
+				PROPERTY_ESTB_IP,
+				PROPERTY_ECM_IP,
+				PROPERTY_LAN_IP,
+				PROPERTY_DOCSIS,
+				PROPERTY_DSG_CA_TUNNEL,
+				PROPERTY_CABLE_CARD,
+				PROPERTY_VOD_AD,
+				PROPERTY_IP_MODE,
+				PROPERTY_COUNT,
+				PROPERTY_INVALID = -1
+			};
+
+			typedef IARM_Bus_SYSMgr_GetSystemStates_Param_t SystemStates;
+			typedef decltype(SystemStates::channel_map) SystemState;
+
+			struct PropertyInfo {
+				const string& name;
+				SystemState SystemStates::* field;
+			};
+
+			// Indexed by StateProperty.
+			const PropertyInfo propertyInfo[PROPERTY_COUNT] = {
+				{ SYSTEM_CHANNEL_MAP, &SystemStates::channel_map },
+				{ SYSTEM_CARD_DISCONNECTED, &SystemStates::disconnect_mgr_state },
+				{ SYSTEM_TUNE_READY, &SystemStates::TuneReadyStatus },
+				{ SYSTEM_EXIT_OK, &SystemStates::exit_ok_key_sequence },
+				{ SYSTEM_CMAC, &SystemStates::cmac },
+				{ SYSTEM_MOTO_ENTITLEMENT, &SystemStates::card_moto_entitlements },
+				{ SYSTEM_DAC_INIT_TIMESTAMP, &SystemStates::dac_init_timestamp },
+				{ SYSTEM_CARD_SERIAL_NO, &SystemStates::card_serial_no },
+				{ SYSTEM_STB_SERIAL_NO, &SystemStates::stb_serial_no },
+				{ SYSTEM_ECM_MAC, &SystemStates::ecm_mac },
+				{ SYSTEM_MOTO_HRV_RX, &SystemStates::card_moto_hrv_rx },
+				{ SYSTEM_CARD_CISCO_STATUS, &SystemStates::card_cisco_status },
+				{ SYSTEM_VIDEO_PRESENTING, &SystemStates::video_presenting },
+				{ SYSTEM_HDMI_OUT, &SystemStates::hdmi_out },
+				{ SYSTEM_HDCP_ENABLED, &SystemStates::hdcp_enabled },
+				{ SYSTEM_HDMI_EDID_READ, &SystemStates::hdmi_edid_read },
+				{ SYSTEM_FIRMWARE_DWNLD, &SystemStates::firmware_download },
+				{ SYSTEM_TIME_SOURCE, &SystemStates::time_source },
+				{ SYSTEM_TIME_ZONE, &SystemStates::time_zone_available },
+				{ SYSTEM_CA_SYSTEM, &SystemStates::ca_system },
+				{ SYSTEM_ESTB_IP, &SystemStates::estb_ip },
+				{ SYSTEM_ECM_IP, &SystemStates::ecm_ip },
+				{ SYSTEM_LAN_IP, &SystemStates::lan_ip },
+				{ SYSTEM_DOCSIS, &SystemStates::docsis },
+				{ SYSTEM_DSG_CA_TUNNEL, &SystemStates::dsg_ca_tunnel },
+				{ SYSTEM_CABLE_CARD, &SystemStates::cable_card },
+				{ SYSTEM_VOD_AD, &SystemStates::vod_ad },
+				{ SYSTEM_IP_MODE, &SystemStates::ip_mode },
+			};
+
+			// FNV-1a with a folded high half; the seed was chosen so that every
+			// name in propertyInfo lands in its own slot of the table.
+			const uint32_t PROPERTY_HASH_SEED = 1890;
+			const uint32_t PROPERTY_HASH_SIZE = 64;
+
+			uint32_t hashPropertyName(const string& name)
+			{
+				uint32_t hash = 2166136261u ^ PROPERTY_HASH_SEED;
+				for (string::const_iterator it = name.begin(); it != name.end(); ++it)
+				{
+					hash ^= static_cast<uint8_t>(*it);
+					hash *= 16777619u;
+				}
+				hash ^= (hash >> 16);
+				return (hash % PROPERTY_HASH_SIZE);
+			}
+
+			class PropertyIndex {
+			public:
+				PropertyIndex()
+				{
+					for (uint32_t slot = 0; slot < PROPERTY_HASH_SIZE; slot++)
+						_slots[slot] = PROPERTY_INVALID;
+					for (int index = 0; index < PROPERTY_COUNT; index++)
+					{
+						uint32_t slot = hashPropertyName(propertyInfo[index].name);
+						if (_slots[slot] != PROPERTY_INVALID)
+							LOGERR("property hash collision between %s and %s", propertyInfo[index].name.c_str(), propertyInfo[_slots[slot]].name.c_str());
+						_slots[slot] = index;
+					}
+				}
+
+				int Lookup(const string& name) const
+				{
+					int index = _slots[hashPropertyName(name)];
+					if ((index != PROPERTY_INVALID) && (propertyInfo[index].name == name))
+						return index;
+					return PROPERTY_INVALID;
+				}
+
+			private:
+				int _slots[PROPERTY_HASH_SIZE];
+			};
+
+			int lookupProperty(const string& name)
+			{
+				static const PropertyIndex index;
+				return index.Lookup(name);
+			}
+
+			template <size_t N>
+			void copyPayload(char (&destination)[N], const char* payload)
+			{
+				strncpy(destination, payload, N - 1);
+				destination[N - 1] = '\0';
+			}
+		}
+
 
 		StateObserver::StateObserver()
 		: AbstractPlugin()
 		, m_apiVersionNumber((uint32_t)-1)
+		, m_snapshotVersion(0)
+		, m_snapshotSeeded(false)
+		, m_updatedByEvent(0)
 		{
+			memset(&m_snapshot, 0, sizeof(m_snapshot));
 			LOGINFO();
 
 			StateObserver::_instance = this;
@@ -108,6 +246,9 @@ namespace WPEFramework {
             {
                 IARM_Result_t res;
 			    IARM_CHECK( IARM_Bus_RegisterEventHandler(IARM_BUS_SYSMGR_NAME, IARM_BUS_SYSMGR_EVENT_SYSTEMSTATE, onReportStateObserverEvents) );
+                // Seed after registering so no event falls in between; states
+                // already updated by an event are kept over the seeded values.
+                seedSnapshot();
             }
 		}
 
@@ -122,6 +263,80 @@ namespace WPEFramework {
             }
 		}
 
+		/**
+		 * @brief This function fetches all system states from SysMgr once and stores them in the snapshot.
+		 * States that an event has already updated are not overwritten.
+		 *
+		 * @return true if the states were fetched.
+		 */
+		bool StateObserver::seedSnapshot()
+		{
+			IARM_Bus_SYSMgr_GetSystemStates_Param_t param;
+			memset(&param, 0, sizeof(param));
+			IARM_Result_t res = IARM_Bus_Call(IARM_BUS_SYSMGR_NAME, IARM_BUS_SYSMGR_API_GetSystemStates, &param, sizeof(param));
+			if (res != IARM_RESULT_SUCCESS)
+			{
+				LOGWARN("IARM_BUS_SYSMGR_API_GetSystemStates failed: %d", res);
+				return false;
+			}
+
+			beginSnapshotUpdate();
+			for (int index = 0; index < PROPERTY_COUNT; index++)
+			{
+				if ((m_updatedByEvent & (1ULL << index)) == 0)
+					m_snapshot.*propertyInfo[index].field = param.*propertyInfo[index].field;
+			}
+			m_snapshotSeeded = true;
+			endSnapshotUpdate(string());
+			return true;
+		}
+
+		/**
+		 * @brief This function copies a consistent view of the snapshot without taking a lock.
+		 *
+		 * param[out] systemStates copy of the system states.
+		 */
+		void StateObserver::readSnapshot(IARM_Bus_SYSMgr_GetSystemStates_Param_t& systemStates)
+		{
+			for (;;)
+			{
+				uint32_t version = m_snapshotVersion.load(std::memory_order_acquire);
+				if (version & 1)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+				memcpy(&systemStates, &m_snapshot, sizeof(systemStates));
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (m_snapshotVersion.load(std::memory_order_relaxed) == version)
+					break;
+			}
+		}
+
+		/**
+		 * @brief This function starts an update of the snapshot; readers retry until endSnapshotUpdate.
+		 */
+		void StateObserver::beginSnapshotUpdate()
+		{
+			m_snapshotLock.lock();
+			m_snapshotVersion.store(m_snapshotVersion.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+		}
+
+		/**
+		 * @brief This function publishes an update of the snapshot.
+		 *
+		 * param[in] propertyName name of the property changed by an event, empty when seeding.
+		 */
+		void StateObserver::endSnapshotUpdate(const string& propertyName)
+		{
+			int index = propertyName.empty() ? PROPERTY_INVALID : lookupProperty(propertyName);
+			if (index != PROPERTY_INVALID)
+				m_updatedByEvent |= (1ULL << index);
+			m_snapshotVersion.store(m_snapshotVersion.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+			m_snapshotLock.unlock();
+		}
+
 		/**
 		 * @brief This function is used to get the state observer plugin  name. The state observer
 		 * plugin name is "com.comcast.stateObserver" .
@@ -296,14 +511,20 @@ namespace WPEFramework {
 				}
 				checkForStandalone = false;
 			}
+			if (!m_snapshotSeeded)
+			{
+				seedSnapshot();
+			}
 			IARM_Bus_SYSMgr_GetSystemStates_Param_t param;
-			IARM_Bus_Call(IARM_BUS_SYSMGR_NAME, IARM_BUS_SYSMGR_API_GetSystemStates, &param, sizeof(param));
+			readSnapshot(param);
 			JsonArray response_arr;
 			for( std::vector<string>::iterator it = pname.begin(); it!= pname.end(); ++it )
 			{
 				string err_str="none";
 				JsonObject devProp;
-				if(*it == SYSTEM_CHANNEL_MAP)
+				switch(lookupProperty(*it))
+				{
+				case PROPERTY_CHANNEL_MAP:
 				{
 					int channelMapState = param.channel_map.state;
 					int channelMapError = param.channel_map.error;
@@ -321,9 +542,9 @@ namespace WPEFramework {
 					}
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-
-				else if(*it == SYSTEM_CARD_DISCONNECTED)
+				case PROPERTY_CARD_DISCONNECTED:
 				{
 					int systemCardState = param.disconnect_mgr_state.state;
 					int systemCardError = param.disconnect_mgr_state.error;
@@ -340,8 +561,9 @@ namespace WPEFramework {
 					}
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it  == SYSTEM_TUNE_READY)
+				case PROPERTY_TUNE_READY:
 				{
 					int tuneReadyState = param.TuneReadyStatus.state;
 					if (stbStandAloneMode)
@@ -352,15 +574,17 @@ namespace WPEFramework {
 					devProp["value"]=tuneReadyState;
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it  == SYSTEM_EXIT_OK)
+				case PROPERTY_EXIT_OK:
 				{
 					devProp["propertyName"]=SYSTEM_EXIT_OK;
 					devProp["value"]=param.exit_ok_key_sequence.state;
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it ==SYSTEM_CMAC )
+				case PROPERTY_CMAC:
 				{
 					devProp["propertyName"]=SYSTEM_CMAC ;
 					devProp["value"]=param.cmac.state;
@@ -370,97 +594,110 @@ namespace WPEFramework {
 					}
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it ==SYSTEM_MOTO_ENTITLEMENT )
+				case PROPERTY_MOTO_ENTITLEMENT:
 				{
 					devProp["propertyName"]=SYSTEM_MOTO_ENTITLEMENT;
 					devProp["value"]=param.card_moto_entitlements.state;
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it == SYSTEM_DAC_INIT_TIMESTAMP)
+				case PROPERTY_DAC_INIT_TIMESTAMP:
 				{
 					devProp["propertyName"]=SYSTEM_DAC_INIT_TIMESTAMP;
 					string dac_init_str(param.dac_init_timestamp.payload);
 					devProp["value"]=dac_init_str;
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it == SYSTEM_CARD_SERIAL_NO )
+				case PROPERTY_CARD_SERIAL_NO:
 				{
 					string card_serial_str(param.card_serial_no.payload);
 					devProp["propertyName"]=SYSTEM_CARD_SERIAL_NO;
 					devProp["value"]=card_serial_str;
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it == SYSTEM_STB_SERIAL_NO )
+				case PROPERTY_STB_SERIAL_NO:
 				{
 					string stb_string(param.stb_serial_no.payload);
 					devProp["propertyName"]=SYSTEM_STB_SERIAL_NO;
 					devProp["value"]=stb_string;
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it ==SYSTEM_ECM_MAC )
+				case PROPERTY_ECM_MAC:
 				{
 					string ecm_mac_str(param.ecm_mac.payload);
 					devProp["propertyName"]=SYSTEM_ECM_MAC;
 					devProp["value"]=ecm_mac_str;
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it == SYSTEM_MOTO_HRV_RX)
+				case PROPERTY_MOTO_HRV_RX:
 				{
 					devProp["propertyName"]=SYSTEM_MOTO_HRV_RX;
 					devProp["value"]=param.card_moto_hrv_rx.state;
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it == SYSTEM_CARD_CISCO_STATUS )
+				case PROPERTY_CARD_CISCO_STATUS:
 				{
 					LOGINFO("property SYSTEM_CARD_CISCO_STATUS \n");
 					devProp["propertyName"]=SYSTEM_CARD_CISCO_STATUS;
 					devProp["value"]=param.card_cisco_status.state;
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it == SYSTEM_VIDEO_PRESENTING)
+				case PROPERTY_VIDEO_PRESENTING:
 				{
 					devProp["propertyName"]=SYSTEM_VIDEO_PRESENTING;
 					devProp["value"]=param.video_presenting.state;
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it == SYSTEM_HDMI_OUT )
+				case PROPERTY_HDMI_OUT:
 				{
 					devProp["propertyName"]=SYSTEM_HDMI_OUT;
 					devProp["value"]=param.hdmi_out.state;
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it == SYSTEM_HDCP_ENABLED )
+				case PROPERTY_HDCP_ENABLED:
 				{
 					devProp["propertyName"]=SYSTEM_HDCP_ENABLED;
 					devProp["value"]=param.hdcp_enabled.state;
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it == SYSTEM_HDMI_EDID_READ )
+				case PROPERTY_HDMI_EDID_READ:
 				{
 					devProp["propertyName"]=SYSTEM_HDMI_EDID_READ;
 					devProp["value"]=param.hdmi_edid_read.state;
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it == SYSTEM_FIRMWARE_DWNLD )
+				case PROPERTY_FIRMWARE_DWNLD:
 				{
 					devProp["propertyName"]=SYSTEM_FIRMWARE_DWNLD;
 					devProp["value"]=param.firmware_download.state;
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it == SYSTEM_TIME_SOURCE)
+				case PROPERTY_TIME_SOURCE:
 				{
 					LOGWARN("%s PropertyName: %s Time source state: %d, time source error: %d",
 						__FUNCTION__,
@@ -480,22 +717,25 @@ namespace WPEFramework {
 					devProp.ToString(json);
 					LOGWARN("%s devProp=%s", __FUNCTION__, json.c_str());
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it == SYSTEM_TIME_ZONE)
+				case PROPERTY_TIME_ZONE:
 				{
 					devProp["propertyName"]=SYSTEM_TIME_ZONE;
 					devProp["value"]=param.time_zone_available.state;
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it == SYSTEM_CA_SYSTEM)
+				case PROPERTY_CA_SYSTEM:
 				{
 					devProp["propertyName"]=SYSTEM_CA_SYSTEM;
 					devProp["value"]=param.ca_system.state;
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it == SYSTEM_ESTB_IP)
+				case PROPERTY_ESTB_IP:
 				{
 					devProp["propertyName"]=SYSTEM_ESTB_IP;
 					devProp["value"]=param.estb_ip.state;
@@ -505,8 +745,9 @@ namespace WPEFramework {
 					}
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it == SYSTEM_ECM_IP)
+				case PROPERTY_ECM_IP:
 				{
 					devProp["propertyName"]=SYSTEM_ECM_IP;
 					devProp["value"]=param.ecm_ip.state;
@@ -516,22 +757,25 @@ namespace WPEFramework {
 					}
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it == SYSTEM_LAN_IP)
+				case PROPERTY_LAN_IP:
 				{
 					devProp["propertyName"]=SYSTEM_LAN_IP;
 					devProp["value"]=param.lan_ip.state;
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it == SYSTEM_DOCSIS)
+				case PROPERTY_DOCSIS:
 				{
 					devProp["propertyName"]=SYSTEM_DOCSIS;
 					devProp["value"]=param.docsis.state;
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it == SYSTEM_DSG_CA_TUNNEL)
+				case PROPERTY_DSG_CA_TUNNEL:
 				{
 					devProp["propertyName"]=SYSTEM_DSG_CA_TUNNEL;
 					devProp["value"]=param.dsg_ca_tunnel.state;
@@ -541,8 +785,9 @@ namespace WPEFramework {
 					}
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it == SYSTEM_CABLE_CARD )
+				case PROPERTY_CABLE_CARD:
 				{
 					devProp["propertyName"]=SYSTEM_CABLE_CARD;
 					devProp["value"]=param.cable_card.state;
@@ -552,15 +797,17 @@ namespace WPEFramework {
 					}
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it == SYSTEM_VOD_AD)
+				case PROPERTY_VOD_AD:
 				{
 					devProp["propertyName"]=SYSTEM_VOD_AD;
 					devProp["value"]=param.vod_ad.state;
 					devProp["error"]=err_str;
 					response_arr.Add(devProp);
+					break;
 				}
-				else if(*it == SYSTEM_IP_MODE)
+				case PROPERTY_IP_MODE:
 				{
 					int ipState=param.ip_mode.state;
 					int ipError=param.ip_mode.error;
@@ -568,17 +815,18 @@ namespace WPEFramework {
 					devProp["value"]=ipState;
 					devProp["error"]=ipError;
 					response_arr.Add(devProp);
+					break;
 				}
-
-				else
+				default:
 				{
 					LOGINFO("Invalid property Name\n");
 					string res="Invalid property Name";
  					devProp["propertyName"] = *it;
 					devProp["error"]=res;
 					response_arr.Add(devProp);
+					break;
+				}
 				}
-
 			}
 
 			response["properties"]=response_arr;
@@ -715,7 +963,7 @@ namespace WPEFramework {
 		 */
 		void StateObserver::onReportStateObserverEvents(const char *owner, IARM_EventId_t eventId, void *data, size_t len)
 		{
-			IARM_Bus_SYSMgr_GetSystemStates_Param_t systemStates;
+			IARM_Bus_SYSMgr_GetSystemStates_Param_t unused;
 			JsonObject params;
 			int state=0;
 			int error=0;
@@ -737,6 +985,10 @@ namespace WPEFramework {
 					LOGINFO("stateId is %d state is %d error is %d \n",stateId,state,error);
 					LOGINFO("payload is %s\n",payload);
 				#endif
+				StateObserver* observer = StateObserver::_instance;
+				if(observer)
+					observer->beginSnapshotUpdate();
+				IARM_Bus_SYSMgr_GetSystemStates_Param_t& systemStates = observer ? observer->m_snapshot : unused;
 				switch(stateId)
 				{
 
@@ -751,8 +1003,7 @@ namespace WPEFramework {
 						{
 						systemStates.channel_map.state = state;
 						systemStates.channel_map.error = error;
-						memcpy( systemStates.channel_map.payload, payload, sizeof( systemStates.channel_map.payload ) );
-						systemStates.channel_map.payload[ sizeof( systemStates.channel_map.payload ) - 1] = 0;
+						copyPayload(systemStates.channel_map.payload, payload);
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_CHANNEL_MAP,state,error);
 						string payload_str(payload);
@@ -800,8 +1051,7 @@ namespace WPEFramework {
 						{
 						systemStates.dac_init_timestamp.state = state;
 						systemStates.dac_init_timestamp.error = error;
-						strncpy(systemStates.dac_init_timestamp.payload,payload,strlen(payload));
-						systemStates.dac_init_timestamp.payload[strlen(payload)]='\0';
+						copyPayload(systemStates.dac_init_timestamp.payload, payload);
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_DAC_INIT_TIMESTAMP,state,error);
 						string payload_str(payload);
@@ -812,8 +1062,7 @@ namespace WPEFramework {
 					case IARM_BUS_SYSMGR_SYSSTATE_CABLE_CARD_SERIAL_NO:
 						{
 						systemStates.card_serial_no.error =error;
-						strncpy(systemStates.card_serial_no.payload,payload,strlen(payload));
-						systemStates.card_serial_no.payload[strlen(payload)]='\0';
+						copyPayload(systemStates.card_serial_no.payload, payload);
 						params["propertyName"]=SYSTEM_CARD_SERIAL_NO;
 						params["error"]=error;
 						string payload_str(payload);
@@ -824,8 +1073,7 @@ namespace WPEFramework {
 					 case IARM_BUS_SYSMGR_SYSSTATE_STB_SERIAL_NO:
 						{
 						systemStates.stb_serial_no.error =error;
-						strncpy(systemStates.stb_serial_no.payload,payload,strlen(payload));
-						systemStates.stb_serial_no.payload[strlen(payload)]='\0';
+						copyPayload(systemStates.stb_serial_no.payload, payload);
 						params["propertyName"]=SYSTEM_STB_SERIAL_NO;
 						params["error"]=error;
 						string payload_str(payload);
@@ -886,8 +1134,7 @@ namespace WPEFramework {
 						{
 						systemStates.time_zone_available.state = state;
 						systemStates.time_zone_available.error = error;
-						memcpy( systemStates.time_zone_available.payload, payload, sizeof( systemStates.time_zone_available.payload ) );
-						systemStates.time_zone_available.payload[ sizeof( systemStates.time_zone_available.payload ) - 1] = 0;
+						copyPayload(systemStates.time_zone_available.payload, payload);
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_TIME_ZONE,state,error);
 						string payload_str(payload);
@@ -948,8 +1195,7 @@ namespace WPEFramework {
 						{
 						systemStates.vod_ad.state = state;
 						systemStates.vod_ad.error = error;
-						memcpy( systemStates.vod_ad.payload, payload, sizeof( systemStates.vod_ad.payload ) );
-						systemStates.vod_ad.payload[ sizeof( systemStates.vod_ad.payload ) -1 ] =0;
+						copyPayload(systemStates.vod_ad.payload, payload);
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_VOD_AD,state,error);
 						string payload_str(payload);
@@ -960,8 +1206,7 @@ namespace WPEFramework {
 					case IARM_BUS_SYSMGR_SYSSTATE_ECM_MAC:
 						{
 						systemStates.ecm_mac.error =error;
-						strncpy(systemStates.ecm_mac.payload,payload,strlen(payload));
-						systemStates.ecm_mac.payload[strlen(payload)]='\0';
+						copyPayload(systemStates.ecm_mac.payload, payload);
 						params["propertyName"]=SYSTEM_ECM_MAC;
 						params["error"]=error;
 						string payload_str(payload);
@@ -973,8 +1218,7 @@ namespace WPEFramework {
 						{
 						systemStates.ip_mode.state=state;
 						systemStates.ip_mode.error =error;
-						strncpy(systemStates.ip_mode.payload,payload,strlen(payload));
-						systemStates.ip_mode.payload[strlen(payload)]='\0';
+						copyPayload(systemStates.ip_mode.payload, payload);
 						if(StateObserver::_instance)
 							StateObserver::_instance->setProp(params,SYSTEM_IP_MODE,state,error);
 						string payload_str(payload);
@@ -984,6 +1228,8 @@ namespace WPEFramework {
 					default:
 						break;
 				}
+				if(observer)
+					observer->endSnapshotUpdate(params["propertyName"].String());
 
 				//notify the params
 				if(StateObserver::_instance)
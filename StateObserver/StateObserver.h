@@ -31,9 +31,12 @@
 #ifndef STATEOBSERVER_H
 #define STATEOBSERVER_H
 #include <cjson/cJSON.h>
+#include <atomic>
+#include <mutex>
 
 #include "Module.h"
 #include "libIBus.h"
+#include "sysMgr.h"
 #include "utils.h"
 #include "utils.h"
 #include "AbstractPlugin.h"
@@ -121,6 +124,10 @@ namespace WPEFramework {
             uint32_t getRegisteredPropertyNames(const JsonObject &parameters, JsonObject &response);
 			uint32_t getNameWrapper(const JsonObject& parameters, JsonObject& response);
 			void getVal(std::vector<string> pname,JsonObject& response);
+			bool seedSnapshot();
+			void readSnapshot(IARM_Bus_SYSMgr_GetSystemStates_Param_t& systemStates);
+			void beginSnapshotUpdate();
+			void endSnapshotUpdate(const string& propertyName);
 			void InitializeIARM();
 			void DeinitializeIARM();
 			//End methods
@@ -146,6 +153,15 @@ namespace WPEFramework {
 			static StateObserver* _instance;
 		private:
 			uint32_t m_apiVersionNumber;
+
+			// System states kept up to date from IARM_BUS_SYSMGR_EVENT_SYSTEMSTATE so that
+			// getValues never calls into SysMgr. Readers copy it under a sequence lock:
+			// m_snapshotVersion is odd while an update is in progress.
+			IARM_Bus_SYSMgr_GetSystemStates_Param_t m_snapshot;
+			std::atomic<uint32_t> m_snapshotVersion;
+			std::atomic<bool> m_snapshotSeeded;
+			std::mutex m_snapshotLock;
+			uint64_t m_updatedByEvent;
 		};
 
 	} // namespace Plugin
@@ -807,8 +807,10 @@ namespace WPEFramework {
                         int sysStat = system(command.c_str());
                         LOGINFO("system returned %d\n", sysStat);
                         //set values in temp file so they can be restored in receiver restarts / crashes
-                        m_temp_settings.setValue("mode", m_currentMode);
-                        m_temp_settings.setValue("mode_duration", m_remainingDuration);
+                        JsonObject modeSettings;
+                        modeSettings["mode"] = m_currentMode;
+                        modeSettings["mode_duration"] = m_remainingDuration;
+                        m_temp_settings.setValues(modeSettings);
                     } else {
                         LOGWARN("Current mode '%s' not changed", m_currentMode.c_str());
                     }
@@ -0,0 +1,419 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TTSAudioCache.h"
+
+#include <curl/curl.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TTS_AUDIO_FETCH_WORKERS 2
+#define TTS_AUDIO_CACHE_DEFAULT_BYTES (4 * 1024 * 1024)
+#define TTS_AUDIO_CACHE_DEFAULT_DISK_BYTES (16 * 1024 * 1024)
+#define TTS_AUDIO_FETCH_CONNECT_TIMEOUT 10
+
+namespace TTS {
+
+static std::string stringFromEnv(const char *env) {
+    const char *value = getenv(env);
+    return value ? value : "";
+}
+
+// --- //
+
+TTSAudio::TTSAudio(const std::string &key, bool persistable) :
+    m_key(key),
+    m_persistable(persistable),
+    m_complete(false),
+    m_failed(false),
+    m_sink(NULL) {}
+
+TTSAudio::~TTSAudio() {}
+
+size_t TTSAudio::size() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_data.size();
+}
+
+void TTSAudio::attach(TTSAudioSink *sink) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(!m_data.empty())
+        sink->audioData(m_data.data(), m_data.size());
+
+    if(m_complete || m_failed)
+        sink->audioEnd(m_failed);
+    else
+        m_sink = sink;
+}
+
+void TTSAudio::detach() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_sink = NULL;
+}
+
+void TTSAudio::append(const uint8_t *data, size_t length) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_data.insert(m_data.end(), data, data + length);
+    if(m_sink)
+        m_sink->audioData(data, length);
+}
+
+void TTSAudio::finish(bool failed) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_complete = !failed;
+    m_failed = failed;
+    if(m_sink)
+        m_sink->audioEnd(failed);
+    m_sink = NULL;
+}
+
+// --- //
+
+TTSAudioCache::TTSAudioCache() :
+    m_running(true),
+    m_maxBytes(INT_FROM_ENV("TTS_AUDIO_CACHE_BYTES", TTS_AUDIO_CACHE_DEFAULT_BYTES)),
+    m_bytes(0),
+    m_diskPath(stringFromEnv("TTS_AUDIO_CACHE_DIR")),
+    m_maxDiskBytes(INT_FROM_ENV("TTS_AUDIO_CACHE_DISK_BYTES", TTS_AUDIO_CACHE_DEFAULT_DISK_BYTES)),
+    m_diskBytes(0) {
+    scanDisk();
+
+    for(int i = 0; i < TTS_AUDIO_FETCH_WORKERS; i++)
+        m_workers.push_back(std::thread(&TTSAudioCache::fetcherLoop, this));
+
+    TTSLOG_INFO("Audio cache of %zu bytes, disk cache \"%s\" of %zu bytes",
+            m_maxBytes, m_diskPath.c_str(), m_maxDiskBytes);
+}
+
+TTSAudioCache::~TTSAudioCache() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+        m_condition.notify_all();
+    }
+
+    for(auto &worker : m_workers)
+        worker.join();
+
+    // Whoever still waits for a fetch that never started must not wait forever
+    for(auto &pending : m_pending)
+        pending.first->finish(true);
+}
+
+std::shared_ptr<TTSAudio> TTSAudioCache::acquire(const std::string &url, bool persistable) {
+    return request(url, persistable, true);
+}
+
+void TTSAudioCache::prefetch(const std::string &url, bool persistable) {
+    if(!url.empty())
+        request(url, persistable, false);
+}
+
+void TTSAudioCache::cancelPrefetch() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_pending.begin();
+    while(it != m_pending.end()) {
+        if(it->second) {
+            TTSLOG_VERBOSE("Dropping prefetch of \"%s\"", it->first->key().c_str());
+            m_inFlight.erase(it->first->key());
+            it = m_pending.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+std::shared_ptr<TTSAudio> TTSAudioCache::request(const std::string &url, bool persistable, bool urgent) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto cached = m_index.find(url);
+    if(cached != m_index.end()) {
+        m_lru.splice(m_lru.begin(), m_lru, cached->second);
+        TTSLOG_VERBOSE("Audio cache hit for \"%s\"", url.c_str());
+        return *cached->second;
+    }
+
+    auto inFlight = m_inFlight.find(url);
+    if(inFlight != m_inFlight.end()) {
+        std::shared_ptr<TTSAudio> audio = inFlight->second;
+
+        // Someone waits for it now, so if it did not start yet, it goes first
+        if(urgent) {
+            for(auto it = m_pending.begin(); it != m_pending.end(); ++it) {
+                if(it->first == audio) {
+                    m_pending.erase(it);
+                    m_pending.push_front(std::make_pair(audio, false));
+                    break;
+                }
+            }
+        }
+        return audio;
+    }
+
+    std::shared_ptr<TTSAudio> audio = std::make_shared<TTSAudio>(url, persistable);
+    m_inFlight[url] = audio;
+    if(urgent)
+        m_pending.push_front(std::make_pair(audio, false));
+    else
+        m_pending.push_back(std::make_pair(audio, true));
+    m_condition.notify_one();
+
+    return audio;
+}
+
+void TTSAudioCache::fetcherLoop() {
+    while(true) {
+        std::shared_ptr<TTSAudio> audio;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] () { return !m_running || !m_pending.empty(); });
+
+            if(!m_running)
+                return;
+
+            audio = m_pending.front().first;
+            m_pending.pop_front();
+        }
+
+        bool ok = loadFromDisk(*audio) || fetch(*audio);
+
+        if(ok)
+            store(audio);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_inFlight.erase(audio->key());
+        }
+
+        audio->finish(!ok);
+    }
+}
+
+void TTSAudioCache::store(std::shared_ptr<TTSAudio> audio) {
+    std::vector<std::shared_ptr<TTSAudio>> evicted;
+    size_t size = audio->size();
+
+    if(size == 0 || size > m_maxBytes)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if(m_index.find(audio->key()) != m_index.end())
+            return;
+
+        m_lru.push_front(audio);
+        m_index[audio->key()] = m_lru.begin();
+        m_bytes += size;
+
+        while(m_bytes > m_maxBytes && m_lru.size() > 1) {
+            std::shared_ptr<TTSAudio> oldest = m_lru.back();
+            m_bytes -= oldest->size();
+            m_index.erase(oldest->key());
+            m_lru.pop_back();
+            evicted.push_back(oldest);
+        }
+    }
+
+    // The disk is only touched outside the cache lock
+    for(auto &audio : evicted) {
+        if(audio->isPersistable())
+            spillToDisk(*audio);
+    }
+}
+
+size_t TTSAudioCache::curlWrite(char *ptr, size_t size, size_t nmemb, void *userdata) {
+    TTSAudio *audio = (TTSAudio*) userdata;
+    audio->append((const uint8_t*) ptr, size * nmemb);
+    return size * nmemb;
+}
+
+int TTSAudioCache::curlProgress(void *clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+    TTSAudioCache *cache = (TTSAudioCache*) clientp;
+    // Non zero aborts the transfer
+    return cache->m_running ? 0 : 1;
+}
+
+bool TTSAudioCache::fetch(TTSAudio &audio) {
+    CURL *curl = curl_easy_init();
+    if(!curl) {
+        TTSLOG_ERROR("Could not create a curl handle");
+        return false;
+    }
+
+    curl_easy_setopt(curl, CURLOPT_URL, audio.key().c_str());
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, (long) TTS_AUDIO_FETCH_CONNECT_TIMEOUT);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curlWrite);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &audio);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, curlProgress);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, this);
+
+    CURLcode res = curl_easy_perform(curl);
+    long httpCode = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
+    curl_easy_cleanup(curl);
+
+    if(res != CURLE_OK || httpCode >= 400) {
+        TTSLOG_ERROR("Fetching \"%s\" failed, curl=%d (%s), http=%ld",
+                audio.key().c_str(), res, curl_easy_strerror(res), httpCode);
+        return false;
+    }
+
+    TTSLOG_VERBOSE("Fetched %zu bytes for \"%s\"", audio.size(), audio.key().c_str());
+    return true;
+}
+
+// File names are a hash of the key; the file starts with the key itself, so
+// a collision reads as a miss.
+std::string TTSAudioCache::diskFile(const std::string &key) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for(unsigned char c : key) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.tts", (unsigned long long) hash);
+    return name;
+}
+
+void TTSAudioCache::scanDisk() {
+    if(m_diskPath.empty())
+        return;
+
+    mkdir(m_diskPath.c_str(), 0700);
+
+    DIR *dir = opendir(m_diskPath.c_str());
+    if(!dir) {
+        TTSLOG_WARNING("Audio disk cache \"%s\" is not accessible", m_diskPath.c_str());
+        return;
+    }
+
+    struct dirent *entry;
+    while((entry = readdir(dir)) != NULL) {
+        std::string name(entry->d_name);
+        struct stat st;
+
+        if(name.size() < 4 || name.compare(name.size() - 4, 4, ".tts") != 0)
+            continue;
+
+        if(stat((m_diskPath + "/" + name).c_str(), &st) == 0) {
+            m_diskFiles.push_back(std::make_pair(name, (size_t) st.st_size));
+            m_diskBytes += st.st_size;
+        }
+    }
+    closedir(dir);
+}
+
+bool TTSAudioCache::loadFromDisk(TTSAudio &audio) {
+    if(m_diskPath.empty() || !audio.isPersistable())
+        return false;
+
+    const std::string name = diskFile(audio.key());
+    {
+        std::lock_guard<std::mutex> lock(m_diskMutex);
+        auto it = m_diskFiles.begin();
+        while(it != m_diskFiles.end() && it->first != name)
+            ++it;
+
+        if(it == m_diskFiles.end())
+            return false;
+
+        m_diskFiles.splice(m_diskFiles.end(), m_diskFiles, it);
+    }
+
+    FILE *file = fopen((m_diskPath + "/" + name).c_str(), "rb");
+    if(!file)
+        return false;
+
+    bool ok = false;
+    std::string key(audio.key().size() + 1, '\0');
+    if(fread(&key[0], 1, key.size(), file) == key.size() && key.compare(0, audio.key().size(), audio.key()) == 0 && key.back() == '\n') {
+        std::vector<uint8_t> data;
+        uint8_t chunk[16 * 1024];
+        size_t n;
+        while((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+            data.insert(data.end(), chunk, chunk + n);
+
+        ok = (ferror(file) == 0 && !data.empty());
+        if(ok) {
+            audio.append(data.data(), data.size());
+            TTSLOG_VERBOSE("Loaded %zu bytes for \"%s\" from disk", data.size(), audio.key().c_str());
+        }
+    }
+    fclose(file);
+
+    return ok;
+}
+
+void TTSAudioCache::spillToDisk(TTSAudio &audio) {
+    if(m_diskPath.empty())
+        return;
+
+    const std::string name = diskFile(audio.key());
+    const std::string path = m_diskPath + "/" + name;
+    const std::string temp = path + ".tmp";
+
+    std::lock_guard<std::mutex> lock(m_diskMutex);
+
+    for(auto &file : m_diskFiles) {
+        if(file.first == name)
+            return;
+    }
+
+    FILE *file = fopen(temp.c_str(), "wb");
+    if(!file) {
+        TTSLOG_WARNING("Could not spill audio to \"%s\"", temp.c_str());
+        return;
+    }
+
+    bool ok;
+    {
+        std::lock_guard<std::mutex> dataLock(audio.m_mutex);
+        ok = (fwrite(audio.m_key.data(), 1, audio.m_key.size(), file) == audio.m_key.size()) &&
+             (fputc('\n', file) != EOF) &&
+             (fwrite(audio.m_data.data(), 1, audio.m_data.size(), file) == audio.m_data.size());
+    }
+    ok = (fclose(file) == 0) && ok;
+
+    if(!ok || rename(temp.c_str(), path.c_str()) != 0) {
+        unlink(temp.c_str());
+        return;
+    }
+
+    size_t size = audio.m_key.size() + 1 + audio.size();
+    m_diskFiles.push_back(std::make_pair(name, size));
+    m_diskBytes += size;
+
+    while(m_diskBytes > m_maxDiskBytes && m_diskFiles.size() > 1) {
+        unlink((m_diskPath + "/" + m_diskFiles.front().first).c_str());
+        m_diskBytes -= m_diskFiles.front().second;
+        m_diskFiles.pop_front();
+    }
+}
+
+} // namespace TTS
@@ -0,0 +1,142 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _TTS_AUDIO_CACHE_H_
+#define _TTS_AUDIO_CACHE_H_
+
+#include <list>
+#include <deque>
+#include <utility>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include <condition_variable>
+
+#include <curl/curl.h>
+
+#include "TTSCommon.h"
+
+// --- //
+
+namespace TTS {
+
+// Receives the audio of one utterance while it is being fetched.
+class TTSAudioSink {
+public:
+    virtual ~TTSAudioSink() {}
+    virtual void audioData(const uint8_t *data, size_t length) = 0;
+    virtual void audioEnd(bool failed) = 0;
+};
+
+// The synthesized (encoded) audio for one request URL. It fills up while it
+// is fetched; once complete it is immutable and can be shared by any number
+// of players.
+class TTSAudio {
+public:
+    TTSAudio(const std::string &key, bool persistable);
+    ~TTSAudio();
+
+    const std::string &key() const { return m_key; }
+    bool isPersistable() const { return m_persistable; }
+    size_t size();
+
+    // Replays what was fetched so far to the sink and streams the rest to it.
+    // No sink call is made after detach() returns.
+    void attach(TTSAudioSink *sink);
+    void detach();
+
+private:
+    friend class TTSAudioCache;
+
+    void append(const uint8_t *data, size_t length);
+    void finish(bool failed);
+
+    const std::string m_key;
+    const bool m_persistable;
+    std::mutex m_mutex;
+    std::vector<uint8_t> m_data;
+    bool m_complete;
+    bool m_failed;
+    TTSAudioSink *m_sink;
+};
+
+// Content addressed cache of synthesized audio, keyed on the request URL
+// (endpoint, voice, language, rate and text). Recently used audio is kept
+// in memory within a byte budget; what falls out is optionally spilled to
+// disk. Fetches run on a small set of worker threads so the next utterance
+// can be prefetched while the current one plays.
+class TTSAudioCache {
+public:
+    TTSAudioCache();
+    ~TTSAudioCache();
+
+    // Returns the audio for the URL, starting (or expediting) its fetch if needed.
+    std::shared_ptr<TTSAudio> acquire(const std::string &url, bool persistable);
+    // Starts fetching the URL in the background, unless it is cached or already underway.
+    void prefetch(const std::string &url, bool persistable);
+    // Forgets prefetches that have not started yet.
+    void cancelPrefetch();
+
+private:
+    typedef std::list<std::shared_ptr<TTSAudio>> AudioList;
+
+    std::shared_ptr<TTSAudio> request(const std::string &url, bool persistable, bool urgent);
+    void fetcherLoop();
+    bool fetch(TTSAudio &audio);
+    void store(std::shared_ptr<TTSAudio> audio);
+
+    // Disk spill
+    std::string diskFile(const std::string &key);
+    void scanDisk();
+    bool loadFromDisk(TTSAudio &audio);
+    void spillToDisk(TTSAudio &audio);
+
+    static size_t curlWrite(char *ptr, size_t size, size_t nmemb, void *userdata);
+    static int curlProgress(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::atomic<bool> m_running;
+    std::vector<std::thread> m_workers;
+
+    // Memory cache, most recently used first
+    const size_t m_maxBytes;
+    size_t m_bytes;
+    AudioList m_lru;
+    std::unordered_map<std::string, AudioList::iterator> m_index;
+
+    // Fetches not started yet (m_pending, flagged when only prefetched) and not finished yet (m_inFlight)
+    std::deque<std::pair<std::shared_ptr<TTSAudio>, bool>> m_pending;
+    std::unordered_map<std::string, std::shared_ptr<TTSAudio>> m_inFlight;
+
+    // Disk cache, least recently used first
+    std::mutex m_diskMutex;
+    const std::string m_diskPath;
+    const size_t m_maxDiskBytes;
+    size_t m_diskBytes;
+    std::list<std::pair<std::string, size_t>> m_diskFiles;
+};
+
+} // namespace TTS
+
+#endif
@@ -23,6 +23,8 @@
 #include "utils.h"
 #include "logger.h"
 
+#define INT_FROM_ENV(env, default_value) ((getenv(env) ? atoi(getenv(env)) : 0) > 0 ? atoi(getenv(env)) : default_value)
+
 namespace TTS {
 
     enum SpeechState {
@@ -23,8 +23,6 @@
 #include <unistd.h>
 #include <regex>
 
-#define INT_FROM_ENV(env, default_value) ((getenv(env) ? atoi(getenv(env)) : 0) > 0 ? atoi(getenv(env)) : default_value)
-
 namespace TTS {
 
 std::map<std::string, std::string> TTSConfiguration::m_others;
@@ -285,14 +283,56 @@ void TTSSpeaker::setSpeakingState(bool state, TTSSpeakerClient *client) {
 }
 
 void TTSSpeaker::queueData(SpeechData data) {
-    std::lock_guard<std::mutex> lock(m_queueMutex);
-    m_queue.push_back(data);
-    m_condition.notify_one();
+    bool prefetch = false;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_queue.push_back(data);
+        // While speaking, the first queued item is the next one to be spoken
+        prefetch = (m_isSpeaking && m_queue.size() == 1);
+        m_condition.notify_one();
+    }
+
+    if(prefetch)
+        prefetchNext();
 }
 
 void TTSSpeaker::flushQueue() {
-    std::lock_guard<std::mutex> lock(m_queueMutex);
-    m_queue.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_queue.clear();
+    }
+    m_audioCache.cancelPrefetch();
+}
+
+void TTSSpeaker::prefetchNext() {
+    SpeechData next;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        if(m_queue.empty())
+            return;
+        next = m_queue.front();
+    }
+
+    TTSLOG_VERBOSE("Prefetching speech %d", next.id);
+    m_audioCache.prefetch(constructURL(*next.client->configuration(), next), !next.secure);
+}
+
+void TTSSpeaker::audioData(const uint8_t *data, size_t length) {
+    GstBuffer *buffer = gst_buffer_new_allocate(NULL, length, NULL);
+    gst_buffer_fill(buffer, 0, data, length);
+    // appsrc takes ownership of the buffer
+    gst_app_src_push_buffer(GST_APP_SRC(m_source), buffer);
+}
+
+void TTSSpeaker::audioEnd(bool failed) {
+    if(failed) {
+        TTSLOG_ERROR("Fetching the speech audio failed");
+        m_networkError = true;
+        m_pipelineError = true;
+        m_condition.notify_one();
+    } else {
+        gst_app_src_end_of_stream(GST_APP_SRC(m_source));
+    }
 }
 
 SpeechData TTSSpeaker::dequeueData() {
@@ -304,45 +344,6 @@ SpeechData TTSSpeaker::dequeueData() {
     return d;
 }
 
-bool TTSSpeaker::waitForStatus(GstState expected_state, uint32_t timeout_ms) {
-    // wait for the pipeline to get to pause so we know we have the audio device
-    if(m_pipeline) {
-        GstState state;
-        GstState pending;
-
-        auto timeout = std::chrono::system_clock::now() + std::chrono::milliseconds(timeout_ms);
-
-        do {
-            std::unique_lock<std::mutex> mlock(m_queueMutex);
-            m_condition.wait_until(mlock, timeout, [this, &state, &pending, expected_state] () {
-                    // Speaker has flushed the data, no need wait for the completion
-                    // must break and reset the pipeline
-                    if(m_flushed) {
-                        TTSLOG_VERBOSE("Bailing out because of forced text queue (m_flushed=true)");
-                        return true;
-                    }
-
-                    gst_element_get_state(m_pipeline, &state, &pending, GST_CLOCK_TIME_NONE);
-                    if(state == expected_state)
-                        return true;
-
-                    return false;
-                });
-        } while(!m_flushed && state != expected_state && timeout > std::chrono::system_clock::now());
-
-        if(state == expected_state) {
-            TTSLOG_VERBOSE("Got Status : expected_state = %d, new_state = %d", expected_state, state);
-            return true;
-        }
-
-        TTSLOG_WARNING("Timed Out waiting for state %s, currentState %s",
-                gst_element_state_get_name(expected_state), gst_element_state_get_name(state));
-        return false;
-    }
-
-    return true;
-}
-
 // GStreamer Releated members
 void TTSSpeaker::createPipeline() {
     m_isEOS = false;
@@ -360,7 +361,8 @@ void TTSSpeaker::createPipeline() {
         return;
     }
 
-    m_source = gst_element_factory_make("souphttpsrc", NULL);
+    // Audio is fetched (or taken from the cache) by m_audioCache and pushed in here
+    m_source = gst_element_factory_make("appsrc", NULL);
 
     // create soc specific elements
 #if defined(PLATFORM_BROADCOM)
@@ -374,24 +376,14 @@ void TTSSpeaker::createPipeline() {
     m_audioSink = gst_element_factory_make("amlhalasink", NULL);
 #endif
 
-    std::string tts_url =
-        !m_defaultConfig.secureEndPoint().empty() ? m_defaultConfig.secureEndPoint() : m_defaultConfig.endPoint();
-    if(!tts_url.empty()) {
-        if(!m_defaultConfig.voice().empty()) {
-            tts_url.append("voice=");
-            tts_url.append(m_defaultConfig.voice());
-        }
-
-        if(!m_defaultConfig.language().empty()) {
-            tts_url.append("&language=");
-            tts_url.append(m_defaultConfig.language());
-        }
-
-        tts_url.append("&text=init");
-        curlSanitize(tts_url);
-
-        g_object_set(G_OBJECT(m_source), "location", tts_url.c_str(), NULL);
-    }
+    GstCaps *caps = gst_caps_new_simple("audio/mpeg", "mpegversion", G_TYPE_INT, 1, NULL);
+    g_object_set(G_OBJECT(m_source),
+            "caps", caps,
+            "format", GST_FORMAT_BYTES,
+            "stream-type", GST_APP_STREAM_TYPE_STREAM,
+            "max-bytes", (guint64) 0,
+            NULL);
+    gst_caps_unref(caps);
 
     // set the TTS volume to max.
     g_object_set(G_OBJECT(m_audioSink), "volume", (double) (m_defaultConfig.volume() / MAX_VOLUME), NULL);
@@ -425,16 +417,19 @@ void TTSSpeaker::createPipeline() {
     gst_object_unref(bus);
 
     m_pipelineConstructionFailures = 0;
+    m_pipelineError = false;
+    m_networkError = false;
+    m_isPaused = false;
 
-    // wait until pipeline is set to NULL state
-    resetPipeline();
+    // Bring the decoder and sink up now and keep them there, so that an
+    // utterance only has to push its audio. The pipeline completes its
+    // preroll once the first buffer arrives.
+    gst_element_set_state(m_pipeline, GST_STATE_PAUSED);
 }
 
 void TTSSpeaker::resetPipeline() {
-    TTSLOG_WARNING("Resetting Pipeline...");
-
     // Detect pipe line error and destroy the pipeline if any
-    if(m_pipelineError) {
+    if(m_pipelineError && !m_networkError) {
         TTSLOG_WARNING("Pipeline error occured, attempting to recover by re-creating pipeline");
 
         // Try to recover from errors by destroying the pipeline
@@ -445,22 +440,40 @@ void TTSSpeaker::resetPipeline() {
     m_isPaused = false;
     m_isEOS = false;
 
-    if(!m_pipeline) {
-        // If pipe line is NULL, create one
+    // If pipe line is NULL, create one
+    if(!m_pipeline)
         createPipeline();
-    } else {
-        // If pipeline is present, bring it to NULL state
-        gst_element_set_state(m_pipeline, GST_STATE_NULL);
-        while(!waitForStatus(GST_STATE_NULL, 60*1000));
+}
+
+void TTSSpeaker::flushPipeline() {
+    // Restarting appsrc clears its end of stream and whatever was left queued
+    gst_element_set_state(m_source, GST_STATE_READY);
+
+    // Flush the decoder and the sink so they take a new stream and reset the running time
+    GstPad *srcPad = gst_element_get_static_pad(m_source, "src");
+    GstPad *peerPad = gst_pad_get_peer(srcPad);
+    if(peerPad) {
+        gst_pad_send_event(peerPad, gst_event_new_flush_start());
+        gst_pad_send_event(peerPad, gst_event_new_flush_stop(TRUE));
+        gst_object_unref(peerPad);
     }
+    gst_object_unref(srcPad);
+
+    // Messages of the previous utterance are stale now, a late EOS would end this one early
+    GstBus *bus = gst_element_get_bus(m_pipeline);
+    gst_bus_set_flushing(bus, TRUE);
+    gst_bus_set_flushing(bus, FALSE);
+    gst_object_unref(bus);
+
+    gst_element_sync_state_with_parent(m_source);
 }
 
 void TTSSpeaker::destroyPipeline() {
     TTSLOG_WARNING("Destroying Pipeline...");
 
     if(m_pipeline) {
+        // Going down to NULL always completes synchronously
         gst_element_set_state(m_pipeline, GST_STATE_NULL);
-        waitForStatus(GST_STATE_NULL, 1*1000);
         g_source_remove(m_busWatch);
         gst_object_unref(m_pipeline);
     }
@@ -517,9 +530,10 @@ void TTSSpeaker::waitForAudioToFinishTimeout(float timeout_s) {
     TTSLOG_INFO("m_isEOS=%d, m_pipeline=%p, m_pipelineError=%d, m_flushed=%d",
             m_isEOS, m_pipeline, m_pipelineError, m_flushed);
 
-    // Irrespective of EOS / Timeout reset pipeline
+    // Irrespective of EOS / Timeout stop playing, but keep the pipeline
+    // prerolled for the next utterance
     if(m_pipeline)
-        gst_element_set_state(m_pipeline, GST_STATE_NULL);
+        gst_element_set_state(m_pipeline, GST_STATE_PAUSED);
 
     if(!m_isEOS)
         TTSLOG_ERROR("Stopped waiting for audio to finish without hitting EOS!");
@@ -651,14 +665,30 @@ void TTSSpeaker::speakText(TTSConfiguration config, SpeechData &data) {
     if(m_pipeline && !m_pipelineError && !m_flushed) {
         m_currentSpeech = &data;
 
-        g_object_set(G_OBJECT(m_source), "location", constructURL(config, data).c_str(), NULL);
+        std::string url = constructURL(config, data);
+        if(url.empty()) {
+            m_pipelineError = true;
+            m_currentSpeech = NULL;
+            return;
+        }
+
+        // Cached (or prefetched) audio is available right away, otherwise this starts the fetch
+        m_currentAudio = m_audioCache.acquire(url, !data.secure);
+
+        // Drop what is left of the previous utterance
+        flushPipeline();
+
         // PCM Sink seems to be accepting volume change before PLAYING state
         g_object_set(G_OBJECT(m_audioSink), "volume", (double) (data.client->configuration()->volume() / MAX_VOLUME), NULL);
         gst_element_set_state(m_pipeline, GST_STATE_PLAYING);
+        m_currentAudio->attach(this);
         TTSLOG_VERBOSE("Speaking.... ( %d, \"%s\")", data.id, data.text.c_str());
 
         //Wait for EOS with a timeout incase EOS never comes
         waitForAudioToFinishTimeout(10);
+
+        m_currentAudio->detach();
+        m_currentAudio.reset();
     } else {
         TTSLOG_WARNING("m_pipeline=%p, m_pipelineError=%d", m_pipeline, m_pipelineError);
     }
@@ -706,10 +736,8 @@ void TTSSpeaker::GStreamerThreadFunc(void *ctx) {
 
         // Stop thread on Speaker's cue
         if(!speaker->m_runThread) {
-            if(speaker->m_pipeline) {
+            if(speaker->m_pipeline)
                 gst_element_set_state(speaker->m_pipeline, GST_STATE_NULL);
-                speaker->waitForStatus(GST_STATE_NULL, 1*1000);
-            }
             TTSLOG_INFO("Stopping GStreamerThread");
             return;
         }
@@ -722,6 +750,9 @@ void TTSSpeaker::GStreamerThreadFunc(void *ctx) {
         SpeechData data = speaker->dequeueData();
 
         speaker->setSpeakingState(true, data.client);
+
+        // Fetch the next utterance while this one plays
+        speaker->prefetchNext();
         // Inform the client before speaking
         if(!speaker->m_flushed)
             data.client->willSpeak(data.id, data.text);
@@ -742,7 +773,7 @@ void TTSSpeaker::GStreamerThreadFunc(void *ctx) {
             data.client->spoke(data.id, data.text);
         speaker->setSpeakingState(false);
 
-        // stop the pipeline until the next tts string...
+        // The pipeline stays up for the next tts string, unless it failed
         speaker->resetPipeline();
     }
 
@@ -768,9 +799,6 @@ bool TTSSpeaker::handleMessage(GstMessage *message) {
                 gst_message_parse_error(message, &error, &debug);
                 TTSLOG_ERROR("error! code: %d, %s, Debug: %s", error->code, error->message, debug);
                 GST_DEBUG_BIN_TO_DOT_FILE_WITH_TS(GST_BIN(m_pipeline), GST_DEBUG_GRAPH_SHOW_ALL, "error-pipeline");
-                std::string source = GST_MESSAGE_SRC_NAME(message);
-                if(source.find("souphttpsrc") == 0)
-                    m_networkError = true;
                 m_pipelineError = true;
                 m_condition.notify_one();
             }
@@ -23,6 +23,7 @@
 #include <gst/gst.h>
 #include <gst/audio/audio.h>
 #include <gst/app/gstappsink.h>
+#include <gst/app/gstappsrc.h>
 
 #include <map>
 #include <list>
@@ -32,6 +33,7 @@
 #include <condition_variable>
 
 #include "TTSCommon.h"
+#include "TTSAudioCache.h"
 
 // --- //
 
@@ -111,7 +113,7 @@ struct SpeechData {
         std::string text;
 };
 
-class TTSSpeaker {
+class TTSSpeaker : public TTSAudioSink {
 public:
     TTSSpeaker(TTSConfiguration &config);
     ~TTSSpeaker();
@@ -145,6 +147,13 @@ private:
     void queueData(SpeechData);
     void flushQueue();
     SpeechData dequeueData();
+    void prefetchNext();
+
+    // Synthesized audio, fetched ahead of playback where possible
+    TTSAudioCache m_audioCache;
+    std::shared_ptr<TTSAudio> m_currentAudio;
+    void audioData(const uint8_t *data, size_t length) override;
+    void audioEnd(bool failed) override;
 
     // Private functions
     inline void setSpeakingState(bool state, TTSSpeakerClient *client=NULL);
@@ -172,6 +181,7 @@ private:
     static void GStreamerThreadFunc(void *ctx);
     void createPipeline();
     void resetPipeline();
+    void flushPipeline();
     void destroyPipeline();
 
     // GStreamer Helper functions
@@ -183,7 +193,6 @@ private:
     void curlSanitize(std::string &url);
     void sanitizeString(std::string &input, std::string &sanitizedString);
     void speakText(TTSConfiguration config, SpeechData &data);
-    bool waitForStatus(GstState expected_state, uint32_t timeout_ms);
     void waitForAudioToFinishTimeout(float timeout_s);
     bool handleMessage(GstMessage*);
     static int GstBusCallback(GstBus *bus, GstMessage *message, gpointer data);
@@ -27,6 +27,8 @@
 
 #include "utils.h"
 
+#include <cmath>
+
 // Methods
 #define TIMER_METHOD_START_TIMER          "startTimer"
 #define TIMER_METHOD_CANCEL               "cancel"
@@ -41,6 +43,11 @@
 
 #define TIMER_ACCURACY 0.001 // 10 milliseconds
 
+// Canceled and expired timers kept queryable before their ids are reused.
+#define TIMER_RETAINED_FINISHED 64
+// Invalidated heap entries tolerated on top of the running timers before the heap is rebuilt.
+#define TIMER_STALE_DEADLINES_LIMIT 1024
+
 static const char* stateStrings[] = {
     "",
     "RUNNING",
@@ -55,6 +62,26 @@ static const char* modeStrings[] = {
     "WAKE"
 };
 
+static std::chrono::steady_clock::duration toDuration(double seconds)
+{
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+// Seconds as sent by the client, a string holding a non-negative number
+static bool parseSeconds(const std::string& text, double& seconds)
+{
+    try
+    {
+        size_t end = 0;
+        seconds = std::stod(text, &end);
+        return end == text.size() && std::isfinite(seconds) && seconds >= 0.0;
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+}
+
 namespace WPEFramework
 {
     namespace Plugin
@@ -65,6 +92,8 @@ namespace WPEFramework
 
         Timer::Timer()
         : AbstractPlugin()
+        , m_runningCount(0)
+        , m_dispatchStop(false)
         {
             LOGINFO();
             Timer::_instance = this;
@@ -78,90 +107,116 @@ namespace WPEFramework
             registerMethod(TIMER_METHOD_GET_TIMER_STATUS, &Timer::getTimerStatusWrapper, this);
             registerMethod(TIMER_METHOD_GET_TIMERS, &Timer::getTimersWrapper, this);
 
-            m_timer.connect(std::bind(&Timer::onTimerCallback, this));
+            m_dispatchThread = std::thread(&Timer::dispatchLoop, this);
         }
 
         Timer::~Timer()
         {
             LOGINFO();
+            {
+                std::lock_guard<std::mutex> guard(m_callMutex);
+                m_dispatchStop = true;
+            }
+            m_dispatchCondition.notify_all();
+            if (m_dispatchThread.joinable())
+                m_dispatchThread.join();
             Timer::_instance = nullptr;
         }
 
-        void Timer::checkTimers()
+        // Queues the reminder and expiry deadlines of a running timer. m_callMutex must be held.
+        void Timer::scheduleTimer(unsigned int timerId)
         {
-            LOGINFO();
+            TimerItem& item = m_timerItems[timerId];
+            TimerDeadline entry;
+            entry.timerId = timerId;
+            entry.generation = item.generation;
 
-            double minTimeout = 100000;
-            for (auto it = m_runningItems.cbegin(); it != m_runningItems.cend(); ++it)
-            {
-                unsigned int timerId = *it;
-                if (timerId < 0 || timerId >= m_timerItems.size())
-                {
-                    LOGERR("Internal error: wrong timerId");
-                    continue;
-                }
-                if (m_timerItems[timerId].state != RUNNING)
-                {
-                    LOGERR("Internal error: timer %d has wrong state", timerId);
-                    continue;
-                }
+            entry.deadline = item.lastExpired + toDuration(item.interval);
+            entry.type = TIMER_EVENT_EXPIRY;
+            m_deadlines.push(entry);
 
-                std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - m_timerItems[timerId].lastExpired;
-                double timeout =  m_timerItems[timerId].interval - elapsed.count();
+            if (!item.reminderSent && item.remindBefore > TIMER_ACCURACY)
+            {
+                entry.deadline -= toDuration(item.remindBefore);
+                entry.type = TIMER_EVENT_REMINDER;
+                m_deadlines.push(entry);
+            }
 
-                if (!m_timerItems[timerId].reminderSent && m_timerItems[timerId].remindBefore > TIMER_ACCURACY)
-                {
-                    if (timeout > m_timerItems[timerId].remindBefore)
-                    {
-                        timeout -= m_timerItems[timerId].remindBefore;
-                    }
-                    else
-                    {
-                        sendTimerExpiryReminder(timerId);
-                        m_timerItems[timerId].reminderSent = true;
-                    }
-                }
+            m_dispatchCondition.notify_one();
+        }
 
-                if (timeout < minTimeout)
-                    minTimeout = timeout;
+        // Returns the slot of the oldest finished timer once enough of them are retained,
+        // otherwise a new slot. m_callMutex must be held.
+        unsigned int Timer::allocateTimerId()
+        {
+            if (m_retiredItems.size() > TIMER_RETAINED_FINISHED)
+            {
+                unsigned int timerId = m_retiredItems.front();
+                m_retiredItems.pop_front();
+                return timerId;
             }
 
-            if (minTimeout < TIMER_ACCURACY)
-                minTimeout = TIMER_ACCURACY;
+            TimerItem item;
+            item.state = INITIAL;
+            item.generation = 0;
+            m_timerItems.push_back(item);
+            return m_timerItems.size() - 1;
+        }
 
-            if (minTimeout < 100000)
+        void Timer::retireTimer(unsigned int timerId)
+        {
+            m_retiredItems.push_back(timerId);
+        }
+
+        // Drops heap entries invalidated by cancel/suspend once they outnumber the live ones.
+        void Timer::compactDeadlines()
+        {
+            if (m_deadlines.size() <= 2 * m_runningCount + TIMER_STALE_DEADLINES_LIMIT)
+                return;
+
+            std::vector<TimerDeadline> live;
+            live.reserve(2 * m_runningCount);
+            while (!m_deadlines.empty())
             {
-                if (!m_timer.isActive())
-                    m_timer.start(int(minTimeout * 1000));
-                else
-                    m_timer.setInterval(int(minTimeout * 1000));
+                const TimerDeadline& entry = m_deadlines.top();
+                if (entry.generation == m_timerItems[entry.timerId].generation && RUNNING == m_timerItems[entry.timerId].state)
+                    live.push_back(entry);
+                m_deadlines.pop();
             }
-            else
-                m_timer.stop();
+
+            m_deadlines = std::priority_queue <TimerDeadline, std::vector<TimerDeadline>, std::greater<TimerDeadline> >(std::greater<TimerDeadline>(), std::move(live));
         }
 
         void Timer::startTimer(int timerId)
         {
-            m_runningItems.push_back(timerId);
-            m_timerItems[timerId].state = RUNNING;
+            TimerItem& item = m_timerItems[timerId];
 
-            m_timerItems[timerId].lastExpired = std::chrono::system_clock::now();
-            m_timerItems[timerId].lastExpiryReminder = std::chrono::system_clock::now();
-            m_timerItems[timerId].reminderSent = false;
+            item.generation++;
+            item.state = RUNNING;
+            item.lastExpired = std::chrono::steady_clock::now();
+            item.lastExpiryReminder = item.lastExpired;
+            item.reminderSent = false;
+            m_runningCount++;
 
-            checkTimers();
+            scheduleTimer(timerId);
         }
 
         bool Timer::cancelTimer(int timerId)
         {
-            m_timerItems[timerId].state = CANCELED;
+            TimerItem& item = m_timerItems[timerId];
+            TimerState previousState = item.state;
 
-            auto it = std::find(m_runningItems.begin(), m_runningItems.end(), timerId);
-            if (m_runningItems.end() != it)
+            item.generation++;
+            item.state = CANCELED;
+
+            // Expired timers are already waiting for their id to be reused.
+            if (EXPIRED != previousState)
+                retireTimer(timerId);
+
+            if (RUNNING == previousState)
             {
-                m_runningItems.erase(it);
-                m_timer.stop();
-                checkTimers();
+                m_runningCount--;
+                compactDeadlines();
                 return true;
             }
 
@@ -170,83 +225,116 @@ namespace WPEFramework
 
         bool Timer::suspendTimer(int timerId)
         {
-            m_timerItems[timerId].state = SUSPENDED;
+            TimerItem& item = m_timerItems[timerId];
+            TimerState previousState = item.state;
+
+            item.generation++;
+            item.state = SUSPENDED;
 
-            auto it = std::find(m_runningItems.begin(), m_runningItems.end(), timerId);
-            if (m_runningItems.end() != it)
+            if (RUNNING == previousState)
             {
-                m_runningItems.erase(it);
-                m_timer.stop();
-                checkTimers();
+                m_runningCount--;
+                compactDeadlines();
                 return true;
             }
 
             return false;
         }
 
-        void Timer::onTimerCallback()
+        // Pops every due deadline in one pass. m_callMutex must be held.
+        void Timer::processDeadlines(std::vector<TimerNotification>& notifications)
         {
-            std::lock_guard<std::mutex> guard(m_callMutex);
-
-            LOGINFO();
-
-            std::list <int> itemsToDelete;
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            std::chrono::steady_clock::time_point horizon = now + toDuration(TIMER_ACCURACY);
 
-            for (auto it = m_runningItems.cbegin(); it != m_runningItems.cend(); ++it)
+            while (!m_deadlines.empty() && m_deadlines.top().deadline <= horizon)
             {
-                unsigned int timerId = *it;
-                if (timerId < 0 || timerId >= m_timerItems.size())
-                {
-                    LOGERR("Internal error: wrong timerId");
-                    continue;
-                }
-                if (m_timerItems[timerId].state != RUNNING)
-                {
-                    LOGERR("Internal error: timer %d has wrong state", timerId);
+                TimerDeadline entry = m_deadlines.top();
+                m_deadlines.pop();
+
+                TimerItem& item = m_timerItems[entry.timerId];
+                if (entry.generation != item.generation || RUNNING != item.state)
                     continue;
-                }
 
-                std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - m_timerItems[timerId].lastExpired;
-                double timeout =  m_timerItems[timerId].interval - elapsed.count();
+                TimerNotification notification;
+                notification.timerId = entry.timerId;
+                notification.mode = item.mode;
+                notification.type = entry.type;
 
-                if (!m_timerItems[timerId].reminderSent && m_timerItems[timerId].remindBefore > TIMER_ACCURACY)
+                if (TIMER_EVENT_REMINDER == entry.type)
                 {
-                    if (timeout < m_timerItems[timerId].remindBefore + TIMER_ACCURACY)
+                    if (!item.reminderSent)
                     {
-                        sendTimerExpiryReminder(timerId);
-                        m_timerItems[timerId].reminderSent = true;
+                        std::chrono::duration<double> elapsed = now - item.lastExpired;
+                        notification.timeRemaining = (int)(item.interval - elapsed.count() + 0.5);
+                        item.reminderSent = true;
+                        item.lastExpiryReminder = now;
+                        notifications.push_back(notification);
                     }
+                    continue;
                 }
 
-                if (timeout <= TIMER_ACCURACY)
-                {
-                    sendTimerExpired(timerId);
-
-                    m_timerItems[timerId].lastExpired = std::chrono::system_clock::now();
+                notification.timeRemaining = 0;
+                notifications.push_back(notification);
+                item.reminderSent = false;
 
-                    if (m_timerItems[timerId].repeatInterval > 0)
-                    {
-                        m_timerItems[timerId].interval = m_timerItems[timerId].repeatInterval;
-                    }
+                if (item.repeatInterval > 0)
+                {
+                    item.interval = item.repeatInterval;
+                    // Keep repeating timers on their cadence unless a whole period was missed.
+                    if (now - entry.deadline < toDuration(item.interval))
+                        item.lastExpired = entry.deadline;
                     else
-                    {
-                        m_timerItems[timerId].state = EXPIRED;
-                        itemsToDelete.push_back(timerId);
-                    }
-
-                    m_timerItems[timerId].reminderSent = false;
+                        item.lastExpired = now;
+                    scheduleTimer(entry.timerId);
+                }
+                else
+                {
+                    item.lastExpired = now;
+                    item.state = EXPIRED;
+                    m_runningCount--;
+                    retireTimer(entry.timerId);
                 }
             }
+        }
 
-            for (auto delIt = itemsToDelete.cbegin(); delIt != itemsToDelete.cend(); ++delIt)
+        void Timer::sendNotifications(const std::vector<TimerNotification>& notifications)
+        {
+            for (auto it = notifications.cbegin(); it != notifications.cend(); ++it)
             {
-                auto it = std::find(m_runningItems.begin(), m_runningItems.end(), *delIt);
-                if (m_runningItems.end() != it)
-                    m_runningItems.erase(it);
-
+                if (TIMER_EVENT_EXPIRY == it->type)
+                    sendTimerExpired(*it);
+                else
+                    sendTimerExpiryReminder(*it);
             }
+        }
+
+        // Waits on the monotonic clock for the earliest deadline, so setting the wall clock
+        // (e.g. by NTP at boot) does not make timers fire early or late.
+        void Timer::dispatchLoop()
+        {
+            std::unique_lock<std::mutex> lock(m_callMutex);
+            while (!m_dispatchStop)
+            {
+                if (m_deadlines.empty())
+                    m_dispatchCondition.wait(lock);
+                else
+                    m_dispatchCondition.wait_until(lock, m_deadlines.top().deadline);
+
+                if (m_dispatchStop)
+                    break;
 
-            checkTimers();
+                std::vector<TimerNotification> notifications;
+                processDeadlines(notifications);
+
+                if (!notifications.empty())
+                {
+                    // Events are sent without the lock so API calls are not held up by delivery.
+                    lock.unlock();
+                    sendNotifications(notifications);
+                    lock.lock();
+                }
+            }
         }
 
         void Timer::getTimerStatus(int timerId, JsonObject& output, bool writeTimerId)
@@ -257,7 +345,7 @@ namespace WPEFramework
             output["state"] = stateStrings[m_timerItems[timerId].state];
             output["mode"] = modeStrings[m_timerItems[timerId].mode];
 
-            std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - m_timerItems[timerId].lastExpired;
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_timerItems[timerId].lastExpired;
             double timeRemaining =  m_timerItems[timerId].interval - elapsed.count();
 
             char buf[256];
@@ -287,7 +375,11 @@ namespace WPEFramework
             TimerItem item;
 
             item.state = INITIAL;
-            item.interval = std::stod(parameters["interval"].String());
+            if (!parseSeconds(parameters["interval"].String(), item.interval))
+            {
+                LOGERR("Bad \"interval\" %s", parameters["interval"].String().c_str());
+                returnResponse(false);
+            }
 
             item.mode = GENERIC;
             if (parameters.HasLabel("mode"))
@@ -298,13 +390,28 @@ namespace WPEFramework
                     item.mode = WAKE;
             }
 
-            item.repeatInterval = parameters.HasLabel("repeatInterval") ? std::stod(parameters["repeatInterval"].String()) : 0.0;
-            item.remindBefore = parameters.HasLabel("remindBefore") ? std::stod(parameters["remindBefore"].String()) : 0.0;
+            item.repeatInterval = 0.0;
+            if (parameters.HasLabel("repeatInterval") && !parseSeconds(parameters["repeatInterval"].String(), item.repeatInterval))
+            {
+                LOGERR("Bad \"repeatInterval\" %s", parameters["repeatInterval"].String().c_str());
+                returnResponse(false);
+            }
 
-            m_timerItems.push_back(item);
+            item.remindBefore = 0.0;
+            if (parameters.HasLabel("remindBefore") && !parseSeconds(parameters["remindBefore"].String(), item.remindBefore))
+            {
+                LOGERR("Bad \"remindBefore\" %s", parameters["remindBefore"].String().c_str());
+                returnResponse(false);
+            }
+
+            // Only now that every parameter is good, a reused slot keeps its generation so its stale
+            // deadlines stay stale
+            unsigned int timerId = allocateTimerId();
+            item.generation = m_timerItems[timerId].generation;
+            m_timerItems[timerId] = item;
 
-            startTimer(m_timerItems.size() - 1);
-            response["timerId"] = m_timerItems.size() - 1;
+            startTimer(timerId);
+            response["timerId"] = timerId;
 
             returnResponse(true);
         }
@@ -447,41 +554,38 @@ namespace WPEFramework
             returnResponse(true);
         }
 
-        void Timer::sendTimerExpired(int timerId)
+        void Timer::sendTimerExpired(const TimerNotification& notification)
         {
 #if defined(USE_IARMBUS) || defined(USE_IARM_BUS)
-            if (SLEEP == m_timerItems[timerId].mode || WAKE == m_timerItems[timerId].mode)
+            if (SLEEP == notification.mode || WAKE == notification.mode)
             {
                 // Taken from power iarm manager
                 IARM_Bus_CECMgr_Send_Param_t dataToSend;
                 unsigned char buf[] = {0x30, 0x36}; //standby msg, from TUNER to TV
 
-                if (WAKE == m_timerItems[timerId].mode)
+                if (WAKE == notification.mode)
                     buf[1] = 0x4; // Image On instead of Standby
 
                 memset(&dataToSend, 0, sizeof(dataToSend));
                 dataToSend.length = sizeof(buf);
                 memcpy(dataToSend.data, buf, dataToSend.length);
-                LOGINFO("Timer send CEC %s", SLEEP == m_timerItems[timerId].mode ? "Standby" : "Wake");
+                LOGINFO("Timer send CEC %s", SLEEP == notification.mode ? "Standby" : "Wake");
                 IARM_Bus_Call(IARM_BUS_CECMGR_NAME,IARM_BUS_CECMGR_API_Send,(void *)&dataToSend, sizeof(dataToSend));
             }
 #endif
             JsonObject params;
-            params["timerId"] = timerId;
-            params["mode"] = modeStrings[m_timerItems[timerId].mode];
+            params["timerId"] = notification.timerId;
+            params["mode"] = modeStrings[notification.mode];
             params["status"] = 0;
             sendNotify(TIMER_EVT_TIMER_EXPIRED, params);
         }
 
-        void Timer::sendTimerExpiryReminder(int timerId)
+        void Timer::sendTimerExpiryReminder(const TimerNotification& notification)
         {
             JsonObject params;
-            params["timerId"] = timerId;
-            params["mode"] = modeStrings[m_timerItems[timerId].mode];
-
-            std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - m_timerItems[timerId].lastExpired;
-
-            params["timeRemaining"] = (int)(m_timerItems[timerId].interval - elapsed.count() + 0.5);
+            params["timerId"] = notification.timerId;
+            params["mode"] = modeStrings[notification.mode];
+            params["timeRemaining"] = notification.timeRemaining;
             sendNotify(TIMER_EVT_TIMER_EXPIRY_REMINDER, params);
         }
     } // namespace Plugin
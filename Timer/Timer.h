@@ -20,14 +20,15 @@
 #pragma once
 
 #include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <queue>
+#include <deque>
 
 #include "Module.h"
 #include "utils.h"
 #include "AbstractPlugin.h"
 
-
-#include "tptimer.h"
-
 namespace WPEFramework {
 
     namespace Plugin {
@@ -52,9 +53,38 @@ namespace WPEFramework {
             TimerMode mode;
             double repeatInterval;
             double remindBefore;
-            std::chrono::system_clock::time_point lastExpired;
-            std::chrono::system_clock::time_point lastExpiryReminder;
+            std::chrono::steady_clock::time_point lastExpired;
+            std::chrono::steady_clock::time_point lastExpiryReminder;
             bool reminderSent;
+            // Bumped on every start/cancel/suspend; queue entries of an older generation are stale.
+            uint32_t generation;
+        };
+
+        enum TimerEventType {
+            TIMER_EVENT_REMINDER,
+            TIMER_EVENT_EXPIRY,
+        };
+
+        // Deadline kept in the min-heap. Cancel and suspend do not search the heap,
+        // they invalidate the entry through TimerItem::generation instead.
+        struct TimerDeadline {
+            std::chrono::steady_clock::time_point deadline;
+            unsigned int timerId;
+            uint32_t generation;
+            TimerEventType type;
+
+            bool operator>(const TimerDeadline& other) const
+            {
+                return deadline > other.deadline;
+            }
+        };
+
+        // Notification collected under the lock and sent once it is released.
+        struct TimerNotification {
+            unsigned int timerId;
+            TimerMode mode;
+            TimerEventType type;
+            int timeRemaining;
         };
 
 		// This is a server for a JSONRPC communication channel.
@@ -86,17 +116,22 @@ namespace WPEFramework {
             //End methods
 
             //Begin events
-            void sendTimerExpired(int timerId);
-            void sendTimerExpiryReminder(int timerId);
+            void sendTimerExpired(const TimerNotification& notification);
+            void sendTimerExpiryReminder(const TimerNotification& notification);
             //End events
 
-            void checkTimers();
+            void scheduleTimer(unsigned int timerId);
+            unsigned int allocateTimerId();
+            void compactDeadlines();
 
             void startTimer(int timerId);
             bool cancelTimer(int timerId);
             bool suspendTimer(int timerId);
+            void retireTimer(unsigned int timerId);
 
-            void onTimerCallback();
+            void dispatchLoop();
+            void processDeadlines(std::vector<TimerNotification>& notifications);
+            void sendNotifications(const std::vector<TimerNotification>& notifications);
             void getTimerStatus(int timerId, JsonObject& output, bool writeTimerId = false);
 
         public:
@@ -106,10 +141,15 @@ namespace WPEFramework {
         public:
             static Timer* _instance;
         private:
-            TpTimer m_timer;
             std::vector <TimerItem> m_timerItems;
-            std::list <int> m_runningItems;
+            // Canceled/expired timers stay queryable until their id is reused, oldest first.
+            std::deque <unsigned int> m_retiredItems;
+            std::priority_queue <TimerDeadline, std::vector<TimerDeadline>, std::greater<TimerDeadline> > m_deadlines;
+            size_t m_runningCount;
             std::mutex m_callMutex;
+            std::condition_variable m_dispatchCondition;
+            std::thread m_dispatchThread;
+            bool m_dispatchStop;
         };
 	} // namespace Plugin
 } // namespace WPEFramework
@@ -17,6 +17,12 @@
  * limitations under the License.
  **/
 
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
 #include "RtXcastConnector.h"
 #include "utils.h"
 
@@ -26,7 +32,8 @@ using namespace WPEFramework;
 #define LOCATE_CAST_SECOND_TIMEOUT_IN_MILLIS 15000  //15 seconds
 #define LOCATE_CAST_THIRD_TIMEOUT_IN_MILLIS  30000  //30 seconds
 #define LOCATE_CAST_FINAL_TIMEOUT_IN_MILLIS  60000  //60 seconds
-#define EVENT_LOOP_ITERATION_IN_100MS     100000
+//Used only when rtRemote cannot signal queued items
+#define EVENT_LOOP_POLL_INTERVAL_IN_MS     100
 
 static rtObjectRef xdialCastObj = NULL;
 RtXcastConnector * RtXcastConnector::_instance = nullptr;
@@ -37,25 +44,98 @@ void RtXcastConnector::remoteDisconnectCallback( void* context) {
     observer->onRtServiceDisconnected();
 }
 
-void RtXcastConnector::processRtMessages(){
-    LOGINFO("Entering Event Loop");
+void RtXcastConnector::onRtQueueReady(void *context){
+    RtXcastConnector * connector = static_cast<RtXcastConnector *> (context);
+    uint64_t value = 1;
+    if (write(connector->m_queueEventFd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+        LOGERR("Failed to signal Rt queue: %d", errno);
+    }
+}
+
+void RtXcastConnector::drainRtQueue(){
     while(true)
     {
         rtError err = rtRemoteProcessSingleItem();
-        if (err != RT_OK && err != RT_ERROR_QUEUE_EMPTY) {
+        if (err == RT_ERROR_QUEUE_EMPTY)
+            break;
+        if (err != RT_OK) {
             LOGERR("Failed to gete item from Rt queue");
+            break;
+        }
+    }
+}
+
+bool RtXcastConnector::createEventFds(){
+    m_queueEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_shutdownEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_queueEventFd < 0 || m_shutdownEventFd < 0 || m_epollFd < 0) {
+        LOGERR("Failed to create event descriptors: %d", errno);
+        closeEventFds();
+        return false;
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = m_queueEventFd;
+    bool status = (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_queueEventFd, &event) == 0);
+    event.data.fd = m_shutdownEventFd;
+    status = status && (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_shutdownEventFd, &event) == 0);
+    if (!status) {
+        LOGERR("Failed to register event descriptors: %d", errno);
+        closeEventFds();
+    }
+    return status;
+}
+
+void RtXcastConnector::closeEventFds(){
+    if (m_epollFd >= 0)
+        close(m_epollFd);
+    if (m_queueEventFd >= 0)
+        close(m_queueEventFd);
+    if (m_shutdownEventFd >= 0)
+        close(m_shutdownEventFd);
+    m_epollFd = m_queueEventFd = m_shutdownEventFd = -1;
+}
+
+void RtXcastConnector::processRtMessages(){
+    LOGINFO("Entering Event Loop");
+    /*
+     Block until rtRemote queues an item or shutdown() is called instead of
+     polling; fall back to polling if the queue ready handler is unavailable.
+    */
+    int timeout = -1;
+    if (rtRemoteRegisterQueueReadyHandler(rtEnvironmentGetGlobal(), &RtXcastConnector::onRtQueueReady, this) != RT_OK) {
+        LOGWARN("Rt queue ready handler not available, polling every %d ms", EVENT_LOOP_POLL_INTERVAL_IN_MS);
+        timeout = EVENT_LOOP_POLL_INTERVAL_IN_MS;
+    }
+
+    // Items may have been queued before the handler was registered.
+    drainRtQueue();
+    while(true)
+    {
+        struct epoll_event events[2];
+        int count = epoll_wait(m_epollFd, events, 2, timeout);
+        if (count < 0 && errno != EINTR) {
+            LOGERR("epoll_wait failed: %d", errno);
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            uint64_t value;
+            if (read(events[i].data.fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+                LOGERR("Failed to read event descriptor: %d", errno);
+            }
         }
         {
             //Queue needs to be deactivated ?
             lock_guard<mutex> lock(m_threadlock);
             if (!m_runEventThread ) break;
         }
-        /*
-         Ideally this should be part of wpe process main message loop,
-         will reconsider once we decide on connectivity with dial server
-        */
-        usleep(EVENT_LOOP_ITERATION_IN_100MS);
+        drainRtQueue();
     }
+    rtRemoteRegisterQueueReadyHandler(rtEnvironmentGetGlobal(), nullptr, nullptr);
     LOGINFO("Exiting Event Loop");
 }
 void RtXcastConnector::threadRun(RtXcastConnector *rtCtx){
@@ -251,10 +331,13 @@ bool RtXcastConnector::initialize()
     if(err != RT_OK){
         LOGINFO("Xcastservice: rtRemoteInit failed : Reason %s", rtStrError(err));
     }
-    else {
+    else if (createEventFds()) {
         m_runEventThread = true;
         m_eventMtrThread = std::thread(threadRun, this);
     }
+    else {
+        err = RT_FAIL;
+    }
     return (err == RT_OK) ? true:false;
 }
 void RtXcastConnector::shutdown()
@@ -264,8 +347,14 @@ void RtXcastConnector::shutdown()
         lock_guard<mutex> lock(m_threadlock);
         m_runEventThread = false;
     }
+    if (m_shutdownEventFd >= 0) {
+        uint64_t value = 1;
+        if (write(m_shutdownEventFd, &value, sizeof(value)) < 0)
+            LOGERR("Failed to signal event thread: %d", errno);
+    }
     if (m_eventMtrThread.joinable())
-        m_eventMtrThread.join();    
+        m_eventMtrThread.join();
+    closeEventFds();
 
     rtRemoteShutdown(rtEnvironmentGetGlobal());
 }
@@ -31,7 +31,7 @@ using namespace std;
  */
 class RtXcastConnector {
 protected:
-    RtXcastConnector():m_runEventThread(true){
+    RtXcastConnector():m_runEventThread(true), m_queueEventFd(-1), m_shutdownEventFd(-1), m_epollFd(-1){
         }
 public:
     virtual ~RtXcastConnector();
@@ -78,8 +78,17 @@ private:
     mutex m_threadlock;
     // Boolean event thread exit condition
     bool m_runEventThread;
+    // Signalled by rtRemote whenever an item is queued
+    int m_queueEventFd;
+    // Signalled by shutdown() to stop the event thread
+    int m_shutdownEventFd;
+    int m_epollFd;
     // Member function to handle RT messages.
     void processRtMessages();
+    // Processes every queued rtRemote item
+    void drainRtQueue();
+    bool createEventFds();
+    void closeEventFds();
 
 
     // Class level contracts
@@ -87,6 +96,8 @@ private:
     static RtXcastConnector * _instance;
     // Thread main function
     static void threadRun(RtXcastConnector *rtCtx);
+    // rtRemote queue ready handler
+    static void onRtQueueReady(void *context);
 
     static rtError onApplicationLaunchRequestCallback(int numArgs, const rtValue* args, rtValue* result, void* context);
     static rtError onApplicationHideRequestCallback(int numArgs, const rtValue* args, rtValue* result, void* context);
@@ -0,0 +1,3 @@
+find_package(PkgConfig)
+
+pkg_search_module(WEBP libwebp)
@@ -0,0 +1,197 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2019 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#include "EdidCache.h"
+#include <algorithm>
+#include "utils.h"
+
+#include "host.hpp"
+#include "exception.hpp"
+#include "videoOutputPort.hpp"
+
+#define EDID_BLOCK_SIZE             128
+#define EDID_DETAILED_TIMING        54
+#define EDID_DESCRIPTOR_SIZE        18
+#define EDID_DESCRIPTOR_COUNT       4
+
+#define EDID_DISPLAY_NAME           0xFC
+
+namespace WPEFramework
+{
+
+    namespace Plugin
+    {
+
+        static bool checksumValid(const uint8_t* block)
+        {
+            uint8_t sum = 0;
+            for (int i = 0; i < EDID_BLOCK_SIZE; i++)
+                sum += block[i];
+            return sum == 0;
+        }
+
+        /* Text descriptors are up to 13 characters, terminated by a line feed and padded with spaces */
+        static std::string readDescriptorText(const uint8_t* text)
+        {
+            std::string value;
+            for (int i = 0; i < 13 && text[i] != '\n' && text[i] != '\0'; i++)
+                value += static_cast<char>(text[i]);
+            while (!value.empty() && value[value.size() - 1] == ' ')
+                value.erase(value.size() - 1);
+            return value;
+        }
+
+        static void parseBaseBlock(const uint8_t* block, EdidInfo& info)
+        {
+            uint16_t id = (block[8] << 8) | block[9];
+            info.manufacturer += static_cast<char>('A' - 1 + ((id >> 10) & 0x1F));
+            info.manufacturer += static_cast<char>('A' - 1 + ((id >> 5) & 0x1F));
+            info.manufacturer += static_cast<char>('A' - 1 + (id & 0x1F));
+
+            info.productCode = block[10] | (block[11] << 8);
+            info.widthCm = block[21];
+            info.heightCm = block[22];
+
+            for (int i = 0; i < EDID_DESCRIPTOR_COUNT; i++)
+            {
+                const uint8_t* descriptor = block + EDID_DETAILED_TIMING + i * EDID_DESCRIPTOR_SIZE;
+
+                // Detailed timings have a non-zero pixel clock, display descriptors do not
+                if (descriptor[0] || descriptor[1])
+                    continue;
+
+                if (descriptor[3] == EDID_DISPLAY_NAME)
+                    info.monitorName = readDescriptorText(descriptor + 5);
+            }
+        }
+
+        EdidInfo::EdidInfo()
+            : valid(false)
+            , productCode(0)
+            , widthCm(0)
+            , heightCm(0)
+        {
+        }
+
+        bool parseEdid(const std::vector<uint8_t>& edid, EdidInfo& info)
+        {
+            static const uint8_t header[] = { 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00 };
+
+            info = EdidInfo();
+
+            if (edid.size() < EDID_BLOCK_SIZE || !std::equal(header, header + sizeof(header), edid.begin()))
+            {
+                LOGWARN("No EDID base block (%d bytes)", (int)edid.size());
+                return false;
+            }
+            if (!checksumValid(&edid[0]))
+            {
+                LOGWARN("EDID base block checksum mismatch");
+                return false;
+            }
+
+            parseBaseBlock(&edid[0], info);
+            info.valid = true;
+
+            return true;
+        }
+
+        EdidCache* EdidCache::instance()
+        {
+            static EdidCache cache;
+            return &cache;
+        }
+
+        EdidCache::EdidCache()
+            : m_cached(false)
+            , m_connected(false)
+        {
+        }
+
+        bool EdidCache::connected()
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            refreshLocked();
+            return m_connected;
+        }
+
+        bool EdidCache::getBytes(std::vector<uint8_t>& edid)
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            // Bytes that do not parse are still handed out, only not cached
+            refreshLocked();
+            if (m_bytes.empty())
+                return false;
+            edid = m_bytes;
+            return true;
+        }
+
+        bool EdidCache::getInfo(EdidInfo& info)
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (!refreshLocked() || !m_info.valid)
+                return false;
+            info = m_info;
+            return true;
+        }
+
+        void EdidCache::invalidate()
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_cached = false;
+        }
+
+        bool EdidCache::refreshLocked()
+        {
+            if (m_cached)
+                return true;
+
+            m_connected = false;
+            m_bytes.clear();
+            m_info = EdidInfo();
+
+            try
+            {
+                device::VideoOutputPort vPort = device::Host::getInstance().getVideoOutputPort("HDMI0");
+                if (vPort.isDisplayConnected())
+                {
+                    m_connected = true;
+                    vPort.getDisplay().getEDIDBytes(m_bytes);
+                    if (!parseEdid(m_bytes, m_info))
+                    {
+                        // Often read while the sink is still coming up, try again on the next query
+                        LOGWARN("Unusable EDID (%d bytes), not cached", (int)m_bytes.size());
+                        return false;
+                    }
+                    LOGINFO("Read %d EDID bytes from %s %s", (int)m_bytes.size(), m_info.manufacturer.c_str(), m_info.monitorName.c_str());
+                }
+            }
+            catch (const device::Exception& err)
+            {
+                LOG_DEVICE_EXCEPTION0();
+                m_bytes.clear();
+                return false;
+            }
+
+            m_cached = true;
+            return true;
+        }
+
+    } // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,88 @@
+/**
+* If not stated otherwise in this file or this component's LICENSE
+* file the following copyright and licenses apply:
+*
+* Copyright 2019 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+**/
+
+#pragma once
+
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace WPEFramework
+{
+
+    namespace Plugin
+    {
+
+        /*
+         * What the plugins need from a sink's EDID, taken from the base block only.
+         */
+        struct EdidInfo
+        {
+            EdidInfo();
+
+            bool valid;                     /* Base block header and checksum are good */
+
+            std::string manufacturer;       /* Three letter PNP id */
+            uint16_t productCode;
+            std::string monitorName;
+            uint8_t widthCm;                /* 0 if undefined */
+            uint8_t heightCm;
+        };
+
+        /*
+         * Parses raw EDID bytes. Returns false (and info.valid false) if the base block is not usable,
+         * extension blocks are not looked at.
+         */
+        bool parseEdid(const std::vector<uint8_t>& edid, EdidInfo& info);
+
+        /*
+         * The EDID of the display on HDMI0, read from the sink once and handed out from memory
+         * afterwards. Whoever owns the hotplug event handler calls invalidate() so the next query
+         * reads the new sink; a failed read or an EDID that does not parse is not cached and retried
+         * on the next query.
+         */
+        class EdidCache
+        {
+        public:
+            static EdidCache* instance();
+
+            bool connected();
+            /* False if no display is connected or its EDID could not be read */
+            bool getBytes(std::vector<uint8_t>& edid);
+            bool getInfo(EdidInfo& info);
+
+            void invalidate();
+
+        private:
+            EdidCache();
+            EdidCache(const EdidCache&) = delete;
+            EdidCache& operator=(const EdidCache&) = delete;
+
+            bool refreshLocked();
+
+            std::mutex m_lock;
+            bool m_cached;
+            bool m_connected;
+            std::vector<uint8_t> m_bytes;
+            EdidInfo m_info;
+        };
+
+    } // namespace Plugin
+} // namespace WPEFramework
@@ -20,14 +20,39 @@
 
 #include <iostream>
 #include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
 #include "cSettings.h"
 #include "SystemServicesHelper.h"
 
+/***
+ * @brief    : Write the whole buffer to a file descriptor.
+ * @return  : <bool> True if every byte was written.
+ */
+static bool writeAll(int fd, const std::string& buffer)
+{
+    size_t offset = 0;
+    while (offset < buffer.size()) {
+        ssize_t written = write(fd, buffer.data() + offset, buffer.size() - offset);
+        if (written < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            return false;
+        }
+        offset += written;
+    }
+    return true;
+}
+
 /***
  * @brief    : Constructor.
  * @return  : nil.
  */
 cSettings::cSettings(std::string file)
+    : m_logEntries(0)
+    , m_liveEntries(0)
 {
     filename = file;
     if (!readFromFile()) {
@@ -40,6 +65,8 @@ cSettings::cSettings(std::string file)
             fs << flush;
             fs.close();
         }
+    } else if (m_logEntries > ((2 * m_liveEntries) + CSETTINGS_COMPACTION_SLACK)) {
+        writeToFile();
     }
 }
 
@@ -60,19 +87,35 @@ bool cSettings::readFromFile()
 {
     bool retStatus = false;
     std::string content;
+    std::lock_guard<std::mutex> lock(m_lock);
     if (!Utils::fileExists(filename.c_str())) {
         return retStatus;
     }
     fstream ifile(filename,ios::in);
     if (ifile) {
+        m_logEntries = 0;
         while (!ifile.eof()) {
             std::getline(ifile,content);
+            if (ifile.eof() && !content.empty()) {
+                /* No newline after the last record: a write torn by a crash, its value can't be trusted. */
+                std::cout << "Warning:[cSettings] ignoring incomplete last record in " << filename << std::endl;
+                break;
+            }
             size_t pos = content.find_last_of("=");
-            if (std::string::npos != pos) {
+            if ((std::string::npos != pos) && (0 != pos)) {
+                /* Later entries supersede earlier ones; "key=" is a tombstone. */
                 data[(content.substr(0, pos).c_str())] = content.substr(pos+1,std::string::npos);
+                m_logEntries++;
             }
             retStatus = true;
         }
+        m_liveEntries = 0;
+        JsonObject::Iterator iterator = data.Variants();
+        while (iterator.Next()) {
+            if (!data[iterator.Label()].String().empty()) {
+                m_liveEntries++;
+            }
+        }
     } else {
         //Do nothing.
     }
@@ -80,34 +123,121 @@ bool cSettings::readFromFile()
 }
 
 /***
- * @brief    : Update new inserts into the json object onto file.
- * @return  : <bool> False if timer thread couldn't be started.
+ * @brief    : Rewrite (compact) the whole file from the json object.
+ * @return  : <bool> False if the file couldn't be written, else True.
  */
 bool cSettings::writeToFile()
 {
-    bool status = false;
-
-    if (Utils::fileExists(filename.c_str())) {
-        ofstream ofile;
-        ofile.open(filename.c_str(),ios::out);
-        if (ofile) {
-            JsonObject::Iterator iterator = data.Variants();
-            while (iterator.Next()) {
-                if (!data[iterator.Label()].String().empty()) {
-                    ofile << iterator.Label() << "=" << data[iterator.Label()].String() << endl;
-                } else {
-                    continue;
-                }
-            }
-            status = true;
-            ofile.close();
-        } else {
-            status = false;
+    std::lock_guard<std::mutex> lock(m_lock);
+    return writeToFileLocked();
+}
+
+/***
+ * @brief    : Rewrite the file through a temp file and rename, so a power
+ *             loss leaves either the old or the new file. m_lock must be held.
+ * @return  : <bool> False if the file couldn't be written, else True.
+ */
+bool cSettings::writeToFileLocked()
+{
+    std::string buffer;
+    size_t entries = 0;
+    JsonObject::Iterator iterator = data.Variants();
+    while (iterator.Next()) {
+        std::string value = data[iterator.Label()].String();
+        if (!value.empty()) {
+            buffer += iterator.Label();
+            buffer += "=";
+            buffer += value;
+            buffer += "\n";
+            entries++;
         }
     }
+
+    std::string tmpFile = filename + ".tmp";
+    int fd = open(tmpFile.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool status = writeAll(fd, buffer) && (0 == fsync(fd));
+    close(fd);
+    if (status && (0 == rename(tmpFile.c_str(), filename.c_str()))) {
+        m_logEntries = entries;
+        m_liveEntries = entries;
+    } else {
+        unlink(tmpFile.c_str());
+        status = false;
+    }
     return status;
 }
 
+/***
+ * @brief    : Append records to the log and compact it when superseded
+ *             entries outweigh the live ones. m_lock must be held.
+ * @param1[in]  : <string> "key=value\n" records
+ * @param2[in]  : <size_t> number of records
+ * @return  : <bool> True if the records were persisted.
+ */
+bool cSettings::appendToFile(const std::string& records, size_t count)
+{
+    if (records.empty()) {
+        return true;
+    }
+    int fd = open(filename.c_str(), O_RDWR|O_CREAT|O_APPEND, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    /* Terminate a record torn by a crash, so it doesn't run into the first one appended now. */
+    std::string buffer;
+    off_t size = lseek(fd, 0, SEEK_END);
+    char last = '\n';
+    if ((size > 0) && (1 == pread(fd, &last, 1, size - 1)) && ('\n' != last)) {
+        buffer = "\n";
+    }
+    buffer += records;
+    /* One write per update keeps the record from interleaving with others. */
+    bool status = writeAll(fd, buffer) && (0 == fsync(fd));
+    close(fd);
+    if (!status) {
+        return false;
+    }
+    m_logEntries += count;
+    if (m_logEntries > ((2 * m_liveEntries) + CSETTINGS_COMPACTION_SLACK)) {
+        /* The appended records are already durable; a failed compaction is retried later. */
+        writeToFileLocked();
+    }
+    return true;
+}
+
+/***
+ * @brief        : Update the json object and build the log record. m_lock must be held.
+ * @param1[in]  : <string> key
+ * @param2[in] : <JsonValue> value; empty removes the key
+ * @param3[out] : <string> record appended to
+ * @return        : <bool> True if the key is valid.
+ */
+bool cSettings::setValueLocked(const std::string& key, const JsonValue& value, std::string& record)
+{
+    if (key.empty() || (std::string::npos != key.find('\n'))) {
+        return false;
+    }
+    bool existed = (data.HasLabel(key.c_str()) && !data[key.c_str()].String().empty());
+    data[key.c_str()] = value;
+    std::string stored = data[key.c_str()].String();
+    if (stored.empty()) {
+        data.Remove(key.c_str());
+        if (existed) {
+            m_liveEntries--;
+        }
+    } else if (!existed) {
+        m_liveEntries++;
+    }
+    record += key;
+    record += "=";
+    record += stored;
+    record += "\n";
+    return true;
+}
+
 /***
  * @brief        : Get value of given key.
  * @param1[in]  : <string> key
@@ -115,6 +245,7 @@ bool cSettings::writeToFile()
  */
 JsonValue cSettings::getValue(std::string key)
 {
+    std::lock_guard<std::mutex> lock(m_lock);
     return data.Get(key.c_str());
 }
 
@@ -126,8 +257,9 @@ JsonValue cSettings::getValue(std::string key)
  */
 bool cSettings::setValue(std::string key,std::string value)
 {
-    data[key.c_str()] = value;
-    return writeToFile();
+    std::string record;
+    std::lock_guard<std::mutex> lock(m_lock);
+    return setValueLocked(key, JsonValue(value), record) && appendToFile(record, 1);
 }
 
 /***
@@ -138,8 +270,9 @@ bool cSettings::setValue(std::string key,std::string value)
  */
 bool cSettings::setValue(std::string key,int value)
 {
-    data[key.c_str()] = value;
-    return writeToFile();
+    std::string record;
+    std::lock_guard<std::mutex> lock(m_lock);
+    return setValueLocked(key, JsonValue(value), record) && appendToFile(record, 1);
 }
 
 /***
@@ -150,8 +283,31 @@ bool cSettings::setValue(std::string key,int value)
  */
 bool cSettings::setValue(std::string key,bool value)
 {
-    data[key.c_str()] = value;
-    return writeToFile();
+    std::string record;
+    std::lock_guard<std::mutex> lock(m_lock);
+    return setValueLocked(key, JsonValue(value), record) && appendToFile(record, 1);
+}
+
+/***
+ * @brief        : Set several key-value pairs with a single file update.
+ * @param1[in]  : <JsonObject> key-value pairs; an empty value removes the key
+ * @return        : <bool> True if all values were stored, else False
+ */
+bool cSettings::setValues(const JsonObject& values)
+{
+    bool status = true;
+    size_t count = 0;
+    std::string records;
+    std::lock_guard<std::mutex> lock(m_lock);
+    JsonObject::Iterator iterator = values.Variants();
+    while (iterator.Next()) {
+        if (setValueLocked(iterator.Label(), iterator.Current(), records)) {
+            count++;
+        } else {
+            status = false;
+        }
+    }
+    return appendToFile(records, count) && status;
 }
 
 /***
@@ -162,6 +318,7 @@ bool cSettings::setValue(std::string key,bool value)
 bool cSettings::contains(std::string key)
 {
     bool resp = false;
+    std::lock_guard<std::mutex> lock(m_lock);
     if (data.HasLabel(key.c_str())) {
         if (data[key.c_str()].String().empty()) {
             resp = false;
@@ -181,24 +338,12 @@ bool cSettings::contains(std::string key)
  */
 bool cSettings::remove(std::string key)
 {
-    bool status = false;
+    std::string record;
+    std::lock_guard<std::mutex> lock(m_lock);
     /*
      * Noticed that there is an error with the Remove function.
      * work around is to assign a null value to the key and handle it
-     * accordingly.
+     * accordingly; the "key=" record doubles as the log tombstone.
      */
-    data[key.c_str()] = "";
-    data.Remove(key.c_str());
-    if (!contains(key)) {
-        if (writeToFile()) {
-            status = true;
-        } else {
-            status = false;
-        }
-    }
-    else {
-        status = false;
-    }
-    return status;
+    return setValueLocked(key, JsonValue(""), record) && appendToFile(record, 1);
 }
-
@@ -18,14 +18,35 @@
 **/
 
 #include <string>
+#include <mutex>
 #include <stdlib.h>
 #include <plugins/plugins.h>
 
 using namespace std;
 
+/*
+ * Number of superseded log entries tolerated on top of twice the number of
+ * live keys before the settings file is compacted.
+ */
+#define CSETTINGS_COMPACTION_SLACK 32
+
+/*
+ * The settings file is an append-only log of "key=value" lines; the last
+ * entry of a key wins and "key=" is a tombstone. Updates append a single
+ * record and the log is rewritten atomically (temp file + rename) once the
+ * superseded entries outweigh the live ones, so each update costs O(1)
+ * amortised bytes on flash.
+ */
 class cSettings {
     std::string filename;
     JsonObject data;
+    std::mutex m_lock;
+    size_t m_logEntries;
+    size_t m_liveEntries;
+
+    bool setValueLocked(const std::string& key, const JsonValue& value, std::string& record);
+    bool appendToFile(const std::string& records, size_t count);
+    bool writeToFileLocked();
     public:
     /***
      * @brief    : Constructor.
@@ -70,6 +91,13 @@ class cSettings {
      */
     bool setValue(std::string key,bool value);
 
+    /***
+     * @brief        : Set several key-value pairs with a single file update.
+     * @param1[in]   : <JsonObject> key-value pairs; an empty value removes the key
+     * @return       : <bool> True if all values were stored, else False
+     */
+    bool setValues(const JsonObject& values);
+
     /***
      * @brief        : Check if a particular key is set.
      * @param1[in]   : <string> key
@@ -85,8 +113,8 @@ class cSettings {
     bool remove(std::string key);
 
     /***
-     * @brief    : Update new inserts into the json object onto file.
-     * @return   : <bool> False if timer thread couldn't be started.
+     * @brief    : Rewrite (compact) the whole file from the json object.
+     * @return   : <bool> False if the file couldn't be written, else True.
      */
     bool writeToFile();
 